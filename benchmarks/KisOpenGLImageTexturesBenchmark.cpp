@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisOpenGLImageTexturesBenchmark.h"
+
+#include <QTest>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_image.h"
+#include "kis_paint_device.h"
+#include "kis_sequential_iterator.h"
+#include "opengl/kis_opengl_image_textures.h"
+
+namespace {
+
+const int IMAGE_WIDTH = 4096;
+const int IMAGE_HEIGHT = 4096;
+
+KisImageSP createNoiseImage(const KoColorSpace *cs)
+{
+    KisImageSP image = new KisImage(0, IMAGE_WIDTH, IMAGE_HEIGHT, cs, "textures benchmark");
+
+    // the projection is filled directly, the textures don't care about the layers
+    KisPaintDeviceSP projection = image->projection();
+    const int pixelSize = cs->pixelSize();
+
+    KisSequentialIterator it(projection, image->bounds());
+    do {
+        quint8 *dst = it.rawData();
+        for (int i = 0; i < pixelSize; i++) {
+            dst[i] = qrand() & 0xff;
+        }
+    } while (it.nextPixel());
+
+    return image;
+}
+
+void runUpdateCache(const KoColorSpace *srcCS, const QRect &updateRect)
+{
+    KisImageSP image = createNoiseImage(srcCS);
+
+    KisOpenGLImageTexturesSP textures =
+        KisOpenGLImageTextures::getImageTextures(image, 0,
+                                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                                 KoColorConversionTransformation::internalConversionFlags());
+
+    textures->testingInitHeadless(KoColorSpaceRegistry::instance()->rgb8());
+
+    QBENCHMARK {
+        KisOpenGLUpdateInfoSP info = textures->updateCache(updateRect, image);
+        QVERIFY(!info->tileList.isEmpty());
+    }
+}
+
+}
+
+void KisOpenGLImageTexturesBenchmark::benchmarkFullUpdateNoConversion()
+{
+    runUpdateCache(KoColorSpaceRegistry::instance()->rgb8(), QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT));
+}
+
+void KisOpenGLImageTexturesBenchmark::benchmarkFullUpdateRgb16()
+{
+    runUpdateCache(KoColorSpaceRegistry::instance()->rgb16(), QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT));
+}
+
+void KisOpenGLImageTexturesBenchmark::benchmarkFullUpdateLab16()
+{
+    runUpdateCache(KoColorSpaceRegistry::instance()->lab16(), QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT));
+}
+
+void KisOpenGLImageTexturesBenchmark::benchmarkPartialUpdateRgb16()
+{
+    // a typical update of a brush stroke, covers only a few textures
+    runUpdateCache(KoColorSpaceRegistry::instance()->rgb16(), QRect(1000, 1000, 300, 300));
+}
+
+QTEST_MAIN(KisOpenGLImageTexturesBenchmark)
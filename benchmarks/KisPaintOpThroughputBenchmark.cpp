@@ -0,0 +1,389 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisPaintOpThroughputBenchmark.h"
+
+#include <QTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTabletEvent>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+
+#include <KoCanvasResourceManager.h>
+#include <KoPointerEvent.h>
+#include <resources/KoPattern.h>
+
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop_registry.h>
+#include <brushengine/kis_uniform_paintop_property.h>
+#include <kis_embedded_pattern_manager.h>
+#include <KisTracer.h>
+
+#include "kis_benchmark_values.h"
+#include "stroke_testing_utils.h"
+
+#include "kis_canvas_resource_provider.h"
+#include "kis_image.h"
+#include "kis_painting_information_builder.h"
+#include "kis_smoothing_options.h"
+#include "kis_tool_freehand_helper.h"
+#include "kundo2magicstring.h"
+#include "tiles3/kis_tile_data_store.h"
+
+
+namespace {
+
+const QSize imageSize(GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+const QStringList variants({"default", "size", "spacing", "texture", "colorsource", "mirror"});
+
+bool loadStrokes(const QString &fileName, QVector<KisPaintOpThroughputBenchmark::Stroke> *strokes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream stream(&file);
+
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        if (line == "stroke") {
+            strokes->append(KisPaintOpThroughputBenchmark::Stroke());
+            continue;
+        }
+
+        const QStringList values = line.split(' ', QString::SkipEmptyParts);
+        if (values.size() != 7 || strokes->isEmpty()) {
+            qWarning() << "Malformed tablet event:" << line;
+            return false;
+        }
+
+        KisPaintOpThroughputBenchmark::TabletEvent event;
+        event.time = values[0].toDouble();
+        event.pos = QPointF(values[1].toDouble(), values[2].toDouble());
+        event.pressure = values[3].toDouble();
+        event.xTilt = values[4].toDouble();
+        event.yTilt = values[5].toDouble();
+        event.rotation = values[6].toDouble();
+
+        strokes->last().append(event);
+    }
+
+    return !strokes->isEmpty();
+}
+
+KisPaintOpPresetSP loadDefaultPreset(const KoID &paintOp)
+{
+    KisPaintOpPresetSP preset =
+        new KisPaintOpPreset(QString(DEFAULT_PRESETS_DIR) + paintOp.id() + ".kpp");
+
+    if (!preset->load()) {
+        preset = KisPaintOpRegistry::instance()->defaultPreset(paintOp);
+    }
+
+    return preset;
+}
+
+KisUniformPaintOpPropertySP findUniformProperty(KisPaintOpPresetSP preset, const QString &id)
+{
+    Q_FOREACH (KisUniformPaintOpPropertySP prop, preset->uniformProperties()) {
+        if (prop->id() == id) {
+            return prop;
+        }
+    }
+
+    return KisUniformPaintOpPropertySP();
+}
+
+bool supportsVariant(const QString &variant, KisPaintOpPresetSP preset)
+{
+    if (variant == "spacing") {
+        return !findUniformProperty(preset, "spacing").isNull();
+    } else if (variant == "texture") {
+        return preset->settings()->hasProperty("Texture/Pattern/Enabled");
+    } else if (variant == "colorsource") {
+        return preset->settings()->hasProperty("ColorSource/Type");
+    }
+
+    return true;
+}
+
+QImage createTextureImage()
+{
+    QImage image(128, 128, QImage::Format_ARGB32);
+
+    qsrand(12345678);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            const int value = qrand() & 0xff;
+            image.setPixel(x, y, qRgb(value, value, value));
+        }
+    }
+
+    return image;
+}
+
+void applyVariant(const QString &variant, KisPaintOpPresetSP preset, KoCanvasResourceManager *manager)
+{
+    KisPaintOpSettingsSP settings = preset->settings();
+
+    if (variant == "size") {
+        settings->setPaintOpSize(200.0);
+    } else if (variant == "spacing") {
+        findUniformProperty(preset, "spacing")->setValue(0.05);
+    } else if (variant == "texture") {
+        KoPattern pattern(createTextureImage(), "paintop_benchmark_texture", QString());
+        KisEmbeddedPatternManager::saveEmbeddedPattern(settings, &pattern);
+        settings->setProperty("Texture/Pattern/Enabled", true);
+    } else if (variant == "colorsource") {
+        settings->setProperty("ColorSource/Type", "total_random");
+    } else if (variant == "mirror") {
+        manager->setResource(KisCanvasResourceProvider::MirrorHorizontal, true);
+        manager->setResource(KisCanvasResourceProvider::MirrorVertical, true);
+    }
+}
+
+qint64 tileMemory()
+{
+    return KisTileDataStore::instance()->memoryStatistics().totalMemorySize;
+}
+
+}
+
+void KisPaintOpThroughputBenchmark::initTestCase()
+{
+    QString strokesFileName = qgetenv("KRITA_PAINTOP_BENCHMARK_STROKES");
+    if (strokesFileName.isEmpty()) {
+        strokesFileName = QString(FILES_DATA_DIR) + "tablet_strokes.txt";
+    }
+
+    QVERIFY2(loadStrokes(strokesFileName, &m_strokes),
+             qPrintable(QString("Cannot load the strokes from %1").arg(strokesFileName)));
+
+    if (KisPaintOpRegistry::instance()->listKeys().isEmpty()) {
+        QSKIP("No paintop plugins found");
+    }
+
+#if HAVE_KIS_TRACING
+    // every dab of a case must fit into the buffers to be counted
+    KisTracer::instance()->setBufferCapacity(1 << 18);
+#endif
+}
+
+void KisPaintOpThroughputBenchmark::cleanupTestCase()
+{
+    if (m_results.isEmpty()) return;
+
+    QString outputFileName = qgetenv("KRITA_PAINTOP_BENCHMARK_OUTPUT");
+    if (outputFileName.isEmpty()) {
+        outputFileName = QString(FILES_OUTPUT_DIR) + QDir::separator() + "paintop_throughput.json";
+    }
+
+    QJsonObject image;
+    image["width"] = imageSize.width();
+    image["height"] = imageSize.height();
+
+    QJsonObject root;
+    root["benchmark"] = "paintop-throughput";
+    root["image"] = image;
+    root["threads"] = QThread::idealThreadCount();
+    root["tracing"] = bool(HAVE_KIS_TRACING);
+    root["results"] = m_results;
+
+    QFile file(outputFileName);
+    QVERIFY2(file.open(QIODevice::WriteOnly | QIODevice::Truncate),
+             qPrintable(QString("Cannot write the results to %1").arg(outputFileName)));
+    file.write(QJsonDocument(root).toJson());
+}
+
+void KisPaintOpThroughputBenchmark::benchmarkPaintOp_data()
+{
+    QTest::addColumn<QString>("paintOpId");
+    QTest::addColumn<QString>("variant");
+
+    QList<KoID> paintOps = KisPaintOpRegistry::instance()->listKeys();
+    std::sort(paintOps.begin(), paintOps.end(),
+              [] (const KoID &lhs, const KoID &rhs) {
+                  return lhs.id() < rhs.id();
+              });
+
+    Q_FOREACH (const KoID &paintOp, paintOps) {
+        KisPaintOpPresetSP preset = loadDefaultPreset(paintOp);
+        if (!preset || !preset->settings()) continue;
+
+        Q_FOREACH (const QString &variant, variants) {
+            if (!supportsVariant(variant, preset)) continue;
+
+            QTest::newRow(qPrintable(paintOp.id() + "/" + variant)) << paintOp.id() << variant;
+        }
+    }
+}
+
+bool KisPaintOpThroughputBenchmark::replayStrokes(const QString &paintOpId, const QString &variant, ReplayStats *stats)
+{
+    KisImageSP image = utils::createImage(0, imageSize);
+    QScopedPointer<KoCanvasResourceManager> manager(
+        utils::createResourceManager(image, 0, QString()));
+
+    KisNodeSP node = manager->resource(KisCanvasResourceProvider::CurrentKritaNode).value<KisNodeSP>();
+
+    KisPaintOpPresetSP preset = loadDefaultPreset(KoID(paintOpId));
+    if (!preset) return false;
+
+    applyVariant(variant, preset, manager.data());
+
+    if (!preset->settings()->isValid()) return false;
+
+    QVariant i;
+    i.setValue(preset);
+    manager->setResource(KisCanvasResourceProvider::CurrentPaintOpPreset, i);
+
+    /**
+     * Use the default smoothing instead of the one saved in the
+     * config, so that the results are comparable between machines
+     */
+    KisPaintingInformationBuilder infoBuilder;
+    KisToolFreehandHelper helper(&infoBuilder, kundo2_noi18n("Paintop benchmark stroke"),
+                                 0, new KisSmoothingOptions(false));
+
+    stats->baselineMemory = tileMemory();
+    stats->peakMemory = stats->baselineMemory;
+    stats->numEvents = 0;
+    stats->recordedTime = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Q_FOREACH (const Stroke &stroke, m_strokes) {
+        if (stroke.isEmpty()) continue;
+
+        for (int j = 0; j < stroke.size(); j++) {
+            const TabletEvent &e = stroke[j];
+
+            QTabletEvent tabletEvent(j == 0 ? QEvent::TabletPress : QEvent::TabletMove,
+                                     e.pos, e.pos,
+                                     QTabletEvent::Stylus, QTabletEvent::Pen,
+                                     e.pressure, qRound(e.xTilt), qRound(e.yTilt),
+                                     0.0, e.rotation, 0, Qt::NoModifier, 0,
+                                     j == 0 ? Qt::LeftButton : Qt::NoButton, Qt::LeftButton);
+
+            KoPointerEvent event(&tabletEvent, e.pos);
+
+            if (j == 0) {
+                helper.initPaint(&event, e.pos, manager.data(), image, node, image.data());
+            } else {
+                helper.paintEvent(&event);
+            }
+
+            // let the airbrushing and asynchronous update timers fire
+            if (!(++stats->numEvents & 0x1f)) {
+                stats->peakMemory = qMax(stats->peakMemory, tileMemory());
+                QCoreApplication::processEvents();
+            }
+        }
+
+        helper.endPaint();
+        stats->recordedTime += stroke.last().time - stroke.first().time;
+    }
+
+    while (!image->isIdle()) {
+        stats->peakMemory = qMax(stats->peakMemory, tileMemory());
+        QTest::qSleep(1);
+    }
+    image->waitForDone();
+
+    stats->totalTime = timer.nsecsElapsed();
+    stats->peakMemory = qMax(stats->peakMemory, tileMemory());
+
+    return true;
+}
+
+void KisPaintOpThroughputBenchmark::benchmarkPaintOp()
+{
+    QFETCH(QString, paintOpId);
+    QFETCH(QString, variant);
+
+    ReplayStats stats;
+
+    if (!replayStrokes(paintOpId, variant, &stats)) {
+        QSKIP("The preset is not valid in this environment");
+    }
+
+    int numDabs = -1;
+
+#if HAVE_KIS_TRACING
+    /**
+     * The dabs are counted in a separate pass, so that recording the
+     * events doesn't affect the measured time
+     */
+    KisTracer::instance()->clear();
+    KisTracer::instance()->start();
+
+    ReplayStats tracedStats;
+    replayStrokes(paintOpId, variant, &tracedStats);
+
+    KisTracer::instance()->stop();
+
+    numDabs = 0;
+    Q_FOREACH (const KisTracer::Event &event, KisTracer::instance()->events()) {
+        if (event.type == KisTracer::Complete && !qstrcmp(event.name, "paintop dab")) {
+            numDabs++;
+        }
+    }
+
+    KisTracer::instance()->clear();
+#endif
+
+    const qreal totalMs = 1e-6 * stats.totalTime;
+    const qreal msPerStroke = totalMs / m_strokes.size();
+
+    QJsonObject result;
+    result["paintop"] = paintOpId;
+    result["variant"] = variant;
+    result["strokes"] = m_strokes.size();
+    result["events"] = stats.numEvents;
+    result["totalMs"] = totalMs;
+    result["msPerStroke"] = msPerStroke;
+    result["realtimeFactor"] = stats.recordedTime / totalMs;
+    result["peakTileMemory"] = stats.peakMemory;
+    result["tileMemoryGrowth"] = stats.peakMemory - stats.baselineMemory;
+
+    /**
+     * Only the dabs painted with KisPaintOp::paintAt() are counted,
+     * the engines painting the whole segments at once report zero
+     */
+    if (numDabs >= 0) {
+        result["dabs"] = numDabs;
+        result["dabsPerSecond"] = numDabs / (1e-9 * stats.totalTime);
+    }
+
+    m_results.append(result);
+
+    QTest::setBenchmarkResult(msPerStroke, QTest::WalltimeMilliseconds);
+}
+
+QTEST_MAIN(KisPaintOpThroughputBenchmark)
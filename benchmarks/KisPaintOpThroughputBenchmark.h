@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISPAINTOPTHROUGHPUTBENCHMARK_H
+#define KISPAINTOPTHROUGHPUTBENCHMARK_H
+
+#include <QtTest>
+#include <QJsonArray>
+
+/**
+ * Replays the recorded tablet strokes from data/tablet_strokes.txt with
+ * every paintop engine found in KisPaintOpRegistry through the same
+ * KisToolFreehandHelper/FreehandStrokeStrategy path the freehand tool
+ * uses.
+ *
+ * Every engine is measured with its default preset and with the
+ * variations of size, spacing, texture, color source and canvas
+ * mirroring it supports. The results (ms per stroke, dabs per second
+ * and the peak tile memory) are written as JSON into
+ * paintop_throughput.json in the build directory, or into the file set
+ * in KRITA_PAINTOP_BENCHMARK_OUTPUT. Another recording can be replayed
+ * by setting KRITA_PAINTOP_BENCHMARK_STROKES.
+ *
+ * The strokes are timed with the tracer stopped. When Krita is built
+ * with HAVE_KIS_TRACING, the dabs are counted in a second, traced
+ * replay of the same case.
+ */
+class KisPaintOpThroughputBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    struct TabletEvent {
+        qreal time;
+        QPointF pos;
+        qreal pressure;
+        qreal xTilt;
+        qreal yTilt;
+        qreal rotation;
+    };
+
+    typedef QVector<TabletEvent> Stroke;
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkPaintOp_data();
+    void benchmarkPaintOp();
+
+private:
+    struct ReplayStats {
+        qint64 totalTime;  ///< nanoseconds
+        qint64 baselineMemory;
+        qint64 peakMemory;
+        int numEvents;
+        qreal recordedTime;  ///< milliseconds
+    };
+
+    /**
+     * Replays all the strokes on a new image with the default preset of
+     * \p paintOpId modified by \p variant
+     *
+     * \return false if the preset is not valid in this environment
+     */
+    bool replayStrokes(const QString &paintOpId, const QString &variant, ReplayStats *stats);
+
+private:
+    QVector<Stroke> m_strokes;
+    QJsonArray m_results;
+};
+
+#endif // KISPAINTOPTHROUGHPUTBENCHMARK_H
@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisUpdateSchedulerBenchmark.h"
+
+#include <QTest>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QRegion>
+#include <QThread>
+#include <QtMath>
+
+#include <algorithm>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_image.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device.h"
+
+namespace {
+
+const QRect imageRect(0, 0, 1536, 1536);
+const int numLayers = 20;
+const int numStrokes = 40;
+const int dabsPerStroke = 100;
+const int dabsPerEvent = 4;
+const int dabSize = 40;
+
+/**
+ * Tracks the moment when every dab rect reaches the projection
+ * of the image, that is, the latency of the canvas update
+ */
+struct LatencyTracker
+{
+    struct PendingDab {
+        QRegion remainingArea;
+        qint64 startTime;
+    };
+
+    void addDab(const QRect &rc) {
+        QMutexLocker l(&lock);
+        PendingDab dab;
+        dab.remainingArea = rc;
+        dab.startTime = timer.nsecsElapsed();
+        pendingDabs.append(dab);
+    }
+
+    void slotImageUpdated(const QRect &rc) {
+        QMutexLocker l(&lock);
+        const qint64 now = timer.nsecsElapsed();
+
+        for (auto it = pendingDabs.begin(); it != pendingDabs.end();) {
+            it->remainingArea -= rc;
+
+            if (it->remainingArea.isEmpty()) {
+                latencies.append(now - it->startTime);
+                it = pendingDabs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    qreal percentileMs(qreal percentile) const {
+        if (latencies.isEmpty()) return 0.0;
+        const int index = qBound(0, qCeil(percentile * latencies.size()) - 1, latencies.size() - 1);
+        return latencies[index] / 1e6;
+    }
+
+    QMutex lock;
+    QElapsedTimer timer;
+    QList<PendingDab> pendingDabs;
+    QVector<qint64> latencies;
+};
+
+}
+
+void KisUpdateSchedulerBenchmark::benchmarkPaintingOnManyLayers_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("ideal threads") << QThread::idealThreadCount();
+}
+
+void KisUpdateSchedulerBenchmark::benchmarkPaintingOnManyLayers()
+{
+    QFETCH(int, numThreads);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "scheduler benchmark");
+    image->setWorkingThreadsLimit(numThreads);
+
+    QVector<KisPaintLayerSP> layers;
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer%1").arg(i), OPACITY_OPAQUE_U8);
+
+        // semi-transparent layers make the composition do real work
+        KoColor color(QColor::fromHsv(i * 360 / numLayers, 255, 255, 128), cs);
+        layer->paintDevice()->fill(imageRect, color);
+
+        image->addNode(layer, image->root());
+        layers << layer;
+    }
+
+    image->initialRefreshGraph();
+
+    LatencyTracker tracker;
+    QMetaObject::Connection connection =
+        connect(image.data(), &KisImage::sigImageUpdated,
+                [&tracker] (const QRect &rc) { tracker.slotImageUpdated(rc); });
+
+    qsrand(1);
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+    tracker.timer.start();
+
+    int numDabs = 0;
+
+    for (int stroke = 0; stroke < numStrokes; stroke++) {
+        KisPaintLayerSP layer = layers[stroke % numLayers];
+        KoColor color(QColor(qrand() % 256, qrand() % 256, qrand() % 256), cs);
+
+        QPointF pt(qrand() % imageRect.width(), qrand() % imageRect.height());
+        const qreal angle = qreal(qrand() % 360) * M_PI / 180.0;
+        const QPointF step(5.0 * qCos(angle), 5.0 * qSin(angle));
+
+        for (int dab = 0; dab < dabsPerStroke; dab++) {
+            const QRect dabRect =
+                QRect(pt.toPoint() - QPoint(dabSize / 2, dabSize / 2), QSize(dabSize, dabSize)) & imageRect;
+
+            if (!dabRect.isEmpty()) {
+                layer->paintDevice()->fill(dabRect, color);
+                tracker.addDab(dabRect);
+                layer->setDirty(dabRect);
+                numDabs++;
+            }
+
+            pt += step;
+            if (!imageRect.contains(pt.toPoint())) {
+                pt = imageRect.center();
+            }
+
+            // emulate the tablet events coming with a small delay
+            if (dab % dabsPerEvent == dabsPerEvent - 1) {
+                QTest::qSleep(1);
+            }
+        }
+    }
+
+    image->waitForDone();
+    const qint64 totalTime = totalTimer.elapsed();
+
+    disconnect(connection);
+
+    std::sort(tracker.latencies.begin(), tracker.latencies.end());
+
+    QVERIFY(tracker.pendingDabs.isEmpty());
+    QCOMPARE(tracker.latencies.size(), numDabs);
+
+    qDebug() << "Threads:" << image->workingThreadsLimit()
+             << "dabs:" << numDabs
+             << "total:" << totalTime << "ms";
+    qDebug() << "Latency p50:" << tracker.percentileMs(0.5) << "ms"
+             << "p90:" << tracker.percentileMs(0.9) << "ms"
+             << "p99:" << tracker.percentileMs(0.99) << "ms"
+             << "max:" << tracker.percentileMs(1.0) << "ms";
+    qDebug() << "Throughput:" << qreal(numDabs) * 1000.0 / qMax(totalTime, qint64(1)) << "dabs/s";
+}
+
+QTEST_MAIN(KisUpdateSchedulerBenchmark)
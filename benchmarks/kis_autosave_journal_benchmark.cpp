@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_autosave_journal_benchmark.h"
+
+#include <QTest>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <KisAutosaveJournal.h>
+
+namespace {
+
+/**
+ * A document large enough for the full autosave to be noticeable:
+ * three 3072x3072 layers, about 113 MB of pixel data
+ */
+const QRect imageRect(0, 0, 3072, 3072);
+const int numLayers = 3;
+
+KisImageSP createSyntheticImage()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "autosave journal benchmark");
+
+    QByteArray noise(imageRect.width() * imageRect.height() * cs->pixelSize(), 0);
+    for (int i = 0; i < noise.size(); i++) {
+        noise[i] = char(qrand() & 0xff);
+    }
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer%1").arg(i), OPACITY_OPAQUE_U8);
+        layer->paintDevice()->writeBytes(reinterpret_cast<const quint8*>(noise.constData()), imageRect);
+        image->addNode(layer, image->root());
+    }
+
+    image->initialRefreshGraph();
+    return image;
+}
+
+KisPaintDeviceSP layerDevice(KisImageSP image, int index)
+{
+    return image->root()->at(index)->paintDevice();
+}
+
+void smallEdit(KisImageSP image, int layerIndex, const QRect &rc)
+{
+    KisPaintDeviceSP dev = layerDevice(image, layerIndex);
+    dev->fill(rc, KoColor(Qt::red, dev->colorSpace()));
+    image->waitForDone();
+}
+
+KisImageSP cloneForSaving(KisImageSP image)
+{
+    image->waitForDone();
+    return image->clone(true);
+}
+
+/**
+ * Writes all the pixel data of the image into \p fileName. It emulates
+ * the cost of the full autosave without requiring the .kra filter.
+ */
+void writeFullDump(KisImageSP image, const QString &fileName)
+{
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+
+    QDataStream stream(&file);
+
+    for (quint32 i = 0; i < image->root()->childCount(); i++) {
+        KisPaintDeviceSP dev = layerDevice(image, i);
+        const QRect rc = dev->exactBounds();
+
+        QByteArray buffer(rc.width() * rc.height() * dev->pixelSize(), 0);
+        dev->readBytes(reinterpret_cast<quint8*>(buffer.data()), rc);
+        stream << rc << qCompress(buffer, 1);
+    }
+}
+
+void doFullSave(KisAutosaveJournal *journal, KisImageSP image, const QString &baseFileName)
+{
+    KisImageSP clone = cloneForSaving(image);
+    QCOMPARE(journal->prepareSave(clone, baseFileName), KisAutosaveJournal::FullSave);
+    writeFullDump(clone, baseFileName);
+    journal->commitPendingSave(true);
+}
+
+void doDeltaSave(KisAutosaveJournal *journal, KisImageSP image, const QString &baseFileName)
+{
+    KisImageSP clone = cloneForSaving(image);
+    QCOMPARE(journal->prepareSave(clone, baseFileName), KisAutosaveJournal::DeltaSave);
+    QCOMPARE(journal->writePendingDelta(), KisImportExportFilter::OK);
+    journal->commitPendingSave(true);
+}
+
+}
+
+void KisAutosaveJournalBenchmark::benchmarkFullSave()
+{
+    QTemporaryDir dir;
+    const QString baseFileName = dir.path() + "/.benchmark-autosave.kra";
+
+    KisImageSP image = createSyntheticImage();
+    KisAutosaveJournal journal;
+
+    QBENCHMARK_ONCE {
+        doFullSave(&journal, image, baseFileName);
+    }
+}
+
+void KisAutosaveJournalBenchmark::benchmarkDeltaSave()
+{
+    QTemporaryDir dir;
+    const QString baseFileName = dir.path() + "/.benchmark-autosave.kra";
+
+    KisImageSP image = createSyntheticImage();
+    KisAutosaveJournal journal;
+
+    doFullSave(&journal, image, baseFileName);
+    smallEdit(image, 1, QRect(100, 200, 50, 150));
+
+    QBENCHMARK_ONCE {
+        doDeltaSave(&journal, image, baseFileName);
+    }
+
+    const qint64 baseSize = QFileInfo(baseFileName).size();
+    const qint64 journalSize = QFileInfo(KisAutosaveJournal::journalFileName(baseFileName)).size();
+
+    QVERIFY(journalSize < baseSize / 100);
+}
+
+QTEST_MAIN(KisAutosaveJournalBenchmark)
@@ -32,6 +32,9 @@
 #include "kis_floodfill_benchmark.h"
 
 #include <kis_fill_painter.h>
+#include <kis_pixel_selection.h>
+#include <floodfill/kis_scanline_fill.h>
+#include <floodfill/kis_tile_parallel_fill.h>
 
 #include <KoCompositeOps.h>
 
@@ -65,6 +68,31 @@ void KisFloodFillBenchmark::initTestCase()
         painter.paintEllipse(x+ 10, y+ 10, tilew, tileh);
     }
 
+    /**
+     * A comic page at 600 dpi: white paper, panel borders and
+     * a lot of random antialiased strokes
+     */
+    const QRect pageRect(0, 0, 12000, 8000);
+
+    m_lineArtDevice = new KisPaintDevice(m_colorSpace);
+    m_lineArtDevice->fill(pageRect, KoColor(Qt::white, m_colorSpace));
+
+    const KoColor ink(Qt::black, m_colorSpace);
+
+    for (int i = 1; i < 3; i++) {
+        m_lineArtDevice->fill(QRect(i * pageRect.width() / 3 - 20, 0, 40, pageRect.height()), ink);
+    }
+    m_lineArtDevice->fill(QRect(0, pageRect.height() / 2 - 20, pageRect.width(), 40), ink);
+
+    KisPainter lineArtPainter(m_lineArtDevice);
+    lineArtPainter.setPaintColor(ink);
+
+    for (int i = 0; i < 3000; i++) {
+        const QPointF start(rand() % pageRect.width(), rand() % pageRect.height());
+        const QPointF end = start + QPointF(rand() % 400 - 200, rand() % 400 - 200);
+
+        lineArtPainter.drawLine(start, end, 3 + rand() % 6, true);
+    }
 
 }
 
@@ -104,9 +132,76 @@ void KisFloodFillBenchmark::benchmarkFlood()
     //out.save("fill_output.png");
 }
 
+void KisFloodFillBenchmark::benchmarkLargeFill_data()
+{
+    QTest::addColumn<bool>("useTileParallelFill");
+    QTest::addColumn<int>("threshold");
+
+    QTest::newRow("scanline") << false << 15;
+    QTest::newRow("tiled") << true << 15;
+    QTest::newRow("scanline-soft") << false << 80;
+    QTest::newRow("tiled-soft") << true << 80;
+}
+
+void KisFloodFillBenchmark::benchmarkLargeFill()
+{
+    QFETCH(bool, useTileParallelFill);
+    QFETCH(int, threshold);
+
+    const QRect pageRect = m_lineArtDevice->extent();
+
+    QBENCHMARK {
+        // measure the cold fill, without the cached masks
+        KisTileParallelFill::clearCache();
+
+        KisPixelSelectionSP selection = new KisPixelSelection();
+
+        KisScanlineFill fill(m_lineArtDevice, QPoint(10, 10), pageRect);
+        fill.setThreshold(threshold);
+        fill.setUseTileParallelFill(useTileParallelFill);
+        fill.fillSelection(selection);
+    }
+}
+
+void KisFloodFillBenchmark::benchmarkLargeFillRepeated_data()
+{
+    QTest::addColumn<bool>("useTileParallelFill");
+
+    QTest::newRow("scanline") << false;
+    QTest::newRow("tiled") << true;
+}
+
+void KisFloodFillBenchmark::benchmarkLargeFillRepeated()
+{
+    QFETCH(bool, useTileParallelFill);
+
+    const QRect pageRect = m_lineArtDevice->extent();
+
+    // several clicks of the bucket tool into the panels of the same page
+    const QVector<QPoint> clicks({
+        QPoint(10, 10),
+        QPoint(pageRect.width() / 2, 10),
+        QPoint(pageRect.width() - 10, pageRect.height() - 10),
+        QPoint(10, pageRect.height() - 10)});
+
+    KisTileParallelFill::clearCache();
+
+    QBENCHMARK {
+        Q_FOREACH (const QPoint &pt, clicks) {
+            KisPixelSelectionSP selection = new KisPixelSelection();
+
+            KisScanlineFill fill(m_lineArtDevice, pt, pageRect);
+            fill.setThreshold(15);
+            fill.setUseTileParallelFill(useTileParallelFill);
+            fill.fillSelection(selection);
+        }
+    }
+}
 
 void KisFloodFillBenchmark::cleanupTestCase()
 {
+    KisTileParallelFill::clearCache();
+    m_lineArtDevice = 0;
 
 }
 
@@ -36,12 +36,20 @@ private:
     KisPaintDeviceSP m_device;        
     int m_startX;
     int m_startY;
+
+    KisPaintDeviceSP m_lineArtDevice;
     
 private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
     
     void benchmarkFlood();
+
+    void benchmarkLargeFill_data();
+    void benchmarkLargeFill();
+
+    void benchmarkLargeFillRepeated_data();
+    void benchmarkLargeFillRepeated();
     
     
     
@@ -33,6 +33,8 @@
 #include "kis_gradient_benchmark.h"
 
 #include <kis_gradient_painter.h>
+#include <kis_selection.h>
+#include <kis_pixel_selection.h>
 
 #include <KoCompositeOps.h>
 #include <resources/KoStopGradient.h>
@@ -82,6 +84,62 @@ void KisGradientBenchmark::benchmarkGradient()
     out.save("fill_output.png");
 }
 
+void KisGradientBenchmark::benchmarkGradientShapes_data()
+{
+    QTest::addColumn<int>("shape");
+    QTest::addColumn<int>("repeat");
+
+    QTest::newRow("linear") << int(KisGradientPainter::GradientShapeLinear) << int(KisGradientPainter::GradientRepeatNone);
+    QTest::newRow("linear-alternate") << int(KisGradientPainter::GradientShapeLinear) << int(KisGradientPainter::GradientRepeatAlternate);
+    QTest::newRow("bilinear") << int(KisGradientPainter::GradientShapeBiLinear) << int(KisGradientPainter::GradientRepeatNone);
+    QTest::newRow("radial") << int(KisGradientPainter::GradientShapeRadial) << int(KisGradientPainter::GradientRepeatNone);
+    QTest::newRow("radial-forwards") << int(KisGradientPainter::GradientShapeRadial) << int(KisGradientPainter::GradientRepeatForwards);
+    QTest::newRow("square") << int(KisGradientPainter::GradientShapeSquare) << int(KisGradientPainter::GradientRepeatNone);
+    QTest::newRow("conical") << int(KisGradientPainter::GradientShapeConical) << int(KisGradientPainter::GradientRepeatNone);
+    QTest::newRow("conical-symmetric") << int(KisGradientPainter::GradientShapeConicalSymetric) << int(KisGradientPainter::GradientRepeatNone);
+    QTest::newRow("shape-burst") << int(KisGradientPainter::GradientShapePolygonal) << int(KisGradientPainter::GradientRepeatNone);
+}
+
+void KisGradientBenchmark::benchmarkGradientShapes()
+{
+    QFETCH(int, shape);
+    QFETCH(int, repeat);
+
+    const QRect imageRect(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    QLinearGradient grad;
+    grad.setColorAt(0, Qt::white);
+    grad.setColorAt(1.0, Qt::red);
+    QScopedPointer<KoAbstractGradient> kograd(KoStopGradient::fromQGradient(&grad));
+
+    KisSelectionSP selection;
+
+    // the shape-burst gradient needs a shape: a frame with a hole
+    if (shape == KisGradientPainter::GradientShapePolygonal) {
+        selection = new KisSelection();
+        KisPixelSelectionSP pixelSelection = selection->pixelSelection();
+        pixelSelection->select(imageRect.adjusted(100, 100, -100, -100));
+        pixelSelection->clear(imageRect.adjusted(1000, 800, -1000, -800));
+        pixelSelection->invalidateOutlineCache();
+    }
+
+    QBENCHMARK
+    {
+        KisGradientPainter fillPainter(m_device, selection);
+        fillPainter.setGradient(kograd.data());
+
+        fillPainter.beginTransaction(kundo2_noi18n("Gradient Fill"));
+
+        fillPainter.setOpacity(OPACITY_OPAQUE_U8);
+        fillPainter.setCompositeOp(COMPOSITE_OVER);
+        fillPainter.setGradientShape(KisGradientPainter::enumGradientShape(shape));
+        fillPainter.paintGradient(QPointF(1000, 800), QPointF(1500, 1200),
+                                  KisGradientPainter::enumGradientRepeat(repeat),
+                                  0, false, imageRect);
+
+        fillPainter.deleteTransaction();
+    }
+}
 
 void KisGradientBenchmark::cleanupTestCase()
 {
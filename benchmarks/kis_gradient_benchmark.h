@@ -42,6 +42,9 @@ private Q_SLOTS:
     void cleanupTestCase();
     
     void benchmarkGradient();
+
+    void benchmarkGradientShapes_data();
+    void benchmarkGradientShapes();
     
     
     
@@ -28,6 +28,7 @@ inline double drand48()
 #include <QTest>
 
 #include <QImage>
+#include <QPainterPath>
 #include <kis_debug.h>
 
 #include "kis_painter_benchmark.h"
@@ -46,6 +47,8 @@ inline double drand48()
 
 #include <kis_image.h>
 #include <kis_painter.h>
+#include <kis_fill_painter.h>
+#include <resources/KoPattern.h>
 #include <kis_types.h>
 
 #define SAVE_OUTPUT
@@ -275,4 +278,116 @@ void KisPainterBenchmark::benchmarkDrawScanLine()
 #endif
 }
 
+void KisPainterBenchmark::benchmarkFillPainterPath_data()
+{
+    QTest::addColumn<QString>("shape");
+    QTest::addColumn<bool>("useCoverageRasterizer");
+
+    QTest::newRow("lasso-qimage") << "lasso" << false;
+    QTest::newRow("lasso-coverage") << "lasso" << true;
+    QTest::newRow("thin-lasso-qimage") << "thin-lasso" << false;
+    QTest::newRow("thin-lasso-coverage") << "thin-lasso" << true;
+    QTest::newRow("small-ellipses-qimage") << "small-ellipses" << false;
+    QTest::newRow("small-ellipses-coverage") << "small-ellipses" << true;
+}
+
+void KisPainterBenchmark::benchmarkFillPainterPath()
+{
+    QFETCH(QString, shape);
+    QFETCH(bool, useCoverageRasterizer);
+
+    QVector<QPainterPath> paths;
+
+    if (shape == "lasso") {
+        // a big freehand selection covering most of the image
+        QPainterPath path;
+        path.moveTo(m_points[0]);
+        for (int i = 1; i < m_points.size(); i++) {
+            path.lineTo(m_points[i]);
+        }
+        path.closeSubpath();
+        paths << path;
+    } else if (shape == "thin-lasso") {
+        // a long diagonal band crossing many empty tiles
+        QPainterPath path;
+        path.moveTo(0, 0);
+        path.lineTo(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT - 20);
+        path.lineTo(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+        path.lineTo(0, 20);
+        path.closeSubpath();
+        paths << path;
+    } else {
+        // the dabs of the spray and experiment paintops
+        for (int i = 0; i < m_points.size(); i++) {
+            QPainterPath path;
+            path.addEllipse(m_points[i], 7.3, 5.1);
+            paths << path;
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(m_colorSpace);
+
+    KisPainter gc(dev);
+    gc.setPaintColor(m_color);
+    gc.setFillStyle(KisPainter::FillStyleForegroundColor);
+    gc.setUseCoverageRasterizer(useCoverageRasterizer);
+
+    QBENCHMARK {
+        Q_FOREACH (const QPainterPath &path, paths) {
+            gc.fillPainterPath(path);
+        }
+    }
+
+#ifdef SAVE_OUTPUT
+    dev->convertToQImage(m_colorSpace->profile(), 0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT)
+        .save(QString("fillPainterPath_%1.png").arg(QTest::currentDataTag()));
+#endif
+}
+
+static QImage createTestPattern(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32);
+
+    for (int y = 0; y < size.height(); y++) {
+        for (int x = 0; x < size.width(); x++) {
+            image.setPixel(x, y, qRgb(x * 255 / size.width(), y * 255 / size.height(), (x * y) & 0xff));
+        }
+    }
+
+    return image;
+}
+
+void KisPainterBenchmark::benchmarkFillRectPattern_data()
+{
+    QTest::addColumn<bool>("noCompose");
+    QTest::addColumn<QSize>("patternSize");
+
+    QTest::newRow("compose-64") << false << QSize(64, 64);
+    QTest::newRow("no-compose-64") << true << QSize(64, 64);
+    QTest::newRow("compose-97") << false << QSize(97, 97);
+    QTest::newRow("no-compose-97") << true << QSize(97, 97);
+}
+
+void KisPainterBenchmark::benchmarkFillRectPattern()
+{
+    QFETCH(bool, noCompose);
+    QFETCH(QSize, patternSize);
+
+    KoPattern pattern(createTestPattern(patternSize), "test_pattern", "");
+
+    // a print-sized fill layer
+    const QRect fillRect(0, 0, 20000, 14000);
+
+    QBENCHMARK_ONCE {
+        KisPaintDeviceSP dev = new KisPaintDevice(m_colorSpace);
+        KisFillPainter gc(dev);
+
+        if (noCompose) {
+            gc.fillRectNoCompose(fillRect, &pattern);
+        } else {
+            gc.fillRect(fillRect, &pattern);
+        }
+    }
+}
+
 QTEST_MAIN(KisPainterBenchmark)
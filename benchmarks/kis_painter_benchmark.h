@@ -48,7 +48,12 @@ private Q_SLOTS:
     void benchmarkDrawThickLine();
     void benchmarkDrawQtLine();
     void benchmarkDrawScanLine();
-    
+
+    void benchmarkFillPainterPath_data();
+    void benchmarkFillPainterPath();
+
+    void benchmarkFillRectPattern_data();
+    void benchmarkFillRectPattern();
 };
 
 #endif
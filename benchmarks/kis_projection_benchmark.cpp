@@ -21,8 +21,11 @@
 #include "kis_benchmark_values.h"
 
 #include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
 
 #include <kis_group_layer.h>
+#include <kis_paint_layer.h>
 #include <kis_paint_device.h>
 #include <KisDocument.h>
 #include <kis_image.h>
@@ -58,5 +61,92 @@ void KisProjectionBenchmark::benchmarkLoading()
     }
 }
 
+namespace {
+
+/**
+ * Creates an image with the layer structure typical for an illustration:
+ * an opaque paper, flat colors, a sparse line art, a multiply shading
+ * and an opaque panel covering a part of the canvas. Most of the tiles
+ * of such images are either transparent, opaque or uniform.
+ */
+KisImageSP createIllustration(KisPaintLayerSP *coveredLayer)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect bounds(0, 0, 4000, 3000);
+
+    KisImageSP image = new KisImage(0, bounds.width(), bounds.height(), cs, "illustration");
+
+    qsrand(1);
+
+    KisPaintLayerSP paper = new KisPaintLayer(image, "paper", OPACITY_OPAQUE_U8);
+    paper->paintDevice()->fill(bounds, KoColor(Qt::white, cs));
+    image->addNode(paper, image->root());
+
+    KisPaintLayerSP flats = new KisPaintLayer(image, "flats", OPACITY_OPAQUE_U8);
+    for (int i = 0; i < 30; i++) {
+        const QRect rc(qrand() % bounds.width(), qrand() % bounds.height(),
+                       200 + qrand() % 1000, 200 + qrand() % 1000);
+        flats->paintDevice()->fill(rc & bounds, KoColor(QColor::fromHsv(qrand() % 360, 128, 200), cs));
+    }
+    image->addNode(flats, image->root());
+
+    KisPaintLayerSP shading = new KisPaintLayer(image, "shading", OPACITY_OPAQUE_U8);
+    shading->setCompositeOpId(COMPOSITE_MULT);
+    KoColor shadow(QColor(80, 60, 120), cs);
+    shadow.setOpacity(quint8(100));
+    for (int i = 0; i < 20; i++) {
+        const QRect rc(qrand() % bounds.width(), qrand() % bounds.height(),
+                       100 + qrand() % 600, 100 + qrand() % 600);
+        shading->paintDevice()->fill(rc & bounds, shadow);
+    }
+    image->addNode(shading, image->root());
+
+    KisPaintLayerSP lineart = new KisPaintLayer(image, "lineart", OPACITY_OPAQUE_U8);
+    for (int i = 0; i < 400; i++) {
+        const bool horizontal = qrand() & 0x1;
+        const int length = 50 + qrand() % 800;
+        const QRect rc(qrand() % bounds.width(), qrand() % bounds.height(),
+                       horizontal ? length : 3, horizontal ? 3 : length);
+        lineart->paintDevice()->fill(rc & bounds, KoColor(Qt::black, cs));
+    }
+    image->addNode(lineart, image->root());
+
+    KisPaintLayerSP panel = new KisPaintLayer(image, "panel", OPACITY_OPAQUE_U8);
+    panel->paintDevice()->fill(QRect(0, 0, bounds.width() / 2, bounds.height()), KoColor(Qt::darkGray, cs));
+    image->addNode(panel, image->root());
+
+    image->initialRefreshGraph();
+
+    if (coveredLayer) {
+        *coveredLayer = flats;
+    }
+
+    return image;
+}
+
+}
+
+void KisProjectionBenchmark::benchmarkIllustrationRefresh()
+{
+    KisImageSP image = createIllustration(0);
+
+    QBENCHMARK {
+        image->refreshGraph();
+    }
+}
+
+void KisProjectionBenchmark::benchmarkIllustrationUpdateBeneathOpaque()
+{
+    KisPaintLayerSP flats;
+    KisImageSP image = createIllustration(&flats);
+
+    // the left half of the dirty rect is hidden by the opaque panel
+    const QRect dirtyRect(1000, 500, 2000, 2000);
+
+    QBENCHMARK {
+        flats->setDirty(dirtyRect);
+        image->waitForDone();
+    }
+}
 
 QTEST_MAIN(KisProjectionBenchmark)
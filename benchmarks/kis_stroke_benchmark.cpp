@@ -48,6 +48,14 @@ inline double drand48()
 #define GMP_IMAGE_HEIGHT 2067
 #include <kis_painter.h>
 #include <brushengine/kis_paintop_registry.h>
+#include <kis_fixed_paint_device.h>
+#include <KisRenderedDab.h>
+#include <brushengine/kis_paintop.h>
+#include <kis_distance_information.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
+
+#include <QThreadPool>
 
 //#define SAVE_OUTPUT
 
@@ -524,4 +532,137 @@ void KisStrokeBenchmark::becnhmarkPresetCloning()
 }
 
 
+void KisStrokeBenchmark::multiDabBlitting_data()
+{
+    QTest::addColumn<bool>("tileMajor");
+
+    QTest::newRow("dab-by-dab") << false;
+    QTest::newRow("tile-major") << true;
+}
+
+void KisStrokeBenchmark::multiDabBlitting()
+{
+    QFETCH(bool, tileMajor);
+
+    // a 300px brush with spacing 0.02, that is a dab every 6px
+    const int dabSize = 300;
+    const int dabStep = 6;
+    const int numDabs = 200;
+
+    KoColor color(Qt::black, m_colorSpace);
+    color.setOpacity(quint8(32));
+
+    KisFixedPaintDeviceSP dabDevice = new KisFixedPaintDevice(m_colorSpace);
+    dabDevice->setRect(QRect(0, 0, dabSize, dabSize));
+    dabDevice->lazyGrowBufferWithoutInitialization();
+    dabDevice->fill(dabDevice->bounds(), color);
+
+    QList<KisRenderedDab> dabs;
+    QRect totalRect;
+
+    for (int i = 0; i < numDabs; i++) {
+        KisRenderedDab dab(dabDevice);
+        dab.offset = QPoint(10 + i * dabStep, 10 + (i % 10));
+        dabs << dab;
+        totalRect |= dab.realBounds();
+    }
+
+    QBENCHMARK {
+        if (tileMajor) {
+            m_painter->bltFixed(totalRect, dabs);
+        } else {
+            // the old way: every dab walks through all its tiles separately
+            Q_FOREACH (const KisRenderedDab &dab, dabs) {
+                m_painter->bltFixed(dab.realBounds(), QList<KisRenderedDab>() << dab);
+            }
+        }
+    }
+}
+
+namespace {
+
+struct RunnableJobWrapper : public QRunnable
+{
+    RunnableJobWrapper(KisRunnableStrokeJobData *job) : m_job(job) {}
+    void run() override { m_job->run(); }
+
+    KisRunnableStrokeJobData *m_job;
+};
+
+/**
+ * Runs the jobs the way the strokes queue does: concurrent jobs are
+ * executed in parallel, sequential jobs wait for all the previous
+ * jobs to complete.
+ */
+struct ThreadPoolRunnableJobsExecutor : public KisRunnableStrokeJobsInterface
+{
+    void addRunnableJobs(const QVector<KisRunnableStrokeJobData*> &list) override {
+        Q_FOREACH (KisRunnableStrokeJobData *job, list) {
+            if (job->sequentiality() == KisStrokeJobData::CONCURRENT) {
+                m_pool.start(new RunnableJobWrapper(job));
+            } else {
+                m_pool.waitForDone();
+                job->run();
+            }
+        }
+        m_pool.waitForDone();
+
+        qDeleteAll(list);
+    }
+
+private:
+    QThreadPool m_pool;
+};
+
+}
+
+void KisStrokeBenchmark::smudgeThroughput_data()
+{
+    QTest::addColumn<QString>("presetFileName");
+    QTest::addColumn<bool>("useJobs");
+
+    QTest::newRow("brush") << "autobrush_300px.kpp" << true;
+    QTest::newRow("smudge-sequential") << "colorsmudge.kpp" << false;
+    QTest::newRow("smudge-jobs") << "colorsmudge.kpp" << true;
+}
+
+void KisStrokeBenchmark::smudgeThroughput()
+{
+    QFETCH(QString, presetFileName);
+    QFETCH(bool, useJobs);
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(m_dataPath + presetFileName);
+    QVERIFY(preset->load());
+    preset->settings()->setPaintOpSize(300);
+
+    ThreadPoolRunnableJobsExecutor executor;
+
+    KisPainter painter(m_layer->paintDevice());
+    painter.setPaintColor(KoColor(Qt::black, m_colorSpace));
+    if (useJobs) {
+        painter.setRunnableStrokeJobsInterface(&executor);
+    }
+    painter.setPaintOpPreset(preset, m_layer, m_image);
+
+    QPointF startPoint(0.10 * TEST_IMAGE_WIDTH, 0.5 * TEST_IMAGE_HEIGHT);
+    QPointF endPoint(0.90 * TEST_IMAGE_WIDTH, 0.5 * TEST_IMAGE_HEIGHT);
+
+    KisPaintInformation pi1(startPoint, 0.0);
+    KisPaintInformation pi2(endPoint, 1.0);
+
+    /**
+     * All the rows paint the same line with a 300px brush, so the
+     * time per line is directly comparable between them
+     */
+    QBENCHMARK {
+        KisDistanceInformation currentDistance;
+
+        painter.paintLine(pi1, pi2, &currentDistance);
+
+        QVector<KisRunnableStrokeJobData*> jobs;
+        painter.paintOp()->doAsyncronousUpdate(jobs);
+        executor.addRunnableJobs(jobs);
+    }
+}
+
 QTEST_MAIN(KisStrokeBenchmark)
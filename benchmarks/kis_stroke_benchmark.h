@@ -127,6 +127,12 @@ private Q_SLOTS:
     void benchmarkRand();
     void benchmarkRand48();
 
+    void multiDabBlitting_data();
+    void multiDabBlitting();
+
+    void smudgeThroughput_data();
+    void smudgeThroughput();
+
     void becnhmarkPresetCloning();
 };
 
@@ -58,6 +58,10 @@ public:
         return 0; // The autobrush does NOT support images!
     }
 
+    void setStampCacheEnabled(bool) override {
+        // The autobrush generates the dabs without the pyramid
+    }
+
     void generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
             KisBrush::ColoringInformation* src,
             KisDabShape const&,
@@ -46,6 +46,7 @@
 #include <brushengine/kis_paint_information.h>
 #include <kis_fixed_paint_device.h>
 #include <kis_qimage_pyramid.h>
+#include <kis_brush_stamp_cache.h>
 #include <brushengine/kis_paintop_lod_limitations.h>
 
 
@@ -127,6 +128,7 @@ struct KisBrush::Private {
     QPointF hotSpot;
 
     mutable QSharedPointer<const KisQImagePyramid> brushPyramid;
+    QSharedPointer<KisBrushStampCache> stampCache;
 
     QImage brushTipImage;
 
@@ -174,6 +176,12 @@ KisBrush::KisBrush(const KisBrush& rhs)
      */
     d->brushPyramid = rhs.d->brushPyramid;
 
+    /**
+     * The stamp cache is thread-safe, so the clones used by the dab
+     * rendering threads share the stamps
+     */
+    d->stampCache = rhs.d->stampCache;
+
     // don't copy the boundary, it will be regenerated -- see bug 291910
 }
 
@@ -374,9 +382,14 @@ qint32 KisBrush::maskWidth(KisDabShape const& shape, qreal subPixelX, qreal subP
 
     qreal angle = normalizeAngle(shape.rotation() + d->angle);
     qreal scale = shape.scale() * d->scale;
+    KisDabShape dabShape(scale, shape.ratio(), angle);
+
+    if (d->stampCache) {
+        KisBrushStampCache::quantize(QSize(width(), height()), &dabShape, &subPixelX, &subPixelY);
+    }
 
     return KisQImagePyramid::imageSize(QSize(width(), height()),
-                                       KisDabShape(scale, shape.ratio(), angle),
+                                       dabShape,
                                        subPixelX, subPixelY).width();
 }
 
@@ -386,9 +399,14 @@ qint32 KisBrush::maskHeight(KisDabShape const& shape, qreal subPixelX, qreal sub
 
     qreal angle = normalizeAngle(shape.rotation() + d->angle);
     qreal scale = shape.scale() * d->scale;
+    KisDabShape dabShape(scale, shape.ratio(), angle);
+
+    if (d->stampCache) {
+        KisBrushStampCache::quantize(QSize(width(), height()), &dabShape, &subPixelX, &subPixelY);
+    }
 
     return KisQImagePyramid::imageSize(QSize(width(), height()),
-                                       KisDabShape(scale, shape.ratio(), angle),
+                                       dabShape,
                                        subPixelX, subPixelY).height();
 }
 
@@ -465,6 +483,34 @@ void KisBrush::prepareBrushPyramid() const
 void KisBrush::clearBrushPyramid()
 {
     d->brushPyramid.clear();
+
+    /**
+     * The cache might be shared with other brushes, so just detach
+     * from the stamps of the old brush tip
+     */
+    if (d->stampCache) {
+        d->stampCache = toQShared(new KisBrushStampCache(d->stampCache->memoryLimit()));
+    }
+}
+
+void KisBrush::setStampCacheEnabled(bool value)
+{
+    if (value && !d->stampCache) {
+        d->stampCache = toQShared(new KisBrushStampCache());
+
+        /**
+         * Create the pyramid beforehand so that the clones
+         * of the brush would share it as well
+         */
+        prepareBrushPyramid();
+    } else if (!value) {
+        d->stampCache.clear();
+    }
+}
+
+bool KisBrush::stampCacheEnabled() const
+{
+    return !d->stampCache.isNull();
 }
 
 void KisBrush::mask(KisFixedPaintDeviceSP dst, const KoColor& color, KisDabShape const& shape, const KisPaintInformation& info, double subPixelX, double subPixelY, qreal softnessFactor) const
@@ -480,6 +526,32 @@ void KisBrush::mask(KisFixedPaintDeviceSP dst, const KisPaintDeviceSP src, KisDa
 }
 
 
+namespace {
+
+void calculateStampAlpha(const QImage &image, bool hasColor, quint8 *dst)
+{
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+        if (hasColor) {
+            for (int x = 0; x < image.width(); x++) {
+                *dst = KoColorSpaceMaths<quint8>::multiply(255 - qGray(*src), qAlpha(*src));
+                src++;
+                dst++;
+            }
+        }
+        else {
+            for (int x = 0; x < image.width(); x++) {
+                *dst = KoColorSpaceMaths<quint8>::multiply(255 - *reinterpret_cast<const quint8*>(src), qAlpha(*src));
+                src++;
+                dst++;
+            }
+        }
+    }
+}
+
+}
+
 void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
         ColoringInformation* coloringInformation,
         KisDabShape const& shape,
@@ -491,13 +563,34 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     Q_UNUSED(softnessFactor);
 
     prepareBrushPyramid();
-    QImage outputImage = d->brushPyramid->createImage(KisDabShape(
-            shape.scale() * d->scale, shape.ratio(),
-            -normalizeAngle(shape.rotation() + d->angle)),
-        subPixelX, subPixelY);
 
-    qint32 maskWidth = outputImage.width();
-    qint32 maskHeight = outputImage.height();
+    KisDabShape dabShape(shape.scale() * d->scale, shape.ratio(),
+                         -normalizeAngle(shape.rotation() + d->angle));
+    bool hasColor = this->hasColor();
+
+    KisBrushStampCache::Key key;
+    KisBrushStampCache::Stamp stamp;
+
+    if (d->stampCache) {
+        KisBrushStampCache::quantize(QSize(width(), height()), &dabShape, &subPixelX, &subPixelY);
+        key = KisBrushStampCache::key(QSize(width(), height()), dabShape, subPixelX, subPixelY,
+                                      hasColor ? KisBrushStampCache::GrayMask : KisBrushStampCache::AlphaMask);
+    }
+
+    if (!d->stampCache || !d->stampCache->fetch(key, &stamp)) {
+        QImage outputImage = d->brushPyramid->createImage(dabShape, subPixelX, subPixelY);
+
+        stamp.size = outputImage.size();
+        stamp.data.resize(stamp.size.width() * stamp.size.height());
+        calculateStampAlpha(outputImage, hasColor, reinterpret_cast<quint8*>(stamp.data.data()));
+
+        if (d->stampCache) {
+            d->stampCache->store(key, stamp);
+        }
+    }
+
+    qint32 maskWidth = stamp.size.width();
+    qint32 maskHeight = stamp.size.height();
 
     dst->setRect(QRect(0, 0, maskWidth, maskHeight));
     dst->lazyGrowBufferWithoutInitialization();
@@ -514,11 +607,9 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     qint32 pixelSize = cs->pixelSize();
     quint8 *dabPointer = dst->data();
     quint8 *rowPointer = dabPointer;
-    quint8 *alphaArray = new quint8[maskWidth];
-    bool hasColor = this->hasColor();
+    const quint8 *alphaPointer = reinterpret_cast<const quint8*>(stamp.data.constData());
 
     for (int y = 0; y < maskHeight; y++) {
-        const quint8* maskPointer = outputImage.constScanLine(y);
         if (coloringInformation) {
             for (int x = 0; x < maskWidth; x++) {
                 if (color) {
@@ -532,39 +623,15 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
             }
         }
 
-        if (hasColor) {
-            const quint8 *src = maskPointer;
-            quint8 *dst = alphaArray;
-            for (int x = 0; x < maskWidth; x++) {
-                const QRgb *c = reinterpret_cast<const QRgb*>(src);
-
-                *dst = KoColorSpaceMaths<quint8>::multiply(255 - qGray(*c), qAlpha(*c));
-                src += 4;
-                dst++;
-            }
-        }
-        else {
-            const quint8 *src = maskPointer;
-            quint8 *dst = alphaArray;
-            for (int x = 0; x < maskWidth; x++) {
-                const QRgb *c = reinterpret_cast<const QRgb*>(src);
-
-                *dst = KoColorSpaceMaths<quint8>::multiply(255 - *src, qAlpha(*c));
-                src += 4;
-                dst++;
-            }
-        }
-
-        cs->applyAlphaU8Mask(rowPointer, alphaArray, maskWidth);
+        cs->applyAlphaU8Mask(rowPointer, alphaPointer, maskWidth);
         rowPointer += maskWidth * pixelSize;
+        alphaPointer += maskWidth;
         dabPointer = rowPointer;
 
         if (!color && coloringInformation) {
             coloringInformation->nextRow();
         }
     }
-
-    delete[] alphaArray;
 }
 
 KisFixedPaintDeviceSP KisBrush::paintDevice(const KoColorSpace * colorSpace,
@@ -578,13 +645,37 @@ KisFixedPaintDeviceSP KisBrush::paintDevice(const KoColorSpace * colorSpace,
     double scale = shape.scale() * d->scale;
 
     prepareBrushPyramid();
-    QImage outputImage = d->brushPyramid->createImage(
-        KisDabShape(scale, shape.ratio(), -angle), subPixelX, subPixelY);
 
+    KisDabShape dabShape(scale, shape.ratio(), -angle);
     KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(colorSpace);
     Q_CHECK_PTR(dab);
+
+    KisBrushStampCache::Key key;
+    KisBrushStampCache::Stamp stamp;
+
+    if (d->stampCache) {
+        KisBrushStampCache::quantize(QSize(width(), height()), &dabShape, &subPixelX, &subPixelY);
+        key = KisBrushStampCache::key(QSize(width(), height()), dabShape, subPixelX, subPixelY,
+                                      KisBrushStampCache::ColorStamp, colorSpace);
+
+        if (d->stampCache->fetch(key, &stamp)) {
+            dab->setRect(QRect(QPoint(), stamp.size));
+            dab->lazyGrowBufferWithoutInitialization();
+            memcpy(dab->data(), stamp.data.constData(), stamp.data.size());
+            return dab;
+        }
+    }
+
+    QImage outputImage = d->brushPyramid->createImage(dabShape, subPixelX, subPixelY);
     dab->convertFromQImage(outputImage, "");
 
+    if (d->stampCache) {
+        stamp.size = dab->bounds().size();
+        stamp.data = QByteArray(reinterpret_cast<const char*>(dab->data()),
+                                stamp.size.width() * stamp.size.height() * colorSpace->pixelSize());
+        d->stampCache->store(key, stamp);
+    }
+
     return dab;
 }
 
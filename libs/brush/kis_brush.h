@@ -338,6 +338,16 @@ public:
     void prepareBrushPyramid() const;
     void clearBrushPyramid();
 
+    /**
+     * Enables the cache of the transformed stamps of the brush tip (see
+     * KisBrushStampCache). The dab parameters are quantized when the
+     * cache is enabled, so it should be enabled only when the paintop
+     * allows approximate dabs. The cache is shared with all the clones
+     * of the brush created afterwards.
+     */
+    virtual void setStampCacheEnabled(bool value);
+    bool stampCacheEnabled() const;
+
     virtual void lodLimitations(KisPaintopLodLimitations *l) const;
 
     virtual KisBrush* clone() const = 0;
@@ -0,0 +1,163 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_brush_stamp_cache.h"
+
+#include <cmath>
+
+#include <kis_global.h>
+#include <kis_assert.h>
+
+
+namespace {
+
+const int sizeSteps = 4;
+const int subPixelSteps = 4;
+
+const int minAngleSteps = 256;
+const int maxAngleSteps = 16384;
+
+/**
+ * A stamp should not take more than this fraction of the memory
+ * limit, otherwise a few huge stamps would wipe the whole cache out
+ */
+const int maxStampCostFraction = 16;
+
+}
+
+KisBrushStampCache::KisBrushStampCache(int memoryLimit)
+    : m_stamps(memoryLimit)
+{
+}
+
+KisBrushStampCache::~KisBrushStampCache()
+{
+}
+
+int KisBrushStampCache::angleSteps(qreal width, qreal height)
+{
+    /**
+     * The rotation is quantized so that the farthest pixel of the
+     * dab moves by not more than 1/4 px between the buckets
+     */
+    const qreal radius = 0.5 * std::sqrt(pow2(width) + pow2(height));
+    return qBound(minAngleSteps, int(std::ceil(2 * M_PI * radius * sizeSteps)), maxAngleSteps);
+}
+
+void KisBrushStampCache::quantize(const QSize &originalSize,
+                                  KisDabShape *shape,
+                                  qreal *subPixelX, qreal *subPixelY)
+{
+    const qreal originalWidth = qMax(1, originalSize.width());
+    const qreal originalHeight = qMax(1, originalSize.height());
+
+    const int width = qMax(1, qRound(shape->scaleX() * originalWidth * sizeSteps));
+    const int height = qMax(1, qRound(shape->scaleY() * originalHeight * sizeSteps));
+
+    const qreal scaleX = width / (originalWidth * sizeSteps);
+    const qreal scaleY = height / (originalHeight * sizeSteps);
+
+    qreal rotation = shape->rotation();
+
+    if (!qIsNaN(rotation)) {
+        const int steps = angleSteps(qreal(width) / sizeSteps, qreal(height) / sizeSteps);
+        const qreal step = 2 * M_PI / steps;
+        const int index = qRound(qAbs(rotation) / step) % steps;
+
+        rotation = (rotation < 0 ? -index : index) * step;
+    }
+
+    *shape = KisDabShape(scaleX, scaleY / scaleX, rotation);
+    *subPixelX = qreal(qRound(*subPixelX * subPixelSteps)) / subPixelSteps;
+    *subPixelY = qreal(qRound(*subPixelY * subPixelSteps)) / subPixelSteps;
+}
+
+KisBrushStampCache::Key KisBrushStampCache::key(const QSize &originalSize,
+                                                const KisDabShape &shape,
+                                                qreal subPixelX, qreal subPixelY,
+                                                StampType type, const KoColorSpace *colorSpace)
+{
+    const qreal originalWidth = qMax(1, originalSize.width());
+    const qreal originalHeight = qMax(1, originalSize.height());
+
+    Key key;
+    key.width = qRound(shape.scaleX() * originalWidth * sizeSteps);
+    key.height = qRound(shape.scaleY() * originalHeight * sizeSteps);
+
+    if (!qIsNaN(shape.rotation())) {
+        const int steps = angleSteps(qreal(key.width) / sizeSteps, qreal(key.height) / sizeSteps);
+        key.angle = qRound(shape.rotation() / (2 * M_PI) * steps) % steps;
+        if (key.angle < 0) {
+            key.angle += steps;
+        }
+    }
+
+    key.subPixelX = qRound(subPixelX * subPixelSteps);
+    key.subPixelY = qRound(subPixelY * subPixelSteps);
+    key.type = type;
+    key.colorSpace = colorSpace;
+
+    KIS_SAFE_ASSERT_RECOVER_NOOP(type == ColorStamp || !colorSpace);
+
+    return key;
+}
+
+bool KisBrushStampCache::fetch(const Key &key, Stamp *stamp)
+{
+    QMutexLocker l(&m_mutex);
+
+    Stamp *cachedStamp = m_stamps.object(key);
+    if (!cachedStamp) return false;
+
+    *stamp = *cachedStamp;
+    return true;
+}
+
+void KisBrushStampCache::store(const Key &key, const Stamp &stamp)
+{
+    QMutexLocker l(&m_mutex);
+
+    const int cost = stamp.data.size();
+    if (cost > m_stamps.maxCost() / maxStampCostFraction) return;
+
+    m_stamps.insert(key, new Stamp(stamp), cost);
+}
+
+void KisBrushStampCache::clear()
+{
+    QMutexLocker l(&m_mutex);
+    m_stamps.clear();
+}
+
+int KisBrushStampCache::memoryLimit() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_stamps.maxCost();
+}
+
+int KisBrushStampCache::memoryUsage() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_stamps.totalCost();
+}
+
+int KisBrushStampCache::numStamps() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_stamps.size();
+}
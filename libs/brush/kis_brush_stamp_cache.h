@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_BRUSH_STAMP_CACHE_H
+#define __KIS_BRUSH_STAMP_CACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QSize>
+
+#include <kis_dab_shape.h>
+#include <kritabrush_export.h>
+
+class KoColorSpace;
+
+/**
+ * A cache of the transformed stamps of a predefined (image based) brush.
+ *
+ * The dab parameters are quantized into buckets: the size of the dab to
+ * 1/4 px, the rotation so that the farthest pixel of the dab moves by
+ * no more than 1/4 px and the subpixel offset to 1/4 px. Every bucket
+ * is transformed only once and stored ready to be painted: the masks
+ * as 8-bit alpha values, the color stamps as the pixels of the color
+ * space of the dab.
+ *
+ * The cache is thread-safe and is shared between all the clones of the
+ * brush, so the dab rendering threads of a stroke fill it together. The
+ * memory used by the stamps is limited by memoryLimit(), the least
+ * recently used stamps are dropped first.
+ */
+class BRUSH_EXPORT KisBrushStampCache
+{
+public:
+    enum StampType {
+        AlphaMask,
+        GrayMask,
+        ColorStamp
+    };
+
+    struct Key {
+        Key()
+            : width(0), height(0), angle(0),
+              subPixelX(0), subPixelY(0),
+              type(AlphaMask), colorSpace(0) {}
+
+        /// the size of the transformed brush in 1/4 px
+        int width;
+        int height;
+
+        /// the rotation in steps of angleSteps(width, height)
+        int angle;
+
+        /// the subpixel offset in 1/4 px
+        int subPixelX;
+        int subPixelY;
+
+        StampType type;
+        const KoColorSpace *colorSpace;
+
+        bool operator==(const Key &rhs) const {
+            return width == rhs.width && height == rhs.height &&
+                angle == rhs.angle &&
+                subPixelX == rhs.subPixelX && subPixelY == rhs.subPixelY &&
+                type == rhs.type && colorSpace == rhs.colorSpace;
+        }
+    };
+
+    struct Stamp {
+        QSize size;
+
+        /// the mask values or the pixels of the stamp, row by row
+        QByteArray data;
+    };
+
+    static const int defaultMemoryLimit = 64 * 1024 * 1024;
+
+public:
+    KisBrushStampCache(int memoryLimit = defaultMemoryLimit);
+    ~KisBrushStampCache();
+
+    /**
+     * Rounds \p shape and the subpixel offset of a brush of \p originalSize
+     * to the nearest bucket of the cache. The rounding is symmetrical in
+     * the rotation angle, so the dab sizes calculated for the angle and
+     * its negation stay the same.
+     */
+    static void quantize(const QSize &originalSize,
+                         KisDabShape *shape,
+                         qreal *subPixelX, qreal *subPixelY);
+
+    /**
+     * \return the key of a \em quantized stamp
+     */
+    static Key key(const QSize &originalSize,
+                   const KisDabShape &shape,
+                   qreal subPixelX, qreal subPixelY,
+                   StampType type, const KoColorSpace *colorSpace = 0);
+
+    /**
+     * \return true if the stamp is present in the cache. Thread-safe.
+     */
+    bool fetch(const Key &key, Stamp *stamp);
+
+    /**
+     * Puts \p stamp into the cache unless it is bigger than a small
+     * fraction of the memory limit. Thread-safe.
+     */
+    void store(const Key &key, const Stamp &stamp);
+
+    void clear();
+
+    int memoryLimit() const;
+    int memoryUsage() const;
+    int numStamps() const;
+
+private:
+    Q_DISABLE_COPY(KisBrushStampCache)
+
+    static int angleSteps(qreal width, qreal height);
+
+private:
+    mutable QMutex m_mutex;
+    QCache<Key, Stamp> m_stamps;
+};
+
+inline uint qHash(const KisBrushStampCache::Key &key, uint seed = 0)
+{
+    return qHash(key.width, seed) ^
+        qHash(key.height << 7, seed) ^
+        qHash(key.angle << 14, seed) ^
+        qHash((key.subPixelX << 3) | (key.subPixelY << 6) | key.type, seed) ^
+        qHash(key.colorSpace, seed);
+}
+
+#endif /* __KIS_BRUSH_STAMP_CACHE_H */
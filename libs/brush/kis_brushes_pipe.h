@@ -86,6 +86,12 @@ public:
         }
     }
 
+    void setStampCacheEnabled(bool value) {
+        Q_FOREACH (BrushType * brush, m_brushes) {
+            brush->setStampCacheEnabled(value);
+        }
+    }
+
     void setSpacing(double spacing) {
         Q_FOREACH (BrushType * brush, m_brushes) {
             brush->setSpacing(spacing);
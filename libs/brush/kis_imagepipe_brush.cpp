@@ -460,6 +460,12 @@ void KisImagePipeBrush::setScale(qreal _scale)
     m_d->brushesPipe.setScale(_scale);
 }
 
+void KisImagePipeBrush::setStampCacheEnabled(bool value)
+{
+    KisGbrBrush::setStampCacheEnabled(value);
+    m_d->brushesPipe.setStampCacheEnabled(value);
+}
+
 void KisImagePipeBrush::setSpacing(double _spacing)
 {
     KisGbrBrush::setSpacing(_spacing);
@@ -91,6 +91,7 @@ public:
     QString defaultFileExtension() const override;
     void setAngle(qreal _angle) override;
     void setScale(qreal _scale) override;
+    void setStampCacheEnabled(bool value) override;
     void setSpacing(double _spacing) override;
 
     quint32 brushIndex(const KisPaintInformation& info) const override;
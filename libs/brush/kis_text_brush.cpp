@@ -322,6 +322,12 @@ void KisTextBrush::setScale(qreal _scale)
     m_brushesPipe->setScale(_scale);
 }
 
+void KisTextBrush::setStampCacheEnabled(bool value)
+{
+    KisBrush::setStampCacheEnabled(value);
+    m_brushesPipe->setStampCacheEnabled(value);
+}
+
 void KisTextBrush::setSpacing(double _spacing)
 {
     KisBrush::setSpacing(_spacing);
@@ -81,6 +81,7 @@ public:
     qint32 maskHeight(KisDabShape const&, double subPixelX, double subPixelY, const KisPaintInformation& info) const override;
     void setAngle(qreal _angle) override;
     void setScale(qreal _scale) override;
+    void setStampCacheEnabled(bool value) override;
     void setSpacing(double _spacing) override;
 
     KisBrush* clone() const override;
@@ -19,6 +19,7 @@
 #include "kis_gbr_brush_test.h"
 
 #include <QTest>
+#include <cmath>
 #include <QString>
 #include <QDir>
 #include <KoColor.h>
@@ -31,6 +32,7 @@
 #include "brushengine/kis_paint_information.h"
 #include <kis_fixed_paint_device.h>
 #include "kis_qimage_pyramid.h"
+#include "kis_brush_stamp_cache.h"
 
 
 void KisGbrBrushTest::testMaskGenerationSingleColor()
@@ -194,6 +196,89 @@ void KisGbrBrushTest::benchmarkMaskScaling()
     }
 }
 
+void KisGbrBrushTest::benchmarkRotationStampCache()
+{
+    KisGbrBrush* brush = new KisGbrBrush(QString(FILES_DATA_DIR) + QDir::separator() + "testing_brush_512_bars.gbr");
+    brush->load();
+    QVERIFY(!brush->brushTipImage().isNull());
+    brush->setStampCacheEnabled(true);
+    qsrand(1);
+
+    const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintInformation info(QPointF(100.0, 100.0), 0.5);
+    KisFixedPaintDeviceSP dab;
+
+    QBENCHMARK {
+        dab = brush->paintDevice(cs, KisDabShape(1.0, 1.0, qreal(qrand() % 64) / 64 * 2 * M_PI), info);
+    }
+}
+
+void KisGbrBrushTest::benchmarkMaskScalingStampCache()
+{
+    KisGbrBrush* brush = new KisGbrBrush(QString(FILES_DATA_DIR) + QDir::separator() + "testing_brush_512_bars.gbr");
+    brush->load();
+    QVERIFY(!brush->brushTipImage().isNull());
+    brush->setStampCacheEnabled(true);
+    qsrand(1);
+
+    const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintInformation info(QPointF(100.0, 100.0), 0.5);
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+
+    QBENCHMARK {
+        KoColor c(Qt::black, cs);
+        qreal scale = qreal(qrand()) / RAND_MAX * 2.0;
+        brush->mask(dab, c, KisDabShape(scale, 1.0, 0.0), info, 0.0, 0.0, 1.0);
+    }
+}
+
+void KisGbrBrushTest::benchmarkStrokeDabs_data()
+{
+    QTest::addColumn<bool>("useStampCache");
+
+    // the paintops use the stamp cache only below the default precision level
+    QTest::newRow("default-precision") << false;
+    QTest::newRow("stamp-cache") << true;
+}
+
+void KisGbrBrushTest::benchmarkStrokeDabs()
+{
+    QFETCH(bool, useStampCache);
+
+    KisGbrBrush* brush = new KisGbrBrush(QString(FILES_DATA_DIR) + QDir::separator() + "testing_brush_512_bars.gbr");
+    brush->load();
+    QVERIFY(!brush->brushTipImage().isNull());
+    brush->setStampCacheEnabled(useStampCache);
+
+    const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    KoColor c(Qt::black, cs);
+
+    /**
+     * The dabs of a wavy stroke with the size following the pressure and
+     * the rotation following the direction of the stroke. Both rows
+     * render the same dabs, the stamp cache starts empty.
+     */
+    const int numDabs = 2000;
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < numDabs; i++) {
+            const qreal t = qreal(i) / numDabs;
+            const QPointF pos(100.0 + 1500.0 * t, 500.0 + 200.0 * std::sin(8 * M_PI * t));
+            const qreal pressure = 0.5 + 0.5 * std::sin(3 * M_PI * t);
+            const qreal rotation = std::atan2(1600.0 * M_PI * std::cos(8 * M_PI * t), 1500.0);
+
+            KisPaintInformation info(pos, pressure);
+            const qreal scale = 0.05 + 0.15 * pressure;
+
+            brush->mask(dab, c, KisDabShape(scale, 1.0, rotation), info,
+                        pos.x() - std::floor(pos.x()), pos.y() - std::floor(pos.y()), 1.0);
+        }
+    }
+
+    delete brush;
+}
+
 void KisGbrBrushTest::testPyramidLevelRounding()
 {
     QSize imageSize(41, 41);
@@ -294,4 +379,147 @@ void KisGbrBrushTest::testQPainterTransformationBorder()
     }
 }
 
+void KisGbrBrushTest::testStampCacheQuantization()
+{
+    const QSize originalSize(150, 100);
+
+    KisDabShape shape(1.0, 1.0, 0.0);
+    qreal subPixelX = 0.0;
+    qreal subPixelY = 0.5;
+
+    // the exact values are kept as they are
+    KisBrushStampCache::quantize(originalSize, &shape, &subPixelX, &subPixelY);
+    QCOMPARE(shape.scaleX(), 1.0);
+    QCOMPARE(shape.scaleY(), 1.0);
+    QCOMPARE(shape.rotation(), 0.0);
+    QCOMPARE(subPixelX, 0.0);
+    QCOMPARE(subPixelY, 0.5);
+
+    shape = KisDabShape(0.5013, 0.7, 0.3);
+    subPixelX = 0.33;
+    subPixelY = 0.9;
+
+    KisBrushStampCache::quantize(originalSize, &shape, &subPixelX, &subPixelY);
+    QVERIFY(qAbs(shape.scaleX() * originalSize.width() - 0.5013 * originalSize.width()) <= 0.125);
+    QVERIFY(qAbs(shape.scaleY() * originalSize.height() - 0.5013 * 0.7 * originalSize.height()) <= 0.125);
+    QVERIFY(qAbs(shape.rotation() - 0.3) < 0.01);
+    QCOMPARE(subPixelX, 0.25);
+    QCOMPARE(subPixelY, 1.0);
+
+    // the quantization is idempotent and symmetrical in the angle
+    KisDabShape negatedShape(shape.scale(), shape.ratio(), -shape.rotation());
+    KisDabShape requantizedShape = shape;
+
+    KisBrushStampCache::quantize(originalSize, &requantizedShape, &subPixelX, &subPixelY);
+    KisBrushStampCache::quantize(originalSize, &negatedShape, &subPixelX, &subPixelY);
+    QCOMPARE(requantizedShape.rotation(), shape.rotation());
+    QCOMPARE(negatedShape.rotation(), -shape.rotation());
+
+    // the close dabs share the same stamp, the distant ones do not
+    KisDabShape shape1(0.5, 1.0, 1.0);
+    KisDabShape shape2(0.5 + 1e-4, 1.0, 1.0 + 1e-5);
+    KisDabShape shape3(0.6, 1.0, 1.0);
+    qreal subPixel = 0.0;
+
+    KisBrushStampCache::quantize(originalSize, &shape1, &subPixel, &subPixel);
+    KisBrushStampCache::quantize(originalSize, &shape2, &subPixel, &subPixel);
+    KisBrushStampCache::quantize(originalSize, &shape3, &subPixel, &subPixel);
+
+    const KisBrushStampCache::StampType type = KisBrushStampCache::AlphaMask;
+
+    QVERIFY(KisBrushStampCache::key(originalSize, shape1, 0, 0, type) ==
+            KisBrushStampCache::key(originalSize, shape2, 0, 0, type));
+    QVERIFY(!(KisBrushStampCache::key(originalSize, shape1, 0, 0, type) ==
+              KisBrushStampCache::key(originalSize, shape3, 0, 0, type)));
+    QVERIFY(!(KisBrushStampCache::key(originalSize, shape1, 0, 0, type) ==
+              KisBrushStampCache::key(originalSize, shape1, 0.25, 0, type)));
+}
+
+void KisGbrBrushTest::testStampCacheDabSize()
+{
+    KisGbrBrush* brush = new KisGbrBrush(QString(FILES_DATA_DIR) + QDir::separator() + "testing_brush_512_bars.gbr");
+    brush->load();
+    QVERIFY(!brush->brushTipImage().isNull());
+    brush->setStampCacheEnabled(true);
+    QVERIFY(brush->stampCacheEnabled());
+
+    QScopedPointer<KisBrush> clone(brush->clone());
+    QVERIFY(clone->stampCacheEnabled());
+
+    qsrand(1);
+
+    const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintInformation info(QPointF(100.0, 100.0), 0.5);
+    KisFixedPaintDeviceSP mask = new KisFixedPaintDevice(cs);
+
+    for (int i = 0; i < 200; i++) {
+        qreal scale = qreal(qrand()) / RAND_MAX * 0.5;
+        qreal rotation = qreal(qrand() % 16) / 16 * 2 * M_PI;
+        qreal subPixelX = qreal(qrand()) / RAND_MAX;
+        qreal subPixelY = qreal(qrand()) / RAND_MAX;
+        KisDabShape shape(scale, 1.0, rotation);
+
+        const QSize expectedSize(brush->maskWidth(shape, subPixelX, subPixelY, info),
+                                 brush->maskHeight(shape, subPixelX, subPixelY, info));
+
+        KisFixedPaintDeviceSP dab = brush->paintDevice(cs, shape, info, subPixelX, subPixelY);
+        QCOMPARE(dab->bounds().size(), expectedSize);
+
+        // the stamp is fetched from the cache by the clone
+        KisFixedPaintDeviceSP cachedDab = clone->paintDevice(cs, shape, info, subPixelX, subPixelY);
+        QCOMPARE(cachedDab->bounds(), dab->bounds());
+        QVERIFY(!memcmp(cachedDab->data(), dab->data(), dab->bounds().width() * dab->bounds().height() * cs->pixelSize()));
+
+        brush->mask(mask, KoColor(Qt::black, cs), shape, info, subPixelX, subPixelY);
+        QCOMPARE(mask->bounds().size(), expectedSize);
+    }
+
+    brush->setStampCacheEnabled(false);
+    QVERIFY(!brush->stampCacheEnabled());
+
+    delete brush;
+}
+
+void KisGbrBrushTest::testStampCacheMemoryLimit()
+{
+    const int memoryLimit = 16 * 1024;
+    KisBrushStampCache cache(memoryLimit);
+
+    KisBrushStampCache::Stamp stamp;
+    stamp.size = QSize(16, 16);
+    stamp.data = QByteArray(256, 0x7f);
+
+    KisBrushStampCache::Key key;
+
+    for (int i = 0; i < 256; i++) {
+        key.angle = i;
+        cache.store(key, stamp);
+        QVERIFY(cache.memoryUsage() <= memoryLimit);
+    }
+
+    QCOMPARE(cache.numStamps(), memoryLimit / 256);
+
+    // the least recently used stamps are dropped first
+    KisBrushStampCache::Stamp fetchedStamp;
+    key.angle = 255;
+    QVERIFY(cache.fetch(key, &fetchedStamp));
+    QCOMPARE(fetchedStamp.data, stamp.data);
+
+    key.angle = 0;
+    QVERIFY(!cache.fetch(key, &fetchedStamp));
+
+    // the huge stamps are not cached at all
+    KisBrushStampCache::Stamp hugeStamp;
+    hugeStamp.size = QSize(64, 64);
+    hugeStamp.data = QByteArray(4096, 0x7f);
+
+    key.angle = 1000;
+    cache.store(key, hugeStamp);
+    QVERIFY(!cache.fetch(key, &fetchedStamp));
+
+    cache.clear();
+    QCOMPARE(cache.numStamps(), 0);
+    QCOMPARE(cache.memoryUsage(), 0);
+}
+
 QTEST_MAIN(KisGbrBrushTest)
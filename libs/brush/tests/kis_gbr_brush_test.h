@@ -37,11 +37,19 @@ private Q_SLOTS:
     void benchmarkScaling();
     void benchmarkRotation();
     void benchmarkMaskScaling();
+    void benchmarkRotationStampCache();
+    void benchmarkMaskScalingStampCache();
+    void benchmarkStrokeDabs_data();
+    void benchmarkStrokeDabs();
 
     void testPyramidLevelRounding();
     void testPyramidDabTransform();
 
     void testQPainterTransformationBorder();
+
+    void testStampCacheQuantization();
+    void testStampCacheDabSize();
+    void testStampCacheMemoryLimit();
 };
 
 #endif
@@ -148,6 +148,7 @@ void KoShapeManager::setShapes(const QList<KoShape *> &shapes, Repaint repaint)
     d->aggregate4update.clear();
     d->tree.clear();
     d->shapes.clear();
+    d->renderCache.clear();
 
     Q_FOREACH (KoShape *shape, shapes) {
         addShape(shape, repaint);
@@ -194,6 +195,7 @@ void KoShapeManager::remove(KoShape *shape)
     shape->priv()->removeShapeManager(this);
     d->selection->deselect(shape);
     d->aggregate4update.remove(shape);
+    d->renderCache.invalidate(shape);
 
     if (d->shapeUsedInRenderingTree(shape)) {
         d->tree.remove(shape);
@@ -218,6 +220,7 @@ void KoShapeManager::ShapeInterface::notifyShapeDestructed(KoShape *shape)
 {
     q->d->selection->deselect(shape);
     q->d->aggregate4update.remove(shape);
+    q->d->renderCache.remove(shape);
 
     // we cannot access RTTI of the semi-destructed shape, so just
     // unlink it lazily
@@ -281,7 +284,9 @@ void KoShapeManager::paint(QPainter &painter, const KoViewConverter &converter,
     KoShapePaintingContext paintContext(d->canvas, forPrint); //FIXME
 
     foreach (KoShape *shape, sortedShapes) {
-        renderSingleShape(shape, painter, converter, paintContext);
+        if (forPrint || !d->renderCache.paintShape(shape, painter, converter, paintContext)) {
+            renderSingleShape(shape, painter, converter, paintContext);
+        }
     }
 
 #ifdef CALLIGRA_RTREE_DEBUG
@@ -301,6 +306,11 @@ void KoShapeManager::paint(QPainter &painter, const KoViewConverter &converter,
     }
 }
 
+void KoShapeManager::setRenderCacheMemoryLimit(qint64 bytes)
+{
+    d->renderCache.setMemoryLimit(bytes);
+}
+
 void KoShapeManager::renderSingleShape(KoShape *shape, QPainter &painter, const KoViewConverter &converter, KoShapePaintingContext &paintContext)
 {
     KisQPainterStateSaver saver(&painter);
@@ -549,6 +559,12 @@ QList<KoShape *> KoShapeManager::shapesAt(const QRectF &rect, bool omitHiddenSha
 
 void KoShapeManager::update(const QRectF &rect, const KoShape *shape, bool selectionHandles)
 {
+    if (shape) {
+        d->renderCache.invalidate(shape);
+    } else {
+        d->renderCache.invalidate(rect);
+    }
+
     d->canvas->updateCanvas(rect);
     if (selectionHandles && d->selection->isSelected(shape)) {
         if (d->canvas->toolProxy())
@@ -559,6 +575,11 @@ void KoShapeManager::update(const QRectF &rect, const KoShape *shape, bool selec
 void KoShapeManager::notifyShapeChanged(KoShape *shape)
 {
     Q_ASSERT(shape);
+
+    // the shape may have changed even if its position in the tree is
+    // still pending for update
+    d->renderCache.invalidate(shape);
+
     if (d->aggregate4update.contains(shape) || d->additionalShapes.contains(shape)) {
         return;
     }
@@ -118,6 +118,14 @@ public:
      */
     void paint(QPainter &painter, const KoViewConverter &converter, bool forPrint);
 
+    /**
+     * Limits the memory used for caching the rendered shapes between
+     * calls to paint(). Zero limit disables the cache (the default).
+     *
+     * \see KoShapeRenderCache
+     */
+    void setRenderCacheMemoryLimit(qint64 bytes);
+
     /**
      * Returns the shape located at a specific point in the document.
      * If more than one shape is located at the specific point, the given selection type
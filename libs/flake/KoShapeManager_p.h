@@ -27,6 +27,7 @@
 #include "KoShape_p.h"
 #include "KoShapeContainer.h"
 #include "KoShapeManager.h"
+#include "KoShapeRenderCache.h"
 #include <KoRTree.h>
 
 class KoCanvasBase;
@@ -110,6 +111,7 @@ public:
     QHash<KoShape*, int> shapeIndexesBeforeUpdate;
     KoShapeManager *q;
     KoShapeManager::ShapeInterface shapeInterface;
+    KoShapeRenderCache renderCache;
 };
 
 #endif
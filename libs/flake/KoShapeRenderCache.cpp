@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoShapeRenderCache.h"
+
+#include <QCache>
+#include <QImage>
+#include <QPainter>
+#include <QTransform>
+
+#include <limits>
+
+#include "KoShape.h"
+#include "KoShapeContainer.h"
+#include "KoShapeManager.h"
+#include "KoViewConverter.h"
+#include "KisQPainterStateSaver.h"
+#include "kis_algebra_2d.h"
+
+
+namespace {
+
+struct CachedShape {
+    QImage image;
+
+    // the full shape-to-device transformation the image was rendered with
+    QTransform transform;
+
+    // the position of the image in device coordinates
+    QPoint offset;
+
+    // the bounding rect of the shape at the moment of rendering
+    QRectF documentRect;
+
+    QPainter::RenderHints renderHints;
+
+    /**
+     * The image can be reused if the new transformation differs
+     * from the cached one by an integer translation only
+     */
+    bool canBeReused(const QTransform &newTransform,
+                     QPainter::RenderHints newRenderHints,
+                     QPoint *newOffset) const {
+
+        if (newRenderHints != renderHints) return false;
+
+        const QPoint diff =
+            QPointF(newTransform.dx() - transform.dx(),
+                    newTransform.dy() - transform.dy()).toPoint();
+
+        const QTransform shiftedTransform =
+            transform * QTransform::fromTranslate(diff.x(), diff.y());
+
+        if (!KisAlgebra2D::fuzzyMatrixCompare(shiftedTransform, newTransform, 1e-6)) {
+            return false;
+        }
+
+        *newOffset = offset + diff;
+        return true;
+    }
+};
+
+// the cost of the cached images is measured in KiB
+int imageCost(const QSize &size) {
+    return int(qint64(size.width()) * size.height() * 4 / 1024) + 1;
+}
+
+}
+
+struct KoShapeRenderCache::Private
+{
+    QCache<const KoShape*, CachedShape> cache;
+    qint64 memoryLimit = 0;
+};
+
+KoShapeRenderCache::KoShapeRenderCache()
+    : m_d(new Private)
+{
+    m_d->cache.setMaxCost(0);
+}
+
+KoShapeRenderCache::~KoShapeRenderCache()
+{
+}
+
+void KoShapeRenderCache::setMemoryLimit(qint64 bytes)
+{
+    m_d->memoryLimit = qMax(qint64(0), bytes);
+    m_d->cache.setMaxCost(int(qMin(m_d->memoryLimit / 1024, qint64(std::numeric_limits<int>::max()))));
+}
+
+qint64 KoShapeRenderCache::memoryLimit() const
+{
+    return m_d->memoryLimit;
+}
+
+bool KoShapeRenderCache::isEnabled() const
+{
+    return m_d->cache.maxCost() > 0;
+}
+
+bool KoShapeRenderCache::paintShape(KoShape *shape, QPainter &painter, const KoViewConverter &converter, KoShapePaintingContext &paintContext)
+{
+    if (!isEnabled()) return false;
+
+    const QTransform baseTransform = painter.transform();
+    const QTransform shapeTransform = shape->absoluteTransformation(&converter) * baseTransform;
+
+    CachedShape *cachedShape = m_d->cache.object(shape);
+    QPoint offset;
+
+    if (!cachedShape ||
+        !cachedShape->canBeReused(shapeTransform, painter.renderHints(), &offset)) {
+
+        const QRectF documentRect = shape->boundingRect();
+
+        // add a couple of pixels for antialiasing
+        const QRect deviceRect =
+            baseTransform.mapRect(converter.documentToView(documentRect))
+                .toAlignedRect().adjusted(-2, -2, 2, 2);
+
+        if (deviceRect.isEmpty()) return false;
+
+        /**
+         * Huge shapes (e.g. a background rect at a high zoom) would
+         * evict everything else from the cache, just paint them
+         * directly.
+         */
+        const int cost = imageCost(deviceRect.size());
+        if (cost > m_d->cache.maxCost() / 8) {
+            m_d->cache.remove(shape);
+            return false;
+        }
+
+        cachedShape = new CachedShape();
+        cachedShape->transform = shapeTransform;
+        cachedShape->offset = deviceRect.topLeft();
+        cachedShape->documentRect = documentRect;
+        cachedShape->renderHints = painter.renderHints();
+
+        cachedShape->image = QImage(deviceRect.size(), QImage::Format_ARGB32_Premultiplied);
+        cachedShape->image.fill(Qt::transparent);
+
+        {
+            QPainter gc(&cachedShape->image);
+            gc.setRenderHints(painter.renderHints());
+            gc.setPen(Qt::NoPen);
+            gc.setBrush(Qt::NoBrush);
+            gc.setTransform(baseTransform *
+                            QTransform::fromTranslate(-deviceRect.x(), -deviceRect.y()));
+
+            KoShapeManager::renderSingleShape(shape, gc, converter, paintContext);
+        }
+
+        offset = cachedShape->offset;
+        m_d->cache.insert(shape, cachedShape, cost);
+    }
+
+    KisQPainterStateSaver saver(&painter);
+    painter.setTransform(QTransform());
+    painter.drawImage(offset, cachedShape->image);
+
+    return true;
+}
+
+void KoShapeRenderCache::invalidate(const KoShape *shape)
+{
+    while (shape) {
+        m_d->cache.remove(shape);
+        shape = shape->parent();
+    }
+}
+
+void KoShapeRenderCache::remove(const KoShape *shape)
+{
+    m_d->cache.remove(shape);
+}
+
+void KoShapeRenderCache::invalidate(const QRectF &documentRect)
+{
+    Q_FOREACH (const KoShape *shape, m_d->cache.keys()) {
+        const CachedShape *cachedShape = m_d->cache.object(shape);
+
+        if (cachedShape && cachedShape->documentRect.intersects(documentRect)) {
+            m_d->cache.remove(shape);
+        }
+    }
+}
+
+void KoShapeRenderCache::clear()
+{
+    m_d->cache.clear();
+}
+
+int KoShapeRenderCache::numCachedShapes() const
+{
+    return m_d->cache.count();
+}
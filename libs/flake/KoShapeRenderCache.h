@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOSHAPERENDERCACHE_H
+#define KOSHAPERENDERCACHE_H
+
+#include "kritaflake_export.h"
+
+#include <QScopedPointer>
+#include <QtGlobal>
+
+class KoShape;
+class KoViewConverter;
+class KoShapePaintingContext;
+class QPainter;
+class QRectF;
+
+/**
+ * A raster cache of the rendered shapes used by KoShapeManager.
+ *
+ * Every shape is rendered into a separate image together with its
+ * clipping, stroke, shadow and filter effects. When the shape is painted
+ * next time with the same transformation (an integer offset, e.g. caused
+ * by panning or by painting a different dirty rect, is allowed), the
+ * image is just blitted onto the painter.
+ *
+ * The owner is responsible for calling invalidate() whenever the shape
+ * changes. The cache is limited in size, the least recently used images
+ * are dropped first.
+ */
+class KRITAFLAKE_EXPORT KoShapeRenderCache
+{
+public:
+    KoShapeRenderCache();
+    ~KoShapeRenderCache();
+
+    /**
+     * Sets the maximum amount of memory used by the cached images.
+     * Zero limit disables the cache (the default).
+     */
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const;
+
+    bool isEnabled() const;
+
+    /**
+     * Paints \p shape onto \p painter the same way
+     * KoShapeManager::renderSingleShape() does, reusing the cached image
+     * if possible.
+     *
+     * @return false if the shape cannot be cached (the cache is disabled or
+     *         the shape is too big), then the caller should paint the shape
+     *         itself
+     */
+    bool paintShape(KoShape *shape, QPainter &painter, const KoViewConverter &converter, KoShapePaintingContext &paintContext);
+
+    /**
+     * Drops the image of \p shape and of all its parents, since
+     * the parents may have the shape baked into their own images.
+     */
+    void invalidate(const KoShape *shape);
+
+    /**
+     * Drops the image of \p shape only. Use it for the shapes being
+     * destroyed, when their parents are not accessible anymore.
+     */
+    void remove(const KoShape *shape);
+
+    /**
+     * Drops the images of all the shapes intersecting \p documentRect
+     */
+    void invalidate(const QRectF &documentRect);
+
+    void clear();
+
+    int numCachedShapes() const;
+
+private:
+    Q_DISABLE_COPY(KoShapeRenderCache)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KOSHAPERENDERCACHE_H
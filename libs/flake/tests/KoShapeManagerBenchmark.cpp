@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoShapeManagerBenchmark.h"
+
+#include <QPainter>
+#include <QTextStream>
+
+#include <svg/SvgParser.h>
+#include <KoDocumentResourceManager.h>
+#include <KoShapeManager.h>
+#include <KoShape.h>
+#include <KoViewConverter.h>
+
+#include <MockShapes.h>
+
+namespace {
+
+const int numRows = 100;
+const int numColumns = 100;
+const int cellSize = 20;
+
+/**
+ * Generates a document with 10k small hatching paths, which is
+ * a typical case for inked comic pages
+ */
+QString generateHatchingSvg()
+{
+    QString paths;
+    QTextStream s(&paths);
+
+    for (int row = 0; row < numRows; row++) {
+        for (int col = 0; col < numColumns; col++) {
+            const int x = col * cellSize;
+            const int y = row * cellSize;
+
+            s << "<path d=\"";
+            for (int i = 0; i < 4; i++) {
+                const int shift = i * cellSize / 4;
+                s << "M " << x + shift << " " << y
+                  << " L " << x << " " << y + shift << " ";
+            }
+            s << "\" fill=\"none\" stroke=\"#000000\" stroke-width=\"0.7\"/>\n";
+        }
+    }
+
+    return QString(
+        "<svg width=\"%1px\" height=\"%2px\" viewBox=\"0 0 %1 %2\""
+        "    xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"
+        "%3"
+        "</svg>")
+        .arg(numColumns * cellSize)
+        .arg(numRows * cellSize)
+        .arg(paths);
+}
+
+}
+
+void KoShapeManagerBenchmark::benchmarkPaintHatching_data()
+{
+    QTest::addColumn<int>("cacheSizeMiB");
+
+    QTest::newRow("no-cache") << 0;
+    QTest::newRow("cache-64mib") << 64;
+}
+
+void KoShapeManagerBenchmark::benchmarkPaintHatching()
+{
+    QFETCH(int, cacheSizeMiB);
+
+    KoXmlDocument doc;
+    QVERIFY(doc.setContent(generateHatchingSvg().toLatin1()));
+
+    KoDocumentResourceManager resourceManager;
+    SvgParser parser(&resourceManager);
+    QList<KoShape*> shapes = parser.parseSvg(doc.documentElement());
+    QCOMPARE(shapes.size(), numRows * numColumns);
+
+    MockCanvas canvas;
+    KoShapeManager manager(&canvas);
+    manager.setRenderCacheMemoryLimit(qint64(cacheSizeMiB) * 1024 * 1024);
+
+    Q_FOREACH (KoShape *shape, shapes) {
+        manager.addShape(shape, KoShapeManager::AddWithoutRepaint);
+    }
+
+    KoViewConverter converter;
+
+    const int tileSize = 256;
+    const QRect viewRect(0, 0, 1024, 1024);
+    QImage image(tileSize, tileSize, QImage::Format_ARGB32_Premultiplied);
+
+    int panOffset = 0;
+
+    QBENCHMARK {
+        // pan the view a bit and repaint it tile-by-tile
+        for (int y = viewRect.top(); y <= viewRect.bottom(); y += tileSize) {
+            for (int x = viewRect.left(); x <= viewRect.right(); x += tileSize) {
+                image.fill(Qt::transparent);
+
+                QPainter painter(&image);
+                painter.setRenderHint(QPainter::Antialiasing);
+                painter.setClipRect(image.rect());
+                painter.translate(-x - panOffset, -y - panOffset);
+                manager.paint(painter, converter, false);
+            }
+        }
+
+        panOffset = (panOffset + 3) % 100;
+    }
+
+    qDeleteAll(shapes);
+}
+
+QTEST_MAIN(KoShapeManagerBenchmark)
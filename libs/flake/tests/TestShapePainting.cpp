@@ -322,4 +322,66 @@ void TestShapePainting::testGroupUngroup()
 }
 
 
+void TestShapePainting::testRenderCache()
+{
+    MockShape *shape = new MockShape();
+    shape->setSize(QSizeF(20, 20));
+    shape->setPosition(QPointF(10, 10));
+
+    MockCanvas canvas;
+    KoShapeManager manager(&canvas);
+    manager.setRenderCacheMemoryLimit(16 * 1024 * 1024);
+    manager.addShape(shape);
+
+    QImage image(100, 100, QImage::Format_ARGB32);
+    KoViewConverter vc;
+
+    auto paintWithOffset = [&] (const QPointF &offset) {
+        QPainter painter(&image);
+        painter.setClipRect(image.rect());
+        painter.translate(offset);
+        manager.paint(painter, vc, false);
+    };
+
+    paintWithOffset(QPointF());
+    QCOMPARE(shape->paintedCount, 1);
+
+    // unchanged shape is blitted from the cache
+    paintWithOffset(QPointF());
+    QCOMPARE(shape->paintedCount, 1);
+
+    // integer offset (e.g. panning) still reuses the cached image
+    paintWithOffset(QPointF(5, 7));
+    QCOMPARE(shape->paintedCount, 1);
+
+    // subpixel offset needs rerendering
+    paintWithOffset(QPointF(5.5, 7));
+    QCOMPARE(shape->paintedCount, 2);
+
+    // change notification drops the cached image
+    shape->update();
+    paintWithOffset(QPointF(5.5, 7));
+    QCOMPARE(shape->paintedCount, 3);
+
+    shape->setPosition(QPointF(20, 20));
+    paintWithOffset(QPointF(5.5, 7));
+    QCOMPARE(shape->paintedCount, 4);
+
+    // the cache is not used for printing
+    {
+        QPainter painter(&image);
+        painter.setClipRect(image.rect());
+        manager.paint(painter, vc, true);
+    }
+    QCOMPARE(shape->paintedCount, 5);
+
+    // zero limit disables the cache
+    manager.setRenderCacheMemoryLimit(0);
+    paintWithOffset(QPointF(5.5, 7));
+    QCOMPARE(shape->paintedCount, 6);
+
+    manager.remove(shape);
+    delete shape;
+}
+
 QTEST_MAIN(TestShapePainting)
@@ -0,0 +1,479 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QThread>
+
+#include "kis_assert.h"
+#include "kis_debug.h"
+
+
+namespace {
+
+const int defaultBufferCapacity = 1 << 16;
+
+/**
+ * Must be initialized before s_environmentStarter below
+ */
+const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+}
+
+std::atomic<bool> KisTracer::s_enabled(false);
+
+namespace {
+
+/**
+ * The tracers alive at the moment. The tracers are identified by ids
+ * that are never reused, so a finishing thread can safely tell whether
+ * the tracer of its buffer still exists.
+ */
+struct TracersRegistry {
+    QMutex lock;
+    QHash<quint64, KisTracer*> tracers;
+};
+
+std::atomic<quint64> s_nextTracerId(1);
+
+}
+
+Q_GLOBAL_STATIC(TracersRegistry, s_registry)
+
+Q_GLOBAL_STATIC(KisTracer, s_instance)
+
+namespace {
+
+/**
+ * Starts the recording as early as possible if KRITA_TRACE_FILE
+ * is set, the trace is saved by the destructor of the tracer
+ */
+struct EnvironmentStarter {
+    EnvironmentStarter() {
+        if (qEnvironmentVariableIsSet("KRITA_TRACE_FILE")) {
+            KisTracer::instance()->start();
+        }
+    }
+};
+
+EnvironmentStarter s_environmentStarter;
+
+}
+
+
+struct KisTracer::ThreadBuffer
+{
+    ThreadBuffer(int _threadId, const QString &_threadName, int capacity)
+        : threadId(_threadId),
+          threadName(_threadName),
+          events(capacity),
+          writeIndex(0),
+          isFinished(false)
+    {
+    }
+
+    /**
+     * Called when the owning thread exits. Only the recorded events are
+     * kept, they are dropped on the next clear().
+     */
+    void finish() {
+        QMutexLocker l(&lock);
+
+        const quint64 capacity = events.size();
+        const quint64 numEvents = qMin(writeIndex, capacity);
+
+        QVector<Event> recordedEvents;
+        recordedEvents.reserve(numEvents);
+
+        for (quint64 i = writeIndex - numEvents; i < writeIndex; i++) {
+            recordedEvents.append(events[i % capacity]);
+        }
+
+        events.swap(recordedEvents);
+        writeIndex = numEvents;
+        isFinished = true;
+    }
+
+    const int threadId;
+    const QString threadName;
+
+    /**
+     * The lock is taken by the owning thread and by the readers of the
+     * trace only, so it is never contended while recording.
+     */
+    QMutex lock;
+    QVector<Event> events;
+    quint64 writeIndex;
+    bool isFinished;
+};
+
+/**
+ * The buffers of the current thread in all the tracers it has recorded
+ * events into. The destructor is called when the thread exits.
+ */
+struct KisTracer::ThreadLocalBuffers
+{
+    ~ThreadLocalBuffers() {
+        if (s_registry.isDestroyed()) return;
+
+        QMutexLocker l(&s_registry->lock);
+
+        for (auto it = buffers.constBegin(); it != buffers.constEnd(); ++it) {
+            if (s_registry->tracers.contains(it->first)) {
+                it->second->finish();
+            }
+        }
+    }
+
+    inline ThreadBuffer* find(quint64 tracerId) const {
+        for (auto it = buffers.constBegin(); it != buffers.constEnd(); ++it) {
+            if (it->first == tracerId) return it->second;
+        }
+        return 0;
+    }
+
+    /**
+     * Forgets about the buffers of the destroyed tracers
+     */
+    void removeDeadTracers() {
+        QMutexLocker l(&s_registry->lock);
+
+        for (auto it = buffers.begin(); it != buffers.end();) {
+            if (!s_registry->tracers.contains(it->first)) {
+                it = buffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    QVector<QPair<quint64, ThreadBuffer*>> buffers;
+};
+
+struct KisTracer::Private
+{
+    Private()
+        : id(s_nextTracerId++),
+          bufferCapacity(defaultBufferCapacity),
+          nextThreadId(1)
+    {
+    }
+
+    ~Private() {
+        qDeleteAll(buffers);
+    }
+
+    const quint64 id;
+
+    mutable QMutex buffersLock;
+    QList<ThreadBuffer*> buffers;
+    int bufferCapacity;
+    int nextThreadId;
+
+    QString environmentFileName;
+};
+
+KisTracer::KisTracer()
+    : m_d(new Private)
+{
+    m_d->environmentFileName = qgetenv("KRITA_TRACE_FILE");
+
+    QMutexLocker l(&s_registry->lock);
+    s_registry->tracers.insert(m_d->id, this);
+}
+
+KisTracer::~KisTracer()
+{
+    if (!m_d->environmentFileName.isEmpty()) {
+        stop();
+
+        if (!saveChromeTrace(m_d->environmentFileName)) {
+            warnKrita << "Failed to save the performance trace to" << m_d->environmentFileName;
+        }
+    }
+
+    /**
+     * After that the finishing threads will not touch our buffers
+     */
+    if (!s_registry.isDestroyed()) {
+        QMutexLocker l(&s_registry->lock);
+        s_registry->tracers.remove(m_d->id);
+    }
+}
+
+KisTracer* KisTracer::instance()
+{
+    return s_instance;
+}
+
+qint64 KisTracer::timestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+void KisTracer::start()
+{
+    s_enabled.store(true);
+}
+
+void KisTracer::stop()
+{
+    s_enabled.store(false);
+}
+
+void KisTracer::clear()
+{
+    QMutexLocker l(&m_d->buffersLock);
+
+    for (auto it = m_d->buffers.begin(); it != m_d->buffers.end();) {
+        ThreadBuffer *buffer = *it;
+
+        {
+            QMutexLocker bufferLocker(&buffer->lock);
+
+            if (!buffer->isFinished) {
+                buffer->writeIndex = 0;
+                if (buffer->events.size() != m_d->bufferCapacity) {
+                    buffer->events = QVector<Event>(m_d->bufferCapacity);
+                }
+
+                ++it;
+                continue;
+            }
+        }
+
+        // the thread has exited, so nobody else can access its buffer
+        delete buffer;
+        it = m_d->buffers.erase(it);
+    }
+}
+
+void KisTracer::setBufferCapacity(int capacity)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(capacity > 0);
+
+    QMutexLocker l(&m_d->buffersLock);
+    m_d->bufferCapacity = capacity;
+}
+
+KisTracer::ThreadBuffer* KisTracer::threadBuffer()
+{
+    static thread_local ThreadLocalBuffers localBuffers;
+
+    ThreadBuffer *buffer = localBuffers.find(m_d->id);
+    if (buffer) return buffer;
+
+    localBuffers.removeDeadTracers();
+
+    QThread *thread = QThread::currentThread();
+    QString threadName = thread->objectName();
+
+    QMutexLocker l(&m_d->buffersLock);
+
+    const int threadId = m_d->nextThreadId++;
+
+    if (threadName.isEmpty()) {
+        threadName =
+            QCoreApplication::instance() &&
+            QCoreApplication::instance()->thread() == thread ?
+            QString("GUI Thread") : QString("Thread %1").arg(threadId);
+    }
+
+    buffer = new ThreadBuffer(threadId, threadName, m_d->bufferCapacity);
+    m_d->buffers.append(buffer);
+    localBuffers.buffers.append(qMakePair(m_d->id, buffer));
+
+    return buffer;
+}
+
+void KisTracer::addEvent(Event &event)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    event.threadId = buffer->threadId;
+
+    QMutexLocker l(&buffer->lock);
+
+    buffer->events.data()[buffer->writeIndex % buffer->events.size()] = event;
+    buffer->writeIndex++;
+}
+
+void KisTracer::addComplete(const char *category, const char *name, qint64 start, const QRect &rect)
+{
+    if (!isEnabled()) return;
+
+    Event event;
+    event.type = Complete;
+    event.category = category;
+    event.name = name;
+    event.timestamp = start;
+    event.duration = timestamp() - start;
+    event.rect = rect;
+
+    addEvent(event);
+}
+
+void KisTracer::addInstant(const char *category, const char *name, const QRect &rect)
+{
+    if (!isEnabled()) return;
+
+    Event event;
+    event.type = Instant;
+    event.category = category;
+    event.name = name;
+    event.timestamp = timestamp();
+    event.rect = rect;
+
+    addEvent(event);
+}
+
+void KisTracer::addCounter(const char *category, const char *name, qint64 value)
+{
+    if (!isEnabled()) return;
+
+    Event event;
+    event.type = Counter;
+    event.category = category;
+    event.name = name;
+    event.timestamp = timestamp();
+    event.value = value;
+
+    addEvent(event);
+}
+
+QVector<KisTracer::Event> KisTracer::events() const
+{
+    QVector<Event> result;
+
+    {
+        QMutexLocker l(&m_d->buffersLock);
+
+        Q_FOREACH (ThreadBuffer *buffer, m_d->buffers) {
+            QMutexLocker bufferLocker(&buffer->lock);
+
+            const quint64 capacity = buffer->events.size();
+            const quint64 numEvents = qMin(buffer->writeIndex, capacity);
+
+            for (quint64 i = buffer->writeIndex - numEvents; i < buffer->writeIndex; i++) {
+                result.append(buffer->events[i % capacity]);
+            }
+        }
+    }
+
+    std::stable_sort(result.begin(), result.end(),
+                     [] (const Event &lhs, const Event &rhs) {
+                         return lhs.timestamp < rhs.timestamp;
+                     });
+
+    return result;
+}
+
+QByteArray KisTracer::chromeTrace() const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+
+    {
+        QMutexLocker l(&m_d->buffersLock);
+
+        Q_FOREACH (ThreadBuffer *buffer, m_d->buffers) {
+            QJsonObject args;
+            args["name"] = buffer->threadName;
+
+            QJsonObject object;
+            object["name"] = "thread_name";
+            object["ph"] = "M";
+            object["pid"] = pid;
+            object["tid"] = buffer->threadId;
+            object["args"] = args;
+
+            traceEvents.append(object);
+        }
+    }
+
+    Q_FOREACH (const Event &event, events()) {
+        QJsonObject object;
+        object["name"] = QString::fromLatin1(event.name);
+        object["cat"] = QString::fromLatin1(event.category);
+        object["pid"] = pid;
+        object["tid"] = event.threadId;
+        object["ts"] = 0.001 * event.timestamp;
+
+        QJsonObject args;
+
+        if (!event.rect.isEmpty()) {
+            args["x"] = event.rect.x();
+            args["y"] = event.rect.y();
+            args["width"] = event.rect.width();
+            args["height"] = event.rect.height();
+        }
+
+        switch (event.type) {
+        case Complete:
+            object["ph"] = "X";
+            object["dur"] = 0.001 * event.duration;
+            break;
+        case Instant:
+            object["ph"] = "i";
+            object["s"] = "t";
+            break;
+        case Counter:
+            object["ph"] = "C";
+            args[QString::fromLatin1(event.name)] = event.value;
+            break;
+        }
+
+        if (!args.isEmpty()) {
+            object["args"] = args;
+        }
+
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool KisTracer::saveChromeTrace(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    const QByteArray data = chromeTrace();
+    return file.write(data) == data.size();
+}
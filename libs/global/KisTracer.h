@@ -0,0 +1,185 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISTRACER_H
+#define KISTRACER_H
+
+#include <atomic>
+
+#include <QtGlobal>
+#include <QRect>
+#include <QVector>
+#include <QScopedPointer>
+
+#include <config-tracing.h>
+#include "kritaglobal_export.h"
+
+/**
+ * A low-overhead recorder of the timings of strokes, update walkers,
+ * tile swapping, texture uploads and paintop dabs.
+ *
+ * Every thread writes the events into its own ring buffer, so recording
+ * an event never waits for other threads. When the buffer is full, the
+ * oldest events are overwritten. When a thread finishes, its buffer is
+ * shrunk to the recorded events and kept until clear(). The recorded events can be exported in
+ * the Chrome trace-event format and opened in chrome://tracing.
+ *
+ * The recording is started either with "Record Performance Trace"
+ * action or by setting KRITA_TRACE_FILE environment variable. In the
+ * latter case the trace is saved into the file on exit.
+ *
+ * Use the KIS_TRACE_* macros to record the events. When Krita is built
+ * with HAVE_KIS_TRACING switched off, the macros are compiled into
+ * nothing. Otherwise, a disabled tracer costs a single relaxed load.
+ *
+ * NOTE: the category and the name of an event are not copied, they
+ *       should be string literals.
+ */
+class KRITAGLOBAL_EXPORT KisTracer
+{
+public:
+    enum EventType {
+        Complete,
+        Instant,
+        Counter
+    };
+
+    struct Event {
+        Event()
+            : type(Instant), category(0), name(0),
+              timestamp(0), duration(0), value(0), threadId(0) {}
+
+        EventType type;
+        const char *category;
+        const char *name;
+        qint64 timestamp; ///< nanoseconds since the tracer creation
+        qint64 duration;  ///< nanoseconds, Complete events only
+        QRect rect;       ///< optional, exported as the arguments of the event
+        qint64 value;     ///< the value of a Counter event
+        int threadId;
+    };
+
+    class Scope
+    {
+    public:
+        inline Scope(const char *category, const char *name, const QRect &rect = QRect())
+            : m_category(category),
+              m_name(name),
+              m_rect(rect),
+              m_start(KisTracer::isEnabled() ? KisTracer::timestamp() : -1)
+        {
+        }
+
+        inline ~Scope() {
+            if (m_start >= 0) {
+                KisTracer::instance()->addComplete(m_category, m_name, m_start, m_rect);
+            }
+        }
+
+    private:
+        Q_DISABLE_COPY(Scope)
+
+        const char *m_category;
+        const char *m_name;
+        QRect m_rect;
+        qint64 m_start;
+    };
+
+public:
+    KisTracer();
+    ~KisTracer();
+
+    static KisTracer* instance();
+
+    static inline bool isEnabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static qint64 timestamp();
+
+    void start();
+    void stop();
+
+    /**
+     * Drops all the recorded events and frees the buffers of the
+     * threads that have already finished
+     */
+    void clear();
+
+    /**
+     * Sets the number of events every thread buffer can hold. Applies
+     * to the buffers created after the call.
+     */
+    void setBufferCapacity(int capacity);
+
+    void addComplete(const char *category, const char *name, qint64 start, const QRect &rect = QRect());
+    void addInstant(const char *category, const char *name, const QRect &rect = QRect());
+    void addCounter(const char *category, const char *name, qint64 value);
+
+    /**
+     * \return the events of all the threads sorted by their timestamp
+     */
+    QVector<Event> events() const;
+
+    QByteArray chromeTrace() const;
+    bool saveChromeTrace(const QString &fileName) const;
+
+private:
+    struct ThreadBuffer;
+    struct ThreadLocalBuffers;
+    ThreadBuffer* threadBuffer();
+    void addEvent(Event &event);
+
+private:
+    static std::atomic<bool> s_enabled;
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#define KIS_TRACE_CONCAT_IMPL(a, b) a##b
+#define KIS_TRACE_CONCAT(a, b) KIS_TRACE_CONCAT_IMPL(a, b)
+
+#if HAVE_KIS_TRACING
+
+#define KIS_TRACE_SCOPE(category, name)                                 \
+    KisTracer::Scope KIS_TRACE_CONCAT(kisTraceScope, __LINE__)(category, name)
+
+#define KIS_TRACE_SCOPE_RECT(category, name, rect)                      \
+    KisTracer::Scope KIS_TRACE_CONCAT(kisTraceScope, __LINE__)(category, name, rect)
+
+#define KIS_TRACE_INSTANT(category, name)                               \
+    do { if (KisTracer::isEnabled()) KisTracer::instance()->addInstant(category, name); } while (0)
+
+#define KIS_TRACE_INSTANT_RECT(category, name, rect)                    \
+    do { if (KisTracer::isEnabled()) KisTracer::instance()->addInstant(category, name, rect); } while (0)
+
+#define KIS_TRACE_COUNTER(category, name, value)                        \
+    do { if (KisTracer::isEnabled()) KisTracer::instance()->addCounter(category, name, value); } while (0)
+
+#else
+
+#define KIS_TRACE_SCOPE(category, name)
+#define KIS_TRACE_SCOPE_RECT(category, name, rect)
+#define KIS_TRACE_INSTANT(category, name) do {} while (0)
+#define KIS_TRACE_INSTANT_RECT(category, name, rect) do {} while (0)
+#define KIS_TRACE_COUNTER(category, name, value) do {} while (0)
+
+#endif
+
+#endif // KISTRACER_H
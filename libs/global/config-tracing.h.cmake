@@ -0,0 +1,4 @@
+/* config-tracing.h.  Generated by cmake from config-tracing.h.cmake */
+
+/* Define to 1 if the structured tracing of strokes and jobs is compiled in */
+#cmakedefine01 HAVE_KIS_TRACING
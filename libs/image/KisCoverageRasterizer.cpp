@@ -0,0 +1,401 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisCoverageRasterizer.h"
+
+#include <cmath>
+#include <algorithm>
+#include <string.h>
+
+#include <QPainterPath>
+#include <QPolygonF>
+
+#include "kis_assert.h"
+
+
+namespace {
+
+struct Edge {
+    qreal x0, y0, x1, y1;
+};
+
+inline int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+struct NonZeroRule {
+    static inline quint8 coverage(float value) {
+        value = std::fabs(value);
+        return value >= 1.0f ? 255 : quint8(value * 255.0f + 0.5f);
+    }
+};
+
+struct OddEvenRule {
+    static inline quint8 coverage(float value) {
+        value = std::fabs(value);
+        value -= 2.0f * std::floor(0.5f * value);
+        if (value > 1.0f) {
+            value = 2.0f - value;
+        }
+        return quint8(value * 255.0f + 0.5f);
+    }
+};
+
+/**
+ * Adds the signed area covered by the line (x0, y0)-(x1, y1) to the
+ * accumulation buffer. After the buffer row is summed up from left to
+ * right, every cell contains the winding-weighted area of the path inside
+ * the pixel.
+ *
+ * The x coordinates should already be clipped into [0, stride - 2].
+ */
+void accumulateLine(float *accumulator, int stride, int height,
+                    int *rowMin, int *rowMax,
+                    qreal x0, qreal y0, qreal x1, qreal y1)
+{
+    if (y0 == y1) return;
+
+    qreal dir = 1.0;
+    if (y0 > y1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1.0;
+    }
+
+    const qreal dxdy = (x1 - x0) / (y1 - y0);
+    const qreal maxX = stride - 2;
+
+    const int firstRow = qMax(0, int(std::floor(y0)));
+    const int lastRow = qMin(height, int(std::ceil(y1)));
+
+    for (int y = firstRow; y < lastRow; y++) {
+        const qreal top = qMax(qreal(y), y0);
+        const qreal bottom = qMin(qreal(y + 1), y1);
+        if (bottom <= top) continue;
+
+        const qreal d = (bottom - top) * dir;
+
+        const qreal xa = qBound(qreal(0.0), x0 + (top - y0) * dxdy, maxX);
+        const qreal xb = qBound(qreal(0.0), x0 + (bottom - y0) * dxdy, maxX);
+
+        const qreal left = qMin(xa, xb);
+        const qreal right = qMax(xa, xb);
+
+        const qreal leftFloor = std::floor(left);
+        const int li = int(leftFloor);
+        const int ri = int(std::ceil(right));
+
+        float *line = accumulator + y * stride;
+
+        if (ri <= li + 1) {
+            const qreal xmf = 0.5 * (left + right) - leftFloor;
+            line[li] += d - d * xmf;
+            line[li + 1] += d * xmf;
+
+            rowMin[y] = qMin(rowMin[y], li);
+            rowMax[y] = qMax(rowMax[y], li + 1);
+        } else {
+            const qreal s = 1.0 / (right - left);
+            const qreal lf = left - leftFloor;
+            const qreal a0 = 0.5 * s * (1.0 - lf) * (1.0 - lf);
+            const qreal rf = right - ri + 1;
+            const qreal am = 0.5 * s * rf * rf;
+
+            line[li] += d * a0;
+
+            if (ri == li + 2) {
+                line[li + 1] += d * (1.0 - a0 - am);
+            } else {
+                const qreal a1 = s * (1.5 - lf);
+                line[li + 1] += d * (a1 - a0);
+
+                for (int xi = li + 2; xi < ri - 1; xi++) {
+                    line[xi] += d * s;
+                }
+
+                const qreal a2 = a1 + (ri - li - 3) * s;
+                line[ri - 1] += d * (1.0 - a2 - am);
+            }
+
+            line[ri] += d * am;
+
+            rowMin[y] = qMin(rowMin[y], li);
+            rowMax[y] = qMax(rowMax[y], ri);
+        }
+    }
+}
+
+template <class FillRule>
+void resolveCoverage(const float *accumulator, int stride, int width, int height,
+                     const int *rowMin, const int *rowMax,
+                     quint8 *coverage, int *firstCovered, int *lastCovered)
+{
+    for (int y = 0; y < height; y++) {
+        const float *line = accumulator + y * stride;
+        quint8 *out = coverage + y * width;
+
+        firstCovered[y] = width;
+        lastCovered[y] = -1;
+
+        if (rowMax[y] < 0) {
+            memset(out, 0, width);
+            continue;
+        }
+
+        const int first = qMin(rowMin[y], width);
+        const int last = qMin(rowMax[y], width - 1);
+
+        memset(out, 0, first);
+
+        float sum = 0.0f;
+        int x = first;
+
+        for (; x <= last; x++) {
+            sum += line[x];
+            out[x] = FillRule::coverage(sum);
+        }
+
+        /**
+         * Nothing is accumulated to the right of the last touched
+         * cell, so the rest of the row has the same coverage
+         */
+        const quint8 restCoverage = FillRule::coverage(sum);
+
+        if (x < width) {
+            memset(out + x, restCoverage, width - x);
+        }
+
+        firstCovered[y] = first;
+        lastCovered[y] = restCoverage ? width - 1 : last;
+    }
+}
+
+}
+
+struct KisCoverageRasterizer::Private
+{
+    QRect rect;
+    QSize gridSize;
+    QPoint gridOrigin;
+    Qt::FillRule fillRule;
+    int firstGridRow;
+
+    QVector<Edge> edges;
+    QVector<QVector<int>> bandEdges;
+
+    void addEdge(const QPointF &p0, const QPointF &p1);
+    void splitAndAddEdge(const QPointF &p0, const QPointF &p1);
+    int bandForRow(int localY) const;
+};
+
+int KisCoverageRasterizer::Private::bandForRow(int localY) const
+{
+    return floorDiv(localY + rect.y() - gridOrigin.y(), gridSize.height()) - firstGridRow;
+}
+
+void KisCoverageRasterizer::Private::addEdge(const QPointF &p0, const QPointF &p1)
+{
+    if (p0.y() == p1.y()) return;
+
+    const qreal maxX = rect.width();
+
+    Edge edge;
+    edge.x0 = qBound(qreal(0.0), p0.x(), maxX);
+    edge.y0 = p0.y();
+    edge.x1 = qBound(qreal(0.0), p1.x(), maxX);
+    edge.y1 = p1.y();
+
+    const int index = edges.size();
+    edges.append(edge);
+
+    const qreal top = qMin(edge.y0, edge.y1);
+    const qreal bottom = qMax(edge.y0, edge.y1);
+
+    const int firstBand = qMax(0, bandForRow(int(std::floor(top))));
+    const int lastBand = qMin(bandEdges.size() - 1, bandForRow(int(std::ceil(bottom)) - 1));
+
+    for (int i = firstBand; i <= lastBand; i++) {
+        bandEdges[i].append(index);
+    }
+}
+
+void KisCoverageRasterizer::Private::splitAndAddEdge(const QPointF &p0, const QPointF &p1)
+{
+    if (p0.y() == p1.y()) return;
+    if (qMax(p0.y(), p1.y()) <= 0 || qMin(p0.y(), p1.y()) >= rect.height()) return;
+
+    /**
+     * The parts of the edge lying outside the rect still change the
+     * winding of the pixels to the right of them, so instead of being
+     * dropped, they are projected onto the borders of the rect.
+     */
+    const qreal borders[] = {0.0, qreal(rect.width())};
+    qreal crossings[2];
+    int numCrossings = 0;
+
+    for (qreal border : borders) {
+        if ((p0.x() - border) * (p1.x() - border) < 0) {
+            crossings[numCrossings++] = (border - p0.x()) / (p1.x() - p0.x());
+        }
+    }
+
+    if (numCrossings == 2 && crossings[0] > crossings[1]) {
+        std::swap(crossings[0], crossings[1]);
+    }
+
+    QPointF start = p0;
+    for (int i = 0; i < numCrossings; i++) {
+        const QPointF end = p0 + crossings[i] * (p1 - p0);
+        addEdge(start, end);
+        start = end;
+    }
+    addEdge(start, p1);
+}
+
+KisCoverageRasterizer::KisCoverageRasterizer(const QPainterPath &path, const QRect &rect,
+                                             const QSize &gridSize, const QPoint &gridOrigin)
+    : m_d(new Private)
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(gridSize.width() > 0 && gridSize.height() > 0);
+
+    m_d->rect = rect;
+    m_d->gridSize = !gridSize.isEmpty() ? gridSize : QSize(64, 64);
+    m_d->gridOrigin = gridOrigin;
+    m_d->fillRule = path.fillRule();
+    m_d->firstGridRow = floorDiv(rect.y() - gridOrigin.y(), m_d->gridSize.height());
+
+    if (rect.isEmpty()) return;
+
+    const int lastGridRow = floorDiv(rect.bottom() - gridOrigin.y(), m_d->gridSize.height());
+    m_d->bandEdges.resize(lastGridRow - m_d->firstGridRow + 1);
+
+    const QPointF offset = rect.topLeft();
+
+    Q_FOREACH (const QPolygonF &polygon, path.toSubpathPolygons()) {
+        const int numPoints = polygon.size();
+
+        // the subpaths are closed implicitly, the same way QPainter does
+        for (int i = 0; i < numPoints; i++) {
+            m_d->splitAndAddEdge(polygon[i] - offset, polygon[(i + 1) % numPoints] - offset);
+        }
+    }
+}
+
+KisCoverageRasterizer::~KisCoverageRasterizer()
+{
+}
+
+QRect KisCoverageRasterizer::rect() const
+{
+    return m_d->rect;
+}
+
+int KisCoverageRasterizer::numBands() const
+{
+    return m_d->bandEdges.size();
+}
+
+QRect KisCoverageRasterizer::bandRect(int index) const
+{
+    const int gridHeight = m_d->gridSize.height();
+    const int gridTop = m_d->gridOrigin.y() + (m_d->firstGridRow + index) * gridHeight;
+    const int top = qMax(m_d->rect.top(), gridTop);
+    const int bottom = qMin(m_d->rect.bottom(), gridTop + gridHeight - 1);
+
+    return QRect(m_d->rect.left(), top, m_d->rect.width(), bottom - top + 1);
+}
+
+void KisCoverageRasterizer::renderBand(int index, Band *band) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(index >= 0 && index < numBands());
+
+    const QRect rc = bandRect(index);
+    band->rect = rc;
+    band->coveredRects.clear();
+
+    const int width = rc.width();
+    const int height = rc.height();
+
+    // the edges projected onto the right border write into two extra cells
+    const int stride = width + 2;
+
+    QVector<float> accumulator(stride * height, 0.0f);
+    QVector<int> rowMin(height, stride);
+    QVector<int> rowMax(height, -1);
+
+    const qreal offsetY = rc.y() - m_d->rect.y();
+
+    Q_FOREACH (int edgeIndex, m_d->bandEdges[index]) {
+        const Edge &e = m_d->edges[edgeIndex];
+        accumulateLine(accumulator.data(), stride, height,
+                       rowMin.data(), rowMax.data(),
+                       e.x0, e.y0 - offsetY, e.x1, e.y1 - offsetY);
+    }
+
+    QVector<int> firstCovered(height);
+    QVector<int> lastCovered(height);
+
+    band->coverage.resize(width * height);
+
+    if (m_d->fillRule == Qt::OddEvenFill) {
+        resolveCoverage<OddEvenRule>(accumulator.constData(), stride, width, height,
+                                     rowMin.constData(), rowMax.constData(),
+                                     band->coverage.data(),
+                                     firstCovered.data(), lastCovered.data());
+    } else {
+        resolveCoverage<NonZeroRule>(accumulator.constData(), stride, width, height,
+                                     rowMin.constData(), rowMax.constData(),
+                                     band->coverage.data(),
+                                     firstCovered.data(), lastCovered.data());
+    }
+
+    /**
+     * Find the grid cells touched by the covered spans
+     */
+    const int gridWidth = m_d->gridSize.width();
+    const int gridLeft = m_d->gridOrigin.x();
+    const int firstGridColumn = floorDiv(rc.left() - gridLeft, gridWidth);
+    const int numCells = floorDiv(rc.right() - gridLeft, gridWidth) - firstGridColumn + 1;
+
+    QVector<int> cellTop(numCells, height);
+    QVector<int> cellBottom(numCells, -1);
+
+    for (int y = 0; y < height; y++) {
+        if (lastCovered[y] < firstCovered[y]) continue;
+
+        const int firstCell = floorDiv(rc.left() + firstCovered[y] - gridLeft, gridWidth) - firstGridColumn;
+        const int lastCell = floorDiv(rc.left() + lastCovered[y] - gridLeft, gridWidth) - firstGridColumn;
+
+        for (int i = firstCell; i <= lastCell; i++) {
+            cellTop[i] = qMin(cellTop[i], y);
+            cellBottom[i] = qMax(cellBottom[i], y);
+        }
+    }
+
+    for (int i = 0; i < numCells; i++) {
+        if (cellBottom[i] < 0) continue;
+
+        const int cellLeft = gridLeft + (firstGridColumn + i) * gridWidth;
+        const int left = qMax(rc.left(), cellLeft);
+        const int right = qMin(rc.right(), cellLeft + gridWidth - 1);
+
+        band->coveredRects.append(QRect(left, rc.y() + cellTop[i],
+                                        right - left + 1, cellBottom[i] - cellTop[i] + 1));
+    }
+}
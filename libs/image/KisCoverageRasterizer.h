@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISCOVERAGERASTERIZER_H
+#define KISCOVERAGERASTERIZER_H
+
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include <QScopedPointer>
+
+#include "kritaimage_export.h"
+
+class QPainterPath;
+
+/**
+ * An anti-aliased scanline rasterizer that converts a painter path into
+ * 8-bit coverage values without going through QImage and QPainter.
+ *
+ * The coverage is calculated from the exact area of every pixel covered
+ * by the path, which is what QPainter does for anti-aliased fills, so the
+ * result is the same up to rounding. Both Qt::OddEvenFill and
+ * Qt::WindingFill rules are supported.
+ *
+ * The rasterized rect is split into horizontal bands aligned to the grid
+ * of \p gridSize passing through \p gridOrigin (usually the tile grid of
+ * the destination device, which is shifted by the offset of the device).
+ * The bands are independent from each other, so renderBand() can
+ * be called from several threads at the same time. For every band the
+ * rasterizer reports the grid cells that got non-zero coverage, so the
+ * caller can skip the empty areas of the band altogether.
+ */
+class KRITAIMAGE_EXPORT KisCoverageRasterizer
+{
+public:
+    struct Band {
+        /// the rect of the band in the coordinates of the path
+        QRect rect;
+
+        /// rect.width() * rect.height() coverage values, row by row
+        QVector<quint8> coverage;
+
+        /// the grid cells of the band with non-zero coverage, trimmed to
+        /// the rows actually covered
+        QVector<QRect> coveredRects;
+
+        inline const quint8* coverageAt(int x, int y) const {
+            return coverage.constData() + (y - rect.y()) * rect.width() + (x - rect.x());
+        }
+    };
+
+public:
+    KisCoverageRasterizer(const QPainterPath &path, const QRect &rect,
+                          const QSize &gridSize = QSize(64, 64),
+                          const QPoint &gridOrigin = QPoint());
+    ~KisCoverageRasterizer();
+
+    /**
+     * \return the rect being rasterized
+     */
+    QRect rect() const;
+
+    int numBands() const;
+    QRect bandRect(int index) const;
+
+    /**
+     * Calculates the coverage of the band \p index. Thread-safe.
+     */
+    void renderBand(int index, Band *band) const;
+
+private:
+    Q_DISABLE_COPY(KisCoverageRasterizer)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISCOVERAGERASTERIZER_H
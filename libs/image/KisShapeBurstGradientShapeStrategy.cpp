@@ -0,0 +1,252 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisShapeBurstGradientShapeStrategy.h"
+
+#include <cmath>
+#include <limits>
+
+#include <QPainterPath>
+#include <QRect>
+#include <QTransform>
+#include <QVector>
+
+#include "kis_global.h"
+#include "KisCoverageRasterizer.h"
+
+
+namespace {
+
+/**
+ * The maximum width or height of the grid the distance is calculated
+ * on. Bigger shapes are transformed on a downsampled grid.
+ */
+const int maxGridDimension = 2048;
+
+/**
+ * The value of the pixels inside the shape before the transform. It
+ * should be bigger than any squared distance on the grid, but stay
+ * finite to keep the arithmetics of the envelope sane.
+ */
+const float infiniteDistance = 1e20f;
+
+/**
+ * Calculates the squared distance transform of the sampled function \p f
+ * of length \p n and writes it into \p d. \p v and \p z are the buffers
+ * for the lower envelope of the parabolas, of length n and n + 1.
+ */
+void distanceTransform1D(const double *f, int n, double *d, int *v, double *z)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+
+    int k = 0;
+    v[0] = 0;
+    z[0] = -inf;
+    z[1] = inf;
+
+    for (int q = 1; q < n; q++) {
+        double s = 0;
+
+        forever {
+            const int p = v[k];
+            s = ((f[q] + double(q) * q) - (f[p] + double(p) * p)) / (2.0 * (q - p));
+            if (s > z[k]) break;
+            k--;
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = inf;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) {
+            k++;
+        }
+
+        const int p = v[k];
+        d[q] = double(q - p) * (q - p) + f[p];
+    }
+}
+
+}
+
+struct KisShapeBurstGradientShapeStrategy::Private
+{
+    QPoint origin;
+    int step = 1;
+    int width = 0;
+    int height = 0;
+
+    /// normalized distances, row by row
+    QVector<float> grid;
+
+    double sample(double gx, double gy) const {
+        gx = qBound(0.0, gx, width - 1.0);
+        gy = qBound(0.0, gy, height - 1.0);
+
+        const int x0 = int(gx);
+        const int y0 = int(gy);
+        const int x1 = qMin(x0 + 1, width - 1);
+        const int y1 = qMin(y0 + 1, height - 1);
+
+        const double fx = gx - x0;
+        const double fy = gy - y0;
+
+        const float *row0 = grid.constData() + y0 * width;
+        const float *row1 = grid.constData() + y1 * width;
+
+        const double top = row0[x0] + fx * (row0[x1] - row0[x0]);
+        const double bottom = row1[x0] + fx * (row1[x1] - row1[x0]);
+
+        return top + fy * (bottom - top);
+    }
+};
+
+KisShapeBurstGradientShapeStrategy::KisShapeBurstGradientShapeStrategy(const QPainterPath &path, const QRect &boundingRect)
+    : m_d(new Private)
+{
+    const int maxDimension = qMax(boundingRect.width(), boundingRect.height());
+    m_d->step = qMax(1, (maxDimension + maxGridDimension - 1) / maxGridDimension);
+
+    /**
+     * The grid has a margin of one cell, so that every row and column of
+     * it has at least one cell outside the shape
+     */
+    const QRect gridBounds = kisGrowRect(boundingRect, m_d->step);
+
+    m_d->origin = gridBounds.topLeft();
+    m_d->width = (gridBounds.width() + m_d->step - 1) / m_d->step;
+    m_d->height = (gridBounds.height() + m_d->step - 1) / m_d->step;
+
+    const int width = m_d->width;
+    const int height = m_d->height;
+
+    m_d->grid = QVector<float>(width * height, 0.0f);
+    float *grid = m_d->grid.data();
+
+    const QTransform pathToGrid =
+        QTransform::fromTranslate(-m_d->origin.x(), -m_d->origin.y()) *
+        QTransform::fromScale(1.0 / m_d->step, 1.0 / m_d->step);
+
+    KisCoverageRasterizer rasterizer(pathToGrid.map(path), QRect(0, 0, width, height));
+    KisCoverageRasterizer::Band band;
+
+    for (int i = 0; i < rasterizer.numBands(); i++) {
+        rasterizer.renderBand(i, &band);
+
+        Q_FOREACH (const QRect &rc, band.coveredRects) {
+            for (int y = rc.y(); y <= rc.bottom(); y++) {
+                const quint8 *coverage = band.coverageAt(rc.x(), y);
+                float *dst = grid + y * width + rc.x();
+
+                for (int x = 0; x < rc.width(); x++) {
+                    if (coverage[x] >= 128) {
+                        dst[x] = infiniteDistance;
+                    }
+                }
+            }
+        }
+    }
+
+    for (int x = 0; x < width; x++) {
+        grid[x] = 0.0f;
+        grid[(height - 1) * width + x] = 0.0f;
+    }
+
+    for (int y = 0; y < height; y++) {
+        grid[y * width] = 0.0f;
+        grid[y * width + width - 1] = 0.0f;
+    }
+
+    const int maxLength = qMax(width, height);
+    QVector<double> f(maxLength);
+    QVector<double> d(maxLength);
+    QVector<int> v(maxLength);
+    QVector<double> z(maxLength + 1);
+
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            f[y] = grid[y * width + x];
+        }
+
+        distanceTransform1D(f.constData(), height, d.data(), v.data(), z.data());
+
+        for (int y = 0; y < height; y++) {
+            grid[y * width + x] = d[y];
+        }
+    }
+
+    float maxDistance = 0.0f;
+
+    for (int y = 0; y < height; y++) {
+        float *row = grid + y * width;
+
+        for (int x = 0; x < width; x++) {
+            f[x] = row[x];
+        }
+
+        distanceTransform1D(f.constData(), width, d.data(), v.data(), z.data());
+
+        for (int x = 0; x < width; x++) {
+            row[x] = std::sqrt(d[x]);
+            maxDistance = qMax(maxDistance, row[x]);
+        }
+    }
+
+    if (maxDistance > 0.0f) {
+        const float scale = 1.0f / maxDistance;
+
+        for (int i = 0; i < m_d->grid.size(); i++) {
+            grid[i] *= scale;
+        }
+    }
+}
+
+KisShapeBurstGradientShapeStrategy::~KisShapeBurstGradientShapeStrategy()
+{
+}
+
+double KisShapeBurstGradientShapeStrategy::valueAt(double x, double y) const
+{
+    const double gx = (x - m_d->origin.x() + 0.5) / m_d->step - 0.5;
+    const double gy = (y - m_d->origin.y() + 0.5) / m_d->step - 0.5;
+
+    return m_d->sample(gx, gy);
+}
+
+void KisShapeBurstGradientShapeStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    /**
+     * On a full-resolution grid the pixels are the nodes of the grid,
+     * so a row can be just copied
+     */
+    if (m_d->step == 1 && x == std::floor(x) && y == std::floor(y)) {
+        const int gy = qBound(0, int(y) - m_d->origin.y(), m_d->height - 1);
+        const int gx = int(x) - m_d->origin.x();
+        const float *row = m_d->grid.constData() + gy * m_d->width;
+
+        for (int i = 0; i < count; i++) {
+            values[i] = row[qBound(0, gx + i, m_d->width - 1)];
+        }
+    } else {
+        KisGradientShapeStrategy::valuesAt(x, y, count, values);
+    }
+}
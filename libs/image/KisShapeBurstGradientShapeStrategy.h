@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSHAPEBURSTGRADIENTSHAPESTRATEGY_H
+#define KISSHAPEBURSTGRADIENTSHAPESTRATEGY_H
+
+#include "kis_gradient_shape_strategy.h"
+
+#include <QScopedPointer>
+
+#include "kritaimage_export.h"
+
+class QPainterPath;
+class QRect;
+
+/**
+ * A shape-burst gradient shape based on the exact Euclidean distance
+ * transform of the rasterized shape.
+ *
+ * The value of a pixel is its distance to the nearest pixel outside the
+ * shape divided by the maximum distance inside the shape, so it is 0 on
+ * the border of the shape (and outside of it) and 1 in the pixel(s)
+ * farthest from the border.
+ *
+ * The transform is calculated in linear time with the algorithm described
+ * in "Distance Transforms of Sampled Functions" by P. Felzenszwalb and
+ * D. Huttenlocher. Huge shapes are transformed on a coarser grid, which
+ * is interpolated bilinearly.
+ */
+class KRITAIMAGE_EXPORT KisShapeBurstGradientShapeStrategy : public KisGradientShapeStrategy
+{
+public:
+    KisShapeBurstGradientShapeStrategy(const QPainterPath &path, const QRect &boundingRect);
+    ~KisShapeBurstGradientShapeStrategy() override;
+
+    double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISSHAPEBURSTGRADIENTSHAPESTRATEGY_H
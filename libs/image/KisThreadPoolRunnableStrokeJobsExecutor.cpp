@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisThreadPoolRunnableStrokeJobsExecutor.h"
+
+#include <QAtomicInt>
+#include <QGlobalStatic>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include <KisRunnableStrokeJobData.h>
+#include <KisSharedRunnable.h>
+#include <KisSharedThreadPoolAdapter.h>
+#include <kis_assert.h>
+
+
+namespace {
+
+Q_GLOBAL_STATIC(QThreadPool, s_executorThreadPool)
+
+struct ConcurrentJobs
+{
+    ConcurrentJobs(KisRunnableStrokeJobData * const *_jobs, int _numJobs)
+        : jobs(_jobs),
+          numJobs(_numJobs),
+          nextJob(0)
+    {
+    }
+
+    void runJobs() {
+        int index;
+        while ((index = nextJob.fetchAndAddOrdered(1)) < numJobs) {
+            jobs[index]->run();
+        }
+    }
+
+    KisRunnableStrokeJobData * const *jobs;
+    const int numJobs;
+    QAtomicInt nextJob;
+};
+
+class ConcurrentJobsHelper : public KisSharedRunnable
+{
+public:
+    ConcurrentJobsHelper(ConcurrentJobs *jobs)
+        : m_jobs(jobs)
+    {
+    }
+
+    void runShared() override {
+        m_jobs->runJobs();
+    }
+
+private:
+    ConcurrentJobs *m_jobs;
+};
+
+void runConcurrently(KisRunnableStrokeJobData * const *jobs, int numJobs)
+{
+    ConcurrentJobs state(jobs, numJobs);
+    KisSharedThreadPoolAdapter adapter(s_executorThreadPool);
+
+    const int numHelpers = qMin(numJobs, QThread::idealThreadCount()) - 1;
+
+    for (int i = 0; i < numHelpers; i++) {
+        ConcurrentJobsHelper *helper = new ConcurrentJobsHelper(&state);
+
+        if (!adapter.tryStart(helper)) {
+            delete helper;
+            break;
+        }
+    }
+
+    state.runJobs();
+    adapter.waitForDone();
+}
+
+}
+
+void KisThreadPoolRunnableStrokeJobsExecutor::addRunnableJobs(const QVector<KisRunnableStrokeJobData *> &list)
+{
+    int i = 0;
+
+    while (i < list.size()) {
+        KisRunnableStrokeJobData *data = list[i];
+
+        KIS_SAFE_ASSERT_RECOVER_NOOP(data->exclusivity() != KisStrokeJobData::EXCLUSIVE && "exclusive jobs are not supported on the thread pool executor");
+
+        if (data->sequentiality() != KisStrokeJobData::CONCURRENT) {
+            data->run();
+            i++;
+            continue;
+        }
+
+        int end = i + 1;
+        while (end < list.size() &&
+               list[end]->sequentiality() == KisStrokeJobData::CONCURRENT) {
+            end++;
+        }
+
+        if (end - i > 1) {
+            runConcurrently(list.constData() + i, end - i);
+        } else {
+            data->run();
+        }
+
+        i = end;
+    }
+
+    qDeleteAll(list);
+}
@@ -0,0 +1,41 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISTHREADPOOLRUNNABLESTROKEJOBSEXECUTOR_H
+#define KISTHREADPOOLRUNNABLESTROKEJOBSEXECUTOR_H
+
+#include "KisRunnableStrokeJobsInterface.h"
+
+/**
+ * Executes the jobs synchronously, like KisFakeRunnableStrokeJobsExecutor,
+ * but runs every group of consecutive CONCURRENT jobs in parallel. The
+ * sequential jobs are executed in the calling thread after all the
+ * preceding jobs are finished.
+ *
+ * The concurrent jobs are taken by the calling thread and by the helpers
+ * started in a dedicated thread pool. The helpers are started only if
+ * the pool has free threads, so the executor can be safely used from
+ * the jobs executed by itself.
+ */
+class KRITAIMAGE_EXPORT KisThreadPoolRunnableStrokeJobsExecutor : public KisRunnableStrokeJobsInterface
+{
+public:
+    void addRunnableJobs(const QVector<KisRunnableStrokeJobData*> &list) override;
+};
+
+#endif // KISTHREADPOOLRUNNABLESTROKEJOBSEXECUTOR_H
@@ -29,6 +29,7 @@
 #include "KisPerStrokeRandomSource.h"
 #include "kis_spacing_information.h"
 #include "kis_timing_information.h"
+#include "KisTracer.h"
 
 
 class QDomDocument;
@@ -108,6 +109,8 @@ public:
 
     template <class PaintOp>
     void paintAt(PaintOp &op, KisDistanceInformation *distanceInfo) {
+        KIS_TRACE_SCOPE("paintop", "paintop dab");
+
         KisSpacingInformation spacingInfo;
         KisTimingInformation timingInfo;
         {
@@ -29,6 +29,7 @@
 #include "kis_pixel_selection.h"
 #include "kis_random_accessor_ng.h"
 #include "kis_fill_sanity_checks.h"
+#include "kis_tile_parallel_fill.h"
 
 
 template <class BaseClass>
@@ -189,6 +190,25 @@ private:
     const quint8 *m_srcPixelPtr;
 };
 
+template <bool useSmoothSelection>
+ALWAYS_INLINE quint8 opacityFromDifference(quint8 diff, int threshold)
+{
+    if (!useSmoothSelection) {
+        return diff <= threshold ? MAX_SELECTED : MIN_SELECTED;
+    } else {
+        quint8 selectionValue = qMax(0, threshold - diff);
+
+        quint8 result = MIN_SELECTED;
+
+        if (selectionValue > 0) {
+            qreal selectionNorm = qreal(selectionValue) / threshold;
+            result = MAX_SELECTED * selectionNorm;
+        }
+
+        return result;
+    }
+}
+
 template <bool useSmoothSelection,
           class DifferencePolicy,
           template <class> class PixelFiller>
@@ -207,27 +227,101 @@ public:
 
     ALWAYS_INLINE quint8 calculateOpacity(quint8* pixelPtr) {
         quint8 diff = this->calculateDifference(pixelPtr);
+        return opacityFromDifference<useSmoothSelection>(diff, m_threshold);
+    }
 
-        if (!useSmoothSelection) {
-            return diff <= m_threshold ? MAX_SELECTED : MIN_SELECTED;
-        } else {
-            quint8 selectionValue = qMax(0, m_threshold - diff);
+private:
+    int m_threshold;
+};
 
-            quint8 result = MIN_SELECTED;
+template <bool useSmoothSelection, class DifferencePolicy>
+class TileOpacityCalculator : public KisTileParallelFill::OpacityCalculator, public DifferencePolicy
+{
+public:
+    TileOpacityCalculator(KisPaintDeviceSP device, const KoColor &srcPixel, int threshold)
+        : m_pixelSize(device->pixelSize()),
+          m_threshold(threshold)
+    {
+        this->initDifferencies(device, srcPixel);
+    }
 
-            if (selectionValue > 0) {
-                qreal selectionNorm = qreal(selectionValue) / m_threshold;
-                result = MAX_SELECTED * selectionNorm;
-            }
+    void calculate(const quint8 *pixels, int numPixels, quint8 *opacity) override {
+        quint8 *pixelPtr = const_cast<quint8*>(pixels);
 
-            return result;
+        for (int i = 0; i < numPixels; i++) {
+            opacity[i] = opacityFromDifference<useSmoothSelection>(this->calculateDifference(pixelPtr), m_threshold);
+            pixelPtr += m_pixelSize;
         }
     }
 
 private:
+    int m_pixelSize;
     int m_threshold;
 };
 
+template <bool useSmoothSelection>
+KisTileParallelFill::CalculatorFactory
+createCalculatorFactory(KisPaintDeviceSP device, const KoColor &srcColor, int threshold)
+{
+    const int pixelSize = device->pixelSize();
+
+    if (pixelSize == 1) {
+        return [=] () { return new TileOpacityCalculator<useSmoothSelection, DifferencePolicyOptimized<quint8>>(device, srcColor, threshold); };
+    } else if (pixelSize == 2) {
+        return [=] () { return new TileOpacityCalculator<useSmoothSelection, DifferencePolicyOptimized<quint16>>(device, srcColor, threshold); };
+    } else if (pixelSize == 4) {
+        return [=] () { return new TileOpacityCalculator<useSmoothSelection, DifferencePolicyOptimized<quint32>>(device, srcColor, threshold); };
+    } else if (pixelSize == 8) {
+        return [=] () { return new TileOpacityCalculator<useSmoothSelection, DifferencePolicyOptimized<quint64>>(device, srcColor, threshold); };
+    } else {
+        return [=] () { return new TileOpacityCalculator<useSmoothSelection, DifferencePolicySlow>(device, srcColor, threshold); };
+    }
+}
+
+/**
+ * Writes the result of the tile-parallel fill into \p device. \p fillPixel
+ * is called for every filled pixel with its opacity.
+ */
+template <class FillPixelOp>
+void writeFillResult(KisPaintDeviceSP device, const QRect &rc,
+                     const quint8 *opacity, int rowStride,
+                     FillPixelOp fillPixel)
+{
+    const int pixelSize = device->pixelSize();
+    KisRandomAccessorSP it = device->createRandomAccessorNG(rc.x(), rc.y());
+
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        const quint8 *srcPtr = opacity + (y - rc.top()) * rowStride;
+
+        int x = rc.left();
+        while (x <= rc.right()) {
+            const int numColumns = qMin(it->numContiguousColumns(x), rc.right() - x + 1);
+
+            it->moveTo(x, y);
+            quint8 *dstPtr = it->rawData();
+
+            for (int i = 0; i < numColumns; i++) {
+                if (*srcPtr) {
+                    fillPixel(dstPtr, *srcPtr);
+                }
+
+                srcPtr++;
+                dstPtr += pixelSize;
+            }
+
+            x += numColumns;
+        }
+    }
+}
+
+QByteArray fillCacheKey(const KoColor &srcColor, int threshold, bool useSmoothSelection)
+{
+    QByteArray key(reinterpret_cast<const char*>(srcColor.data()), srcColor.colorSpace()->pixelSize());
+    key.append(QByteArray::number(threshold));
+    key.append(useSmoothSelection ? "s" : "h");
+    return key;
+}
+
 class IsNonNullPolicySlow
 {
 public:
@@ -269,6 +363,7 @@ struct Q_DECL_HIDDEN KisScanlineFill::Private
     QPoint startPoint;
     QRect boundingRect;
     int threshold;
+    bool useTileParallelFill;
 
     int rowIncrement;
     KisFillIntervalMap backwardMap;
@@ -284,6 +379,31 @@ struct Q_DECL_HIDDEN KisScanlineFill::Private
         forwardStack = QStack<KisFillInterval>(backwardMap.fetchAllIntervals(rowIncrement));
         backwardMap.clear();
     }
+
+    /**
+     * The tile engine doesn't know how to wrap the tiles around
+     */
+    inline bool canUseTileParallelFill() const {
+        return useTileParallelFill && !device->defaultBounds()->wrapAroundMode();
+    }
+
+    /**
+     * Runs the tile-parallel fill and passes the filled pixels
+     * to \p fillPixel
+     */
+    template <bool useSmoothSelection, class FillPixelOp>
+    void runTileParallelFill(const KoColor &srcColor, KisPaintDeviceSP dstDevice,
+                             FillPixelOp fillPixel)
+    {
+        KisTileParallelFill fill(device, startPoint, boundingRect);
+        fill.run(createCalculatorFactory<useSmoothSelection>(device, srcColor, threshold),
+                 fillCacheKey(srcColor, threshold, useSmoothSelection));
+
+        fill.writeResult(
+            [&] (const QRect &rc, const quint8 *opacity, int rowStride) {
+                writeFillResult(dstDevice, rc, opacity, rowStride, fillPixel);
+            });
+    }
 };
 
 
@@ -298,6 +418,7 @@ KisScanlineFill::KisScanlineFill(KisPaintDeviceSP device, const QPoint &startPoi
     m_d->rowIncrement = 1;
 
     m_d->threshold = 0;
+    m_d->useTileParallelFill = true;
 }
 
 KisScanlineFill::~KisScanlineFill()
@@ -309,6 +430,16 @@ void KisScanlineFill::setThreshold(int threshold)
     m_d->threshold = threshold;
 }
 
+void KisScanlineFill::setUseTileParallelFill(bool value)
+{
+    m_d->useTileParallelFill = value;
+}
+
+bool KisScanlineFill::useTileParallelFill() const
+{
+    return m_d->useTileParallelFill;
+}
+
 template <class T>
 void KisScanlineFill::extendedPass(KisFillInterval *currentInterval, int srcRow, bool extendRight, T &pixelPolicy)
 {
@@ -473,6 +604,19 @@ void KisScanlineFill::fillColor(const KoColor &fillColor)
 
     const int pixelSize = m_d->device->pixelSize();
 
+    if (m_d->canUseTileParallelFill()) {
+        const quint8 *colorData = fillColor.data();
+        const int colorSize = fillColor.colorSpace()->pixelSize();
+
+        m_d->runTileParallelFill<false>(srcColor, m_d->device,
+            [colorData, colorSize] (quint8 *dstPtr, quint8 opacity) {
+                if (opacity == MAX_SELECTED) {
+                    memcpy(dstPtr, colorData, colorSize);
+                }
+            });
+        return;
+    }
+
     if (pixelSize == 1) {
         SelectionPolicy<false, DifferencePolicyOptimized<quint8>, FillWithColor>
             policy(m_d->device, srcColor, m_d->threshold);
@@ -508,6 +652,19 @@ void KisScanlineFill::fillColor(const KoColor &fillColor, KisPaintDeviceSP exter
 
     const int pixelSize = m_d->device->pixelSize();
 
+    if (m_d->canUseTileParallelFill()) {
+        const quint8 *colorData = fillColor.data();
+        const int colorSize = fillColor.colorSpace()->pixelSize();
+
+        m_d->runTileParallelFill<false>(srcColor, externalDevice,
+            [colorData, colorSize] (quint8 *dstPtr, quint8 opacity) {
+                if (opacity == MAX_SELECTED) {
+                    memcpy(dstPtr, colorData, colorSize);
+                }
+            });
+        return;
+    }
+
     if (pixelSize == 1) {
         SelectionPolicy<false, DifferencePolicyOptimized<quint8>, FillWithColorExternal>
             policy(m_d->device, srcColor, m_d->threshold);
@@ -548,6 +705,14 @@ void KisScanlineFill::fillSelection(KisPixelSelectionSP pixelSelection)
 
     const int pixelSize = m_d->device->pixelSize();
 
+    if (m_d->canUseTileParallelFill()) {
+        m_d->runTileParallelFill<true>(srcColor, pixelSelection,
+            [] (quint8 *dstPtr, quint8 opacity) {
+                *dstPtr = opacity;
+            });
+        return;
+    }
+
     if (pixelSize == 1) {
         SelectionPolicy<true, DifferencePolicyOptimized<quint8>, CopyToSelection>
             policy(m_d->device, srcColor, m_d->threshold);
@@ -64,6 +64,16 @@ public:
      */
     void setThreshold(int threshold);
 
+    /**
+     * When set (default), fillColor() and fillSelection() use the
+     * tile-parallel engine (see KisTileParallelFill), which calculates
+     * the similarity of the pixels of the tiles concurrently and caches
+     * it between the fills. Devices in wrap-around mode are always
+     * filled scanline by scanline.
+     */
+    void setUseTileParallelFill(bool value);
+    bool useTileParallelFill() const;
+
 private:
     friend class KisScanlineFillTest;
     Q_DISABLE_COPY(KisScanlineFill)
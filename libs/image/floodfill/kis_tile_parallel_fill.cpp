@@ -0,0 +1,670 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_parallel_fill.h"
+
+#include <QGlobalStatic>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+
+#include "kis_assert.h"
+#include "KisSharedRunnable.h"
+#include "KisSharedThreadPoolAdapter.h"
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+#include "kis_tile_content_flags.h"
+
+
+namespace {
+
+inline int tileIndex(int coordinate, int tileSize)
+{
+    return coordinate >= 0 ? coordinate / tileSize : -((-coordinate + tileSize - 1) / tileSize);
+}
+
+inline quint64 tileKey(int col, int row)
+{
+    return (quint64(quint32(col)) << 32) | quint32(row);
+}
+
+inline int tileKeyCol(quint64 key)
+{
+    return qint32(quint32(key >> 32));
+}
+
+inline int tileKeyRow(quint64 key)
+{
+    return qint32(quint32(key & 0xFFFFFFFF));
+}
+
+struct TileMask
+{
+    TileMask()
+        : serialNumber(0),
+          revision(-1),
+          uniformOpacity(0),
+          numLabels(0)
+    {
+    }
+
+    /// zero for the tiles not allocated in the device
+    quint64 serialNumber;
+
+    /// -1 while the mask is not calculated
+    qint32 revision;
+
+    /// the part of the tile inside the fill bounds, in tile coordinates
+    QRect clipRect;
+
+    /**
+     * If all the pixels of clipRect have the same opacity, the mask
+     * keeps the single value only, otherwise \p opacity and \p labels
+     * store a value for every pixel of the tile
+     */
+    quint8 uniformOpacity;
+    int numLabels;
+    QVector<quint8> opacity;
+    QVector<quint16> labels;
+
+    inline bool isUniform() const {
+        return opacity.isEmpty();
+    }
+
+    inline int labelAt(int x, int y) const {
+        if (isUniform()) {
+            return uniformOpacity && clipRect.contains(x, y) ? 1 : 0;
+        }
+
+        return labels[y * KisTileData::WIDTH + x];
+    }
+
+    inline quint8 opacityAt(int x, int y) const {
+        if (isUniform()) {
+            return clipRect.contains(x, y) ? uniformOpacity : 0;
+        }
+
+        return opacity[y * KisTileData::WIDTH + x];
+    }
+
+    void setUniform(quint8 value) {
+        opacity = QVector<quint8>();
+        labels = QVector<quint16>();
+        uniformOpacity = value;
+        numLabels = value ? 1 : 0;
+    }
+};
+
+typedef QSharedPointer<TileMask> TileMaskSP;
+
+/**
+ * Labels the 4-connected areas of non-zero opacity of \p mask
+ * with numbers 1..numLabels
+ */
+void labelConnectedAreas(TileMask *mask)
+{
+    const int width = KisTileData::WIDTH;
+    const int height = KisTileData::HEIGHT;
+
+    const quint8 *opacity = mask->opacity.constData();
+
+    QVector<int> provisionalLabels(width * height, 0);
+    int *labels = provisionalLabels.data();
+
+    QVector<int> parent;
+    parent.append(0);
+
+    auto findRoot = [&parent] (int label) {
+        while (parent[label] != label) {
+            parent[label] = parent[parent[label]];
+            label = parent[label];
+        }
+        return label;
+    };
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int i = y * width + x;
+            if (!opacity[i]) continue;
+
+            const int up = y > 0 ? labels[i - width] : 0;
+            const int left = x > 0 ? labels[i - 1] : 0;
+
+            if (!up && !left) {
+                labels[i] = parent.size();
+                parent.append(labels[i]);
+            } else if (up && left) {
+                const int upRoot = findRoot(up);
+                const int leftRoot = findRoot(left);
+
+                labels[i] = qMin(upRoot, leftRoot);
+                parent[qMax(upRoot, leftRoot)] = qMin(upRoot, leftRoot);
+            } else {
+                labels[i] = up ? up : left;
+            }
+        }
+    }
+
+    QVector<int> compactLabels(parent.size(), 0);
+    int numLabels = 0;
+
+    mask->labels.resize(width * height);
+    quint16 *dstLabels = mask->labels.data();
+
+    for (int i = 0; i < width * height; i++) {
+        if (labels[i]) {
+            const int root = findRoot(labels[i]);
+
+            if (!compactLabels[root]) {
+                compactLabels[root] = ++numLabels;
+            }
+
+            dstLabels[i] = compactLabels[root];
+        } else {
+            dstLabels[i] = 0;
+        }
+    }
+
+    mask->numLabels = numLabels;
+}
+
+struct TileJob
+{
+    TileJob() : col(0), row(0), mask(0) {}
+    TileJob(int _col, int _row, TileMask *_mask) : col(_col), row(_row), mask(_mask) {}
+
+    int col;
+    int row;
+    TileMask *mask;
+};
+
+struct MaskContext
+{
+    KisDataManager *dataManager;
+    QRect dataBoundingRect;
+    int pixelSize;
+    KisTileContent::AlphaDescriptor alpha;
+    quint8 defaultOpacity;
+};
+
+/**
+ * Brings the mask of the tile up to date. Thread-safe as long as
+ * different jobs refer to different masks.
+ */
+void updateTileMask(const TileJob &job, const MaskContext &context,
+                    KisTileParallelFill::OpacityCalculator *calculator)
+{
+    const int width = KisTileData::WIDTH;
+    const int height = KisTileData::HEIGHT;
+
+    const QRect tileRect(job.col * width, job.row * height, width, height);
+    const QRect clipRect = (tileRect & context.dataBoundingRect).translated(-tileRect.topLeft());
+
+    TileMask *mask = job.mask;
+
+    KisTileSP tile = context.dataManager->getExistingTile(job.col, job.row);
+
+    if (!tile) {
+        if (mask->revision < 0 || mask->serialNumber != 0 || mask->clipRect != clipRect) {
+            mask->serialNumber = 0;
+            mask->revision = 0;
+            mask->clipRect = clipRect;
+            mask->setUniform(context.defaultOpacity);
+        }
+        return;
+    }
+
+    tile->lockForRead();
+
+    KisTileData *td = tile->tileData();
+    const quint64 serialNumber = td->serialNumber();
+    const qint32 revision = td->contentRevision();
+
+    if (mask->revision != revision ||
+        mask->serialNumber != serialNumber ||
+        mask->clipRect != clipRect) {
+
+        mask->serialNumber = serialNumber;
+        mask->revision = revision;
+        mask->clipRect = clipRect;
+
+        const quint8 *data = td->data();
+
+        if (td->contentFlags(context.alpha) & KisTileContent::Uniform) {
+            quint8 value = 0;
+            calculator->calculate(data, 1, &value);
+            mask->setUniform(value);
+        } else {
+            mask->opacity.fill(0, width * height);
+            quint8 *opacity = mask->opacity.data();
+
+            for (int y = clipRect.top(); y <= clipRect.bottom(); y++) {
+                const int offset = y * width + clipRect.x();
+                calculator->calculate(data + offset * context.pixelSize,
+                                      clipRect.width(), opacity + offset);
+            }
+
+            const quint8 firstValue = opacity[clipRect.y() * width + clipRect.x()];
+            bool isUniform = true;
+
+            for (int y = clipRect.top(); y <= clipRect.bottom() && isUniform; y++) {
+                const quint8 *row = opacity + y * width;
+
+                for (int x = clipRect.left(); x <= clipRect.right(); x++) {
+                    if (row[x] != firstValue) {
+                        isUniform = false;
+                        break;
+                    }
+                }
+            }
+
+            if (isUniform) {
+                mask->setUniform(firstValue);
+            } else {
+                labelConnectedAreas(mask);
+            }
+        }
+    }
+
+    tile->unlock();
+}
+
+/**
+ * The fill is usually executed by a stroke job, so the masks are
+ * calculated in a pool of their own instead of the global one. The fill
+ * waits only for its own jobs, which never wait for anything else.
+ */
+Q_GLOBAL_STATIC(QThreadPool, s_maskThreadPool)
+
+class UpdateMasksRunnable : public KisSharedRunnable
+{
+public:
+    UpdateMasksRunnable(QVector<TileJob> jobs, const MaskContext &context,
+                        KisTileParallelFill::CalculatorFactory factory)
+        : m_jobs(jobs),
+          m_context(context),
+          m_factory(factory)
+    {
+    }
+
+    void runShared() override {
+        QScopedPointer<KisTileParallelFill::OpacityCalculator> calculator(m_factory());
+
+        Q_FOREACH (const TileJob &job, m_jobs) {
+            updateTileMask(job, m_context, calculator.data());
+        }
+    }
+
+private:
+    QVector<TileJob> m_jobs;
+    MaskContext m_context;
+    KisTileParallelFill::CalculatorFactory m_factory;
+};
+
+/**
+ * The masks of the last fill. They are validated against the tile data
+ * serial numbers and revisions, and the masks of the unallocated tiles
+ * depend on the default pixel only (which is a part of the key), so
+ * reusing them for a wrong device cannot give a wrong result. The device
+ * pointer just avoids keeping the masks of unrelated devices.
+ */
+struct MaskCache
+{
+    MaskCache() : device(0) {}
+
+    QMutex lock;
+    const KisPaintDevice *device;
+    QByteArray key;
+    QHash<quint64, TileMaskSP> masks;
+};
+
+Q_GLOBAL_STATIC(MaskCache, s_maskCache)
+
+/**
+ * A non-uniform mask takes about 12KiB, so the cache is limited to
+ * about 200MiB
+ */
+const int maxCachedNonUniformMasks = 16384;
+
+}
+
+KisTileParallelFill::OpacityCalculator::~OpacityCalculator()
+{
+}
+
+struct KisTileParallelFill::Private
+{
+    Private() : hasRun(false) {}
+
+    KisPaintDeviceSP device;
+    QPoint startPoint;
+    QRect boundingRect;
+
+    bool hasRun;
+    QByteArray cacheKey;
+
+    QHash<quint64, TileMaskSP> masks;
+    QHash<quint64, QVector<bool>> filledLabels;
+};
+
+KisTileParallelFill::KisTileParallelFill(KisPaintDeviceSP device, const QPoint &startPoint, const QRect &boundingRect)
+    : m_d(new Private)
+{
+    m_d->device = device;
+    m_d->startPoint = startPoint;
+    m_d->boundingRect = boundingRect;
+}
+
+KisTileParallelFill::~KisTileParallelFill()
+{
+    if (!m_d->hasRun) return;
+
+    /**
+     * The masks are returned to the cache only when the result is
+     * written, because another fill may start updating them right away
+     */
+    int numNonUniformMasks = 0;
+    Q_FOREACH (const TileMaskSP &mask, m_d->masks) {
+        if (!mask->isUniform()) {
+            numNonUniformMasks++;
+        }
+    }
+
+    QMutexLocker l(&s_maskCache->lock);
+
+    s_maskCache->device = m_d->device.data();
+    s_maskCache->key = m_d->cacheKey;
+    s_maskCache->masks.clear();
+
+    if (numNonUniformMasks <= maxCachedNonUniformMasks) {
+        s_maskCache->masks.swap(m_d->masks);
+    }
+}
+
+void KisTileParallelFill::clearCache()
+{
+    QMutexLocker l(&s_maskCache->lock);
+
+    s_maskCache->device = 0;
+    s_maskCache->key.clear();
+    s_maskCache->masks.clear();
+}
+
+void KisTileParallelFill::run(CalculatorFactory factory, const QByteArray &cacheKey)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(!m_d->hasRun);
+
+    if (!m_d->boundingRect.contains(m_d->startPoint)) return;
+
+    const int width = KisTileData::WIDTH;
+    const int height = KisTileData::HEIGHT;
+
+    KisDataManagerSP dataManager = m_d->device->dataManager();
+    const QPoint offset(m_d->device->x(), m_d->device->y());
+    const QPoint dataStartPoint = m_d->startPoint - offset;
+
+    QScopedPointer<OpacityCalculator> calculator(factory());
+    const KoColor defaultPixel = m_d->device->defaultPixel();
+
+    MaskContext context;
+    context.dataManager = dataManager.data();
+    context.dataBoundingRect = m_d->boundingRect.translated(-offset);
+    context.pixelSize = m_d->device->pixelSize();
+    context.alpha = KisTileContent::alphaDescriptor(m_d->device->colorSpace());
+    context.defaultOpacity = 0;
+    calculator->calculate(defaultPixel.data(), 1, &context.defaultOpacity);
+
+    const int firstCol = tileIndex(context.dataBoundingRect.left(), width);
+    const int lastCol = tileIndex(context.dataBoundingRect.right(), width);
+    const int firstRow = tileIndex(context.dataBoundingRect.top(), height);
+    const int lastRow = tileIndex(context.dataBoundingRect.bottom(), height);
+
+    m_d->hasRun = true;
+    m_d->cacheKey = cacheKey;
+    m_d->cacheKey.append(reinterpret_cast<const char*>(defaultPixel.data()), context.pixelSize);
+    m_d->cacheKey.append(m_d->device->colorSpace()->id().toLatin1());
+
+    {
+        QMutexLocker l(&s_maskCache->lock);
+
+        if (s_maskCache->device == m_d->device.data() &&
+            s_maskCache->key == m_d->cacheKey) {
+
+            m_d->masks.swap(s_maskCache->masks);
+        }
+
+        s_maskCache->device = 0;
+        s_maskCache->key.clear();
+        s_maskCache->masks.clear();
+    }
+
+    QSet<quint64> updatedTiles;
+
+    auto updateMasks = [&] (const QVector<QPoint> &tiles) {
+        QVector<TileJob> jobs;
+
+        Q_FOREACH (const QPoint &tile, tiles) {
+            const quint64 key = tileKey(tile.x(), tile.y());
+            if (updatedTiles.contains(key)) continue;
+
+            updatedTiles.insert(key);
+
+            TileMaskSP &mask = m_d->masks[key];
+            if (!mask) {
+                mask.reset(new TileMask());
+            }
+
+            jobs << TileJob(tile.x(), tile.y(), mask.data());
+        }
+
+        /**
+         * The front is split into a chunk per thread, the first chunk
+         * is calculated by the current thread. All the masks should be
+         * ready before the areas are connected.
+         */
+        const int numChunks = qMin(jobs.size(), QThread::idealThreadCount());
+        if (numChunks <= 0) return;
+
+        const int chunkSize = (jobs.size() + numChunks - 1) / numChunks;
+
+        KisSharedThreadPoolAdapter adapter(s_maskThreadPool);
+
+        for (int start = chunkSize; start < jobs.size(); start += chunkSize) {
+            adapter.start(new UpdateMasksRunnable(jobs.mid(start, chunkSize), context, factory));
+        }
+
+        for (int i = 0; i < qMin(chunkSize, jobs.size()); i++) {
+            updateTileMask(jobs[i], context, calculator.data());
+        }
+
+        adapter.waitForDone();
+    };
+
+    struct Node {
+        int col;
+        int row;
+        int label;
+    };
+
+    auto markFilled = [&] (int col, int row, int label, QVector<Node> *nodes) {
+        const quint64 key = tileKey(col, row);
+        QVector<bool> &filled = m_d->filledLabels[key];
+
+        if (filled.isEmpty()) {
+            filled.resize(m_d->masks[key]->numLabels + 1);
+        }
+
+        if (!filled[label]) {
+            filled[label] = true;
+            nodes->append({col, row, label});
+        }
+    };
+
+    const int seedCol = tileIndex(dataStartPoint.x(), width);
+    const int seedRow = tileIndex(dataStartPoint.y(), height);
+
+    updateMasks({QPoint(seedCol, seedRow)});
+
+    const int seedLabel =
+        m_d->masks[tileKey(seedCol, seedRow)]->labelAt(dataStartPoint.x() - seedCol * width,
+                                                       dataStartPoint.y() - seedRow * height);
+    if (!seedLabel) return;
+
+    QVector<Node> frontier;
+    markFilled(seedCol, seedRow, seedLabel, &frontier);
+
+    static const int directions[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+    /**
+     * Returns the coordinates of the i-th pixel of the border of the
+     * tile facing the direction and of its neighbour across the border
+     */
+    auto borderPixel = [width, height] (int dir, int i, QPoint *pixel, QPoint *neighbourPixel) {
+        switch (dir) {
+        case 0:
+            *pixel = QPoint(width - 1, i);
+            *neighbourPixel = QPoint(0, i);
+            break;
+        case 1:
+            *pixel = QPoint(0, i);
+            *neighbourPixel = QPoint(width - 1, i);
+            break;
+        case 2:
+            *pixel = QPoint(i, height - 1);
+            *neighbourPixel = QPoint(i, 0);
+            break;
+        default:
+            *pixel = QPoint(i, 0);
+            *neighbourPixel = QPoint(i, height - 1);
+            break;
+        }
+    };
+
+    auto borderLength = [width, height] (int dir) {
+        return dir < 2 ? height : width;
+    };
+
+    auto isInRange = [&] (int col, int row) {
+        return col >= firstCol && col <= lastCol && row >= firstRow && row <= lastRow;
+    };
+
+    /**
+     * Every pass of the loop first calculates the masks of all the tiles
+     * the current areas leak into, then connects the areas across the
+     * borders
+     */
+    while (!frontier.isEmpty()) {
+        QVector<QPoint> neededTiles;
+
+        Q_FOREACH (const Node &node, frontier) {
+            const TileMask *mask = m_d->masks[tileKey(node.col, node.row)].data();
+
+            for (int dir = 0; dir < 4; dir++) {
+                const int col = node.col + directions[dir][0];
+                const int row = node.row + directions[dir][1];
+
+                if (!isInRange(col, row) || updatedTiles.contains(tileKey(col, row))) continue;
+
+                QPoint pixel;
+                QPoint neighbourPixel;
+
+                for (int i = 0; i < borderLength(dir); i++) {
+                    borderPixel(dir, i, &pixel, &neighbourPixel);
+
+                    if (mask->labelAt(pixel.x(), pixel.y()) == node.label) {
+                        neededTiles << QPoint(col, row);
+                        break;
+                    }
+                }
+            }
+        }
+
+        updateMasks(neededTiles);
+
+        QVector<Node> nextFrontier;
+
+        Q_FOREACH (const Node &node, frontier) {
+            const TileMask *mask = m_d->masks[tileKey(node.col, node.row)].data();
+
+            for (int dir = 0; dir < 4; dir++) {
+                const int col = node.col + directions[dir][0];
+                const int row = node.row + directions[dir][1];
+
+                if (!isInRange(col, row) || !updatedTiles.contains(tileKey(col, row))) continue;
+
+                const TileMask *neighbour = m_d->masks[tileKey(col, row)].data();
+
+                QPoint pixel;
+                QPoint neighbourPixel;
+
+                for (int i = 0; i < borderLength(dir); i++) {
+                    borderPixel(dir, i, &pixel, &neighbourPixel);
+
+                    if (mask->labelAt(pixel.x(), pixel.y()) != node.label) continue;
+
+                    const int label = neighbour->labelAt(neighbourPixel.x(), neighbourPixel.y());
+
+                    if (label) {
+                        markFilled(col, row, label, &nextFrontier);
+                    }
+                }
+            }
+        }
+
+        frontier.swap(nextFrontier);
+    }
+}
+
+void KisTileParallelFill::writeResult(ResultWriter writer) const
+{
+    const int width = KisTileData::WIDTH;
+    const int height = KisTileData::HEIGHT;
+
+    const QPoint offset(m_d->device->x(), m_d->device->y());
+
+    QVector<quint8> buffer(width * height);
+
+    for (auto it = m_d->filledLabels.constBegin(); it != m_d->filledLabels.constEnd(); ++it) {
+        const int col = tileKeyCol(it.key());
+        const int row = tileKeyRow(it.key());
+
+        const TileMask *mask = m_d->masks.value(it.key()).data();
+        KIS_SAFE_ASSERT_RECOVER(mask) { continue; }
+
+        const QVector<bool> &filled = it.value();
+        const QRect &clipRect = mask->clipRect;
+
+        quint8 *dst = buffer.data();
+
+        for (int y = clipRect.top(); y <= clipRect.bottom(); y++) {
+            for (int x = clipRect.left(); x <= clipRect.right(); x++) {
+                *dst++ = filled[mask->labelAt(x, y)] ? mask->opacityAt(x, y) : 0;
+            }
+        }
+
+        writer(clipRect.translated(col * width + offset.x(), row * height + offset.y()),
+               buffer.constData(), clipRect.width());
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_PARALLEL_FILL_H
+#define __KIS_TILE_PARALLEL_FILL_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QPoint>
+#include <QRect>
+#include <QScopedPointer>
+
+#include <kis_types.h>
+#include "kritaimage_export.h"
+
+
+/**
+ * A flood fill engine that works on whole tiles of the source device
+ * instead of single scanlines.
+ *
+ * For every tile reached by the fill the engine calculates the opacity
+ * mask of its pixels and labels the connected (4-neighbourhood) areas
+ * of the mask. The masks of the tiles are independent from each other,
+ * so the masks of a whole front of tiles are calculated concurrently.
+ * Then the labelled areas are connected across the borders of the
+ * tiles, starting from the area of the seed pixel, until no new areas
+ * are reached.
+ *
+ * The masks are cached between the fills and are validated against the
+ * content revision of every tile, so consecutive fills of the same
+ * (e.g. merged) device with the same reference color recalculate only
+ * the tiles changed in between.
+ *
+ * The engine does not support devices in wrap-around mode.
+ */
+class KRITAIMAGE_EXPORT KisTileParallelFill
+{
+public:
+    /**
+     * Calculates the opacities of the pixels of the source device.
+     * Every thread gets its own instance, so the implementation
+     * doesn't need to be thread-safe.
+     */
+    class OpacityCalculator
+    {
+    public:
+        virtual ~OpacityCalculator();
+        virtual void calculate(const quint8 *pixels, int numPixels, quint8 *opacity) = 0;
+    };
+
+    typedef std::function<OpacityCalculator*()> CalculatorFactory;
+
+    /**
+     * Receives the opacities of the filled pixels of \p rc, the
+     * opacity of the pixels outside the filled area is zero
+     */
+    typedef std::function<void(const QRect &rc, const quint8 *opacity, int rowStride)> ResultWriter;
+
+public:
+    KisTileParallelFill(KisPaintDeviceSP device, const QPoint &startPoint, const QRect &boundingRect);
+    ~KisTileParallelFill();
+
+    /**
+     * Finds the contiguous area of the start point.
+     *
+     * \p cacheKey must identify the way \p factory calculates the
+     *    opacities, e.g. the reference color and the threshold. The
+     *    cached masks are reused only by the fills with the same key.
+     */
+    void run(CalculatorFactory factory, const QByteArray &cacheKey);
+
+    /**
+     * Passes the filled area to \p writer tile by tile
+     */
+    void writeResult(ResultWriter writer) const;
+
+    /**
+     * Drops the cached masks. Used by the tests and benchmarks.
+     */
+    static void clearCache();
+
+private:
+    Q_DISABLE_COPY(KisTileParallelFill)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_TILE_PARALLEL_FILL_H */
@@ -46,6 +46,7 @@
 #include "kis_refresh_subtree_walker.h"
 
 #include "kis_abstract_projection_plane.h"
+#include "kis_layer_projection_plane.h"
 
 
 //#define DEBUG_MERGER
@@ -203,6 +204,56 @@ private:
 };
 
 
+/**
+ * Checks whether one of the leaves lying above \p leaf in the same
+ * group completely hides \p rect of it, so compositing the leaf can be
+ * skipped.
+ *
+ * We consider only the leaves that are not changed by the current
+ * walker and are composited in a plain Normal mode, so their projection
+ * replaces everything beneath when it is opaque. The leaf itself is
+ * still recalculated, only its compositing is avoided.
+ */
+static bool isCoveredByUpperLeaf(const KisMergeWalker::LeafStack &leafStack,
+                                 KisProjectionLeafSP leaf, const QRect &rect)
+{
+    KisProjectionLeafSP parent = leaf->parent();
+
+    // the next item to be merged lies on the top of the stack
+    for (int i = leafStack.size() - 1; i >= 0; i--) {
+        const KisMergeWalker::JobItem &item = leafStack[i];
+
+        if (item.m_position & KisMergeWalker::N_EXTRA) continue;
+        if (item.m_leaf->parent() != parent) break;
+
+        KisProjectionLeafSP cover = item.m_leaf;
+
+        if ((item.m_position & KisMergeWalker::N_ABOVE_FILTHY) &&
+            !cover->dependsOnLowerNodes() &&
+            cover->visible() &&
+            cover->opacity() == OPACITY_OPAQUE_U8 &&
+            cover->channelFlags().isEmpty() &&
+            cover->node()->compositeOpId() == COMPOSITE_OVER &&
+            item.m_applyRect.contains(rect) &&
+            dynamic_cast<KisLayerProjectionPlane*>(cover->projectionPlane().data())) {
+
+            const KisGroupLayer *group = qobject_cast<const KisGroupLayer*>(cover->node().data());
+            KisPaintDeviceSP device = cover->projection();
+
+            if ((!group || !group->passThroughMode() || group->passThroughCacheActive()) && device &&
+                (device->tileContentFlags(rect) & KisTileContent::Opaque)) {
+
+                return true;
+            }
+        }
+
+        if (item.m_position & KisMergeWalker::N_TOPMOST) break;
+    }
+
+    return false;
+}
+
+
 /*********************************************************************/
 /*                     KisAsyncMerger                                */
 /*********************************************************************/
@@ -271,7 +322,11 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
             /* nothing to do */
         }
 
-        compositeWithProjection(currentLeaf, applyRect);
+        if (!isCoveredByUpperLeaf(leafStack, currentLeaf, applyRect)) {
+            compositeWithProjection(currentLeaf, applyRect);
+        } else {
+            DEBUG_NODE_ACTION("Skipping covered", "", currentLeaf, applyRect);
+        }
 
         if(item.m_position & KisMergeWalker::N_TOPMOST) {
             writeProjection(currentLeaf, useTempProjections, applyRect);
@@ -34,6 +34,8 @@
 #include <QPainter>
 #include <QRect>
 #include <QString>
+#include <QHash>
+#include <QVector>
 
 #include <klocalizedstring.h>
 
@@ -47,6 +49,7 @@
 #include "kis_image.h"
 #include "kis_layer.h"
 #include "kis_paint_device.h"
+#include "kis_datamanager.h"
 #include <resources/KoPattern.h>
 #include "KoColorSpace.h"
 #include "kis_transaction.h"
@@ -54,6 +57,8 @@
 #include <KoCompositeOpRegistry.h>
 #include <floodfill/kis_scanline_fill.h>
 #include "kis_selection_filters.h"
+#include <KisRunnableStrokeJobData.h>
+#include <KisThreadPoolRunnableStrokeJobsExecutor.h>
 
 KisFillPainter::KisFillPainter()
         : KisPainter()
@@ -124,6 +129,166 @@ void KisFillPainter::fillRect(qint32 x1, qint32 y1, qint32 w, qint32 h, const Ko
     fillRect(x1, y1, w, h, patternLayer, QRect(0, 0, pattern->width(), pattern->height()));
 }
 
+namespace {
+
+inline int positiveModulo(int value, int divisor)
+{
+    const int result = value % divisor;
+    return result < 0 ? result + divisor : result;
+}
+
+inline int divideFloor(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value - 1) / divisor) - 1;
+}
+
+/**
+ * Renders the pattern for \p rect into \p buffer. The pixel (x, y) of
+ * the rect gets the pixel (x mod width, y mod height) of the pattern.
+ */
+void renderPatternRect(const QRect &rect, QVector<quint8> *buffer,
+                       const QVector<quint8> &patternData, const QSize &patternSize,
+                       int pixelSize)
+{
+    buffer->resize(rect.width() * rect.height() * pixelSize);
+    quint8 *dstPtr = buffer->data();
+
+    const int patternRowSize = patternSize.width() * pixelSize;
+
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        const quint8 *patternRow =
+            patternData.constData() + positiveModulo(y, patternSize.height()) * patternRowSize;
+
+        int patternX = positiveModulo(rect.left(), patternSize.width());
+        int x = 0;
+
+        while (x < rect.width()) {
+            const int numPixels = qMin(rect.width() - x, patternSize.width() - patternX);
+
+            memcpy(dstPtr, patternRow + patternX * pixelSize, numPixels * pixelSize);
+
+            dstPtr += numPixels * pixelSize;
+            x += numPixels;
+            patternX = 0;
+        }
+    }
+}
+
+}
+
+void KisFillPainter::fillRectNoCompose(const QRect& rc, const KoPattern * pattern)
+{
+    if (!pattern) return;
+    if (!pattern->valid()) return;
+    if (!device()) return;
+    if (rc.isEmpty()) return;
+
+    KisPaintDeviceSP dev = device();
+    const int pixelSize = dev->pixelSize();
+
+    const QSize patternSize(pattern->width(), pattern->height());
+
+    QVector<quint8> patternData(patternSize.width() * patternSize.height() * pixelSize);
+
+    {
+        KisPaintDeviceSP patternDevice = new KisPaintDevice(dev->colorSpace());
+        patternDevice->convertFromQImage(pattern->pattern(), 0);
+        patternDevice->readBytes(patternData.data(), QRect(QPoint(), patternSize));
+    }
+
+    /**
+     * The tiles are aligned to the origin of the data manager, which
+     * is shifted by the offset of the device
+     */
+    const QPoint offset(dev->x(), dev->y());
+    const QRect dmRect = rc.translated(-offset);
+
+    const int firstColumn = divideFloor(dmRect.left(), KisTileData::WIDTH);
+    const int lastColumn = divideFloor(dmRect.right(), KisTileData::WIDTH);
+    const int firstRow = divideFloor(dmRect.top(), KisTileData::HEIGHT);
+    const int lastRow = divideFloor(dmRect.bottom(), KisTileData::HEIGHT);
+
+    struct SharedTile {
+        QPoint tile;
+        QPoint srcTile;
+    };
+
+    QVector<QRect> renderedRects;
+    QVector<SharedTile> sharedTiles;
+    QHash<quint64, QPoint> tileForPhase;
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            const QRect tileRect(column * KisTileData::WIDTH + offset.x(),
+                                 row * KisTileData::HEIGHT + offset.y(),
+                                 KisTileData::WIDTH, KisTileData::HEIGHT);
+
+            const QRect fillRect = tileRect & rc;
+
+            if (fillRect != tileRect) {
+                renderedRects.append(fillRect);
+                continue;
+            }
+
+            const quint64 phase =
+                (quint64(positiveModulo(tileRect.x(), patternSize.width())) << 32) |
+                quint64(positiveModulo(tileRect.y(), patternSize.height()));
+
+            auto it = tileForPhase.constFind(phase);
+
+            if (it == tileForPhase.constEnd()) {
+                tileForPhase.insert(phase, QPoint(column, row));
+                renderedRects.append(tileRect);
+            } else {
+                SharedTile sharedTile;
+                sharedTile.tile = QPoint(column, row);
+                sharedTile.srcTile = *it;
+                sharedTiles.append(sharedTile);
+            }
+        }
+    }
+
+    /**
+     * The distinct tiles are rendered into separate buffers concurrently.
+     * writeBytes() serializes on the lock of the data manager, so the
+     * buffers are written into the device afterwards on this thread.
+     */
+    QVector<QVector<quint8>> renderedData(renderedRects.size());
+
+    {
+        QVector<KisRunnableStrokeJobData*> jobs;
+
+        for (int i = 0; i < renderedRects.size(); i++) {
+            const QRect rect = renderedRects[i];
+            QVector<quint8> *buffer = &renderedData[i];
+
+            jobs.append(
+                new KisRunnableStrokeJobData(
+                    [rect, buffer, &patternData, patternSize, pixelSize] () {
+                        renderPatternRect(rect, buffer, patternData, patternSize, pixelSize);
+                    },
+                    KisStrokeJobData::CONCURRENT));
+        }
+
+        KisThreadPoolRunnableStrokeJobsExecutor executor;
+        executor.addRunnableJobs(jobs);
+    }
+
+    for (int i = 0; i < renderedRects.size(); i++) {
+        dev->writeBytes(renderedData[i].constData(), renderedRects[i]);
+    }
+
+    KisDataManager *dm = dev->dataManager().data();
+
+    Q_FOREACH (const SharedTile &sharedTile, sharedTiles) {
+        dm->shareTile(dm,
+                      sharedTile.srcTile.x(), sharedTile.srcTile.y(),
+                      sharedTile.tile.x(), sharedTile.tile.y());
+    }
+
+    addDirtyRect(rc);
+}
+
 void KisFillPainter::fillRect(qint32 x1, qint32 y1, qint32 w, qint32 h, const KisPaintDeviceSP device, const QRect& deviceRect)
 {
     Q_ASSERT(deviceRect.x() == 0); // the case x,y != 0,0 is not yet implemented
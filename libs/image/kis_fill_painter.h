@@ -115,6 +115,19 @@ public:
      */
     void fillRect(const QRect& rc, const KoPattern * pattern);
 
+    /**
+     * Fill a rectangle with a certain pattern, replacing the content of the
+     * device. The pattern is aligned to the origin of the device, like in
+     * fillRect(). Selection, opacity and composite op are not applied.
+     *
+     * The tiles fully covered by the rectangle that get the same part of
+     * the pattern share their data (copy-on-write), so the cost depends on
+     * the number of distinct pattern cells rather than on the size of the
+     * rectangle. The distinct cells are rendered in parallel in a thread
+     * pool; the call returns when the whole rectangle is filled.
+     */
+    void fillRectNoCompose(const QRect& rc, const KoPattern * pattern);
+
     /**
      * Fill the specified area with the output of the generator plugin that is configured
      * in the generator parameter
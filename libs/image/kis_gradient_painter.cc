@@ -20,6 +20,8 @@
 
 #include <cfloat>
 
+#include <QThread>
+
 #include <KoColorSpace.h>
 #include <resources/KoAbstractGradient.h>
 #include <KoUpdater.h>
@@ -36,7 +38,11 @@
 #include "kis_gradient_shape_strategy.h"
 #include "kis_polygonal_gradient_shape_strategy.h"
 #include "kis_cached_gradient_shape_strategy.h"
+#include "KisShapeBurstGradientShapeStrategy.h"
 #include "krita_utils.h"
+#include "KisRunnableStrokeJobData.h"
+#include "KisRunnableStrokeJobsInterface.h"
+#include "tiles3/kis_tile_data.h"
 
 
 class CachedGradient : public KoAbstractGradient
@@ -110,6 +116,7 @@ public:
     LinearGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_normalisedVectorX;
@@ -152,6 +159,17 @@ double LinearGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void LinearGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    // the value grows linearly along the row
+    const double t0 = LinearGradientStrategy::valueAt(x, y);
+    const double dt = m_vectorLength < DBL_EPSILON ? 0.0 : m_normalisedVectorX / m_vectorLength;
+
+    for (int i = 0; i < count; i++) {
+        values[i] = t0 + i * dt;
+    }
+}
+
 
 class BiLinearGradientStrategy : public LinearGradientStrategy
 {
@@ -160,6 +178,7 @@ public:
     BiLinearGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 };
 
 BiLinearGradientStrategy::BiLinearGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd)
@@ -179,6 +198,15 @@ double BiLinearGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void BiLinearGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    LinearGradientStrategy::valuesAt(x, y, count, values);
+
+    for (int i = 0; i < count; i++) {
+        values[i] = values[i] < -DBL_EPSILON ? -values[i] : values[i];
+    }
+}
+
 
 class RadialGradientStrategy : public KisGradientShapeStrategy
 {
@@ -187,6 +215,7 @@ public:
     RadialGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_radius;
@@ -219,6 +248,19 @@ double RadialGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void RadialGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    const double dx0 = x - m_gradientVectorStart.x();
+    const double dy = y - m_gradientVectorStart.y();
+    const double dy2 = dy * dy;
+    const double scale = m_radius < DBL_EPSILON ? 0.0 : 1.0 / m_radius;
+
+    for (int i = 0; i < count; i++) {
+        const double dx = dx0 + i;
+        values[i] = sqrt(dx * dx + dy2) * scale;
+    }
+}
+
 
 class SquareGradientStrategy : public KisGradientShapeStrategy
 {
@@ -227,6 +269,7 @@ public:
     SquareGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_normalisedVectorX;
@@ -279,6 +322,27 @@ double SquareGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void SquareGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    if (m_vectorLength <= DBL_EPSILON) {
+        KisGradientShapeStrategy::valuesAt(x, y, count, values);
+        return;
+    }
+
+    // both distances are linear along the row
+    const double px0 = x - m_gradientVectorStart.x();
+    const double py = y - m_gradientVectorStart.y();
+
+    const double distance1 = -m_normalisedVectorY * px0 + m_normalisedVectorX * py;
+    const double distance2 = m_normalisedVectorY * py + m_normalisedVectorX * px0;
+    const double scale = 1.0 / m_vectorLength;
+
+    for (int i = 0; i < count; i++) {
+        values[i] = qMax(fabs(distance1 - i * m_normalisedVectorY),
+                         fabs(distance2 + i * m_normalisedVectorX)) * scale;
+    }
+}
+
 
 class ConicalGradientStrategy : public KisGradientShapeStrategy
 {
@@ -287,6 +351,7 @@ public:
     ConicalGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_vectorAngle;
@@ -320,6 +385,22 @@ double ConicalGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void ConicalGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    const double px0 = x - m_gradientVectorStart.x();
+    const double py = y - m_gradientVectorStart.y();
+
+    for (int i = 0; i < count; i++) {
+        double angle = atan2(py, px0 + i) + M_PI - m_vectorAngle;
+
+        if (angle < 0) {
+            angle += 2 * M_PI;
+        }
+
+        values[i] = angle / (2 * M_PI);
+    }
+}
+
 
 class ConicalSymetricGradientStrategy : public KisGradientShapeStrategy
 {
@@ -327,6 +408,7 @@ public:
     ConicalSymetricGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_vectorAngle;
@@ -366,144 +448,161 @@ double ConicalSymetricGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
-
-class GradientRepeatStrategy
+void ConicalSymetricGradientStrategy::valuesAt(double x, double y, int count, double *values) const
 {
-public:
-    GradientRepeatStrategy() {}
-    virtual ~GradientRepeatStrategy() {}
+    const double px0 = x - m_gradientVectorStart.x();
+    const double py = y - m_gradientVectorStart.y();
 
-    virtual double valueAt(double t) const = 0;
-};
+    for (int i = 0; i < count; i++) {
+        double angle = atan2(py, px0 + i) + M_PI - m_vectorAngle;
 
+        if (angle < 0) {
+            angle += 2 * M_PI;
+        }
 
-class GradientRepeatNoneStrategy : public GradientRepeatStrategy
-{
-public:
-    static GradientRepeatNoneStrategy *instance();
+        values[i] = angle < M_PI ? angle / M_PI : 1 - ((angle - M_PI) / M_PI);
+    }
+}
 
-    double valueAt(double t) const override;
 
-private:
-    GradientRepeatNoneStrategy() {}
-
-    static GradientRepeatNoneStrategy *m_instance;
-};
+/**
+ * The repeat policies are applied to a whole row of values at once, so
+ * that the compiler can inline and vectorize the loop
+ */
+struct RepeatNonePolicy
+{
+    // Output is clamped to 0 to 1.
+    static inline double valueAt(double t) {
+        double value = t;
 
-GradientRepeatNoneStrategy *GradientRepeatNoneStrategy::m_instance = 0;
+        if (t < DBL_EPSILON) {
+            value = 0;
+        } else if (t > 1 - DBL_EPSILON) {
+            value = 1;
+        }
 
-GradientRepeatNoneStrategy *GradientRepeatNoneStrategy::instance()
-{
-    if (m_instance == 0) {
-        m_instance = new GradientRepeatNoneStrategy();
-        Q_CHECK_PTR(m_instance);
+        return value;
     }
+};
 
-    return m_instance;
-}
-
-// Output is clamped to 0 to 1.
-double GradientRepeatNoneStrategy::valueAt(double t) const
+struct RepeatForwardsPolicy
 {
-    double value = t;
+    // Output is 0 to 1, 0 to 1, 0 to 1...
+    static inline double valueAt(double t) {
+        int i = static_cast<int>(t);
 
-    if (t < DBL_EPSILON) {
-        value = 0;
-    } else if (t > 1 - DBL_EPSILON) {
-        value = 1;
-    }
-
-    return value;
-}
+        if (t < DBL_EPSILON) {
+            i--;
+        }
 
+        return t - i;
+    }
+};
 
-class GradientRepeatForwardsStrategy : public GradientRepeatStrategy
+struct RepeatAlternatePolicy
 {
-public:
-    static GradientRepeatForwardsStrategy *instance();
-
-    double valueAt(double t) const override;
+    // Output is 0 to 1, 1 to 0, 0 to 1, 1 to 0...
+    static inline double valueAt(double t) {
+        if (t < 0) {
+            t = -t;
+        }
 
-private:
-    GradientRepeatForwardsStrategy() {}
+        int i = static_cast<int>(t);
 
-    static GradientRepeatForwardsStrategy *m_instance;
-};
+        double value = t - i;
 
-GradientRepeatForwardsStrategy *GradientRepeatForwardsStrategy::m_instance = 0;
+        if (i % 2 == 1) {
+            value = 1 - value;
+        }
 
-GradientRepeatForwardsStrategy *GradientRepeatForwardsStrategy::instance()
-{
-    if (m_instance == 0) {
-        m_instance = new GradientRepeatForwardsStrategy();
-        Q_CHECK_PTR(m_instance);
+        return value;
     }
+};
 
-    return m_instance;
-}
-
-// Output is 0 to 1, 0 to 1, 0 to 1...
-double GradientRepeatForwardsStrategy::valueAt(double t) const
+template <class RepeatPolicy>
+void applyRepeat(double *values, int count, bool reverse)
 {
-    int i = static_cast<int>(t);
-
-    if (t < DBL_EPSILON) {
-        i--;
+    if (reverse) {
+        for (int i = 0; i < count; i++) {
+            values[i] = 1 - RepeatPolicy::valueAt(values[i]);
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            values[i] = RepeatPolicy::valueAt(values[i]);
+        }
     }
-
-    double value = t - i;
-
-    return value;
 }
 
+typedef void (*ApplyRepeatFunc)(double *values, int count, bool reverse);
 
-class GradientRepeatAlternateStrategy : public GradientRepeatStrategy
+/**
+ * Splits \p rc into full-width stripes aligned to the rows of the tiles
+ * of a device with the offset \p origin
+ */
+QVector<QRect> splitIntoTileStripes(const QRect &rc, const QPoint &origin)
 {
-public:
-    static GradientRepeatAlternateStrategy *instance();
-
-    double valueAt(double t) const override;
+    const int stripeHeight = KisTileData::HEIGHT;
 
-private:
-    GradientRepeatAlternateStrategy() {}
+    QVector<QRect> stripes;
 
-    static GradientRepeatAlternateStrategy *m_instance;
-};
+    int y = rc.y();
+    while (y <= rc.bottom()) {
+        const int relY = y - origin.y();
+        const int alignedY = origin.y() +
+            (relY >= 0 ?
+             relY / stripeHeight * stripeHeight :
+             -((-relY + stripeHeight - 1) / stripeHeight) * stripeHeight);
 
-GradientRepeatAlternateStrategy *GradientRepeatAlternateStrategy::m_instance = 0;
+        const int nextY = qMin(alignedY + stripeHeight, rc.bottom() + 1);
 
-GradientRepeatAlternateStrategy *GradientRepeatAlternateStrategy::instance()
-{
-    if (m_instance == 0) {
-        m_instance = new GradientRepeatAlternateStrategy();
-        Q_CHECK_PTR(m_instance);
+        stripes << QRect(rc.x(), y, rc.width(), nextY - y);
+        y = nextY;
     }
 
-    return m_instance;
+    return stripes;
 }
 
-// Output is 0 to 1, 1 to 0, 0 to 1, 1 to 0...
-double GradientRepeatAlternateStrategy::valueAt(double t) const
+void renderGradientRect(KisPaintDeviceSP dev, const QRect &rc,
+                        const KisGradientShapeStrategy *shapeStrategy,
+                        ApplyRepeatFunc applyRepeatFunc,
+                        bool reverseGradient,
+                        const CachedGradient &cachedGradient)
 {
-    if (t < 0) {
-        t = -t;
-    }
+    const qint32 pixelSize = dev->pixelSize();
 
-    int i = static_cast<int>(t);
+    KisRandomAccessorSP it = dev->createRandomAccessorNG(rc.x(), rc.y());
+    QVector<double> values(rc.width());
 
-    double value = t - i;
+    for (int y = rc.y(); y <= rc.bottom(); y++) {
+        shapeStrategy->valuesAt(rc.x(), y, rc.width(), values.data());
+        applyRepeatFunc(values.data(), rc.width(), reverseGradient);
 
-    if (i % 2 == 1) {
-        value = 1 - value;
-    }
+        const double *value = values.constData();
+
+        int x = rc.x();
+        while (x <= rc.right()) {
+            const int numColumns = qMin(it->numContiguousColumns(x), rc.right() - x + 1);
+
+            it->moveTo(x, y);
+            quint8 *dst = it->rawData();
 
-    return value;
+            for (int i = 0; i < numColumns; i++) {
+                memcpy(dst, cachedGradient.cachedAt(*value), pixelSize);
+                dst += pixelSize;
+                value++;
+            }
+
+            x += numColumns;
+        }
+    }
 }
+
 }
 
 struct Q_DECL_HIDDEN KisGradientPainter::Private
 {
     enumGradientShape shape;
+    bool useDistanceTransformShape = true;
 
     struct ProcessRegion {
         ProcessRegion() {}
@@ -545,6 +644,19 @@ void KisGradientPainter::setGradientShape(enumGradientShape shape)
     m_d->shape = shape;
 }
 
+void KisGradientPainter::setUseDistanceTransformShape(bool value)
+{
+    if (m_d->useDistanceTransformShape == value) return;
+
+    m_d->useDistanceTransformShape = value;
+    m_d->processRegions.clear();
+}
+
+bool KisGradientPainter::useDistanceTransformShape() const
+{
+    return m_d->useDistanceTransformShape;
+}
+
 KisGradientShapeStrategy* createPolygonShapeStrategy(const QPainterPath &path, const QRect &boundingRect)
 {
     // TODO: implement UI for exponent option
@@ -592,8 +704,15 @@ void KisGradientPainter::precalculateShape()
             boundingRect = kisGrowRect(boundingRect, 2);
         }
 
-        Private::ProcessRegion r(toQShared(createPolygonShapeStrategy(subpath, boundingRect)),
-                                 boundingRect);
+        KisGradientShapeStrategy *strategy = 0;
+
+        if (m_d->useDistanceTransformShape) {
+            strategy = new KisShapeBurstGradientShapeStrategy(subpath, boundingRect);
+        } else {
+            strategy = createPolygonShapeStrategy(subpath, boundingRect);
+        }
+
+        Private::ProcessRegion r(toQShared(strategy), boundingRect);
         m_d->processRegions << r;
     }
 }
@@ -685,54 +804,78 @@ bool KisGradientPainter::paintGradient(const QPointF& gradientVectorStart,
         break;
     }
 
-    GradientRepeatStrategy *repeatStrategy = 0;
+    ApplyRepeatFunc applyRepeatFunc = 0;
 
     switch (repeat) {
     case GradientRepeatNone:
-        repeatStrategy = GradientRepeatNoneStrategy::instance();
+        applyRepeatFunc = &applyRepeat<RepeatNonePolicy>;
         break;
     case GradientRepeatForwards:
-        repeatStrategy = GradientRepeatForwardsStrategy::instance();
+        applyRepeatFunc = &applyRepeat<RepeatForwardsPolicy>;
         break;
     case GradientRepeatAlternate:
-        repeatStrategy = GradientRepeatAlternateStrategy::instance();
+        applyRepeatFunc = &applyRepeat<RepeatAlternatePolicy>;
         break;
     }
-    Q_ASSERT(repeatStrategy != 0);
+    KIS_ASSERT_RECOVER_RETURN_VALUE(applyRepeatFunc, false);
 
 
     KisPaintDeviceSP dev = device()->createCompositionSourceDevice();
 
     const KoColorSpace * colorSpace = dev->colorSpace();
-    const qint32 pixelSize = colorSpace->pixelSize();
+
+    /**
+     * The stripes are aligned to the tiles, so the concurrent jobs never
+     * write into the same tile. They are dispatched in batches to be able
+     * to report the progress in between. Without a runnable jobs interface
+     * the painter renders them in a thread pool before returning.
+     */
+    const int batchSize = qMax(1, QThread::idealThreadCount());
+
+    QVector<KisRunnableStrokeJobData*> jobs;
 
     Q_FOREACH (const Private::ProcessRegion &r, m_d->processRegions) {
-        QRect processRect = r.processRect;
+        const QRect processRect = r.processRect;
         QSharedPointer<KisGradientShapeStrategy> shapeStrategy = r.precalculatedShapeStrategy;
 
-        CachedGradient cachedGradient(gradient(), qMax(processRect.width(), processRect.height()), colorSpace);
-
-        KisSequentialIterator it(dev, processRect);
-        const int rightCol = processRect.right();
-        KisProgressUpdateHelper progressHelper(progressUpdater(), 100, processRect.height());
+        QSharedPointer<CachedGradient> cachedGradient(
+            new CachedGradient(gradient(), qMax(processRect.width(), processRect.height()), colorSpace));
 
-        do {
-            double t = shapeStrategy->valueAt(it.x(), it.y());
-            t = repeatStrategy->valueAt(t);
+        const QVector<QRect> stripes = splitIntoTileStripes(processRect, QPoint(dev->x(), dev->y()));
+        QSharedPointer<KisProgressUpdateHelper> progressHelper(
+            new KisProgressUpdateHelper(progressUpdater(), 100, stripes.size()));
 
-            if (reverseGradient) {
-                t = 1 - t;
-            }
+        for (int i = 0; i < stripes.size(); i += batchSize) {
+            const int numStripes = qMin(batchSize, stripes.size() - i);
 
-            memcpy(it.rawData(), cachedGradient.cachedAt(t), pixelSize);
+            for (int j = i; j < i + numStripes; j++) {
+                const QRect rc = stripes[j];
 
-            if (it.x() == rightCol) {
-                progressHelper.step();
+                jobs.append(new KisRunnableStrokeJobData(
+                    [dev, rc, shapeStrategy, applyRepeatFunc, reverseGradient, cachedGradient] () {
+                        renderGradientRect(dev, rc, shapeStrategy.data(), applyRepeatFunc,
+                                           reverseGradient, *cachedGradient);
+                    },
+                    KisStrokeJobData::CONCURRENT));
             }
-        } while (it.nextPixel());
 
-        bitBlt(processRect.topLeft(), dev, processRect);
+            jobs.append(new KisRunnableStrokeJobData(
+                [progressHelper, numStripes] () {
+                    for (int j = 0; j < numStripes; j++) {
+                        progressHelper->step();
+                    }
+                },
+                KisStrokeJobData::SEQUENTIAL));
+        }
+
+        jobs.append(new KisRunnableStrokeJobData(
+            [this, dev, processRect] () {
+                bitBlt(processRect.topLeft(), dev, processRect);
+            },
+            KisStrokeJobData::SEQUENTIAL));
     }
 
+    runnableStrokeJobsInterface()->addRunnableJobs(jobs);
+
     return true;
 }
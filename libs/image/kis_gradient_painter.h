@@ -60,10 +60,25 @@ public:
 
     void setGradientShape(enumGradientShape shape);
 
+    /**
+     * Selects the algorithm of GradientShapePolygonal. When true (default),
+     * the shape-burst is calculated from the exact distance transform of
+     * the selection shape, otherwise from the legacy smoothed
+     * approximation of the distance to the shape edges, which is much
+     * slower.
+     */
+    void setUseDistanceTransformShape(bool value);
+    bool useDistanceTransformShape() const;
+
     void precalculateShape();
 
     /**
      * Paint a gradient in the rect between startx, starty, width and height.
+     *
+     * The gradient is rendered in tile stripes via runnableStrokeJobsInterface().
+     * If the interface has been set explicitly, the gradient is written into
+     * the device only after the current stroke job is finished. Otherwise the
+     * stripes are rendered in parallel before the call returns.
      */
     bool paintGradient(const QPointF& gradientVectorStart,
                        const QPointF& gradientVectorEnd,
@@ -31,6 +31,14 @@ public:
 
     virtual double valueAt(double x, double y) const = 0;
 
+    /**
+     * Calculates the values of \p count consecutive pixels of the row \p y
+     * starting at \p x and writes them into \p values. The default
+     * implementation calls valueAt() for every pixel, the strategies that
+     * can calculate a row faster should override it.
+     */
+    virtual void valuesAt(double x, double y, int count, double *values) const;
+
 protected:
     QPointF m_gradientVectorStart;
     QPointF m_gradientVectorEnd;
@@ -37,6 +37,10 @@
 #include "kis_selection_mask.h"
 #include "kis_psd_layer_style.h"
 #include "kis_layer_properties_icons.h"
+#include "kis_projection_leaf.h"
+#include "kis_image_config.h"
+#include "krita_utils.h"
+#include "kis_update_pass_through_cache_job.h"
 
 
 struct Q_DECL_HIDDEN KisGroupLayer::Private
@@ -47,6 +51,9 @@ public:
         , x(0)
         , y(0)
         , passThroughMode(false)
+        , passThroughCacheEnabled(KisImageConfig(true).cachePassThroughGroups())
+        , passThroughCacheActive(false)
+        , passThroughCacheOpacity(OPACITY_OPAQUE_U8)
     {
     }
 
@@ -54,8 +61,112 @@ public:
     qint32 x;
     qint32 y;
     bool passThroughMode;
+
+    bool passThroughCacheEnabled;
+    bool passThroughCacheActive;
+    quint8 passThroughCacheOpacity;
+
+    static bool isPassThroughGroup(const KisNode *node);
+    static quint8 passThroughOpacity(const KisNode *node);
+    static bool checkCacheableChildren(const KisNode *node);
+    bool checkCacheable(const KisGroupLayer *q) const;
+    static void updatePassThroughCache(KisNodeSP node);
+    static void updateNestedPassThroughCaches(KisNodeSP node);
+    static bool affectsPassThroughCaches(KisNodeSP node);
 };
 
+bool KisGroupLayer::Private::isPassThroughGroup(const KisNode *node)
+{
+    const KisGroupLayer *group = qobject_cast<const KisGroupLayer*>(node);
+    return group && group->passThroughMode();
+}
+
+/**
+ * The opacity of the node merged with the opacities of all the
+ * pass-through groups it is nested into, exactly the way
+ * KisProjectionLeaf::opacity() does it for their children
+ */
+quint8 KisGroupLayer::Private::passThroughOpacity(const KisNode *node)
+{
+    quint8 result = node->opacity();
+
+    const KisNode *parent = node->parent().data();
+    if (parent && isPassThroughGroup(parent)) {
+        result = KritaUtils::mergeOpacity(result, passThroughOpacity(parent));
+    }
+
+    return result;
+}
+
+bool KisGroupLayer::Private::checkCacheableChildren(const KisNode *node)
+{
+    const KisNode *child = node->firstChild().data();
+
+    while (child) {
+        KisProjectionLeafSP leaf = child->projectionLeaf();
+
+        if (leaf->isLayer()) {
+            const KisLayer *layer = qobject_cast<const KisLayer*>(child);
+
+            if (leaf->dependsOnLowerNodes() ||
+                layer->compositeOpId() != COMPOSITE_OVER ||
+                !layer->channelFlags().isEmpty() ||
+                layer->layerStyle()) {
+
+                return false;
+            }
+
+            /**
+             * The children of nested pass-through groups are composited
+             * into the same stack, so they should be checked as well
+             */
+            if (isPassThroughGroup(child) && !checkCacheableChildren(child)) {
+                return false;
+            }
+        }
+
+        child = child->nextSibling().data();
+    }
+
+    return true;
+}
+
+bool KisGroupLayer::Private::checkCacheable(const KisGroupLayer *q) const
+{
+    if (!passThroughMode || !passThroughCacheEnabled) return false;
+
+    if (q->compositeOpId() != COMPOSITE_OVER ||
+        !q->channelFlags().isEmpty() ||
+        q->layerStyle() ||
+        paintDevice->defaultPixel().opacityU8() != OPACITY_TRANSPARENT_U8) {
+
+        return false;
+    }
+
+    /**
+     * The projection of the group should have the same color space as
+     * the device its children are composited into in pass-through mode
+     */
+    const KisNode *parent = q->parent().data();
+    if (!parent) return false;
+
+    while (parent) {
+        if (*parent->colorSpace() != *q->colorSpace()) return false;
+        if (!isPassThroughGroup(parent)) break;
+        parent = parent->parent().data();
+    }
+
+    /**
+     * In pass-through mode the masks of the group are dropped, but
+     * they would be applied to the cached projection
+     */
+    for (const KisNode *child = q->firstChild().data(); child; child = child->nextSibling().data()) {
+        if (child->projectionLeaf()->isMask()) return false;
+    }
+
+    return checkCacheableChildren(q);
+}
+
 KisGroupLayer::KisGroupLayer(KisImageWSP image, const QString &name, quint8 opacity) :
     KisLayer(image, name, opacity),
     m_d(new Private())
@@ -73,6 +184,7 @@ KisGroupLayer::KisGroupLayer(const KisGroupLayer &rhs) :
     m_d->paintDevice->setDefaultPixel(const_cast<KisGroupLayer*>(&rhs)->m_d->paintDevice->defaultPixel());
     m_d->paintDevice->setProjectionDevice(true);
     m_d->passThroughMode = rhs.passThroughMode();
+    m_d->passThroughCacheEnabled = rhs.passThroughCacheEnabled();
 }
 
 KisGroupLayer::~KisGroupLayer()
@@ -224,6 +336,15 @@ KisPaintDeviceSP KisGroupLayer::tryObligeChild() const
 {
     const KisLayer *child = onlyMeaningfulChild();
 
+    /**
+     * A pass-through child composites its own children into this group,
+     * its projection is not filled
+     */
+    const KisGroupLayer *childGroup = qobject_cast<const KisGroupLayer*>(child);
+    if (childGroup && childGroup->passThroughMode() && !childGroup->passThroughCacheActive()) {
+        return 0;
+    }
+
     if (child &&
         child->channelFlags().isEmpty() &&
         child->projection() &&
@@ -232,6 +353,8 @@ KisPaintDeviceSP KisGroupLayer::tryObligeChild() const
          child->compositeOpId() == COMPOSITE_ALPHA_DARKEN ||
          child->compositeOpId() == COMPOSITE_COPY) &&
         child->opacity() == OPACITY_OPAQUE_U8 &&
+        (!m_d->passThroughCacheActive ||
+         m_d->passThroughCacheOpacity == OPACITY_OPAQUE_U8) &&
         *child->projection()->colorSpace() == *colorSpace() &&
         !child->layerStyle()) {
 
@@ -297,10 +420,128 @@ void KisGroupLayer::setPassThroughMode(bool value)
 
     m_d->passThroughMode = value;
 
+    /**
+     * The projection of a usual group doesn't have the opacity of the
+     * group folded in, so it cannot be reused as a cache
+     */
+    m_d->passThroughCacheActive = false;
+
     baseNodeChangedCallback();
     baseNodeInvalidateAllFramesCallback();
 }
 
+bool KisGroupLayer::passThroughCacheEnabled() const
+{
+    return m_d->passThroughCacheEnabled;
+}
+
+void KisGroupLayer::setPassThroughCacheEnabled(bool value)
+{
+    if (m_d->passThroughCacheEnabled == value) return;
+
+    m_d->passThroughCacheEnabled = value;
+    requestPassThroughCachesUpdate(this);
+}
+
+bool KisGroupLayer::passThroughCacheActive() const
+{
+    return m_d->passThroughMode && m_d->passThroughCacheActive;
+}
+
+void KisGroupLayer::updatePassThroughCacheState()
+{
+    const bool cacheable = m_d->checkCacheable(this);
+    const quint8 opacity = cacheable ? Private::passThroughOpacity(this) : OPACITY_OPAQUE_U8;
+
+    /**
+     * Both switching the cache on and off change the way the children
+     * are composited, so the group should be regenerated in both cases
+     */
+    const bool needsRefresh =
+        cacheable != m_d->passThroughCacheActive ||
+        (cacheable && m_d->passThroughCacheOpacity != opacity);
+
+    m_d->passThroughCacheActive = cacheable;
+    m_d->passThroughCacheOpacity = opacity;
+
+    if (needsRefresh) {
+        KisImageSP image = this->image().toStrongRef();
+        if (image) {
+            image->refreshGraphAsync(this);
+        }
+    }
+}
+
+void KisGroupLayer::Private::updatePassThroughCache(KisNodeSP node)
+{
+    KisGroupLayer *group = qobject_cast<KisGroupLayer*>(node.data());
+    if (group && group->passThroughMode()) {
+        group->updatePassThroughCacheState();
+    }
+}
+
+/**
+ * Only the pass-through groups nested right into \p node (through other
+ * pass-through groups) have its opacity and color space folded in, the
+ * rest of the subtree is not affected
+ */
+void KisGroupLayer::Private::updateNestedPassThroughCaches(KisNodeSP node)
+{
+    for (KisNodeSP child = node->firstChild(); child; child = child->nextSibling()) {
+        if (isPassThroughGroup(child.data())) {
+            updatePassThroughCache(child);
+            updateNestedPassThroughCaches(child);
+        }
+    }
+}
+
+bool KisGroupLayer::Private::affectsPassThroughCaches(KisNodeSP node)
+{
+    if (qobject_cast<KisGroupLayer*>(node.data())) return true;
+
+    for (node = node->parent(); node; node = node->parent()) {
+        KisGroupLayer *group = qobject_cast<KisGroupLayer*>(node.data());
+        if (group && group->passThroughMode() && group->passThroughCacheEnabled()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void KisGroupLayer::updatePassThroughCaches(KisNodeSP node)
+{
+    if (!node) return;
+
+    Private::updatePassThroughCache(node);
+    Private::updateNestedPassThroughCaches(node);
+
+    for (node = node->parent(); node; node = node->parent()) {
+        Private::updatePassThroughCache(node);
+    }
+}
+
+void KisGroupLayer::requestPassThroughCachesUpdate(KisNodeSP node)
+{
+    if (!node || !Private::affectsPassThroughCaches(node)) return;
+
+    KisImageSP image = node->image().toStrongRef();
+    if (image) {
+        image->addSpontaneousJob(new KisUpdatePassThroughCacheJob(node));
+    }
+}
+
+void KisGroupLayer::childNodeChanged(KisNodeSP changedChildNode)
+{
+    KisLayer::childNodeChanged(changedChildNode);
+
+    /**
+     * If the node has been removed, only the group itself and its
+     * ancestors are affected
+     */
+    requestPassThroughCachesUpdate(changedChildNode->parent() ? changedChildNode : KisNodeSP(this));
+}
+
 KisBaseNode::PropertyList KisGroupLayer::sectionModelProperties() const
 {
     KisBaseNode::PropertyList l = KisLayer::sectionModelProperties();
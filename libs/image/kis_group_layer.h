@@ -102,12 +102,58 @@ public:
     bool passThroughMode() const;
     void setPassThroughMode(bool value);
 
+    /**
+     * When enabled, a pass-through group keeps the composited result of
+     * its children in its own projection while it gives the same result
+     * as compositing the children right into the parent: all the layers
+     * inside use Normal blending mode and have no channel flags or layer
+     * styles, there are no adjustment layers and the group has no masks.
+     *
+     * The opacity of the group is folded into its children then, and the
+     * group is composited as a usual group layer, so the updates outside
+     * the group reuse its projection instead of compositing every child
+     * again. The default value is taken from KisImageConfig.
+     */
+    bool passThroughCacheEnabled() const;
+    void setPassThroughCacheEnabled(bool value);
+
+    /**
+     * \return true if the group is in pass-through mode and is currently
+     * composited through its cached projection
+     */
+    bool passThroughCacheActive() const;
+
+    /**
+     * Checks whether the cached projection can be used for the current
+     * state of the group. When the cache becomes active, or the opacity
+     * folded into the children changes, the projection of the group is
+     * regenerated with a full refresh.
+     */
+    void updatePassThroughCacheState();
+
+    /**
+     * Updates the state of the cached pass-through groups affected by
+     * a change of \p node: the node itself, the pass-through groups
+     * nested right into it and its ancestors. Must be called only when
+     * no walkers are running, use requestPassThroughCachesUpdate()
+     * otherwise.
+     */
+    static void updatePassThroughCaches(KisNodeSP node);
+
+    /**
+     * Schedules updatePassThroughCaches() for \p node as a spontaneous
+     * job of its image
+     */
+    static void requestPassThroughCachesUpdate(KisNodeSP node);
+
     QRect extent() const override;
     QRect exactBounds() const override;
 
     bool projectionIsValid() const;
 
 protected:
+    void childNodeChanged(KisNodeSP changedChildNode) override;
+
     KisLayer* onlyMeaningfulChild() const;
     KisPaintDeviceSP tryObligeChild() const;
 
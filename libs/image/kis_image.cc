@@ -230,6 +230,7 @@ public:
     KisCompositeProgressProxy compositeProgressProxy;
 
     bool blockLevelOfDetail = false;
+    bool projectionPreloaded = false;
 
     QPointF axesCenter;
 
@@ -366,6 +367,7 @@ void KisImage::aboutToRemoveANode(KisNode *parent, int index)
 void KisImage::nodeChanged(KisNode* node)
 {
     KisNodeGraphListener::nodeChanged(node);
+    KisGroupLayer::requestPassThroughCachesUpdate(node);
     requestStrokeEnd();
     m_d->signalRouter.emitNodeChanged(node);
 }
@@ -1411,9 +1413,20 @@ void KisImage::initialRefreshGraph()
      */
 
     refreshGraphAsync(0, bounds(), QRect());
+
+    if (m_d->projectionPreloaded) {
+        m_d->projectionPreloaded = false;
+        return;
+    }
+
     waitForDone();
 }
 
+void KisImage::setProjectionPreloaded(bool value)
+{
+    m_d->projectionPreloaded = value;
+}
+
 void KisImage::refreshGraphAsync(KisNodeSP root)
 {
     refreshGraphAsync(root, bounds(), bounds());
@@ -861,8 +861,22 @@ public Q_SLOTS:
      */
     void refreshGraph(KisNodeSP root = KisNodeSP());
     void refreshGraph(KisNodeSP root, const QRect& rc, const QRect &cropRect);
+
+    /**
+     * Triggers the first recomposition of the projection after the image
+     * has been loaded. The call is synchronous unless the projection has
+     * been preloaded (see setProjectionPreloaded()).
+     */
     void initialRefreshGraph();
 
+    /**
+     * Tells initialRefreshGraph() that the projection is already filled
+     * with a preview of the image (e.g. with the merged image stored in
+     * the file), so the first recomposition may go in the background
+     * while the preview is shown.
+     */
+    void setProjectionPreloaded(bool value);
+
     /**
      * Initiate a stack regeneration skipping the recalculation of the
      * filthy node's projection.
@@ -483,6 +483,50 @@ void KisImageConfig::setUseLodForColorizeMask(bool value)
     m_config.writeEntry("useLodForColorizeMask", value);
 }
 
+bool KisImageConfig::useIncrementalColorizeMask(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useIncrementalColorizeMask", false) : false;
+}
+
+void KisImageConfig::setUseIncrementalColorizeMask(bool value)
+{
+    m_config.writeEntry("useIncrementalColorizeMask", value);
+}
+
+int KisImageConfig::colorizeMaskRegionWallThreshold(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("colorizeMaskRegionWallThreshold", 64) : 64;
+}
+
+void KisImageConfig::setColorizeMaskRegionWallThreshold(int value)
+{
+    m_config.writeEntry("colorizeMaskRegionWallThreshold", value);
+}
+
+int KisImageConfig::colorizeMaskRegionWallGrowRadius(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("colorizeMaskRegionWallGrowRadius", 4) : 4;
+}
+
+void KisImageConfig::setColorizeMaskRegionWallGrowRadius(int value)
+{
+    m_config.writeEntry("colorizeMaskRegionWallGrowRadius", value);
+}
+
+bool KisImageConfig::cachePassThroughGroups(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("cachePassThroughGroups", false) : false;
+}
+
+void KisImageConfig::setCachePassThroughGroups(bool value)
+{
+    m_config.writeEntry("cachePassThroughGroups", value);
+}
+
 int KisImageConfig::maxNumberOfThreads(bool defaultValue) const
 {
     return (defaultValue ? QThread::idealThreadCount() : m_config.readEntry("maxNumberOfThreads", QThread::idealThreadCount()));
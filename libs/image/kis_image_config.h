@@ -111,6 +111,28 @@ public:
     bool useLodForColorizeMask(bool requestDefault = false) const;
     void setUseLodForColorizeMask(bool value);
 
+    bool useIncrementalColorizeMask(bool requestDefault = false) const;
+    void setUseIncrementalColorizeMask(bool value);
+
+    /**
+     * The value of the (inverted) filtered source of the colorize mask
+     * below which a pixel is considered to be a part of a line that
+     * separates the independent regions of the incremental mode
+     */
+    int colorizeMaskRegionWallThreshold(bool requestDefault = false) const;
+    void setColorizeMaskRegionWallThreshold(int value);
+
+    /**
+     * The distance by which every independent region of the colorize
+     * mask is extended into the surrounding lines, so that the lines
+     * get filled as well
+     */
+    int colorizeMaskRegionWallGrowRadius(bool requestDefault = false) const;
+    void setColorizeMaskRegionWallGrowRadius(int value);
+
+    bool cachePassThroughGroups(bool requestDefault = false) const;
+    void setCachePassThroughGroups(bool value);
+
     int maxNumberOfThreads(bool defaultValue = false) const;
     void setMaxNumberOfThreads(int value);
 
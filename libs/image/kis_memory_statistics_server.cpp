@@ -157,6 +157,8 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
 
     stats.swapSize = tileStats.swapSize;
 
+    stats.uniformTilesSavedSize = tileStats.uniformTilesSavedSize;
+
     KisImageConfig cfg;
 
     stats.tilesHardLimit = cfg.tilesHardLimit() * MiB;
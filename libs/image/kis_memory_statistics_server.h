@@ -46,6 +46,8 @@ public:
 
               swapSize(0),
 
+              uniformTilesSavedSize(0),
+
               totalMemoryLimit(0),
               tilesHardLimit(0),
               tilesSoftLimit(0),
@@ -65,6 +67,8 @@ public:
 
         qint64 swapSize;
 
+        qint64 uniformTilesSavedSize;
+
         qint64 totalMemoryLimit;
         qint64 tilesHardLimit;
         qint64 tilesSoftLimit;
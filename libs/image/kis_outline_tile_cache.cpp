@@ -0,0 +1,606 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_outline_tile_cache.h"
+
+#include <QMultiHash>
+#include <QRegion>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "kis_global.h"
+#include "kis_paint_device.h"
+
+
+namespace {
+const int maskStride = KisOutlineTileCache::cellSize + 1;
+
+/**
+ * Chains the segments into polylines. Every vertex of a closed outline
+ * has an even number of segments, so the chains return to their starts.
+ */
+QVector<QPolygon> chainSegments(const QVector<QLine> &segments)
+{
+    auto pointKey = [] (const QPoint &pt) {
+        return (quint64(quint32(pt.x())) << 32) | quint64(quint32(pt.y()));
+    };
+
+    QMultiHash<quint64, int> segmentsAtPoint;
+    segmentsAtPoint.reserve(2 * segments.size());
+
+    for (int i = 0; i < segments.size(); i++) {
+        segmentsAtPoint.insert(pointKey(segments[i].p1()), i);
+        segmentsAtPoint.insert(pointKey(segments[i].p2()), i);
+    }
+
+    QVector<bool> used(segments.size(), false);
+
+    auto takeNextPoint = [&] (const QPoint &pt, QPoint *nextPt) {
+        const quint64 key = pointKey(pt);
+
+        for (auto it = segmentsAtPoint.find(key);
+             it != segmentsAtPoint.end() && it.key() == key; ++it) {
+
+            const int index = it.value();
+            if (used[index]) continue;
+
+            used[index] = true;
+            *nextPt = segments[index].p1() == pt ? segments[index].p2() : segments[index].p1();
+            return true;
+        }
+        return false;
+    };
+
+    // the runs are axis-aligned, so collinear runs share either x or y
+    auto isCollinear = [] (const QPoint &p0, const QPoint &p1, const QPoint &p2) {
+        return (p0.x() == p1.x() && p1.x() == p2.x()) ||
+               (p0.y() == p1.y() && p1.y() == p2.y());
+    };
+
+    auto appendPoint = [isCollinear] (QPolygon &polyline, const QPoint &pt) {
+        const int n = polyline.size();
+
+        if (n >= 2 && isCollinear(polyline[n - 2], polyline[n - 1], pt)) {
+            polyline[n - 1] = pt;
+        } else {
+            polyline.append(pt);
+        }
+    };
+
+    QVector<QPolygon> polylines;
+
+    for (int i = 0; i < segments.size(); i++) {
+        if (used[i]) continue;
+        used[i] = true;
+
+        QPolygon polyline;
+        polyline << segments[i].p1() << segments[i].p2();
+
+        QPoint nextPt;
+        while (takeNextPoint(polyline.last(), &nextPt)) {
+            appendPoint(polyline, nextPt);
+        }
+
+        /**
+         * If the chain didn't return to its start, continue it
+         * backwards to avoid splitting it.
+         */
+        if (polyline.first() != polyline.last()) {
+            std::reverse(polyline.begin(), polyline.end());
+
+            while (takeNextPoint(polyline.last(), &nextPt)) {
+                appendPoint(polyline, nextPt);
+            }
+        }
+
+        // the chain might have started in the middle of a straight run
+        const int n = polyline.size();
+        if (n > 3 && polyline.first() == polyline.last() &&
+            isCollinear(polyline[n - 2], polyline[0], polyline[1])) {
+
+            polyline.removeLast();
+            polyline.removeFirst();
+            polyline.append(polyline.first());
+        }
+
+        polylines.append(polyline);
+    }
+
+    return polylines;
+}
+
+/**
+ * Adds the parts of \p polyline lying inside \p clipRect to \p path.
+ * The points of the polyline are the corners of the pixels, so the
+ * rect is inclusive on all the sides.
+ */
+void addClippedPolyline(const QPolygon &polyline, const QRect &clipRect,
+                        qreal dashPeriod, QPainterPath *path)
+{
+    const int numPoints = polyline.size();
+    if (numPoints < 2) return;
+
+    // the length of the polyline up to every point, the runs are axis-aligned
+    QVector<int> lengths(numPoints);
+    lengths[0] = 0;
+    for (int i = 1; i < numPoints; i++) {
+        lengths[i] = lengths[i - 1] + (polyline[i] - polyline[i - 1]).manhattanLength();
+    }
+
+    // the intervals of the length lying inside the rect
+    QVector<QPair<qreal, qreal>> parts;
+
+    for (int i = 1; i < numPoints; i++) {
+        const QPoint &p0 = polyline[i - 1];
+        const QPoint &p1 = polyline[i];
+
+        const bool isHorizontal = p0.y() == p1.y();
+        const int fixedCoord = isHorizontal ? p0.y() : p0.x();
+        const int c0 = isHorizontal ? p0.x() : p0.y();
+        const int c1 = isHorizontal ? p1.x() : p1.y();
+
+        const int fixedMin = isHorizontal ? clipRect.top() : clipRect.left();
+        const int fixedMax = isHorizontal ? clipRect.bottom() : clipRect.right();
+        const int clipMin = isHorizontal ? clipRect.left() : clipRect.top();
+        const int clipMax = isHorizontal ? clipRect.right() : clipRect.bottom();
+
+        if (fixedCoord < fixedMin || fixedCoord > fixedMax) continue;
+
+        const int low = qMax(qMin(c0, c1), clipMin);
+        const int high = qMin(qMax(c0, c1), clipMax);
+
+        if (low > high) continue;
+
+        const int startOffset = c1 >= c0 ? low - c0 : c0 - high;
+        const int endOffset = c1 >= c0 ? high - c0 : c0 - low;
+
+        qreal start = lengths[i - 1] + startOffset;
+        const qreal end = lengths[i - 1] + endOffset;
+
+        if (dashPeriod > 0.0) {
+            start = std::floor(start / dashPeriod) * dashPeriod;
+        }
+
+        if (!parts.isEmpty() && parts.last().second >= start) {
+            parts.last().second = qMax(parts.last().second, end);
+        } else if (end > start) {
+            parts.append(qMakePair(start, end));
+        }
+    }
+
+    auto pointAt = [&polyline, &lengths, numPoints] (qreal length, int *edge) {
+        int e = *edge;
+        while (e < numPoints - 2 && lengths[e + 1] <= length) e++;
+        *edge = e;
+
+        const int edgeLength = lengths[e + 1] - lengths[e];
+        if (!edgeLength) return QPointF(polyline[e]);
+
+        // the edges are axis-aligned, so step along the unit direction
+        const QPointF direction = QPointF(polyline[e + 1] - polyline[e]) / edgeLength;
+        return QPointF(polyline[e]) + (length - lengths[e]) * direction;
+    };
+
+    int edge = 0;
+
+    for (auto it = parts.constBegin(); it != parts.constEnd(); ++it) {
+        path->moveTo(pointAt(it->first, &edge));
+
+        for (int i = edge + 1; i < numPoints && lengths[i] < it->second; i++) {
+            path->lineTo(polyline[i]);
+        }
+
+        path->lineTo(pointAt(it->second, &edge));
+    }
+}
+
+}
+
+KisOutlineTileCache::KisOutlineTileCache()
+    : m_allDirty(true)
+{
+}
+
+int KisOutlineTileCache::cellCoord(int pixelCoord)
+{
+    return pixelCoord >= 0 ?
+        pixelCoord / cellSize :
+        -((-pixelCoord - 1) / cellSize) - 1;
+}
+
+void KisOutlineTileCache::invalidate(const KisPaintDevice *device, const QRect &rc)
+{
+    if (m_allDirty || rc.isEmpty()) return;
+
+    /**
+     * The pixel owns its top and left edges, the right and the bottom
+     * ones belong to its neighbours
+     */
+    m_dirtyRects.append(rc.translated(-QPoint(device->x(), device->y())).adjusted(0, 0, 1, 1));
+}
+
+void KisOutlineTileCache::invalidate()
+{
+    m_allDirty = true;
+    m_dirtyRects.clear();
+}
+
+int KisOutlineTileCache::update(const KisPaintDevice *device, const QRect &rc)
+{
+    m_offset = QPoint(device->x(), device->y());
+    const QRect localRect = rc.translated(-m_offset);
+
+    if (localRect.isEmpty()) {
+        clear();
+        return 0;
+    }
+
+    /**
+     * Every cell owns the top and the left edges of its pixels, so
+     * the right and the bottom edges of the outline belong to the
+     * cells lying outside the rect.
+     */
+    const QRect processRect = localRect.adjusted(0, 0, 1, 1);
+
+    QRegion dirtyRegion;
+
+    if (m_allDirty) {
+        dirtyRegion = processRect;
+    } else {
+        Q_FOREACH (const QRect &rect, m_dirtyRects) {
+            dirtyRegion += rect;
+        }
+
+        // the pixels outside the rect are unselected, so the pixels
+        // entering or leaving the rect are changed as well
+        if (localRect != m_localRect) {
+            const QRegion changedArea = QRegion(localRect).xored(QRegion(m_localRect));
+
+            Q_FOREACH (const QRect &rect, changedArea.rects()) {
+                dirtyRegion += rect.adjusted(0, 0, 1, 1);
+            }
+        }
+    }
+
+    m_allDirty = false;
+    m_dirtyRects.clear();
+
+    const int firstCol = cellCoord(processRect.left());
+    const int lastCol = cellCoord(processRect.right());
+    const int firstRow = cellCoord(processRect.top());
+    const int lastRow = cellCoord(processRect.bottom());
+
+    QSet<CellIndex> changedCells;
+
+    for (auto it = m_cells.begin(); it != m_cells.end();) {
+        const CellIndex &index = it.key();
+
+        if (index.first < firstCol || index.first > lastCol ||
+            index.second < firstRow || index.second > lastRow) {
+
+            if (!it->segments.isEmpty()) {
+                changedCells.insert(index);
+            }
+            it = m_cells.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    /**
+     * The data is read in strips of dirty cells. Every strip also
+     * includes the last row of the previous strip and the column to
+     * the left of the first cell, since the edges depend on them.
+     */
+    QVector<quint8> strip;
+    QVector<quint8> mask(maskStride * maskStride);
+
+    int numRegenerated = 0;
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        auto needsUpdate = [&] (int c) {
+            return !m_cells.contains(CellIndex(c, row)) ||
+                dirtyRegion.intersects(QRect(c * cellSize, row * cellSize, cellSize, cellSize));
+        };
+
+        int col = firstCol;
+
+        while (col <= lastCol) {
+            if (!needsUpdate(col)) {
+                col++;
+                continue;
+            }
+
+            const int stripFirstCol = col;
+            while (col <= lastCol && needsUpdate(col)) {
+                col++;
+            }
+            const int stripLastCol = col - 1;
+
+            const int stripWidth = (stripLastCol - stripFirstCol + 1) * cellSize + 1;
+            const QRect stripRect(stripFirstCol * cellSize - 1, row * cellSize - 1,
+                                  stripWidth, maskStride);
+
+            strip.resize(stripWidth * maskStride);
+            device->readBytes(strip.data(), stripRect.translated(m_offset));
+
+            // binarize the strip, the pixels outside the rect are unselected
+            quint8 *ptr = strip.data();
+            for (int y = stripRect.top(); y <= stripRect.bottom(); y++) {
+                const bool rowInside = y >= localRect.top() && y <= localRect.bottom();
+
+                for (int x = stripRect.left(); x <= stripRect.right(); x++, ptr++) {
+                    *ptr = rowInside &&
+                        x >= localRect.left() && x <= localRect.right() &&
+                        *ptr != MIN_SELECTED;
+                }
+            }
+
+            for (int c = stripFirstCol; c <= stripLastCol; c++) {
+                const int stripOffset = (c - stripFirstCol) * cellSize;
+
+                for (int y = 0; y < maskStride; y++) {
+                    memcpy(mask.data() + y * maskStride,
+                           strip.constData() + y * stripWidth + stripOffset,
+                           maskStride);
+                }
+
+                const CellIndex index(c, row);
+                const quint64 hash = calculateHash(mask.constData(), mask.size());
+
+                auto it = m_cells.find(index);
+                if (it != m_cells.end() && it->contentHash == hash) {
+                    continue;
+                }
+
+                const bool hadSegments = it != m_cells.end() && !it->segments.isEmpty();
+
+                Cell cell;
+                cell.contentHash = hash;
+                cell.segments = generateCellSegments(mask.constData(),
+                                                     QPoint(c * cellSize, row * cellSize));
+
+                if (hadSegments || !cell.segments.isEmpty()) {
+                    changedCells.insert(index);
+                }
+
+                m_cells.insert(index, cell);
+                numRegenerated++;
+            }
+        }
+    }
+
+    m_localRect = localRect;
+    m_localBounds = processRect;
+
+    if (!changedCells.isEmpty()) {
+        stitchPolylines(changedCells);
+    }
+
+    return numRegenerated;
+}
+
+quint64 KisOutlineTileCache::calculateHash(const quint8 *mask, int maskSize)
+{
+    return (quint64(qHashBits(mask, maskSize, 0)) << 32) |
+        quint64(qHashBits(mask, maskSize, 0x9e3779b9));
+}
+
+QVector<QLine> KisOutlineTileCache::generateCellSegments(const quint8 *mask, const QPoint &cellOrigin)
+{
+    auto isSelected = [mask] (int x, int y) {
+        return mask[(y + 1) * maskStride + x + 1];
+    };
+
+    QVector<QLine> segments;
+
+    // horizontal edges, lying between the rows y - 1 and y
+    for (int y = 0; y < cellSize; y++) {
+        int runStart = -1;
+
+        for (int x = 0; x <= cellSize; x++) {
+            const bool isEdge = x < cellSize && isSelected(x, y) != isSelected(x, y - 1);
+
+            if (isEdge && runStart < 0) {
+                runStart = x;
+            } else if (!isEdge && runStart >= 0) {
+                segments.append(QLine(cellOrigin + QPoint(runStart, y),
+                                      cellOrigin + QPoint(x, y)));
+                runStart = -1;
+            }
+        }
+    }
+
+    // vertical edges, lying between the columns x - 1 and x
+    for (int x = 0; x < cellSize; x++) {
+        int runStart = -1;
+
+        for (int y = 0; y <= cellSize; y++) {
+            const bool isEdge = y < cellSize && isSelected(x, y) != isSelected(x - 1, y);
+
+            if (isEdge && runStart < 0) {
+                runStart = y;
+            } else if (!isEdge && runStart >= 0) {
+                segments.append(QLine(cellOrigin + QPoint(x, runStart),
+                                      cellOrigin + QPoint(x, y)));
+                runStart = -1;
+            }
+        }
+    }
+
+    return segments;
+}
+
+bool KisOutlineTileCache::cutPolyline(const QPolygon &polyline,
+                                      const QSet<CellIndex> &changedCells,
+                                      QVector<QLine> *pieces)
+{
+    /**
+     * A horizontal run belongs to the row of cells it lies on and to
+     * the columns of its pixels, a vertical one vice versa, see
+     * generateCellSegments()
+     */
+    QVector<QPair<CellIndex, QLine>> cellPieces;
+    bool passesChangedCells = false;
+
+    for (int i = 1; i < polyline.size(); i++) {
+        const QPoint &p0 = polyline[i - 1];
+        const QPoint &p1 = polyline[i];
+
+        if (p0.y() == p1.y()) {
+            const int row = cellCoord(p0.y());
+            const int right = qMax(p0.x(), p1.x());
+
+            for (int x = qMin(p0.x(), p1.x()); x < right;) {
+                const int col = cellCoord(x);
+                const int end = qMin(right, (col + 1) * cellSize);
+
+                cellPieces.append(qMakePair(CellIndex(col, row), QLine(x, p0.y(), end, p0.y())));
+                passesChangedCells |= changedCells.contains(CellIndex(col, row));
+                x = end;
+            }
+        } else {
+            const int col = cellCoord(p0.x());
+            const int bottom = qMax(p0.y(), p1.y());
+
+            for (int y = qMin(p0.y(), p1.y()); y < bottom;) {
+                const int row = cellCoord(y);
+                const int end = qMin(bottom, (row + 1) * cellSize);
+
+                cellPieces.append(qMakePair(CellIndex(col, row), QLine(p0.x(), y, p0.x(), end)));
+                passesChangedCells |= changedCells.contains(CellIndex(col, row));
+                y = end;
+            }
+        }
+    }
+
+    if (!passesChangedCells) return false;
+
+    for (auto it = cellPieces.constBegin(); it != cellPieces.constEnd(); ++it) {
+        if (!changedCells.contains(it->first)) {
+            pieces->append(it->second);
+        }
+    }
+
+    return true;
+}
+
+void KisOutlineTileCache::stitchPolylines(const QSet<CellIndex> &changedCells)
+{
+    QVector<QLine> segments;
+    QRect changedBounds;
+
+    Q_FOREACH (const CellIndex &index, changedCells) {
+        auto it = m_cells.constFind(index);
+        if (it != m_cells.constEnd()) {
+            segments += it->segments;
+        }
+
+        changedBounds |= QRect(index.first * cellSize, index.second * cellSize,
+                               cellSize + 1, cellSize + 1);
+    }
+
+    /**
+     * The polylines passing through the changed cells are cut at the
+     * borders of the cells, and their pieces lying in the unchanged
+     * cells are stitched again together with the new segments. The
+     * other polylines are kept as they are.
+     */
+    QVector<QPolygon> polylines;
+    QVector<QRect> polylineBounds;
+
+    for (int i = 0; i < m_polylines.size(); i++) {
+        if (!m_polylineBounds[i].intersects(changedBounds) ||
+            !cutPolyline(m_polylines[i], changedCells, &segments)) {
+
+            polylines.append(m_polylines[i]);
+            polylineBounds.append(m_polylineBounds[i]);
+        }
+    }
+
+    Q_FOREACH (const QPolygon &polyline, chainSegments(segments)) {
+        polylines.append(polyline);
+        polylineBounds.append(polyline.boundingRect());
+    }
+
+    m_polylines = polylines;
+    m_polylineBounds = polylineBounds;
+}
+
+QPainterPath KisOutlineTileCache::outline(const QRect &rc, qreal dashPeriod) const
+{
+    // the outline goes along the borders of the pixels of the rect
+    const QRect clipRect = rc.translated(-m_offset).adjusted(0, 0, 1, 1) & m_localBounds;
+    if (clipRect.isEmpty()) return QPainterPath();
+
+    QPainterPath path;
+
+    for (int i = 0; i < m_polylines.size(); i++) {
+        if (!m_polylineBounds[i].intersects(clipRect)) continue;
+
+        if (clipRect.contains(m_polylineBounds[i])) {
+            path.addPolygon(m_polylines[i]);
+        } else {
+            addClippedPolyline(m_polylines[i], clipRect, dashPeriod, &path);
+        }
+    }
+
+    path.translate(m_offset);
+    return path;
+}
+
+QPainterPath KisOutlineTileCache::outline() const
+{
+    QPainterPath path;
+
+    Q_FOREACH (const QPolygon &polyline, m_polylines) {
+        path.addPolygon(polyline);
+    }
+
+    path.translate(m_offset);
+    return path;
+}
+
+QRect KisOutlineTileCache::bounds() const
+{
+    return m_localBounds.translated(m_offset);
+}
+
+bool KisOutlineTileCache::isEmpty() const
+{
+    return m_localBounds.isEmpty();
+}
+
+int KisOutlineTileCache::numCells() const
+{
+    return m_cells.size();
+}
+
+void KisOutlineTileCache::clear()
+{
+    m_cells.clear();
+    m_polylines.clear();
+    m_polylineBounds.clear();
+    m_localRect = QRect();
+    m_localBounds = QRect();
+    m_dirtyRects.clear();
+    m_allDirty = false;
+}
@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_OUTLINE_TILE_CACHE_H
+#define __KIS_OUTLINE_TILE_CACHE_H
+
+#include <QHash>
+#include <QLine>
+#include <QPair>
+#include <QPainterPath>
+#include <QPolygon>
+#include <QPoint>
+#include <QRect>
+#include <QSet>
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+class KisPaintDevice;
+
+/**
+ * A spatial index of the outline of a selection mask, used for
+ * rendering the marching ants.
+ *
+ * The device is split into cells aligned to the tile grid. Every cell
+ * stores the edge segments lying between its selected and unselected
+ * pixels. Unlike KisOutlineGenerator, the segments are not connected
+ * into closed polygons, so the cells are fully independent and update()
+ * regenerates only the cells touching the rects passed to invalidate().
+ *
+ * The segments are stitched into continuous polylines, so that the dash
+ * pattern of the marching ants doesn't restart on every cell border.
+ * When some cells change, only the polylines passing through them are
+ * cut at the borders of the changed cells and stitched again.
+ * outline() clips the polylines to the requested rect.
+ *
+ * The class is implicitly shared, so the copies passed to the GUI
+ * thread are cheap.
+ */
+class KRITAIMAGE_EXPORT KisOutlineTileCache
+{
+public:
+    static const int cellSize = 64;
+
+public:
+    KisOutlineTileCache();
+
+    /**
+     * Marks the pixels of \p device inside \p rc as changed, so that
+     * the next update() reads them again
+     */
+    void invalidate(const KisPaintDevice *device, const QRect &rc);
+
+    /**
+     * Marks all the pixels as changed. The cells whose content hasn't
+     * changed still keep their segments.
+     */
+    void invalidate();
+
+    /**
+     * Updates the outline of \p device inside \p rc. The pixels outside
+     * \p rc are considered to be unselected. Only the cells touching
+     * the invalidated rects or the changed parts of \p rc are read.
+     *
+     * \return the number of the regenerated cells
+     */
+    int update(const KisPaintDevice *device, const QRect &rc);
+
+    /**
+     * \return the parts of the outline lying inside \p rc.
+     *
+     * When \p dashPeriod is non-zero, every part starts at a multiple of
+     * \p dashPeriod along its polyline, so the dash pattern doesn't
+     * depend on \p rc. The part may begin slightly outside \p rc then.
+     */
+    QPainterPath outline(const QRect &rc, qreal dashPeriod = 0.0) const;
+
+    /**
+     * \return the full outline
+     */
+    QPainterPath outline() const;
+
+    QRect bounds() const;
+    bool isEmpty() const;
+    int numCells() const;
+
+    void clear();
+
+private:
+    // column and row of the cell in the grid
+    typedef QPair<int, int> CellIndex;
+
+    struct Cell {
+        quint64 contentHash = 0;
+        QVector<QLine> segments;
+    };
+
+    static quint64 calculateHash(const quint8 *mask, int maskSize);
+    static QVector<QLine> generateCellSegments(const quint8 *mask, const QPoint &cellOrigin);
+    static int cellCoord(int pixelCoord);
+    static bool cutPolyline(const QPolygon &polyline,
+                            const QSet<CellIndex> &changedCells,
+                            QVector<QLine> *pieces);
+
+    void stitchPolylines(const QSet<CellIndex> &changedCells);
+
+private:
+    QHash<CellIndex, Cell> m_cells;
+
+    QVector<QPolygon> m_polylines;
+    QVector<QRect> m_polylineBounds;
+
+    // the cells' grid and paths are stored in the coordinates of the
+    // device's data, so the position of the device is kept separately
+    QPoint m_offset;
+    QRect m_localRect;
+    QRect m_localBounds;
+
+    QVector<QRect> m_dirtyRects;
+    bool m_allDirty;
+};
+
+#endif /* __KIS_OUTLINE_TILE_CACHE_H */
@@ -63,6 +63,7 @@
 #include "kis_paint_device_cache.h"
 #include "kis_paint_device_data.h"
 #include "kis_paint_device_frames_interface.h"
+#include "kis_paint_device_lazy_loader.h"
 
 #include "kis_transform_worker.h"
 #include "kis_filter_strategy.h"
@@ -111,7 +112,9 @@ public:
 
     inline const KoColorSpace* colorSpace() const
     {
-        return currentData()->colorSpace();
+        // the color space is known before the lazy data is loaded
+        return Q_UNLIKELY(lazyLoader.load()) ?
+            m_data->colorSpace() : currentData()->colorSpace();
     }
     inline KisDataManagerSP dataManager() const
     {
@@ -147,6 +150,10 @@ public:
 
     void cloneAllDataObjects(Private *rhs, bool copyFrames)
     {
+        rhs->ensureMaterialized();
+
+        // the postponed data would overwrite the cloned one
+        delete lazyLoader.fetchAndStoreOrdered(0);
 
         m_lodData.reset();
         m_externalFrameData.reset();
@@ -473,8 +480,19 @@ private:
         return data;
     }
 
+    inline void ensureMaterialized() const
+    {
+        if (Q_UNLIKELY(lazyLoader.load())) {
+            materializeLazyData();
+        }
+    }
+
+    void materializeLazyData() const;
+
     inline Data* currentNonLodData() const
     {
+        ensureMaterialized();
+
         Data *data = m_data.data();
 
         if (contentChannel) {
@@ -533,6 +551,12 @@ private:
     }
 
     QList<Data*> allDataObjects() const
+    {
+        ensureMaterialized();
+        return allDataObjectsNoMaterialize();
+    }
+
+    QList<Data*> allDataObjectsNoMaterialize() const
     {
         QList<Data*> dataObjects;
 
@@ -566,6 +590,11 @@ private:
 
     FramesHash m_frames;
     int m_nextFreeFrameId;
+
+public:
+    QAtomicPointer<KisPaintDeviceLazyLoader> lazyLoader;
+    mutable QMutex lazyLoaderLock;
+    mutable bool isMaterializing;
 };
 
 const KisDefaultBoundsSP KisPaintDevice::Private::transitionalDefaultBounds = new KisDefaultBounds();
@@ -577,15 +606,43 @@ KisPaintDevice::Private::Private(KisPaintDevice *paintDevice)
       basicStrategy(new KisPaintDeviceStrategy(paintDevice, this)),
       isProjectionDevice(false),
       m_data(new Data(paintDevice)),
-      m_nextFreeFrameId(0)
+      m_nextFreeFrameId(0),
+      lazyLoader(0),
+      lazyLoaderLock(QMutex::Recursive),
+      isMaterializing(false)
 {
 }
 
 KisPaintDevice::Private::~Private()
 {
+    delete lazyLoader.load();
     m_frames.clear();
 }
 
+void KisPaintDevice::Private::materializeLazyData() const
+{
+    QMutexLocker l(&lazyLoaderLock);
+
+    KisPaintDeviceLazyLoader *loader = lazyLoader.load();
+
+    /**
+     * The loader fills the device via its public interface, so the
+     * recursive calls from the loading thread should just pass through
+     */
+    if (!loader || isMaterializing) return;
+
+    isMaterializing = true;
+
+    if (!loader->load(q)) {
+        warnKrita << "WARNING: failed to load lazy data of the paint device" << q->objectName();
+    }
+
+    lazyLoader.store(0);
+    isMaterializing = false;
+
+    delete loader;
+}
+
 KisPaintDevice::Private::KisPaintDeviceStrategy* KisPaintDevice::Private::currentStrategy()
 {
     if (!defaultBounds->wrapAroundMode()) {
@@ -819,6 +876,8 @@ void KisPaintDevice::Private::uploadFrame(int dstFrameId, KisPaintDeviceSP srcDe
     DataSP dstData = m_frames[dstFrameId];
     KIS_ASSERT_RECOVER_RETURN(dstData);
 
+    srcDevice->m_d->ensureMaterialized();
+
     DataSP srcData = srcDevice->m_d->m_data;
     KIS_ASSERT_RECOVER_RETURN(srcData);
 
@@ -927,7 +986,8 @@ bool KisPaintDevice::Private::assignProfile(const KoColorProfile * profile)
         KoColorSpaceRegistry::instance()->colorSpace(colorSpace()->colorModelId().id(), colorSpace()->colorDepthId().id(), profile);
     if (!dstColorSpace) return false;
 
-    QList<Data*> dataObjects = allDataObjects();;
+    // assigning a profile doesn't touch the pixels, so it doesn't need the lazy data
+    QList<Data*> dataObjects = allDataObjectsNoMaterialize();
     Q_FOREACH (Data *data, dataObjects) {
         if (!data) continue;
         data->assignColorSpace(dstColorSpace);
@@ -1173,6 +1233,27 @@ QRegion KisPaintDevice::region() const
     return m_d->currentStrategy()->region();
 }
 
+KisTileContent::Flags KisPaintDevice::tileContentFlags(const QRect &rc) const
+{
+    if (rc.isEmpty()) return KisTileContent::Flags();
+
+    const KisTileContent::AlphaDescriptor alpha = KisTileContent::alphaDescriptor(colorSpace());
+    KisTileContent::Flags flags(KisTileContent::Uniform |
+                                KisTileContent::Transparent |
+                                KisTileContent::Opaque);
+
+    KisRandomConstAccessorSP accessor = createRandomConstAccessorNG(rc.x(), rc.y());
+
+    for (qint32 y = rc.y(); y <= rc.bottom() && flags; y += accessor->numContiguousRows(y)) {
+        for (qint32 x = rc.x(); x <= rc.right() && flags; x += accessor->numContiguousColumns(x)) {
+            accessor->moveTo(x, y);
+            flags &= int(accessor->tileContentFlags(alpha));
+        }
+    }
+
+    return flags;
+}
+
 QRect KisPaintDevice::nonDefaultPixelArea() const
 {
     return m_d->cache()->nonDefaultPixelArea();
@@ -1330,10 +1411,216 @@ QRect calculateExactBoundsImpl(const KisPaintDevice *device, const QRect &startR
                  boundBottom - boundTop + 1);
 }
 
+/**
+ * Calculates the bounds of the non-empty pixels of a single tile
+ */
+template <class ComparePixelOp>
+QRect calculateTileExactBounds(const quint8 *data, int pixelSize, ComparePixelOp &compareOp)
+{
+    const int width = KisTileData::WIDTH;
+    const int height = KisTileData::HEIGHT;
+    const int rowStride = width * pixelSize;
+
+    auto isPixelEmpty = [&] (int x, int y) {
+        return compareOp.isPixelEmpty(data + y * rowStride + x * pixelSize);
+    };
+
+    int top = -1;
+    for (int y = 0; y < height && top < 0; y++) {
+        for (int x = 0; x < width; x++) {
+            if (!isPixelEmpty(x, y)) {
+                top = y;
+                break;
+            }
+        }
+    }
+
+    if (top < 0) return QRect();
+
+    int bottom = -1;
+    for (int y = height - 1; y >= top && bottom < 0; y--) {
+        for (int x = 0; x < width; x++) {
+            if (!isPixelEmpty(x, y)) {
+                bottom = y;
+                break;
+            }
+        }
+    }
+
+    int left = -1;
+    for (int x = 0; x < width && left < 0; x++) {
+        for (int y = top; y <= bottom; y++) {
+            if (!isPixelEmpty(x, y)) {
+                left = x;
+                break;
+            }
+        }
+    }
+
+    int right = -1;
+    for (int x = width - 1; x >= left && right < 0; x--) {
+        for (int y = top; y <= bottom; y++) {
+            if (!isPixelEmpty(x, y)) {
+                right = x;
+                break;
+            }
+        }
+    }
+
+    return QRect(left, top, right - left + 1, bottom - top + 1);
+}
+
+inline int tileIndex(int coordinate, int tileSize)
+{
+    return coordinate >= 0 ? coordinate / tileSize : -((-coordinate + tileSize - 1) / tileSize);
+}
+
+/**
+ * The same as calculateExactBoundsImpl(), but works on the level of
+ * tiles. The bounds of every tile are taken from \p cache, if the tile
+ * hasn't changed since they were calculated, and the tiles are visited
+ * from the edges of the device inwards, so the search stops at the
+ * outermost non-empty tiles.
+ *
+ * \p startRect should cover all the tiles of the device, that is, the
+ * device should not be in wrap-around mode.
+ */
+template <class ComparePixelOp>
+QRect calculateExactBoundsTiled(const KisPaintDevice *device,
+                                const QRect &startRect, const QRect &endRect,
+                                ComparePixelOp compareOp,
+                                KisPaintDeviceCache::TileBoundsCache *cache,
+                                const QByteArray &emptyPixelKey)
+{
+    typedef KisPaintDeviceCache::TileBoundsCache TileBoundsCache;
+
+    if (startRect == endRect) return startRect;
+
+    KisDataManagerSP dm = device->dataManager();
+    const QPoint offset(device->x(), device->y());
+    const int pixelSize = device->pixelSize();
+
+    const QRect dataRect = startRect.translated(-offset) & dm->extent();
+    if (dataRect.isEmpty()) return endRect;
+
+    const int firstCol = tileIndex(dataRect.left(), KisTileData::WIDTH);
+    const int lastCol = tileIndex(dataRect.right(), KisTileData::WIDTH);
+    const int firstRow = tileIndex(dataRect.top(), KisTileData::HEIGHT);
+    const int lastRow = tileIndex(dataRect.bottom(), KisTileData::HEIGHT);
+
+    QMutexLocker locker(&cache->lock);
+
+    if (cache->emptyPixelKey != emptyPixelKey) {
+        cache->tiles.clear();
+        cache->emptyPixelKey = emptyPixelKey;
+    }
+
+    auto tileBounds = [&] (int col, int row) {
+        const quint64 key = TileBoundsCache::key(col, row);
+
+        KisTileSP tile = dm->getExistingTile(col, row);
+        if (!tile) {
+            cache->tiles.remove(key);
+            return QRect();
+        }
+
+        tile->lockForRead();
+
+        KisTileData *td = tile->tileData();
+        const quint64 serialNumber = td->serialNumber();
+        const qint32 revision = td->contentRevision();
+
+        QRect bounds;
+        auto it = cache->tiles.find(key);
+
+        if (it != cache->tiles.end() &&
+            it->serialNumber == serialNumber &&
+            it->revision == revision) {
+
+            bounds = it->bounds;
+        } else {
+            bounds = calculateTileExactBounds(td->data(), pixelSize, compareOp);
+
+            TileBoundsCache::Entry &entry = cache->tiles[key];
+            entry.serialNumber = serialNumber;
+            entry.revision = revision;
+            entry.bounds = bounds;
+        }
+
+        tile->unlock();
+
+        return bounds.translated(col * KisTileData::WIDTH + offset.x(),
+                                 row * KisTileData::HEIGHT + offset.y());
+    };
+
+    QRect resultRect;
+    bool found = false;
+
+    for (int row = firstRow; row <= lastRow && !found; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            const QRect rc = tileBounds(col, row);
+            if (!rc.isEmpty()) {
+                resultRect |= rc;
+                found = true;
+            }
+        }
+    }
+
+    /**
+     * If there are no non-empty tiles in the topmost
+     * direction, there are no non-empty tiles at all
+     */
+    if (!found) return endRect;
+
+    const int topRow = tileIndex(resultRect.top() - offset.y(), KisTileData::HEIGHT);
+    found = false;
+
+    for (int row = lastRow; row > topRow && !found; row--) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            const QRect rc = tileBounds(col, row);
+            if (!rc.isEmpty()) {
+                resultRect |= rc;
+                found = true;
+            }
+        }
+    }
+
+    const int bottomRow = tileIndex(resultRect.bottom() - offset.y(), KisTileData::HEIGHT);
+    found = false;
+
+    for (int col = firstCol; col <= lastCol && !found; col++) {
+        for (int row = topRow; row <= bottomRow; row++) {
+            const QRect rc = tileBounds(col, row);
+            if (!rc.isEmpty()) {
+                resultRect |= rc;
+                found = true;
+            }
+        }
+    }
+
+    const int leftCol = tileIndex(resultRect.left() - offset.x(), KisTileData::WIDTH);
+    found = false;
+
+    for (int col = lastCol; col > leftCol && !found; col--) {
+        for (int row = topRow; row <= bottomRow; row++) {
+            const QRect rc = tileBounds(col, row);
+            if (!rc.isEmpty()) {
+                resultRect |= rc;
+                found = true;
+            }
+        }
+    }
+
+    return resultRect | endRect;
+}
+
 }
 
 QRect KisPaintDevice::calculateExactBounds(bool nonDefaultOnly) const
 {
+    KisPaintDeviceCache::TileBoundsCache *tileBoundsCache =
+        m_d->cache()->tileBoundsCache(nonDefaultOnly);
+
     QRect startRect = extent();
     QRect endRect;
 
@@ -1353,13 +1640,39 @@ QRect KisPaintDevice::calculateExactBounds(bool nonDefaultOnly) const
         }
     }
 
+    /**
+     * In wrap-around mode the extent of the device is cropped
+     * by the wrap rect, so the tiles may be only partially
+     * inside the searched area
+     */
+    const bool useTiles = !defaultBounds()->wrapAroundMode();
+
     if (nonDefaultOnly) {
         const KoColor defaultPixel = this->defaultPixel();
         Impl::CheckNonDefault compareOp(pixelSize(), defaultPixel.data());
-        endRect = Impl::calculateExactBoundsImpl(this, startRect, endRect, compareOp);
+
+        if (useTiles) {
+            const QByteArray emptyPixelKey =
+                QByteArray("nondefault:") +
+                QByteArray(reinterpret_cast<const char*>(defaultPixel.data()), pixelSize());
+
+            endRect = Impl::calculateExactBoundsTiled(this, startRect, endRect, compareOp,
+                                                      tileBoundsCache, emptyPixelKey);
+        } else {
+            endRect = Impl::calculateExactBoundsImpl(this, startRect, endRect, compareOp);
+        }
     } else {
         Impl::CheckFullyTransparent compareOp(m_d->colorSpace());
-        endRect = Impl::calculateExactBoundsImpl(this, startRect, endRect, compareOp);
+
+        if (useTiles) {
+            const QByteArray emptyPixelKey =
+                QByteArray("transparent:") + m_d->colorSpace()->id().toLatin1();
+
+            endRect = Impl::calculateExactBoundsTiled(this, startRect, endRect, compareOp,
+                                                      tileBoundsCache, emptyPixelKey);
+        } else {
+            endRect = Impl::calculateExactBoundsImpl(this, startRect, endRect, compareOp);
+        }
     }
 
     return endRect;
@@ -1458,6 +1771,28 @@ bool KisPaintDevice::read(QIODevice *stream)
     return retval;
 }
 
+void KisPaintDevice::setLazyLoader(KisPaintDeviceLazyLoader *loader)
+{
+    KIS_SAFE_ASSERT_RECOVER(!m_d->contentChannel && !m_d->isProjectionDevice) {
+        QScopedPointer<KisPaintDeviceLazyLoader> guard(loader);
+        loader->load(this);
+        return;
+    }
+
+    QMutexLocker l(&m_d->lazyLoaderLock);
+    delete m_d->lazyLoader.fetchAndStoreOrdered(loader);
+}
+
+bool KisPaintDevice::isMaterialized() const
+{
+    return !m_d->lazyLoader.load();
+}
+
+void KisPaintDevice::materialize()
+{
+    m_d->ensureMaterialized();
+}
+
 void KisPaintDevice::emitColorSpaceChanged()
 {
     emit colorSpaceChanged(m_d->colorSpace());
@@ -30,6 +30,7 @@
 #include "kis_types.h"
 #include "kis_shared.h"
 #include "kis_default_bounds_base.h"
+#include "kis_tile_content_flags.h"
 
 #include <kritaimage_export.h>
 
@@ -51,6 +52,7 @@ class KisKeyframe;
 class KisRasterKeyframeChannel;
 
 class KisPaintDeviceFramesInterface;
+class KisPaintDeviceLazyLoader;
 
 typedef KisSharedPtr<KisDataManager> KisDataManagerSP;
 
@@ -125,6 +127,26 @@ public:
      */
     bool read(QIODevice *stream);
 
+    /**
+     * Postpones loading of the pixel data until it is accessed for the
+     * first time (or until materialize() is called). The color space and
+     * the profile of the device can still be changed without loading.
+     *
+     * Only the devices without animation frames can be loaded lazily.
+     * The device takes ownership of \p loader.
+     */
+    void setLazyLoader(KisPaintDeviceLazyLoader *loader);
+
+    /**
+     * \return false if the device still waits for its lazily loaded data
+     */
+    bool isMaterialized() const;
+
+    /**
+     * Loads the postponed data right now. Can be called from any thread.
+     */
+    void materialize();
+
 public:
 
     /**
@@ -253,6 +275,16 @@ public:
      */
     QRegion regionExact() const;
 
+    /**
+     * Returns the content flags shared by all the tiles intersecting
+     * \p rc. KisTileContent::Uniform means that every tile is uniform
+     * on its own, the tiles may still have different colors.
+     *
+     * The flags are cached in the tiles, so the call is cheap for the
+     * tiles that have not changed since the previous request.
+     */
+    KisTileContent::Flags tileContentFlags(const QRect &rc) const;
+
     /**
      * Cut the paint device down to the specified rect. If the crop
      * area is bigger than the paint device, nothing will happen.
@@ -810,9 +842,11 @@ public:
 
     /**
      * Caclculates exact bounds of the device. Used internally
-     * by a transparent caching system. The solution is very slow
-     * because it does a linear scanline search. So the complexity
-     * is n*n at worst.
+     * by a transparent caching system. The bounds of every tile
+     * are cached separately and only the tiles changed since the
+     * previous call are scanned again. The search goes inwards from
+     * the edges of the device, so only the outermost non-empty
+     * tiles are scanned at all.
      *
      * \see exactBounds(), nonDefaultPixelArea()
      */
@@ -21,6 +21,9 @@
 
 #include "kis_lock_free_cache.h"
 #include <QElapsedTimer>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
 
 
 class KisPaintDeviceCache
@@ -112,6 +115,42 @@ public:
         return m_sequenceNumber;
     }
 
+    /**
+     * The bounds of the non-empty pixels of every tile, which are
+     * used by KisPaintDevice::calculateExactBounds(). An entry is
+     * valid while the tile keeps the same tile data with the same
+     * content revision, so, unlike the other caches, it is not
+     * dropped by invalidate() and only the changed tiles are
+     * scanned again.
+     */
+    struct TileBoundsCache {
+        struct Entry {
+            Entry() : serialNumber(0), revision(0) {}
+
+            quint64 serialNumber;
+            qint32 revision;
+            QRect bounds;
+        };
+
+        static quint64 key(qint32 col, qint32 row) {
+            return (quint64(quint32(col)) << 32) | quint32(row);
+        }
+
+        QMutex lock;
+
+        /**
+         * Describes what an empty pixel is, the entries are
+         * dropped when it changes
+         */
+        QByteArray emptyPixelKey;
+
+        QHash<quint64, Entry> tiles;
+    };
+
+    TileBoundsCache* tileBoundsCache(bool nonDefaultOnly) {
+        return nonDefaultOnly ? &m_nonDefaultTileBoundsCache : &m_exactTileBoundsCache;
+    }
+
 private:
     inline QImage findThumbnail(qint32 w, qint32 h, qreal oversample) {
         QImage resultImage;
@@ -162,6 +201,9 @@ private:
     NonDefaultPixelCache m_nonDefaultPixelAreaCache;
     RegionCache m_regionCache;
 
+    TileBoundsCache m_exactTileBoundsCache;
+    TileBoundsCache m_nonDefaultTileBoundsCache;
+
     bool m_thumbnailsValid;
     QMap<int, QMap<int, QMap<qreal,QImage> > > m_thumbnails;
     QAtomicInt m_sequenceNumber;
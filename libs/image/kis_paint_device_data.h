@@ -21,6 +21,7 @@
 
 #include "KoAlwaysInline.h"
 #include "kundo2command.h"
+#include "kis_tile_content_flags.h"
 
 
 struct DirectDataAccessPolicy {
@@ -72,12 +73,14 @@ public:
           m_levelOfDetail(rhs->m_levelOfDetail),
           m_cacheInvalidator(this)
         {
+            m_dataManager->setAlphaDescriptor(rhs->m_dataManager->alphaDescriptor());
             m_cache.setupCache();
         }
 
     void init(const KoColorSpace *cs, KisDataManagerSP dataManager) {
         m_colorSpace = cs;
         m_dataManager = dataManager;
+        updateAlphaDescriptor();
         m_cache.setupCache();
     }
 
@@ -136,6 +139,7 @@ public:
         KIS_ASSERT_RECOVER_RETURN(m_colorSpace->pixelSize() == dstColorSpace->pixelSize());
 
         m_colorSpace = dstColorSpace;
+        updateAlphaDescriptor();
         m_cache.invalidate();
     }
 
@@ -155,6 +159,7 @@ public:
         m_colorSpace->convertPixelsTo(m_dataManager->defaultPixel(), dstDefaultPixel.data(), dstColorSpace, 1, renderingIntent, conversionFlags);
 
         KisDataManagerSP dstDataManager = new KisDataManager(dstPixelSize, dstDefaultPixel.data());
+        dstDataManager->setAlphaDescriptor(KisTileContent::alphaDescriptor(dstColorSpace));
 
 
         if (!rc.isEmpty()) {
@@ -217,6 +222,7 @@ public:
 
         m_levelOfDetail = srcData->levelOfDetail();
         m_colorSpace = srcData->colorSpace();
+        updateAlphaDescriptor();
         m_cache.invalidate();
     }
 
@@ -269,6 +275,10 @@ private:
         KisPaintDeviceData *q;
     };
 
+    void updateAlphaDescriptor() {
+        m_dataManager->setAlphaDescriptor(KisTileContent::alphaDescriptor(m_colorSpace));
+    }
+
 
 private:
 
@@ -0,0 +1,44 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KIS_PAINT_DEVICE_LAZY_LOADER_H
+#define KIS_PAINT_DEVICE_LAZY_LOADER_H
+
+#include <kritaimage_export.h>
+
+class KisPaintDevice;
+
+/**
+ * The source of the pixel data of a paint device, which is loaded only
+ * when the data is accessed for the first time.
+ *
+ * \see KisPaintDevice::setLazyLoader()
+ */
+class KRITAIMAGE_EXPORT KisPaintDeviceLazyLoader {
+public:
+    virtual ~KisPaintDeviceLazyLoader() {}
+
+    /**
+     * Fills \p device with the postponed data. The method is called
+     * exactly once, from the thread that accessed the device first.
+     * All the other threads accessing the device wait until it returns.
+     */
+    virtual bool load(KisPaintDevice *device) = 0;
+};
+
+
+#endif // KIS_PAINT_DEVICE_LAZY_LOADER_H
@@ -63,6 +63,7 @@
 #include "kis_lod_transform.h"
 #include "kis_algebra_2d.h"
 #include "krita_utils.h"
+#include "KisRunnableStrokeJobData.h"
 
 
 // Maximum distance from a Bezier control point to the line through the start
@@ -108,6 +109,7 @@ void KisPainter::init()
     d->fillStyle = FillStyleNone;
     d->strokeStyle = StrokeStyleBrush;
     d->antiAliasPolygonFill = true;
+    d->useCoverageRasterizer = true;
     d->progressUpdater = 0;
     d->gradient = 0;
     d->maskPainter = 0;
@@ -677,6 +679,35 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
         }
     }
     else {
+        /**
+         * The content flags of the source tiles let us skip transparent
+         * chunks, copy opaque ones and composite uniform ones as a
+         * constant color. Calculating the flags costs a pass over the
+         * tile, so we ask for them only when the chunk covers a big part
+         * of it. The flags are cached by the tile afterwards, so the
+         * layers that don't change are checked only once.
+         *
+         * The old data of the tiles can be changed without locking the
+         * tile for writing, so there are no flags for it.
+         */
+        const bool sameColorSpace = *srcDev->colorSpace() == *d->colorSpace;
+        const bool isOver = d->compositeOp->id() == COMPOSITE_OVER;
+        const bool canSkipTransparent = isOver;
+        const bool canCopyOpaque = isOver && sameColorSpace &&
+            d->isOpacityUnit && d->paramInfo.flow == 1.0f &&
+            d->paramInfo.channelFlags.isEmpty();
+        const bool canUseConstantColor = sameColorSpace;
+
+        const bool useContentFlags = !useOldSrcData &&
+            (canSkipTransparent || canCopyOpaque || canUseConstantColor);
+
+        const KisTileContent::AlphaDescriptor srcAlpha =
+            useContentFlags ?
+            KisTileContent::alphaDescriptor(srcDev->colorSpace()) :
+            KisTileContent::AlphaDescriptor();
+
+        const qint32 minContentFlagsChunkArea = KisTileData::WIDTH * KisTileData::HEIGHT / 2;
+        const qint32 pixelSize = d->device->pixelSize();
 
         while (rowsRemaining > 0) {
 
@@ -700,9 +731,47 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                 qint32 srcRowStride = srcIt->rowStride(srcX_, srcY_);
                 srcIt->moveTo(srcX_, srcY_);
 
+                KisTileContent::Flags srcFlags;
+                if (useContentFlags && rows * columns >= minContentFlagsChunkArea) {
+                    srcFlags = srcIt->tileContentFlags(srcAlpha);
+                }
+
+                /**
+                 * Check the source before touching the destination,
+                 * so skipped chunks don't detach its tiles
+                 */
+                if (canSkipTransparent && (srcFlags & KisTileContent::Transparent)) {
+                    srcX_ += columns;
+                    dstX_ += columns;
+                    columnsRemaining -= columns;
+                    continue;
+                }
+
                 qint32 dstRowStride = dstIt->rowStride(dstX_, dstY_);
                 dstIt->moveTo(dstX_, dstY_);
 
+                if (canCopyOpaque && (srcFlags & KisTileContent::Opaque)) {
+                    const quint8 *srcPtr = srcIt->rawDataConst();
+                    quint8 *dstPtr = dstIt->rawData();
+                    const qint32 rowSize = columns * pixelSize;
+
+                    for (qint32 i = 0; i < rows; i++) {
+                        memcpy(dstPtr, srcPtr, rowSize);
+                        srcPtr += srcRowStride;
+                        dstPtr += dstRowStride;
+                    }
+
+                    srcX_ += columns;
+                    dstX_ += columns;
+                    columnsRemaining -= columns;
+                    continue;
+                }
+
+                if (canUseConstantColor && (srcFlags & KisTileContent::Uniform)) {
+                    // the composite ops treat zero stride as a constant color
+                    srcRowStride = 0;
+                }
+
                 d->paramInfo.dstRowStart   = dstIt->rawData();
                 d->paramInfo.dstRowStride  = dstRowStride;
                 // if we don't use the oldRawData, we need to access the rawData of the source device.
@@ -1230,57 +1299,71 @@ void KisPainter::fillPolygon(const vQPointF& points, FillStyle fillStyle)
 
 void KisPainter::paintPolygon(const vQPointF& points)
 {
+    d->beginJobsBatch();
+
     if (d->fillStyle != FillStyleNone) {
         fillPolygon(points, d->fillStyle);
     }
 
     if (d->strokeStyle != StrokeStyleNone) {
         if (points.count() > 1) {
-            KisDistanceInformation distance(points[0],
-                                            KisAlgebra2D::directionBetweenPoints(points[0], points[1], 0.0));
+            // the outline should be painted on top of the fill
+            d->runAfterBatchedJobs([this, points] () {
+                KisDistanceInformation distance(points[0],
+                                                KisAlgebra2D::directionBetweenPoints(points[0], points[1], 0.0));
 
-            for (int i = 0; i < points.count() - 1; i++) {
-                paintLine(KisPaintInformation(points[i]), KisPaintInformation(points[i + 1]), &distance);
-            }
-            paintLine(points[points.count() - 1], points[0], &distance);
+                for (int i = 0; i < points.count() - 1; i++) {
+                    paintLine(KisPaintInformation(points[i]), KisPaintInformation(points[i + 1]), &distance);
+                }
+                paintLine(points[points.count() - 1], points[0], &distance);
+            });
         }
     }
+
+    d->endJobsBatch();
 }
 
 void KisPainter::paintPainterPath(const QPainterPath& path)
 {
+    d->beginJobsBatch();
+
     if (d->fillStyle != FillStyleNone) {
         fillPainterPath(path);
     }
 
-    if (d->strokeStyle == StrokeStyleNone) return;
-
-    QPointF lastPoint, nextPoint;
-    int elementCount = path.elementCount();
-    KisDistanceInformation saveDist;
-    for (int i = 0; i < elementCount; i++) {
-        QPainterPath::Element element = path.elementAt(i);
-        switch (element.type) {
-        case QPainterPath::MoveToElement:
-            lastPoint =  QPointF(element.x, element.y);
-            break;
-        case QPainterPath::LineToElement:
-            nextPoint =  QPointF(element.x, element.y);
-            paintLine(KisPaintInformation(lastPoint), KisPaintInformation(nextPoint), &saveDist);
-            lastPoint = nextPoint;
-            break;
-        case QPainterPath::CurveToElement:
-            nextPoint =  QPointF(path.elementAt(i + 2).x, path.elementAt(i + 2).y);
-            paintBezierCurve(KisPaintInformation(lastPoint),
-                             QPointF(path.elementAt(i).x, path.elementAt(i).y),
-                             QPointF(path.elementAt(i + 1).x, path.elementAt(i + 1).y),
-                             KisPaintInformation(nextPoint), &saveDist);
-            lastPoint = nextPoint;
-            break;
-        default:
-            continue;
-        }
+    if (d->strokeStyle != StrokeStyleNone) {
+        // the outline should be painted on top of the fill
+        d->runAfterBatchedJobs([this, path] () {
+            QPointF lastPoint, nextPoint;
+            int elementCount = path.elementCount();
+            KisDistanceInformation saveDist;
+            for (int i = 0; i < elementCount; i++) {
+                QPainterPath::Element element = path.elementAt(i);
+                switch (element.type) {
+                case QPainterPath::MoveToElement:
+                    lastPoint =  QPointF(element.x, element.y);
+                    break;
+                case QPainterPath::LineToElement:
+                    nextPoint =  QPointF(element.x, element.y);
+                    paintLine(KisPaintInformation(lastPoint), KisPaintInformation(nextPoint), &saveDist);
+                    lastPoint = nextPoint;
+                    break;
+                case QPainterPath::CurveToElement:
+                    nextPoint =  QPointF(path.elementAt(i + 2).x, path.elementAt(i + 2).y);
+                    paintBezierCurve(KisPaintInformation(lastPoint),
+                                     QPointF(path.elementAt(i).x, path.elementAt(i).y),
+                                     QPointF(path.elementAt(i + 1).x, path.elementAt(i + 1).y),
+                                     KisPaintInformation(nextPoint), &saveDist);
+                    lastPoint = nextPoint;
+                    break;
+                default:
+                    continue;
+                }
+            }
+        });
     }
+
+    d->endJobsBatch();
 }
 
 void KisPainter::fillPainterPath(const QPainterPath& path)
@@ -1290,6 +1373,8 @@ void KisPainter::fillPainterPath(const QPainterPath& path)
 
 void KisPainter::fillPainterPath(const QPainterPath& path, const QRect &requestedRect)
 {
+    d->beginJobsBatch();
+
     if (d->mirrorHorizontally || d->mirrorVertically) {
         KisLodTransform lod(d->device);
         QPointF effectiveAxesCenter = lod.map(d->axesCenter);
@@ -1324,6 +1409,54 @@ void KisPainter::fillPainterPath(const QPainterPath& path, const QRect &requeste
     }
 
     d->fillPainterPathImpl(path, requestedRect);
+
+    d->endJobsBatch();
+}
+
+void KisPainter::fillAndDrawPainterPath(const QPainterPath& path, const QPen& pen)
+{
+    d->beginJobsBatch();
+
+    fillPainterPath(path);
+
+    d->runAfterBatchedJobs([this, path, pen] () {
+        drawPainterPath(path, pen);
+    });
+
+    d->endJobsBatch();
+}
+
+void KisPainter::Private::beginJobsBatch()
+{
+    jobsBatchLevel++;
+}
+
+void KisPainter::Private::endJobsBatch()
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(jobsBatchLevel > 0);
+
+    if (--jobsBatchLevel > 0 || jobsBatch.isEmpty()) return;
+
+    KIS_SAFE_ASSERT_RECOVER(runnableStrokeJobsInterface) {
+        Q_FOREACH (KisRunnableStrokeJobData *job, jobsBatch) {
+            job->run();
+        }
+        qDeleteAll(jobsBatch);
+        jobsBatch.clear();
+        return;
+    }
+
+    runnableStrokeJobsInterface->addRunnableJobs(jobsBatch);
+    jobsBatch.clear();
+}
+
+void KisPainter::Private::runAfterBatchedJobs(std::function<void()> func)
+{
+    if (jobsBatch.isEmpty()) {
+        func();
+    } else {
+        jobsBatch.append(new KisRunnableStrokeJobData(func, KisStrokeJobData::SEQUENTIAL));
+    }
 }
 
 void KisPainter::Private::fillPainterPathImpl(const QPainterPath& path, const QRect &requestedRect)
@@ -1332,6 +1465,33 @@ void KisPainter::Private::fillPainterPathImpl(const QPainterPath& path, const QR
         return;
     }
 
+    /**
+     * The mirrored copies of the fill may still be waiting in the
+     * batch, so the rest of the copies should be painted after them
+     */
+    if (!jobsBatch.isEmpty()) {
+        runAfterBatchedJobs([this, path, requestedRect] () {
+            fillPainterPathImpl(path, requestedRect);
+        });
+        return;
+    }
+
+    /**
+     * The copy op writes the transparent pixels of the source as well, so
+     * it needs the whole fill rect to be blitted
+     */
+    if (useCoverageRasterizer && antiAliasPolygonFill &&
+        compositeOp->id() != COMPOSITE_COPY) {
+
+        QRect fillRect = path.boundingRect().toAlignedRect().adjusted(-1, -1, 1, 1);
+        if (requestedRect.isValid()) {
+            fillRect &= requestedRect;
+        }
+
+        fillPainterPathCoverage(path, fillRect);
+        return;
+    }
+
     // Fill the polygon bounding rectangle with the required contents then we'll
     // create a mask for the actual polygon coverage.
 
@@ -1419,6 +1579,220 @@ void KisPainter::Private::fillPainterPathImpl(const QPainterPath& path, const QR
     q->bitBlt(bltRect.x(), bltRect.y(), polygon, bltRect.x(), bltRect.y(), bltRect.width(), bltRect.height());
 }
 
+void KisPainter::Private::fillPainterPathCoverage(const QPainterPath& path, const QRect &fillRect)
+{
+    if (fillRect.isEmpty()) return;
+
+    KoColor srcColor;
+    bool useSourceDevice = false;
+
+    switch (fillStyle) {
+    default:
+        // Fall through
+    case FillStyleGradient:
+        // Currently unsupported, fall through
+    case FillStyleStrokes:
+        // Currently unsupported, fall through
+        warnImage << "Unknown or unsupported fill style in fillPolygon\n";
+    case FillStyleForegroundColor:
+        srcColor = q->paintColor();
+        break;
+    case FillStyleBackgroundColor:
+        srcColor = q->backgroundColor();
+        break;
+    case FillStylePattern:
+        if (!pattern) return;
+        useSourceDevice = true;
+        break;
+    case FillStyleGenerator:
+        if (!generator) return;
+        useSourceDevice = true;
+        break;
+    }
+
+    if (useSourceDevice) {
+        if (!fillPainter) {
+            polygon = device->createCompositionSourceDevice();
+            fillPainter = new KisFillPainter(polygon);
+        } else {
+            polygon->clear();
+        }
+    } else {
+        srcColor.convertTo(device->compositionSourceColorSpace());
+    }
+
+    /**
+     * The bands are aligned to the tiles of the device, which are shifted
+     * by the offset of the device, so the bands never share a tile.
+     */
+    QSharedPointer<KisCoverageRasterizer> rasterizer(
+        new KisCoverageRasterizer(path, fillRect,
+                                  QSize(KisTileData::WIDTH, KisTileData::HEIGHT),
+                                  QPoint(device->x(), device->y())));
+
+    KisPaintDeviceSP selectionProjection;
+    if (selection) {
+        selectionProjection = selection->projection();
+    }
+
+    /**
+     * When the painter runs inside a stroke, the bands filled with a color
+     * are processed by concurrent stroke jobs. Patterns and generators are
+     * rendered by the shared fill painter, so they are always processed
+     * sequentially, as well as the fills done outside strokes.
+     */
+    const int minBandsForParallelFill = 4;
+    const bool runInParallel =
+        runnableStrokeJobsInterface && jobsBatchLevel > 0 &&
+        !useSourceDevice && rasterizer->numBands() >= minBandsForParallelFill;
+
+    if (runInParallel) {
+        QSharedPointer<QVector<QRect>> dirtyRects(new QVector<QRect>(rasterizer->numBands()));
+        const KoCompositeOp::ParameterInfo bandParamInfo = paramInfo;
+
+        for (int i = 0; i < rasterizer->numBands(); i++) {
+            jobsBatch.append(new KisRunnableStrokeJobData(
+                [this, i, rasterizer, dirtyRects, srcColor, selectionProjection, bandParamInfo] () {
+                    KisCoverageRasterizer::Band band;
+                    rasterizer->renderBand(i, &band);
+
+                    KoCompositeOp::ParameterInfo localParamInfo = bandParamInfo;
+                    (*dirtyRects)[i] = compositeCoverage(band, srcColor, KisPaintDeviceSP(),
+                                                         selectionProjection, localParamInfo);
+                },
+                KisStrokeJobData::CONCURRENT));
+        }
+
+        // the sequential job also separates the bands of the following fills
+        jobsBatch.append(new KisRunnableStrokeJobData(
+            [this, dirtyRects] () {
+                Q_FOREACH (const QRect &rc, *dirtyRects) {
+                    q->addDirtyRect(rc);
+                }
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+    } else {
+        KisCoverageRasterizer::Band band;
+
+        for (int i = 0; i < rasterizer->numBands(); i++) {
+            rasterizer->renderBand(i, &band);
+            if (band.coveredRects.isEmpty()) continue;
+
+            if (useSourceDevice) {
+                Q_FOREACH (const QRect &rc, band.coveredRects) {
+                    if (fillStyle == FillStylePattern) {
+                        fillPainter->fillRect(rc, pattern);
+                    } else {
+                        fillPainter->fillRect(rc.x(), rc.y(), rc.width(), rc.height(), q->generator());
+                    }
+                }
+            }
+
+            KoCompositeOp::ParameterInfo localParamInfo = paramInfo;
+            q->addDirtyRect(compositeCoverage(band, srcColor,
+                                              useSourceDevice ? polygon : KisPaintDeviceSP(),
+                                              selectionProjection, localParamInfo));
+        }
+    }
+}
+
+QRect KisPainter::Private::compositeCoverage(const KisCoverageRasterizer::Band &band,
+                                             const KoColor &srcColor,
+                                             KisPaintDeviceSP srcDev,
+                                             KisPaintDeviceSP selectionProjection,
+                                             KoCompositeOp::ParameterInfo &localParamInfo)
+{
+    if (band.coveredRects.isEmpty()) return QRect();
+
+    const QPoint bandOrigin = band.rect.topLeft();
+
+    KisRandomAccessorSP dstIt = device->createRandomAccessorNG(bandOrigin.x(), bandOrigin.y());
+    KisRandomConstAccessorSP srcIt;
+    if (srcDev) {
+        srcIt = srcDev->createRandomConstAccessorNG(bandOrigin.x(), bandOrigin.y());
+    }
+
+    const KoColorSpace *srcColorSpace = srcDev ? srcDev->colorSpace() : srcColor.colorSpace();
+
+    QVector<quint8> maskBuffer;
+    QRect dirtyRect;
+
+    Q_FOREACH (const QRect &rc, band.coveredRects) {
+        const quint8 *mask = band.coverageAt(rc.x(), rc.y());
+        qint32 maskStride = band.rect.width();
+
+        if (selectionProjection) {
+            maskBuffer.resize(rc.width() * rc.height());
+            selectionProjection->readBytes(maskBuffer.data(), rc);
+
+            quint8 *maskPtr = maskBuffer.data();
+            for (int row = 0; row < rc.height(); row++) {
+                const quint8 *coveragePtr = mask + row * maskStride;
+                for (int col = 0; col < rc.width(); col++, maskPtr++) {
+                    *maskPtr = KoColorSpaceMaths<quint8>::multiply(*maskPtr, coveragePtr[col]);
+                }
+            }
+
+            mask = maskBuffer.constData();
+            maskStride = rc.width();
+        }
+
+        qint32 dstY = rc.y();
+        qint32 rowsRemaining = rc.height();
+
+        while (rowsRemaining > 0) {
+            qint32 dstX = rc.x();
+            qint32 columnsRemaining = rc.width();
+
+            qint32 rows = qMin(dstIt->numContiguousRows(dstY), rowsRemaining);
+            if (srcIt) {
+                rows = qMin(rows, srcIt->numContiguousRows(dstY));
+            }
+
+            while (columnsRemaining > 0) {
+                qint32 columns = qMin(dstIt->numContiguousColumns(dstX), columnsRemaining);
+                if (srcIt) {
+                    columns = qMin(columns, srcIt->numContiguousColumns(dstX));
+                }
+
+                qint32 dstRowStride = dstIt->rowStride(dstX, dstY);
+                dstIt->moveTo(dstX, dstY);
+
+                localParamInfo.dstRowStart   = dstIt->rawData();
+                localParamInfo.dstRowStride  = dstRowStride;
+
+                if (srcIt) {
+                    qint32 srcRowStride = srcIt->rowStride(dstX, dstY);
+                    srcIt->moveTo(dstX, dstY);
+
+                    localParamInfo.srcRowStart   = srcIt->rawDataConst();
+                    localParamInfo.srcRowStride  = srcRowStride;
+                } else {
+                    localParamInfo.srcRowStart   = srcColor.data();
+                    localParamInfo.srcRowStride  = 0; // use the compositeOp with only a single color pixel
+                }
+
+                localParamInfo.maskRowStart  = mask + (dstY - rc.y()) * maskStride + (dstX - rc.x());
+                localParamInfo.maskRowStride = maskStride;
+                localParamInfo.rows          = rows;
+                localParamInfo.cols          = columns;
+                colorSpace->bitBlt(srcColorSpace, localParamInfo, compositeOp, renderingIntent, conversionFlags);
+
+                dstX += columns;
+                columnsRemaining -= columns;
+            }
+
+            dstY += rows;
+            rowsRemaining -= rows;
+        }
+
+        dirtyRect |= rc;
+    }
+
+    return dirtyRect;
+}
+
 void KisPainter::drawPainterPath(const QPainterPath& path, const QPen& pen)
 {
     drawPainterPath(path, pen, QRect());
@@ -2517,6 +2891,16 @@ bool KisPainter::antiAliasPolygonFill()
     return d->antiAliasPolygonFill;
 }
 
+void KisPainter::setUseCoverageRasterizer(bool value)
+{
+    d->useCoverageRasterizer = value;
+}
+
+bool KisPainter::useCoverageRasterizer() const
+{
+    return d->useCoverageRasterizer;
+}
+
 void KisPainter::setStrokeStyle(KisPainter::StrokeStyle strokeStyle)
 {
     d->strokeStyle = strokeStyle;
@@ -2708,10 +3092,10 @@ void KisPainter::setRunnableStrokeJobsInterface(KisRunnableStrokeJobsInterface *
 KisRunnableStrokeJobsInterface *KisPainter::runnableStrokeJobsInterface() const
 {
     if (!d->runnableStrokeJobsInterface) {
-        if (!d->fakeRunnableStrokeJobsInterface) {
-            d->fakeRunnableStrokeJobsInterface.reset(new KisFakeRunnableStrokeJobsExecutor());
+        if (!d->fallbackRunnableStrokeJobsInterface) {
+            d->fallbackRunnableStrokeJobsInterface.reset(new KisThreadPoolRunnableStrokeJobsExecutor());
         }
-        return d->fakeRunnableStrokeJobsInterface.data();
+        return d->fallbackRunnableStrokeJobsInterface.data();
     }
 
     return d->runnableStrokeJobsInterface;
@@ -550,6 +550,14 @@ public:
     // convenience overload
     void drawPainterPath(const QPainterPath& path, const QPen& pen);
 
+    /**
+     * Fills \p path with the current fill style and draws its outline
+     * with \p pen on top of it. Unlike calling fillPainterPath() and
+     * drawPainterPath() one after another, it keeps the order of the two
+     * when the fill is processed by the runnable stroke jobs.
+     */
+    void fillAndDrawPainterPath(const QPainterPath& path, const QPen& pen);
+
     /**
      * paint an unstroked one-pixel wide line from specified start position to the
      * specified end position.
@@ -710,6 +718,18 @@ public:
     /// Return whether a polygon's filled area should be anti-aliased or not
     bool antiAliasPolygonFill();
 
+    /**
+     * Set whether fillPainterPath() rasterizes the anti-aliased paths with
+     * the built-in span rasterizer (KisCoverageRasterizer) instead of
+     * rendering the mask with QPainter. The rasterizer writes only into the
+     * tiles covered by the path and composes them right from the fill
+     * color. The default is true.
+     */
+    void setUseCoverageRasterizer(bool value);
+
+    /// Return whether fillPainterPath() uses the built-in span rasterizer
+    bool useCoverageRasterizer() const;
+
     /// The style of the brush stroke around polygons and so
     enum StrokeStyle {
         StrokeStyleNone,
@@ -802,7 +822,9 @@ public:
     void setColorConversionFlags(KoColorConversionTransformation::ConversionFlags conversionFlags);
 
     /**
-     * Set interface for running asynchronous jobs by paintops.
+     * Set interface for running asynchronous jobs by paintops. When it is
+     * set, fillPainterPath() also processes the large fills with concurrent
+     * jobs, so they are finished only after the current stroke job.
      *
      * NOTE: the painter does *not* own the interface device. It is the responsibility
      *       of the caller to ensure that the interface object is alive during the lifetime
@@ -812,6 +834,8 @@ public:
 
     /**
      * Get the interface for running asynchronous jobs. It is used by paintops mostly.
+     * If no interface has been set, the jobs are executed synchronously, the
+     * concurrent ones in parallel (see KisThreadPoolRunnableStrokeJobsExecutor).
      */
     KisRunnableStrokeJobsInterface* runnableStrokeJobsInterface() const;
 
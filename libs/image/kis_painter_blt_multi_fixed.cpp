@@ -24,118 +24,105 @@
 #include "kis_random_accessor_ng.h"
 #include "KisRenderedDab.h"
 
-void KisPainter::Private::applyDevice(const QRect &applyRect,
-                                      const KisRenderedDab &dab,
-                                      KisRandomAccessorSP dstIt,
-                                      const KoColorSpace *srcColorSpace,
-                                      KoCompositeOp::ParameterInfo &localParamInfo)
+void KisPainter::Private::applyDevices(const QRect &applyRect,
+                                       const QList<KisRenderedDab> &devices,
+                                       KisRandomAccessorSP dstIt,
+                                       KisRandomConstAccessorSP maskIt,
+                                       const KoColorSpace *srcColorSpace,
+                                       KoCompositeOp::ParameterInfo &localParamInfo)
 {
-    const QRect dabRect = dab.realBounds();
-    const QRect rc = applyRect & dabRect;
-
     const int srcPixelSize = srcColorSpace->pixelSize();
-    const int dabRowStride = srcPixelSize * dabRect.width();
 
+    /**
+     * The destination is traversed tile-by-tile, and every tile gets
+     * all the dabs overlapping it at once, while its data is still hot
+     * in the cache. Dense strokes may have dozens of dabs covering the
+     * same tile, so walking the dabs in the outer loop would read and
+     * write every tile dozens of times.
+     *
+     * The order of the dabs is preserved for every pixel, so the result
+     * is exactly the same as the one of blitting the dabs one-by-one.
+     */
 
-    qint32 dstY = rc.y();
-    qint32 rowsRemaining = rc.height();
+    qint32 dstY = applyRect.y();
+    qint32 rowsRemaining = applyRect.height();
 
     while (rowsRemaining > 0) {
-        qint32 dstX = rc.x();
-
-        qint32 numContiguousDstRows = dstIt->numContiguousRows(dstY);
-        qint32 rows = qMin(rowsRemaining, numContiguousDstRows);
-
-        qint32 columnsRemaining = rc.width();
-
-        while (columnsRemaining > 0) {
-
-            qint32 numContiguousDstColumns = dstIt->numContiguousColumns(dstX);
-            qint32 columns = qMin(numContiguousDstColumns, columnsRemaining);
-
-            qint32 dstRowStride = dstIt->rowStride(dstX, dstY);
-            dstIt->moveTo(dstX, dstY);
-
-            localParamInfo.dstRowStart   = dstIt->rawData();
-            localParamInfo.dstRowStride  = dstRowStride;
-            localParamInfo.maskRowStart  = 0;
-            localParamInfo.maskRowStride = 0;
-            localParamInfo.rows          = rows;
-            localParamInfo.cols          = columns;
-
+        qint32 dstX = applyRect.x();
 
-            const int dabX = dstX - dabRect.x();
-            const int dabY = dstY - dabRect.y();
-
-            localParamInfo.srcRowStart   = dab.device->constData() + dabX * pixelSize + dabY * dabRowStride;
-            localParamInfo.srcRowStride  = dabRowStride;
-            localParamInfo.setOpacityAndAverage(dab.opacity, dab.averageOpacity);
-            localParamInfo.flow = dab.flow;
-            colorSpace->bitBlt(srcColorSpace, localParamInfo, compositeOp, renderingIntent, conversionFlags);
-
-            dstX += columns;
-            columnsRemaining -= columns;
+        qint32 rows = qMin(rowsRemaining, dstIt->numContiguousRows(dstY));
+        if (maskIt) {
+            rows = qMin(rows, maskIt->numContiguousRows(dstY));
         }
 
-        dstY += rows;
-        rowsRemaining -= rows;
-    }
-
-}
-
-void KisPainter::Private::applyDeviceWithSelection(const QRect &applyRect,
-                                                   const KisRenderedDab &dab,
-                                                   KisRandomAccessorSP dstIt,
-                                                   KisRandomConstAccessorSP maskIt,
-                                                   const KoColorSpace *srcColorSpace,
-                                                   KoCompositeOp::ParameterInfo &localParamInfo)
-{
-    const QRect dabRect = dab.realBounds();
-    const QRect rc = applyRect & dabRect;
-
-    const int srcPixelSize = srcColorSpace->pixelSize();
-    const int dabRowStride = srcPixelSize * dabRect.width();
-
-
-    qint32 dstY = rc.y();
-    qint32 rowsRemaining = rc.height();
-
-    while (rowsRemaining > 0) {
-        qint32 dstX = rc.x();
-
-        qint32 numContiguousDstRows = dstIt->numContiguousRows(dstY);
-        qint32 numContiguousMaskRows = maskIt->numContiguousRows(dstY);
-        qint32 rows = qMin(rowsRemaining, qMin(numContiguousDstRows, numContiguousMaskRows));
-
-        qint32 columnsRemaining = rc.width();
+        qint32 columnsRemaining = applyRect.width();
 
         while (columnsRemaining > 0) {
-
-            qint32 numContiguousDstColumns = dstIt->numContiguousColumns(dstX);
-            qint32 numContiguousMaskColumns = maskIt->numContiguousColumns(dstX);
-            qint32 columns = qMin(columnsRemaining, qMin(numContiguousDstColumns, numContiguousMaskColumns));
-
-            qint32 dstRowStride = dstIt->rowStride(dstX, dstY);
-            qint32 maskRowStride = maskIt->rowStride(dstX, dstY);
+            qint32 columns = qMin(columnsRemaining, dstIt->numContiguousColumns(dstX));
+            if (maskIt) {
+                columns = qMin(columns, maskIt->numContiguousColumns(dstX));
+            }
+
+            const QRect tileRect(dstX, dstY, columns, rows);
+
+            /**
+             * The union of the dabs' bounds may have holes, so check the
+             * intersection before asking for write access. Otherwise we
+             * would materialize default tiles nobody paints on, growing
+             * the extent of the device and the undo data.
+             */
+            bool hasOverlappingDabs = false;
+            Q_FOREACH (const KisRenderedDab &dab, devices) {
+                if (tileRect.intersects(dab.realBounds())) {
+                    hasOverlappingDabs = true;
+                    break;
+                }
+            }
+
+            if (!hasOverlappingDabs) {
+                dstX += columns;
+                columnsRemaining -= columns;
+                continue;
+            }
+
+            const qint32 dstRowStride = dstIt->rowStride(dstX, dstY);
             dstIt->moveTo(dstX, dstY);
-            maskIt->moveTo(dstX, dstY);
-
-            localParamInfo.dstRowStart   = dstIt->rawData();
-            localParamInfo.dstRowStride  = dstRowStride;
-            localParamInfo.maskRowStart  = maskIt->rawDataConst();
-            localParamInfo.maskRowStride = maskRowStride;
-            localParamInfo.rows          = rows;
-            localParamInfo.cols          = columns;
-
-
-            const int dabX = dstX - dabRect.x();
-            const int dabY = dstY - dabRect.y();
-
-            localParamInfo.srcRowStart   = dab.device->constData() + dabX * pixelSize + dabY * dabRowStride;
-            localParamInfo.srcRowStride  = dabRowStride;
-            localParamInfo.setOpacityAndAverage(dab.opacity, dab.averageOpacity);
-            localParamInfo.flow = dab.flow;
-            colorSpace->bitBlt(srcColorSpace, localParamInfo, compositeOp, renderingIntent, conversionFlags);
+            quint8 *dstTileStart = dstIt->rawData();
+
+            qint32 maskRowStride = 0;
+            const quint8 *maskTileStart = 0;
+
+            if (maskIt) {
+                maskRowStride = maskIt->rowStride(dstX, dstY);
+                maskIt->moveTo(dstX, dstY);
+                maskTileStart = maskIt->rawDataConst();
+            }
+
+            Q_FOREACH (const KisRenderedDab &dab, devices) {
+                const QRect dabRect = dab.realBounds();
+                const QRect rc = tileRect & dabRect;
+                if (rc.isEmpty()) continue;
+
+                const int tileX = rc.x() - dstX;
+                const int tileY = rc.y() - dstY;
+
+                localParamInfo.dstRowStart   = dstTileStart + tileX * pixelSize + tileY * dstRowStride;
+                localParamInfo.dstRowStride  = dstRowStride;
+                localParamInfo.maskRowStart  = maskTileStart ? maskTileStart + tileX + tileY * maskRowStride : 0;
+                localParamInfo.maskRowStride = maskRowStride;
+                localParamInfo.rows          = rc.height();
+                localParamInfo.cols          = rc.width();
+
+                const int dabX = rc.x() - dabRect.x();
+                const int dabY = rc.y() - dabRect.y();
+                const int dabRowStride = srcPixelSize * dabRect.width();
+
+                localParamInfo.srcRowStart   = dab.device->constData() + dabX * srcPixelSize + dabY * dabRowStride;
+                localParamInfo.srcRowStride  = dabRowStride;
+                localParamInfo.setOpacityAndAverage(dab.opacity, dab.averageOpacity);
+                localParamInfo.flow = dab.flow;
+                colorSpace->bitBlt(srcColorSpace, localParamInfo, compositeOp, renderingIntent, conversionFlags);
+            }
 
             dstX += columns;
             columnsRemaining -= columns;
@@ -144,7 +131,6 @@ void KisPainter::Private::applyDeviceWithSelection(const QRect &applyRect,
         dstY += rows;
         rowsRemaining -= rows;
     }
-
 }
 
 void KisPainter::bltFixed(const QRect &applyRect, const QList<KisRenderedDab> allSrcDevices)
@@ -180,15 +166,7 @@ void KisPainter::bltFixed(const QRect &applyRect, const QList<KisRenderedDab> al
     KisRandomAccessorSP dstIt = d->device->createRandomAccessorNG(rc.left(), rc.top());
     KisRandomConstAccessorSP maskIt = d->selection ? d->selection->projection()->createRandomConstAccessorNG(rc.left(), rc.top()) : 0;
 
-    if (maskIt) {
-        Q_FOREACH (const KisRenderedDab &dab, devices) {
-            d->applyDeviceWithSelection(rc, dab, dstIt, maskIt, srcColorSpace, localParamInfo);
-        }
-    } else {
-        Q_FOREACH (const KisRenderedDab &dab, devices) {
-            d->applyDevice(rc, dab, dstIt, srcColorSpace, localParamInfo);
-        }
-    }
+    d->applyDevices(rc, devices, dstIt, maskIt, srcColorSpace, localParamInfo);
 
 
 #if 0
@@ -28,7 +28,10 @@
 #include "kis_fill_painter.h"
 #include "kis_painter.h"
 #include "kis_paintop_preset.h"
-#include <KisFakeRunnableStrokeJobsExecutor.h>
+#include <KisThreadPoolRunnableStrokeJobsExecutor.h>
+#include <KisRunnableStrokeJobData.h>
+#include <functional>
+#include "KisCoverageRasterizer.h"
 
 struct Q_DECL_HIDDEN KisPainter::Private {
     Private(KisPainter *_q) : q(_q) {}
@@ -52,6 +55,7 @@ struct Q_DECL_HIDDEN KisPainter::Private {
     FillStyle                   fillStyle;
     StrokeStyle                 strokeStyle;
     bool                        antiAliasPolygonFill;
+    bool                        useCoverageRasterizer;
     const KoPattern*           pattern;
     QPointF                     duplicateOffset;
     quint32                     pixelSize;
@@ -74,7 +78,25 @@ struct Q_DECL_HIDDEN KisPainter::Private {
     KoColorConversionTransformation::Intent renderingIntent;
     KoColorConversionTransformation::ConversionFlags conversionFlags;
     KisRunnableStrokeJobsInterface *runnableStrokeJobsInterface = 0;
-    QScopedPointer<KisRunnableStrokeJobsInterface> fakeRunnableStrokeJobsInterface;
+    QScopedPointer<KisRunnableStrokeJobsInterface> fallbackRunnableStrokeJobsInterface;
+
+    /**
+     * The jobs generated by a single call of the painter are collected
+     * into a batch and passed to the runnable jobs interface at once, so
+     * that the jobs of the following parts of the call are executed after
+     * them in the order they were added.
+     */
+    int jobsBatchLevel = 0;
+    QVector<KisRunnableStrokeJobData*> jobsBatch;
+
+    void beginJobsBatch();
+    void endJobsBatch();
+
+    /**
+     * Runs \p func right away if the batch is empty, otherwise adds it
+     * to the batch as a sequential job
+     */
+    void runAfterBatchedJobs(std::function<void()> func);
 
     bool tryReduceSourceRect(const KisPaintDevice *srcDev,
                              QRect *srcRect,
@@ -86,19 +108,20 @@ struct Q_DECL_HIDDEN KisPainter::Private {
                              qint32 *dstY);
 
     void fillPainterPathImpl(const QPainterPath& path, const QRect &requestedRect);
+    void fillPainterPathCoverage(const QPainterPath& path, const QRect &fillRect);
 
-    void applyDevice(const QRect &applyRect,
-                     const KisRenderedDab &dab,
-                     KisRandomAccessorSP dstIt,
-                     const KoColorSpace *srcColorSpace,
-                     KoCompositeOp::ParameterInfo &localParamInfo);
+    QRect compositeCoverage(const KisCoverageRasterizer::Band &band,
+                            const KoColor &srcColor,
+                            KisPaintDeviceSP srcDev,
+                            KisPaintDeviceSP selectionProjection,
+                            KoCompositeOp::ParameterInfo &localParamInfo);
 
-    void applyDeviceWithSelection(const QRect &applyRect,
-                                  const KisRenderedDab &dab,
-                                  KisRandomAccessorSP dstIt,
-                                  KisRandomConstAccessorSP maskIt,
-                                  const KoColorSpace *srcColorSpace,
-                                  KoCompositeOp::ParameterInfo &localParamInfo);
+    void applyDevices(const QRect &applyRect,
+                      const QList<KisRenderedDab> &devices,
+                      KisRandomAccessorSP dstIt,
+                      KisRandomConstAccessorSP maskIt,
+                      const KoColorSpace *srcColorSpace,
+                      KoCompositeOp::ParameterInfo &localParamInfo);
 
 };
 
@@ -49,12 +49,27 @@ struct Q_DECL_HIDDEN KisPixelSelection::Private {
     bool outlineCacheValid;
     QMutex outlineCacheMutex;
 
+    KisOutlineTileCache outlineTileCache;
+    bool outlineTileCacheValid;
+
     bool thumbnailImageValid;
     QImage thumbnailImage;
     QTransform thumbnailImageTransform;
 
     QPoint lod0CachesOffset;
 
+    void invalidateOutlineTiles(const KisPaintDevice *device, const QRect &rc) {
+        QMutexLocker locker(&outlineCacheMutex);
+        outlineTileCache.invalidate(device, rc);
+        outlineTileCacheValid = false;
+    }
+
+    void invalidateOutlineTiles() {
+        QMutexLocker locker(&outlineCacheMutex);
+        outlineTileCache.invalidate();
+        outlineTileCacheValid = false;
+    }
+
     void invalidateThumbnailImage() {
         thumbnailImageValid = false;
         thumbnailImage = QImage();
@@ -67,6 +82,7 @@ KisPixelSelection::KisPixelSelection(KisDefaultBoundsBaseSP defaultBounds, KisSe
         , m_d(new Private)
 {
     m_d->outlineCacheValid = true;
+    m_d->outlineTileCacheValid = true;
     m_d->invalidateThumbnailImage();
 
     m_d->parentSelection = parentSelection;
@@ -80,6 +96,8 @@ KisPixelSelection::KisPixelSelection(const KisPixelSelection& rhs)
     // parent selection is not supposed to be shared
     m_d->outlineCache = rhs.m_d->outlineCache;
     m_d->outlineCacheValid = rhs.m_d->outlineCacheValid;
+    m_d->outlineTileCache = rhs.m_d->outlineTileCache;
+    m_d->outlineTileCacheValid = rhs.m_d->outlineTileCacheValid;
 
     m_d->thumbnailImageValid = rhs.m_d->thumbnailImageValid;
     m_d->thumbnailImage = rhs.m_d->thumbnailImage;
@@ -108,6 +126,7 @@ bool KisPixelSelection::read(QIODevice *stream)
 {
     bool retval = KisPaintDevice::read(stream);
     m_d->outlineCacheValid = false;
+    m_d->invalidateOutlineTiles();
     m_d->invalidateThumbnailImage();
     return retval;
 }
@@ -131,6 +150,7 @@ void KisPixelSelection::select(const QRect & rc, quint8 selectedness)
             m_d->outlineCache -= path;
         }
     }
+    m_d->invalidateOutlineTiles(this, r);
     m_d->invalidateThumbnailImage();
 }
 
@@ -171,6 +191,7 @@ void KisPixelSelection::copyAlphaFrom(KisPaintDeviceSP src, const QRect &process
 
     m_d->outlineCacheValid = false;
     m_d->outlineCache = QPainterPath();
+    m_d->invalidateOutlineTiles(this, processRect);
     m_d->invalidateThumbnailImage();
 }
 
@@ -199,6 +220,7 @@ void KisPixelSelection::addSelection(KisPixelSelectionSP selection)
         m_d->outlineCache += selection->outlineCache();
     }
 
+    m_d->invalidateOutlineTiles(this, r);
     m_d->invalidateThumbnailImage();
 }
 
@@ -228,6 +250,7 @@ void KisPixelSelection::subtractSelection(KisPixelSelectionSP selection)
         m_d->outlineCache -= selection->outlineCache();
     }
 
+    m_d->invalidateOutlineTiles(this, r);
     m_d->invalidateThumbnailImage();
 }
 
@@ -252,6 +275,7 @@ void KisPixelSelection::intersectSelection(KisPixelSelectionSP selection)
         m_d->outlineCache &= selection->outlineCache();
     }
 
+    m_d->invalidateOutlineTiles(this, r);
     m_d->invalidateThumbnailImage();
 }
 
@@ -272,6 +296,7 @@ void KisPixelSelection::clear(const QRect & r)
         m_d->outlineCache -= path;
     }
 
+    m_d->invalidateOutlineTiles(this, r);
     m_d->invalidateThumbnailImage();
 }
 
@@ -283,6 +308,9 @@ void KisPixelSelection::clear()
     m_d->outlineCacheValid = true;
     m_d->outlineCache = QPainterPath();
 
+    m_d->outlineTileCacheValid = true;
+    m_d->outlineTileCache.clear();
+
     // Empty the thumbnail image. It is a valid state.
     m_d->invalidateThumbnailImage();
     m_d->thumbnailImageValid = true;
@@ -310,6 +338,7 @@ void KisPixelSelection::invert()
         m_d->outlineCache = path - m_d->outlineCache;
     }
 
+    m_d->invalidateOutlineTiles();
     m_d->invalidateThumbnailImage();
 }
 
@@ -333,6 +362,10 @@ void KisPixelSelection::moveTo(const QPoint &pt)
 
     m_d->lod0CachesOffset = lod0Point;
 
+    // the cells are stored in the device's coordinates, so the
+    // recalculation will just pick up the new offset
+    m_d->outlineTileCacheValid = false;
+
     KisPaintDevice::moveTo(pt);
 }
 
@@ -408,6 +441,8 @@ void KisPixelSelection::setOutlineCache(const QPainterPath &cache)
     QMutexLocker locker(&m_d->outlineCacheMutex);
     m_d->outlineCache = cache;
     m_d->outlineCacheValid = true;
+    m_d->outlineTileCache.invalidate();
+    m_d->outlineTileCacheValid = false;
     m_d->thumbnailImageValid = false;
 }
 
@@ -421,6 +456,8 @@ void KisPixelSelection::invalidateOutlineCache()
 {
     QMutexLocker locker(&m_d->outlineCacheMutex);
     m_d->outlineCacheValid = false;
+    m_d->outlineTileCache.invalidate();
+    m_d->outlineTileCacheValid = false;
     m_d->thumbnailImageValid = false;
 }
 
@@ -448,6 +485,33 @@ void KisPixelSelection::recalculateOutlineCache()
     m_d->outlineCacheValid = true;
 }
 
+KisOutlineTileCache KisPixelSelection::outlineTileCache() const
+{
+    QMutexLocker locker(&m_d->outlineCacheMutex);
+    return m_d->outlineTileCache;
+}
+
+bool KisPixelSelection::outlineTileCacheValid() const
+{
+    QMutexLocker locker(&m_d->outlineCacheMutex);
+    return m_d->outlineTileCacheValid;
+}
+
+void KisPixelSelection::recalculateOutlineTileCache()
+{
+    QMutexLocker locker(&m_d->outlineCacheMutex);
+
+    QRect selectionExtent = selectedExactRect();
+
+    // see a comment in outline()
+    if (*defaultPixel().data() != MIN_SELECTED) {
+        selectionExtent &= defaultBounds()->bounds();
+    }
+
+    m_d->outlineTileCache.update(this, selectionExtent);
+    m_d->outlineTileCacheValid = true;
+}
+
 bool KisPixelSelection::thumbnailImageValid() const
 {
     return m_d->thumbnailImageValid;
@@ -26,6 +26,7 @@
 #include "kis_paint_device.h"
 #include "kis_selection_component.h"
 #include "kis_selection.h"
+#include "kis_outline_tile_cache.h"
 #include <kritaimage_export.h>
 
 
@@ -125,6 +126,17 @@ public:
     void setOutlineCache(const QPainterPath &cache);
     void invalidateOutlineCache();
 
+    /**
+     * The tile-local outline of the selection used for rendering
+     * marching ants. It is invalidated together with outlineCache(),
+     * but on recalculation only the changed cells are regenerated.
+     *
+     * \see KisOutlineTileCache
+     */
+    KisOutlineTileCache outlineTileCache() const;
+    bool outlineTileCacheValid() const;
+    void recalculateOutlineTileCache();
+
     bool thumbnailImageValid() const;
     QImage thumbnailImage() const;
     QTransform thumbnailImageTransform() const;
@@ -37,9 +37,32 @@ struct Q_DECL_HIDDEN KisProjectionLeaf::Private
 
     KisNode* node;
 
+    /**
+     * \return true if the children of the group are composited right
+     * into the parent of the group. The pass-through groups with active
+     * cache are composited as usual groups.
+     */
     static bool checkPassThrough(const KisNode *node) {
         const KisGroupLayer *group = qobject_cast<const KisGroupLayer*>(node);
-        return group && group->passThroughMode();
+        return group && group->passThroughMode() && !group->passThroughCacheActive();
+    }
+
+    static bool checkCachedPassThrough(const KisNode *node) {
+        const KisGroupLayer *group = qobject_cast<const KisGroupLayer*>(node);
+        return group && group->passThroughCacheActive();
+    }
+
+    static quint8 passThroughOpacity(const KisNode *node) {
+        quint8 resultOpacity = node->opacity();
+
+        const KisNode *parent = node->parent().data();
+        const KisGroupLayer *group = qobject_cast<const KisGroupLayer*>(parent);
+
+        if (group && group->passThroughMode()) {
+            resultOpacity = KritaUtils::mergeOpacity(resultOpacity, passThroughOpacity(parent));
+        }
+
+        return resultOpacity;
     }
 
     bool checkParentPassThrough() {
@@ -211,15 +234,15 @@ bool KisProjectionLeaf::visible() const
 
 quint8 KisProjectionLeaf::opacity() const
 {
-    quint8 resultOpacity = m_d->node->opacity();
-
-    if (m_d->checkParentPassThrough()) {
-        quint8 parentOpacity = m_d->node->parent()->projectionLeaf()->opacity();
-
-        resultOpacity = KritaUtils::mergeOpacity(resultOpacity, parentOpacity);
+    /**
+     * The opacity of a cached pass-through group is already folded
+     * into the opacity of its children
+     */
+    if (Private::checkCachedPassThrough(m_d->node)) {
+        return OPACITY_OPAQUE_U8;
     }
 
-    return resultOpacity;
+    return Private::passThroughOpacity(m_d->node);
 }
 
 QBitArray KisProjectionLeaf::channelFlags() const
@@ -20,6 +20,7 @@
 #define _KIS_RANDOM_ACCESSOR_NG_H_
 
 #include "kis_base_accessor.h"
+#include "kis_tile_content_flags.h"
 
 class KRITAIMAGE_EXPORT KisRandomConstAccessorNG : public KisBaseConstAccessor
 {
@@ -31,6 +32,13 @@ public:
     virtual qint32 numContiguousColumns(qint32 x) const = 0;
     virtual qint32 numContiguousRows(qint32 y) const = 0;
     virtual qint32 rowStride(qint32 x, qint32 y) const = 0;
+
+    /**
+     * Returns the content flags of the tile under the current position
+     * of the accessor. The flags are cached in the tile, so it is cheap
+     * to ask for them for unchanged tiles.
+     */
+    virtual KisTileContent::Flags tileContentFlags(const KisTileContent::AlphaDescriptor &alpha) const = 0;
 };
 
 class KRITAIMAGE_EXPORT KisRandomAccessorNG : public KisRandomConstAccessorNG, public KisBaseAccessor
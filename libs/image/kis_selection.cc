@@ -143,6 +143,25 @@ void KisSelection::recalculateOutlineCache()
     }
 }
 
+bool KisSelection::outlineTileCacheValid() const
+{
+    return m_d->pixelSelection->outlineTileCacheValid();
+}
+
+KisOutlineTileCache KisSelection::outlineTileCache() const
+{
+    return m_d->pixelSelection->outlineTileCache();
+}
+
+void KisSelection::recalculateOutlineTileCache()
+{
+    Q_ASSERT(m_d->pixelSelection);
+
+    if (!m_d->pixelSelection->outlineTileCacheValid()) {
+        m_d->pixelSelection->recalculateOutlineTileCache();
+    }
+}
+
 bool KisSelection::thumbnailImageValid() const
 {
     return m_d->pixelSelection->thumbnailImageValid();
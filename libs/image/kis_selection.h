@@ -43,6 +43,7 @@ enum SelectionAction {
 
 class KisSelectionComponent;
 class QPainterPath;
+class KisOutlineTileCache;
 
 /**
  * KisSelection is a composite object. It may contain an instance
@@ -98,6 +99,17 @@ public:
     QPainterPath outlineCache() const;
     void recalculateOutlineCache();
 
+    /**
+     * The tile-local outline of the pixel selection, used for
+     * rendering marching ants of the selections without the
+     * shape selection.
+     *
+     * \see KisPixelSelection::outlineTileCache()
+     */
+    bool outlineTileCacheValid() const;
+    KisOutlineTileCache outlineTileCache() const;
+    void recalculateOutlineTileCache();
+
 
     /**
      * Tells whether the cached thumbnail of the selection is still valid
@@ -20,6 +20,7 @@
 
 #include <QMutexLocker>
 #include <QVector>
+#include <QSet>
 
 #include "kis_image_config.h"
 #include "kis_full_refresh_walker.h"
@@ -80,6 +81,11 @@ void KisSimpleUpdateQueue::updateSettings()
     m_maxCollectAlpha = config.maxCollectAlpha();
     m_maxMergeAlpha = config.maxMergeAlpha();
     m_maxMergeCollectAlpha = config.maxMergeCollectAlpha();
+
+    m_mergeIndex.reset(m_patchWidth, m_patchHeight);
+    Q_FOREACH (KisBaseRectsWalkerSP walker, m_updatesList) {
+        m_mergeIndex.addWalker(walker);
+    }
 }
 
 int KisSimpleUpdateQueue::overrideLevelOfDetail() const
@@ -122,6 +128,7 @@ bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
             updaterContext.isJobAllowed(item)) {
 
             updaterContext.addMergeJob(item);
+            m_mergeIndex.removeWalker(item);
             iter.remove();
             jobAdded = true;
             break;
@@ -139,7 +146,9 @@ bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
          * in parallel.
          *
          * Right now it works as it is. Probably will need to be fixed
-         * in the future.
+         * in the future. The jobs that really need exclusive access
+         * should report isExclusive(), then the new updates and strokes
+         * wait on the exclusive lock of the context.
          */
         qint32 numMergeJobs;
         qint32 numStrokeJobs;
@@ -209,6 +218,9 @@ void KisSimpleUpdateQueue::addJob(KisNodeSP node, const QVector<QRect> &rects,
     if (!walkers.isEmpty()) {
         m_lock.lock();
         m_updatesList.append(walkers);
+        Q_FOREACH (KisBaseRectsWalkerSP walker, walkers) {
+            m_mergeIndex.addWalker(walker);
+        }
         m_lock.unlock();
     }
 }
@@ -289,18 +301,19 @@ bool KisSimpleUpdateQueue::tryMergeJob(KisNodeSP node, const QRect& rc,
     QRect baseRect = rc;
 
     KisBaseRectsWalkerSP goodCandidate;
-    KisBaseRectsWalkerSP item;
-    KisWalkersListIterator iter(m_updatesList);
 
     /**
+     * Only the walkers lying next to the rect can be merged with it,
+     * the index returns them in the order of the list.
+     *
      * We add new jobs to the tail of the list,
-     * so it's more probable to find a good candidate here.
+     * so it's more probable to find a good candidate there.
      */
+    const QVector<KisBaseRectsWalkerSP> candidates =
+        m_mergeIndex.mergeCandidates(node, rc);
 
-    iter.toBack();
-
-    while(iter.hasPrevious()) {
-        item = iter.previous();
+    for (auto it = candidates.crbegin(); it != candidates.crend(); ++it) {
+        const KisBaseRectsWalkerSP &item = *it;
 
         if(item->startNode() != node) continue;
         if(item->type() != type) continue;
@@ -335,12 +348,16 @@ void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
                                        QRect baseRect,
                                        const qreal maxAlpha)
 {
-    KisBaseRectsWalkerSP item;
-    KisMutableWalkersListIterator iter(m_updatesList);
+    /**
+     * The base rect only grows while collecting, so all the walkers
+     * that can be joined are among the candidates for the initial rect
+     */
+    const QVector<KisBaseRectsWalkerSP> candidates =
+        m_mergeIndex.mergeCandidates(baseWalker->startNode(), baseRect);
 
-    while(iter.hasNext()) {
-        item = iter.next();
+    QSet<KisBaseRectsWalker*> joinedWalkers;
 
+    Q_FOREACH (KisBaseRectsWalkerSP item, candidates) {
         if(item == baseWalker) continue;
         if(item->type() != baseWalker->type()) continue;
         if(item->startNode() != baseWalker->startNode()) continue;
@@ -348,12 +365,23 @@ void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
         if(item->levelOfDetail() != baseWalker->levelOfDetail()) continue;
 
         if(joinRects(baseRect, item->requestedRect(), maxAlpha)) {
-            iter.remove();
+            m_mergeIndex.removeWalker(item);
+            joinedWalkers.insert(item.data());
+        }
+    }
+
+    if (!joinedWalkers.isEmpty()) {
+        KisMutableWalkersListIterator iter(m_updatesList);
+        while(iter.hasNext()) {
+            if (joinedWalkers.contains(iter.next().data())) {
+                iter.remove();
+            }
         }
     }
 
     if(baseWalker->requestedRect() != baseRect) {
         baseWalker->collectRects(baseWalker->startNode(), baseRect);
+        m_mergeIndex.updateWalker(baseWalker);
     }
 }
 
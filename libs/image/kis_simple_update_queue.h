@@ -21,6 +21,7 @@
 
 #include <QMutex>
 #include "kis_updater_context.h"
+#include "kis_walkers_merge_index.h"
 
 typedef QList<KisBaseRectsWalkerSP> KisWalkersList;
 typedef QListIterator<KisBaseRectsWalkerSP> KisWalkersListIterator;
@@ -73,6 +74,12 @@ protected:
     KisWalkersList m_updatesList;
     KisSpontaneousJobsList m_spontaneousJobsList;
 
+    /**
+     * Spatial index of m_updatesList used for finding the walkers
+     * to merge without scanning the entire list
+     */
+    KisWalkersMergeIndex m_mergeIndex;
+
     /**
      * Parameters of optimization
      * (loaded from a configuration file)
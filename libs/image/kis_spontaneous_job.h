@@ -32,6 +32,14 @@ class KRITAIMAGE_EXPORT KisSpontaneousJob : public KisRunnable
 public:
     virtual bool overrides(const KisSpontaneousJob *otherJob) = 0;
     virtual int levelOfDetail() const = 0;
+
+    /**
+     * An exclusive job is never executed in parallel with any merge
+     * or stroke jobs, the same way exclusive stroke jobs are not
+     */
+    virtual bool isExclusive() const {
+        return false;
+    }
 };
 
 #endif /* __KIS_SPONTANEOUS_JOB_H */
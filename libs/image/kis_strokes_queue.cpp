@@ -32,6 +32,7 @@ typedef QQueue<KisStrokeSP> StrokesQueue;
 typedef QQueue<KisStrokeSP>::iterator StrokesQueueIterator;
 
 #include "kis_image_interfaces.h"
+#include "KisTracer.h"
 class KisStrokesQueue::LodNUndoStrokesFacade : public KisStrokesFacade
 {
 public:
@@ -285,6 +286,8 @@ KisStrokeId KisStrokesQueue::startStroke(KisStrokeStrategy *strokeStrategy)
 {
     QMutexLocker locker(&m_d->mutex);
 
+    KIS_TRACE_INSTANT("strokes", "stroke start");
+
     KisStrokeSP stroke;
     KisStrokeStrategy* lodBuddyStrategy;
 
@@ -378,6 +381,8 @@ void KisStrokesQueue::endStroke(KisStrokeId id)
     stroke->endStroke();
     m_d->openedStrokesCounter--;
 
+    KIS_TRACE_INSTANT("strokes", "stroke end");
+
     KisStrokeSP buddy = stroke->lodBuddy();
     if (buddy) {
         buddy->endStroke();
@@ -393,6 +398,8 @@ bool KisStrokesQueue::cancelStroke(KisStrokeId id)
         stroke->cancelStroke();
         m_d->openedStrokesCounter--;
 
+        KIS_TRACE_INSTANT("strokes", "stroke cancel");
+
         KisStrokeSP buddy = stroke->lodBuddy();
         if (buddy) {
             buddy->cancelStroke();
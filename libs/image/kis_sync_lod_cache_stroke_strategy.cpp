@@ -22,6 +22,7 @@
 #include <kundo2magicstring.h>
 #include "krita_utils.h"
 #include "kis_layer_utils.h"
+#include "KisTracer.h"
 
 
 struct KisSyncLodCacheStrokeStrategy::Private
@@ -101,6 +102,8 @@ void KisSyncLodCacheStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
         const int lod = dev->defaultBounds()->currentLevelOfDetail();
         m_d->dataObjects.insert(dev, dev->createLodDataStruct(lod));
     } else if (processData) {
+        KIS_TRACE_SCOPE_RECT("lod", "lod sync", processData->rect);
+
         KisPaintDeviceSP dev = processData->device;
         KIS_ASSERT(m_d->dataObjects.contains(dev));
 
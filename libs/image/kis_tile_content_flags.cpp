@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_content_flags.h"
+
+#include <QVector>
+
+#include <KoColorSpace.h>
+#include <KoChannelInfo.h>
+
+#include "kis_assert.h"
+
+
+namespace KisTileContent {
+
+AlphaDescriptor alphaDescriptor(const KoColorSpace *cs)
+{
+    AlphaDescriptor alpha;
+
+    Q_FOREACH (const KoChannelInfo *channel, cs->channels()) {
+        if (channel->channelType() == KoChannelInfo::ALPHA) {
+            KIS_SAFE_ASSERT_RECOVER_BREAK(channel->size() <= int(sizeof(alpha.opaqueValue)));
+
+            QVector<quint8> pixel(cs->pixelSize(), 0);
+            cs->setOpacity(pixel.data(), OPACITY_OPAQUE_U8, 1);
+
+            alpha.offset = channel->pos();
+            alpha.size = channel->size();
+            memcpy(alpha.opaqueValue, pixel.constData() + alpha.offset, alpha.size);
+            break;
+        }
+    }
+
+    return alpha;
+}
+
+quint32 calculateFlags(const quint8 *data, int numPixels, int pixelSize,
+                       const AlphaDescriptor &alpha)
+{
+    bool uniform = true;
+    bool transparent = alpha.isValid();
+    bool opaque = alpha.isValid();
+
+    static const quint8 zeroValue[sizeof(AlphaDescriptor::opaqueValue)] = {0};
+
+    const quint8 *firstPixel = data;
+
+    if (alpha.isValid()) {
+        const quint8 *firstAlpha = data + alpha.offset;
+        transparent = !memcmp(firstAlpha, zeroValue, alpha.size);
+        opaque = !memcmp(firstAlpha, alpha.opaqueValue, alpha.size);
+    }
+
+    const quint8 *pixel = data + pixelSize;
+
+    for (int i = 1; i < numPixels && (uniform || transparent || opaque); i++, pixel += pixelSize) {
+        if (uniform && memcmp(pixel, firstPixel, pixelSize)) {
+            uniform = false;
+        }
+
+        /**
+         * While the tile is uniform all the alpha values are
+         * equal to the first one, so there is nothing to check
+         */
+        if (!uniform && alpha.isValid()) {
+            const quint8 *pixelAlpha = pixel + alpha.offset;
+
+            if (transparent && memcmp(pixelAlpha, zeroValue, alpha.size)) {
+                transparent = false;
+            }
+
+            if (opaque && memcmp(pixelAlpha, alpha.opaqueValue, alpha.size)) {
+                opaque = false;
+            }
+        }
+    }
+
+    quint32 flags = NoFlags;
+    if (uniform) flags |= Uniform;
+    if (transparent) flags |= Transparent;
+    if (opaque) flags |= Opaque;
+
+    return flags;
+}
+
+}
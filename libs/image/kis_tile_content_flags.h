@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_CONTENT_FLAGS_H
+#define __KIS_TILE_CONTENT_FLAGS_H
+
+#include <string.h>
+
+#include <QFlags>
+#include <QtGlobal>
+
+#include "kritaimage_export.h"
+
+class KoColorSpace;
+
+/**
+ * The content flags describe what kind of pixels a tile stores. They
+ * are calculated lazily on the first request and cached in the tile data
+ * until the tile is written again, so asking for them again is cheap.
+ *
+ * The tiles know nothing about color spaces, so the caller describes
+ * where the alpha channel of the pixel lives with AlphaDescriptor.
+ */
+namespace KisTileContent {
+
+enum Flag {
+    NoFlags = 0x0,
+    Uniform = 0x1,      ///< all the pixels of the tile are bitwise equal
+    Transparent = 0x2,  ///< the alpha channel of all the pixels is zero
+    Opaque = 0x4        ///< the alpha channel of all the pixels is unit
+};
+
+Q_DECLARE_FLAGS(Flags, Flag)
+
+struct AlphaDescriptor
+{
+    AlphaDescriptor() : offset(-1), size(0) {
+        memset(opaqueValue, 0, sizeof(opaqueValue));
+    }
+
+    /**
+     * \return true if the color space has an alpha channel, otherwise
+     *         only Uniform flag can be reported
+     */
+    bool isValid() const {
+        return offset >= 0;
+    }
+
+    bool operator==(const AlphaDescriptor &rhs) const {
+        return offset == rhs.offset &&
+            size == rhs.size &&
+            !memcmp(opaqueValue, rhs.opaqueValue, sizeof(opaqueValue));
+    }
+
+    bool operator!=(const AlphaDescriptor &rhs) const {
+        return !(*this == rhs);
+    }
+
+    qint32 offset;
+    qint32 size;
+    quint8 opaqueValue[8];
+};
+
+/**
+ * Describes the alpha channel of \p cs. The result does not change for the
+ * lifetime of the color space, so the callers are free to cache it.
+ */
+KRITAIMAGE_EXPORT AlphaDescriptor alphaDescriptor(const KoColorSpace *cs);
+
+/**
+ * Calculates the flags of \p numPixels pixels of \p pixelSize bytes each
+ * laid out continuously in \p data
+ */
+KRITAIMAGE_EXPORT quint32 calculateFlags(const quint8 *data, int numPixels, int pixelSize,
+                                         const AlphaDescriptor &alpha);
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KisTileContent::Flags)
+
+#endif /* __KIS_TILE_CONTENT_FLAGS_H */
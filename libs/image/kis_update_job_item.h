@@ -28,6 +28,7 @@
 #include "kis_spontaneous_job.h"
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
+#include "KisTracer.h"
 
 
 class KisUpdateJobItem :  public QObject, public QRunnable
@@ -87,6 +88,9 @@ public:
                 KIS_ASSERT(m_atomicType == Type::STROKE ||
                            m_atomicType == Type::SPONTANEOUS);
 
+                KIS_TRACE_SCOPE("update", m_atomicType == Type::STROKE ?
+                                "stroke job" : "spontaneous job");
+
                 m_runnableJob->run();
             }
 
@@ -111,6 +115,8 @@ public:
 
     inline void runMergeJob() {
         Q_ASSERT(m_atomicType == Type::MERGE);
+        KIS_TRACE_SCOPE_RECT("update", "merge walker", m_changeRect);
+
         // dbgKrita << "Executing merge job" << m_walker->changeRect()
         //          << "on thread" << QThread::currentThreadId();
         m_merger.startMerge(*m_walker);
@@ -125,6 +131,7 @@ public:
 
         m_accessRect = walker->accessRect();
         m_changeRect = walker->changeRect();
+        m_lastMergeChangeRect = m_changeRect;
         m_walker = walker;
 
         m_exclusive = false;
@@ -155,7 +162,7 @@ public:
 
         m_runnableJob = spontaneousJob;
 
-        m_exclusive = false;
+        m_exclusive = spontaneousJob->isExclusive();
         m_walker = 0;
         m_accessRect = m_changeRect = QRect();
 
@@ -186,6 +193,15 @@ public:
         return m_changeRect;
     }
 
+    /**
+     * The change rect of the last merge job executed by this item. It is
+     * preserved when the item runs stroke jobs, so the context can send
+     * merge jobs with similar rects to the same thread.
+     */
+    inline const QRect& lastMergeChangeRect() const {
+        return m_lastMergeChangeRect;
+    }
+
     inline KisStrokeJobData::Sequentiality strokeJobSequentiality() const {
         return m_strokeJobSequentiality;
     }
@@ -251,6 +267,8 @@ private:
      */
     QRect m_accessRect;
     QRect m_changeRect;
+
+    QRect m_lastMergeChangeRect;
 };
 
 
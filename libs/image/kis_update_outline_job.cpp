@@ -33,7 +33,17 @@ bool KisUpdateOutlineJob::overrides(const KisSpontaneousJob *otherJob)
 
 void KisUpdateOutlineJob::run()
 {
-    m_selection->recalculateOutlineCache();
+    /**
+     * Pixel selections are rendered using the tile-local outline,
+     * which is updated incrementally. The polygonal outline cache is
+     * recalculated lazily by its users.
+     */
+    if (m_selection->hasShapeSelection()) {
+        m_selection->recalculateOutlineCache();
+    } else {
+        m_selection->recalculateOutlineTileCache();
+    }
+
     if (m_updateThumbnail) {
         m_selection->recalculateThumbnailImage(m_maskColor);
     }
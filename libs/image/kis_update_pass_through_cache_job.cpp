@@ -0,0 +1,58 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_update_pass_through_cache_job.h"
+
+#include "kis_group_layer.h"
+#include "kis_image.h"
+
+
+KisUpdatePassThroughCacheJob::KisUpdatePassThroughCacheJob(KisNodeSP node)
+    : m_node(node)
+{
+}
+
+bool KisUpdatePassThroughCacheJob::overrides(const KisSpontaneousJob *_otherJob)
+{
+    const KisUpdatePassThroughCacheJob *otherJob =
+        dynamic_cast<const KisUpdatePassThroughCacheJob*>(_otherJob);
+
+    return otherJob && otherJob->m_node == m_node;
+}
+
+void KisUpdatePassThroughCacheJob::run()
+{
+    /**
+     * The node might have been removed from the layers stack. In
+     * such a case, its former parent has its own job scheduled.
+     */
+    KisImageSP image = m_node->image().toStrongRef();
+    if (!image || (!m_node->parent() && m_node != image->root())) return;
+
+    KisGroupLayer::updatePassThroughCaches(m_node);
+}
+
+int KisUpdatePassThroughCacheJob::levelOfDetail() const
+{
+    return 0;
+}
+
+bool KisUpdatePassThroughCacheJob::isExclusive() const
+{
+    return true;
+}
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_UPDATE_PASS_THROUGH_CACHE_JOB_H
+#define __KIS_UPDATE_PASS_THROUGH_CACHE_JOB_H
+
+#include "kis_types.h"
+#include "kis_spontaneous_job.h"
+
+/**
+ * Rechecks the cached pass-through groups affected by a change of the
+ * node. Switching the cache on or off changes the topology of the
+ * projection leaves, so the job is exclusive and is never executed
+ * while the walkers are running.
+ */
+class KRITAIMAGE_EXPORT KisUpdatePassThroughCacheJob : public KisSpontaneousJob
+{
+public:
+    KisUpdatePassThroughCacheJob(KisNodeSP node);
+
+    bool overrides(const KisSpontaneousJob *otherJob) override;
+    void run() override;
+    int levelOfDetail() const override;
+    bool isExclusive() const override;
+
+private:
+    KisNodeSP m_node;
+};
+
+#endif /* __KIS_UPDATE_PASS_THROUGH_CACHE_JOB_H */
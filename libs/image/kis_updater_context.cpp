@@ -23,6 +23,7 @@
 
 #include "kis_update_job_item.h"
 #include "kis_stroke_job.h"
+#include "tiles3/kis_tile_data_interface.h"
 
 const int KisUpdaterContext::useIdealThreadCountTag = -1;
 
@@ -136,7 +137,7 @@ bool KisUpdaterContext::isJobAllowed(KisBaseRectsWalkerSP walker)
 void KisUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
 {
     m_lodCounter.addLod(walker->levelOfDetail());
-    qint32 jobIndex = findSpareThread();
+    qint32 jobIndex = findSpareThread(walker->changeRect());
     Q_ASSERT(jobIndex >= 0);
 
     const bool shouldStartThread = m_jobs[jobIndex]->setWalker(walker);
@@ -154,7 +155,7 @@ void KisUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
 void KisTestableUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
 {
     m_lodCounter.addLod(walker->levelOfDetail());
-    qint32 jobIndex = findSpareThread();
+    qint32 jobIndex = findSpareThread(walker->changeRect());
     Q_ASSERT(jobIndex >= 0);
 
     const bool shouldStartThread = m_jobs[jobIndex]->setWalker(walker);
@@ -235,13 +236,42 @@ bool KisUpdaterContext::walkerIntersectsJob(KisBaseRectsWalkerSP walker,
         (job->accessRect().intersects(walker->changeRect()));
 }
 
-qint32 KisUpdaterContext::findSpareThread()
+namespace {
+inline bool shareTileColumns(const QRect &rc1, const QRect &rc2)
+{
+    if (rc1.isEmpty() || rc2.isEmpty()) return false;
+
+    const int firstColumn1 = rc1.left() / KisTileData::WIDTH;
+    const int lastColumn1 = rc1.right() / KisTileData::WIDTH;
+    const int firstColumn2 = rc2.left() / KisTileData::WIDTH;
+    const int lastColumn2 = rc2.right() / KisTileData::WIDTH;
+
+    return firstColumn1 <= lastColumn2 && firstColumn2 <= lastColumn1;
+}
+}
+
+qint32 KisUpdaterContext::findSpareThread(const QRect &localityHint)
 {
-    for(qint32 i=0; i < m_jobs.size(); i++)
-        if(!m_jobs[i]->isRunning())
-            return i;
+    qint32 bestIndex = -1;
+    int bestScore = -1;
+
+    for (qint32 i = 0; i < m_jobs.size(); i++) {
+        const KisUpdateJobItem *item = m_jobs[i];
+        if (item->isRunning()) continue;
+
+        const int score =
+            2 * (item->type() == KisUpdateJobItem::Type::WAITING) +
+            shareTileColumns(localityHint, item->lastMergeChangeRect());
+
+        if (score > bestScore) {
+            bestIndex = i;
+            bestScore = score;
+
+            if (score == 3) break;
+        }
+    }
 
-    return -1;
+    return bestIndex;
 }
 
 void KisUpdaterContext::slotJobFinished()
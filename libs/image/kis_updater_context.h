@@ -150,7 +150,16 @@ protected Q_SLOTS:
 protected:
     static bool walkerIntersectsJob(KisBaseRectsWalkerSP walker,
                                     const KisUpdateJobItem* job);
-    qint32 findSpareThread();
+
+    /**
+     * Finds a job item that is not running. Items whose threads are
+     * still alive (the ones that have just finished their jobs) are
+     * preferred, because waking up a new pool thread is expensive. For
+     * merge jobs, \p localityHint is the change rect of the walker. The
+     * items that have recently merged the same tile columns are preferred
+     * then, because their tiles are still in the CPU cache.
+     */
+    qint32 findSpareThread(const QRect &localityHint = QRect());
 
 protected:
     /**
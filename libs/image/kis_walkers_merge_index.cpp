@@ -0,0 +1,166 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_walkers_merge_index.h"
+
+#include <algorithm>
+
+#include "kis_assert.h"
+
+
+KisWalkersMergeIndex::KisWalkersMergeIndex()
+    : m_patchWidth(512),
+      m_patchHeight(512),
+      m_nextSequenceNumber(0)
+{
+}
+
+void KisWalkersMergeIndex::reset(int patchWidth, int patchHeight)
+{
+    KIS_SAFE_ASSERT_RECOVER(patchWidth > 0 && patchHeight > 0) {
+        patchWidth = patchHeight = 512;
+    }
+
+    m_patchWidth = patchWidth;
+    m_patchHeight = patchHeight;
+    clear();
+}
+
+int KisWalkersMergeIndex::floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+KisWalkersMergeIndex::CellKey KisWalkersMergeIndex::cellForWalker(KisBaseRectsWalker *walker) const
+{
+    const QRect &rc = walker->requestedRect();
+    return CellKey(walker->startNode().data(),
+                   floorDiv(rc.x(), m_patchWidth),
+                   floorDiv(rc.y(), m_patchHeight));
+}
+
+void KisWalkersMergeIndex::insertEntry(const CellKey &cell, KisBaseRectsWalkerSP walker, quint64 sequenceNumber)
+{
+    Entry entry;
+    entry.walker = walker;
+    entry.sequenceNumber = sequenceNumber;
+    m_cells[cell].append(entry);
+
+    Position pos;
+    pos.cell = cell;
+    pos.sequenceNumber = sequenceNumber;
+    m_positions.insert(walker.data(), pos);
+}
+
+void KisWalkersMergeIndex::removeEntry(const CellKey &cell, KisBaseRectsWalker *walker)
+{
+    auto it = m_cells.find(cell);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(it != m_cells.end());
+
+    QVector<Entry> &entries = it.value();
+
+    for (int i = 0; i < entries.size(); i++) {
+        if (entries[i].walker.data() == walker) {
+            entries.remove(i);
+            break;
+        }
+    }
+
+    if (entries.isEmpty()) {
+        m_cells.erase(it);
+    }
+
+    m_positions.remove(walker);
+}
+
+void KisWalkersMergeIndex::addWalker(KisBaseRectsWalkerSP walker)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(!m_positions.contains(walker.data()));
+    insertEntry(cellForWalker(walker.data()), walker, m_nextSequenceNumber++);
+}
+
+void KisWalkersMergeIndex::removeWalker(KisBaseRectsWalkerSP walker)
+{
+    auto it = m_positions.constFind(walker.data());
+    if (it == m_positions.constEnd()) return;
+
+    removeEntry(it->cell, walker.data());
+}
+
+void KisWalkersMergeIndex::updateWalker(KisBaseRectsWalkerSP walker)
+{
+    auto it = m_positions.constFind(walker.data());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(it != m_positions.constEnd());
+
+    const Position oldPos = *it;
+    const CellKey newCell = cellForWalker(walker.data());
+
+    if (newCell == oldPos.cell) return;
+
+    removeEntry(oldPos.cell, walker.data());
+    insertEntry(newCell, walker, oldPos.sequenceNumber);
+}
+
+QVector<KisBaseRectsWalkerSP> KisWalkersMergeIndex::mergeCandidates(KisNodeSP node, const QRect &rc) const
+{
+    /**
+     * The united rect of the two walkers should fit into a patch, so the
+     * left edge of a candidate lies in [rc.right() - patchWidth + 1,
+     * rc.left() + patchWidth - 1], and the same for the top edge.
+     */
+    const int firstCol = floorDiv(rc.right() - m_patchWidth + 1, m_patchWidth);
+    const int lastCol = floorDiv(rc.left() + m_patchWidth - 1, m_patchWidth);
+    const int firstRow = floorDiv(rc.bottom() - m_patchHeight + 1, m_patchHeight);
+    const int lastRow = floorDiv(rc.top() + m_patchHeight - 1, m_patchHeight);
+
+    QVector<Entry> entries;
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            auto it = m_cells.constFind(CellKey(node.data(), col, row));
+            if (it != m_cells.constEnd()) {
+                entries += it.value();
+            }
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [] (const Entry &lhs, const Entry &rhs) {
+                  return lhs.sequenceNumber < rhs.sequenceNumber;
+              });
+
+    QVector<KisBaseRectsWalkerSP> result;
+    result.reserve(entries.size());
+
+    Q_FOREACH (const Entry &entry, entries) {
+        result.append(entry.walker);
+    }
+
+    return result;
+}
+
+int KisWalkersMergeIndex::size() const
+{
+    return m_positions.size();
+}
+
+void KisWalkersMergeIndex::clear()
+{
+    m_cells.clear();
+    m_positions.clear();
+}
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_WALKERS_MERGE_INDEX_H
+#define __KIS_WALKERS_MERGE_INDEX_H
+
+#include <QHash>
+#include <QVector>
+
+#include "kis_base_rects_walker.h"
+
+/**
+ * A spatial index of the walkers waiting in KisSimpleUpdateQueue.
+ *
+ * Two walkers can be merged only when the union of their requested
+ * rects fits into a single update patch, so the candidates for merging
+ * with a rect can only start in the patch cells lying next to it. The
+ * index groups the walkers by their start node and the cell of the
+ * top-left corner of their requested rects, so finding the candidates
+ * doesn't depend on the total number of the walkers in the queue.
+ *
+ * Every walker keeps the sequence number it got when it was added, so
+ * the candidates can be checked in the order they are stored in the
+ * queue.
+ *
+ * The index is not thread-safe, it is protected by the lock of the queue.
+ */
+class KRITAIMAGE_EXPORT KisWalkersMergeIndex
+{
+public:
+    KisWalkersMergeIndex();
+
+    /**
+     * Sets the size of the patch and drops all the walkers.
+     * The owner should re-add them afterwards.
+     */
+    void reset(int patchWidth, int patchHeight);
+
+    void addWalker(KisBaseRectsWalkerSP walker);
+    void removeWalker(KisBaseRectsWalkerSP walker);
+
+    /**
+     * Should be called when the requested rect of the walker changes,
+     * the walker keeps its position in the queue.
+     */
+    void updateWalker(KisBaseRectsWalkerSP walker);
+
+    /**
+     * \return the walkers of \p node that can potentially be merged with
+     * \p rc, sorted by their position in the queue (the oldest first)
+     */
+    QVector<KisBaseRectsWalkerSP> mergeCandidates(KisNodeSP node, const QRect &rc) const;
+
+    int size() const;
+    void clear();
+
+private:
+    struct CellKey {
+        CellKey() : node(0), x(0), y(0) {}
+        CellKey(const KisNode *_node, int _x, int _y) : node(_node), x(_x), y(_y) {}
+
+        bool operator==(const CellKey &rhs) const {
+            return node == rhs.node && x == rhs.x && y == rhs.y;
+        }
+
+        friend uint qHash(const CellKey &key, uint seed = 0) {
+            return ::qHash(key.node, seed) ^ ::qHash((quint64(quint32(key.x)) << 32) | quint32(key.y), seed);
+        }
+
+        const KisNode *node;
+        int x;
+        int y;
+    };
+
+    struct Entry {
+        Entry() : sequenceNumber(0) {}
+
+        KisBaseRectsWalkerSP walker;
+        quint64 sequenceNumber;
+    };
+
+    struct Position {
+        Position() : sequenceNumber(0) {}
+
+        CellKey cell;
+        quint64 sequenceNumber;
+    };
+
+    CellKey cellForWalker(KisBaseRectsWalker *walker) const;
+    void insertEntry(const CellKey &cell, KisBaseRectsWalkerSP walker, quint64 sequenceNumber);
+    void removeEntry(const CellKey &cell, KisBaseRectsWalker *walker);
+
+    static int floorDiv(int value, int divisor);
+
+private:
+    int m_patchWidth;
+    int m_patchHeight;
+    quint64 m_nextSequenceNumber;
+
+    QHash<CellKey, QVector<Entry>> m_cells;
+    QHash<KisBaseRectsWalker*, Position> m_positions;
+};
+
+#endif /* __KIS_WALKERS_MERGE_INDEX_H */
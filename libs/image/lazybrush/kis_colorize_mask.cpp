@@ -21,6 +21,7 @@
 #include <QCoreApplication>
 
 #include <KoColorSpaceRegistry.h>
+#include "kis_selection.h"
 #include "kis_pixel_selection.h"
 
 #include "kis_icon_utils.h"
@@ -45,6 +46,7 @@
 #include "kis_processing_applicator.h"
 #include "krita_utils.h"
 #include "kis_command_utils.h"
+#include "kis_image_config.h"
 
 
 using namespace KisLazyFillTools;
@@ -60,7 +62,8 @@ struct KisColorizeMask::Private
           showColoring(true),
           needsUpdate(true),
           originalSequenceNumber(-1),
-          updateCompressor(1, KisSignalCompressor::POSTPONE, q)
+          updateCompressor(1, KisSignalCompressor::POSTPONE, q),
+          regionsCacheValid(false)
     {
     }
 
@@ -74,7 +77,8 @@ struct KisColorizeMask::Private
           needsUpdate(false),
           originalSequenceNumber(-1),
           updateCompressor(1000, KisSignalCompressor::POSTPONE, q),
-          offset(rhs.offset)
+          offset(rhs.offset),
+          regionsCacheValid(false)
     {
         Q_FOREACH (const KeyStroke &stroke, rhs.keyStrokes) {
             keyStrokes << KeyStroke(KisPaintDeviceSP(new KisPaintDevice(*stroke.dev)), stroke.color, stroke.isTransparent);
@@ -101,8 +105,78 @@ struct KisColorizeMask::Private
 
     KisSignalCompressor updateCompressor;
     QPoint offset;
+
+    struct KeyStrokeState {
+        KisPaintDeviceSP dev;
+        KoColor color;
+        bool isTransparent;
+        int sequenceNumber;
+        QRect extent;
+    };
+
+    /**
+     * The regions and the state of the key strokes used for the
+     * previous update of the filling. The regions cache is written
+     * by the colorize stroke itself, so it may be accessed only from
+     * the context of the stroke.
+     */
+    QVector<KisSelectionSP> regionsCache;
+    QVector<KeyStrokeState> lastKeyStrokes;
+    bool regionsCacheValid;
+
+    bool calculateChangedRect(QRect *changedRect) const;
+    void saveKeyStrokesState();
 };
 
+bool KisColorizeMask::Private::calculateChangedRect(QRect *changedRect) const
+{
+    if (keyStrokes.size() < lastKeyStrokes.size()) return false;
+
+    QRect rc;
+
+    for (int i = 0; i < keyStrokes.size(); i++) {
+        const KeyStroke &stroke = keyStrokes[i];
+
+        if (i >= lastKeyStrokes.size()) {
+            rc |= stroke.dev->extent();
+            continue;
+        }
+
+        const KeyStrokeState &state = lastKeyStrokes[i];
+
+        // removed or recolored strokes need the full update
+        if (state.dev != stroke.dev ||
+            !(state.color == stroke.color) ||
+            state.isTransparent != stroke.isTransparent) {
+
+            return false;
+        }
+
+        if (state.sequenceNumber != stroke.dev->sequenceNumber()) {
+            rc |= state.extent | stroke.dev->extent();
+        }
+    }
+
+    *changedRect = rc;
+    return true;
+}
+
+void KisColorizeMask::Private::saveKeyStrokesState()
+{
+    lastKeyStrokes.clear();
+
+    Q_FOREACH (const KeyStroke &stroke, keyStrokes) {
+        KeyStrokeState state;
+        state.dev = stroke.dev;
+        state.color = stroke.color;
+        state.isTransparent = stroke.isTransparent;
+        state.sequenceNumber = stroke.dev->sequenceNumber();
+        state.extent = stroke.dev->extent();
+
+        lastKeyStrokes << state;
+    }
+}
+
 KisColorizeMask::KisColorizeMask()
     : m_d(new Private(this))
 {
@@ -229,6 +303,8 @@ KUndo2Command* KisColorizeMask::setColorSpace(const KoColorSpace * dstColorSpace
 
     composite->addCommand(new SkipFirstRedoWrapper(strokesConversionCommand));
 
+    m_d->regionsCacheValid = false;
+
     return composite;
 }
 
@@ -256,7 +332,20 @@ void KisColorizeMask::slotUpdateRegenerateFilling()
 
     bool filteredSourceValid = m_d->originalSequenceNumber == src->sequenceNumber();
     m_d->originalSequenceNumber = src->sequenceNumber();
-    m_d->coloringProjection->clear();
+
+    KisImageConfig cfg;
+    const bool useRegions = cfg.useIncrementalColorizeMask();
+
+    QRect changedRect;
+    const bool incrementalUpdate =
+        useRegions &&
+        filteredSourceValid &&
+        m_d->regionsCacheValid &&
+        m_d->calculateChangedRect(&changedRect);
+
+    if (!incrementalUpdate) {
+        m_d->coloringProjection->clear();
+    }
 
     KisLayerSP parentLayer(qobject_cast<KisLayer*>(parent().data()));
     if (!parentLayer) return;
@@ -280,6 +369,17 @@ void KisColorizeMask::slotUpdateRegenerateFilling()
             strategy->addKeyStroke(stroke.dev, color);
         }
 
+        if (useRegions) {
+            strategy->setRegionsCache(&m_d->regionsCache);
+
+            if (incrementalUpdate) {
+                strategy->setIncrementalUpdate(changedRect);
+            }
+        }
+
+        m_d->regionsCacheValid = useRegions;
+        m_d->saveKeyStrokesState();
+
         connect(strategy, SIGNAL(sigFinished()), SLOT(slotRegenerationFinished()));
         KisStrokeId id = image->startStroke(strategy);
         image->endStroke(id);
@@ -509,6 +609,8 @@ void KisColorizeMask::setImage(KisImageWSP image)
     m_d->coloringProjection->setDefaultBounds(bounds);
     m_d->fakePaintDevice->setDefaultBounds(bounds);
     m_d->filteredSource->setDefaultBounds(bounds);
+
+    m_d->regionsCacheValid = false;
 }
 
 void KisColorizeMask::setCurrentColor(const KoColor &_color)
@@ -813,6 +915,7 @@ void KisColorizeMask::resetCache()
 {
     m_d->filteredSource->clear();
     m_d->originalSequenceNumber = -1;
+    m_d->regionsCacheValid = false;
 
     rerenderFakePaintDevice();
 }
@@ -907,6 +1010,8 @@ KisPaintDeviceList KisColorizeMask::getLodCapableDevices() const
 
 void KisColorizeMask::moveAllInternalDevices(const QPoint &diff)
 {
+    m_d->regionsCacheValid = false;
+
     QVector<KisPaintDeviceSP> devices = allPaintDevices();
 
     Q_FOREACH (KisPaintDeviceSP dev, devices) {
@@ -29,12 +29,17 @@
 #include "kis_lod_transform.h"
 #include "kis_node.h"
 #include "kis_image_config.h"
+#include "kis_selection.h"
+#include "kis_pixel_selection.h"
+#include "KisRunnableStrokeJobData.h"
+#include "KisRunnableStrokeJobsInterface.h"
 
 using namespace KisLazyFillTools;
 
 struct KisColorizeStrokeStrategy::Private
 {
-    Private() : filteredSourceValid(false) {}
+    Private() : filteredSourceValid(false), regionsCache(0), incrementalUpdate(false),
+                wallThreshold(0), wallGrowRadius(0) {}
     Private(const Private &rhs)
         : src(rhs.src),
           dst(rhs.dst),
@@ -43,7 +48,12 @@ struct KisColorizeStrokeStrategy::Private
           filteredSourceValid(rhs.filteredSourceValid),
           boundingRect(rhs.boundingRect),
           keyStrokes(rhs.keyStrokes),
-          dirtyNode(rhs.dirtyNode)
+          dirtyNode(rhs.dirtyNode),
+          // the regions cache belongs to the LoD0 stroke only
+          regionsCache(0),
+          incrementalUpdate(false),
+          wallThreshold(rhs.wallThreshold),
+          wallGrowRadius(rhs.wallGrowRadius)
     {}
 
     KisPaintDeviceSP src;
@@ -55,15 +65,74 @@ struct KisColorizeStrokeStrategy::Private
 
     QVector<KeyStroke> keyStrokes;
     KisNodeSP dirtyNode;
+
+    QVector<KisSelectionSP> *regionsCache;
+    bool incrementalUpdate;
+    QRect changedRect;
+    int wallThreshold;
+    int wallGrowRadius;
+
+    QVector<KisSelectionSP> keptRegions;
+    QVector<KisSelectionSP> staleRegions;
+    QVector<KisSelectionSP> regions;
+    QVector<KisPaintDeviceSP> regionResults;
+
+    void fillRegion(KisSelectionSP region, KisPaintDeviceSP result) const;
+    QRect mergeRegions();
 };
 
+void KisColorizeStrokeStrategy::Private::fillRegion(KisSelectionSP region, KisPaintDeviceSP result) const
+{
+    const QRect rc = region->pixelSelection()->selectedExactRect() & boundingRect;
+    if (rc.isEmpty()) return;
+
+    KisMultiwayCut cut(filteredSource, result, rc);
+    cut.setRegion(region);
+
+    Q_FOREACH (const KeyStroke &stroke, keyStrokes) {
+        if (!stroke.dev->extent().intersects(rc)) continue;
+
+        KisPaintDeviceSP dev = new KisPaintDevice(stroke.dev->colorSpace());
+        KisPainter::copyAreaOptimized(rc.topLeft(), stroke.dev, dev, rc, region);
+        cut.addKeyStroke(dev, stroke.color);
+    }
+
+    cut.run();
+}
+
+QRect KisColorizeStrokeStrategy::Private::mergeRegions()
+{
+    QRect dirtyRect;
+
+    Q_FOREACH (KisSelectionSP region, staleRegions) {
+        dirtyRect |= region->pixelSelection()->selectedExactRect();
+        dst->clearSelection(region);
+    }
+
+    for (int i = 0; i < regions.size(); i++) {
+        const QRect rc = regions[i]->pixelSelection()->selectedExactRect() & boundingRect;
+        KisPainter::copyAreaOptimized(rc.topLeft(), regionResults[i], dst, rc, regions[i]);
+        dirtyRect |= rc;
+    }
+
+    *regionsCache = keptRegions + regions;
+
+    keptRegions.clear();
+    staleRegions.clear();
+    regions.clear();
+    regionResults.clear();
+
+    return dirtyRect & boundingRect;
+}
+
 KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(KisPaintDeviceSP src,
                                                      KisPaintDeviceSP dst,
                                                      KisPaintDeviceSP filteredSource,
                                                      bool filteredSourceValid,
                                                      const QRect &boundingRect,
                                                      KisNodeSP dirtyNode)
-    : m_d(new Private)
+    : KisRunnableBasedStrokeStrategy("colorize-stroke", KUndo2MagicString()),
+      m_d(new Private)
 {
     m_d->src = src;
     m_d->dst = dst;
@@ -72,11 +141,18 @@ KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(KisPaintDeviceSP src,
     m_d->filteredSourceValid = filteredSourceValid;
     m_d->dirtyNode = dirtyNode;
 
+    KisImageConfig cfg(true);
+    m_d->wallThreshold = cfg.colorizeMaskRegionWallThreshold();
+    m_d->wallGrowRadius = cfg.colorizeMaskRegionWallGrowRadius();
+
     enableJob(JOB_INIT, true, KisStrokeJobData::SEQUENTIAL, KisStrokeJobData::EXCLUSIVE);
+
+    // the regions are filled by the jobs added from inside the init job
+    enableJob(JOB_DOSTROKE);
 }
 
 KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(const KisColorizeStrokeStrategy &rhs, int levelOfDetail)
-    : KisSimpleStrokeStrategy(rhs),
+    : KisRunnableBasedStrokeStrategy(rhs),
       m_d(new Private(*rhs.m_d))
 {
     KisLodTransform t(levelOfDetail);
@@ -95,6 +171,17 @@ void KisColorizeStrokeStrategy::addKeyStroke(KisPaintDeviceSP dev, const KoColor
     m_d->keyStrokes << KeyStroke(dev, convertedColor);
 }
 
+void KisColorizeStrokeStrategy::setRegionsCache(QVector<KisSelectionSP> *regionsCache)
+{
+    m_d->regionsCache = regionsCache;
+}
+
+void KisColorizeStrokeStrategy::setIncrementalUpdate(const QRect &changedRect)
+{
+    m_d->incrementalUpdate = true;
+    m_d->changedRect = changedRect;
+}
+
 void KisColorizeStrokeStrategy::initStrokeCallback()
 {
     if (!m_d->filteredSourceValid) {
@@ -113,16 +200,77 @@ void KisColorizeStrokeStrategy::initStrokeCallback()
         m_d->filteredSource->setDefaultBounds(oldBounds);
     }
 
-    KisMultiwayCut cut(m_d->filteredSource, m_d->dst, m_d->boundingRect);
+    if (!m_d->regionsCache) {
+        KisMultiwayCut cut(m_d->filteredSource, m_d->dst, m_d->boundingRect);
+
+        Q_FOREACH (const KeyStroke &stroke, m_d->keyStrokes) {
+            cut.addKeyStroke(new KisPaintDevice(*stroke.dev), stroke.color);
+        }
 
-    Q_FOREACH (const KeyStroke &stroke, m_d->keyStrokes) {
-        cut.addKeyStroke(new KisPaintDevice(*stroke.dev), stroke.color);
+        cut.run();
+
+        m_d->dirtyNode->setDirty(m_d->boundingRect);
+        emit sigFinished();
+        return;
     }
 
-    cut.run();
+    /**
+     * In incremental mode only the regions touched by the changed key
+     * strokes are recalculated. The filling of the other regions is
+     * still valid, because neither their key strokes nor the filtered
+     * source have changed since the previous update.
+     */
+    QRect seedRect = m_d->boundingRect;
+
+    if (m_d->incrementalUpdate) {
+        seedRect = m_d->changedRect;
+
+        Q_FOREACH (KisSelectionSP region, *m_d->regionsCache) {
+            const QRect rc = region->pixelSelection()->selectedExactRect();
+
+            if (rc.intersects(m_d->changedRect)) {
+                m_d->staleRegions << region;
+                seedRect |= rc;
+            } else {
+                m_d->keptRegions << region;
+            }
+        }
+    }
+
+    m_d->regions =
+        splitIntoIndependentRegions(m_d->filteredSource,
+                                    m_d->keyStrokes,
+                                    m_d->boundingRect,
+                                    seedRect,
+                                    m_d->wallThreshold,
+                                    m_d->wallGrowRadius,
+                                    m_d->keptRegions);
+
+    QVector<KisRunnableStrokeJobData*> jobs;
+
+    Q_FOREACH (KisSelectionSP region, m_d->regions) {
+        KisPaintDeviceSP result = new KisPaintDevice(m_d->dst->colorSpace());
+        m_d->regionResults << result;
+
+        jobs << new KisRunnableStrokeJobData(
+                    [this, region, result] () {
+                        m_d->fillRegion(region, result);
+                    },
+                    KisStrokeJobData::CONCURRENT);
+    }
+
+    jobs << new KisRunnableStrokeJobData(
+                [this] () {
+                    const QRect dirtyRect = m_d->mergeRegions();
+
+                    if (!dirtyRect.isEmpty()) {
+                        m_d->dirtyNode->setDirty(dirtyRect);
+                    }
+                    emit sigFinished();
+                },
+                KisStrokeJobData::SEQUENTIAL);
 
-    m_d->dirtyNode->setDirty(m_d->boundingRect);
-    emit sigFinished();
+    runnableJobsInterface()->addRunnableJobs(jobs);
 }
 
 KisStrokeStrategy* KisColorizeStrokeStrategy::createLodClone(int levelOfDetail)
@@ -23,12 +23,12 @@
 #include <QObject>
 
 #include "kis_types.h"
-#include <kis_simple_stroke_strategy.h>
+#include <KisRunnableBasedStrokeStrategy.h>
 
 class KoColor;
 
 
-class KisColorizeStrokeStrategy : public QObject, public KisSimpleStrokeStrategy
+class KisColorizeStrokeStrategy : public QObject, public KisRunnableBasedStrokeStrategy
 {
     Q_OBJECT
 
@@ -43,6 +43,24 @@ public:
 
     void addKeyStroke(KisPaintDeviceSP dev, const KoColor &color);
 
+    /**
+     * Split the image into independent regions separated by closed
+     * line art and solve them concurrently. The regions are saved into
+     * \p regionsCache so that the next update could reuse them.
+     *
+     * \see KisLazyFillTools::splitIntoIndependentRegions()
+     */
+    void setRegionsCache(QVector<KisSelectionSP> *regionsCache);
+
+    /**
+     * Recalculate only the regions touched by \p changedRect, the
+     * filling of all the other regions is reused from the previous
+     * update. Works only when the regions cache is set, and requires
+     * the filtered source and the destination device to be unchanged
+     * since the previous update.
+     */
+    void setIncrementalUpdate(const QRect &changedRect);
+
     void initStrokeCallback() override;
 
     KisStrokeStrategy *createLodClone(int levelOfDetail) override;
@@ -40,8 +40,15 @@
 #include "lazybrush/kis_lazy_fill_capacity_map.h"
 
 #include "kis_sequential_iterator.h"
+#include "kis_random_accessor_ng.h"
 #include <floodfill/kis_scanline_fill.h>
 
+#include <KoColorSpaceRegistry.h>
+#include "kis_painter.h"
+#include "kis_selection.h"
+#include "kis_pixel_selection.h"
+#include "kis_selection_filters.h"
+
 #include "krita_utils.h"
 
 namespace KisLazyFillTools {
@@ -159,6 +166,138 @@ void cutOneWay(const KoColor &color,
     return points;
 }
 
+QVector<KisSelectionSP> splitIntoIndependentRegions(KisPaintDeviceSP filteredSource,
+                                                    const QVector<KeyStroke> &keyStrokes,
+                                                    const QRect &boundingRect,
+                                                    const QRect &seedRect,
+                                                    int wallThreshold,
+                                                    int wallGrowRadius,
+                                                    const QVector<KisSelectionSP> &existingRegions)
+{
+    QVector<KisSelectionSP> regions;
+
+    KIS_ASSERT_RECOVER(filteredSource->pixelSize() == 1) { return regions; }
+
+    const QRect seedArea = seedRect & boundingRect;
+    if (seedArea.isEmpty()) return regions;
+
+    const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+
+    /**
+     * The filtered source is inverted, so the line art has the lowest
+     * values. Everything below the threshold is considered to be a
+     * wall that separates the regions.
+     */
+    KisPaintDeviceSP passable = new KisPaintDevice(alpha8);
+    passable->makeCloneFromRough(filteredSource, boundingRect);
+    KritaUtils::filterAlpha8Device(passable, boundingRect,
+                                   [wallThreshold] (quint8 pixel) {
+                                       return pixel >= wallThreshold ? MAX_SELECTED : MIN_SELECTED;
+                                   });
+
+    KisPaintDeviceSP seeds = new KisPaintDevice(alpha8);
+    {
+        KisPainter gc(seeds);
+        Q_FOREACH (const KeyStroke &stroke, keyStrokes) {
+            const QRect rc = stroke.dev->extent() & seedArea;
+            if (rc.isEmpty()) continue;
+
+            gc.bitBlt(rc.topLeft(), stroke.dev, rc);
+        }
+    }
+
+    const QRect seedsRect = seeds->exactBounds() & seedArea;
+    if (seedsRect.isEmpty()) return regions;
+
+    /**
+     * All the pixels that already belong to some region, including
+     * the strips of the line art around them. The passable pixels of
+     * this device mark the components that have already been visited,
+     * the line art pixels are not given to any other region.
+     */
+    KisPaintDeviceSP claimed = new KisPaintDevice(alpha8);
+    {
+        KisPainter gc(claimed);
+        Q_FOREACH (KisSelectionSP region, existingRegions) {
+            KisPixelSelectionSP pixelSelection = region->pixelSelection();
+            const QRect rc = pixelSelection->selectedExactRect() & boundingRect;
+            if (rc.isEmpty()) continue;
+
+            gc.bitBlt(rc.topLeft(), pixelSelection, rc);
+        }
+    }
+
+    KisSequentialConstIterator seedIt(seeds, seedsRect);
+    KisRandomConstAccessorSP passableIt = passable->createRandomConstAccessorNG(seedsRect.x(), seedsRect.y());
+    KisRandomConstAccessorSP claimedIt = claimed->createRandomConstAccessorNG(seedsRect.x(), seedsRect.y());
+
+    do {
+        if (!*seedIt.rawDataConst()) continue;
+
+        const QPoint pt(seedIt.x(), seedIt.y());
+
+        passableIt->moveTo(pt.x(), pt.y());
+        if (*passableIt->rawDataConst() != MAX_SELECTED) continue;
+
+        claimedIt->moveTo(pt.x(), pt.y());
+        if (*claimedIt->rawDataConst() != MIN_SELECTED) continue;
+
+        KisPixelSelectionSP component = new KisPixelSelection();
+        KisScanlineFill fill(passable, pt, boundingRect);
+        fill.fillSelection(component);
+
+        const QRect componentRect = component->selectedExactRect();
+
+        KisSelectionSP region = new KisSelection(filteredSource->defaultBounds());
+        KisPixelSelectionSP regionPixels = region->pixelSelection();
+        regionPixels->makeCloneFromRough(component, componentRect);
+
+        KisGrowSelectionFilter filter(wallGrowRadius, wallGrowRadius);
+        const QRect growRect = filter.changeRect(componentRect) & boundingRect;
+        filter.process(regionPixels, growRect);
+
+        /**
+         * The grown area must not leak into the neighbouring components
+         * and must not overlap the strips that have already been given
+         * to other regions, otherwise the border pixels would be filled
+         * by several cuts.
+         */
+        KisSequentialIterator dstIt(regionPixels, growRect);
+        KisSequentialConstIterator passableSeqIt(passable, growRect);
+        KisSequentialConstIterator componentIt(component, growRect);
+        KisSequentialConstIterator claimedSeqIt(claimed, growRect);
+
+        do {
+            const bool isPassable = *passableSeqIt.rawDataConst() == MAX_SELECTED;
+
+            if (isPassable ?
+                *componentIt.rawDataConst() == MIN_SELECTED :
+                *claimedSeqIt.rawDataConst() != MIN_SELECTED) {
+
+                *dstIt.rawData() = MIN_SELECTED;
+            }
+        } while (dstIt.nextPixel() &&
+                 passableSeqIt.nextPixel() &&
+                 componentIt.nextPixel() &&
+                 claimedSeqIt.nextPixel());
+
+        regionPixels->setDirty(growRect);
+
+        {
+            KisPainter gc(claimed);
+            gc.bitBlt(growRect.topLeft(), regionPixels, growRect);
+        }
+
+        // the accessor may still keep the old tiles of the device, so
+        // recreate it after the device has been modified
+        claimedIt = claimed->createRandomConstAccessorNG(pt.x(), pt.y());
+
+        regions << region;
+
+    } while (seedIt.nextPixel());
+
+    return regions;
+}
 
 KeyStroke::KeyStroke()
     : isTransparent(false)
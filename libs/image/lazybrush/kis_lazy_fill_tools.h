@@ -76,6 +76,41 @@ namespace KisLazyFillTools
         KoColor color;
         bool isTransparent;
     };
+
+    /**
+     * Splits the area of \p filteredSource into regions that are
+     * separated from each other by closed line art. Such regions can
+     * be filled independently (and concurrently), because the minimal
+     * cut practically never crosses a closed line: it is always cheaper
+     * to cut along it.
+     *
+     * Only the regions that contain at least one pixel of \p keyStrokes
+     * inside \p seedRect are generated. Regions that are already covered
+     * by \p existingRegions are skipped.
+     *
+     * Every region is a binary selection that covers the contiguous
+     * non-line-art area and a strip of the line art around it, up to
+     * \p wallGrowRadius pixels wide, so that the lines get filled as
+     * well. The strips never overlap: a line pixel that is already
+     * covered by \p existingRegions or by a region generated earlier
+     * is not added to any other region.
+     *
+     * \p filteredSource must be an alpha8 device, filtered with
+     *                   normalizeAndInvertAlpha8Device()
+     * \p wallThreshold pixels of \p filteredSource below this value
+     *                   are considered to be line art
+     *
+     * \see KisImageConfig::colorizeMaskRegionWallThreshold()
+     * \see KisImageConfig::colorizeMaskRegionWallGrowRadius()
+     */
+    KRITAIMAGE_EXPORT
+    QVector<KisSelectionSP> splitIntoIndependentRegions(KisPaintDeviceSP filteredSource,
+                                                        const QVector<KeyStroke> &keyStrokes,
+                                                        const QRect &boundingRect,
+                                                        const QRect &seedRect,
+                                                        int wallThreshold,
+                                                        int wallGrowRadius,
+                                                        const QVector<KisSelectionSP> &existingRegions = QVector<KisSelectionSP>());
 };
 
 #endif /* __KIS_LAZY_FILL_TOOLS_H */
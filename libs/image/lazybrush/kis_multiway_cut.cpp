@@ -24,8 +24,11 @@
 
 #include "kis_paint_device.h"
 #include "kis_painter.h"
+#include "kis_selection.h"
+#include "kis_pixel_selection.h"
 #include "kis_lazy_fill_tools.h"
 #include "kis_sequential_iterator.h"
+#include "krita_utils.h"
 #include <floodfill/kis_scanline_fill.h>
 
 
@@ -37,6 +40,7 @@ struct KisMultiwayCut::Private
     KisPaintDeviceSP dst;
     KisPaintDeviceSP mask;
     QRect boundingRect;
+    KisSelectionSP region;
 
     QVector<KeyStroke> keyStrokes;
 
@@ -64,6 +68,11 @@ void KisMultiwayCut::addKeyStroke(KisPaintDeviceSP dev, const KoColor &color)
 }
 
 
+void KisMultiwayCut::setRegion(KisSelectionSP region)
+{
+    m_d->region = region;
+}
+
 void KisMultiwayCut::Private::maskOutKeyStroke(KisPaintDeviceSP keyStrokeDevice, KisPaintDeviceSP mask, const QRect &boundingRect)
 {
     KIS_ASSERT_RECOVER_RETURN(keyStrokeDevice->pixelSize() == 1);
@@ -106,6 +115,23 @@ void KisMultiwayCut::run()
 {
     KisPaintDeviceSP other(new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8()));
 
+    /**
+     * The pixels outside the region are marked in the mask as if they
+     * have already been filled by some other cut, that is, they have
+     * zero capacity and are never reached by the fill.
+     */
+    if (m_d->region) {
+        KisPixelSelectionSP regionPixels = m_d->region->pixelSelection();
+        m_d->boundingRect &= regionPixels->selectedExactRect();
+        if (m_d->boundingRect.isEmpty()) return;
+
+        m_d->mask->makeCloneFromRough(regionPixels, m_d->boundingRect);
+        KritaUtils::filterAlpha8Device(m_d->mask, m_d->boundingRect,
+                                       [] (quint8 pixel) {
+                                           return pixel ? OPACITY_TRANSPARENT_U8 : OPACITY_OPAQUE_U8;
+                                       });
+    }
+
     /**
      * First sort all the key strokes in a way that all the
      * transparent strokes go to the beginning of the list.
@@ -36,6 +36,16 @@ public:
 
     void addKeyStroke(KisPaintDeviceSP dev, const KoColor &color);
 
+    /**
+     * Limit the cut to the pixels of \p region only. All the pixels
+     * outside the region are excluded from the graph, so neither the
+     * cut, nor the final fill will leak outside it. Used for solving
+     * independent regions of the image separately.
+     *
+     * \see KisLazyFillTools::splitIntoIndependentRegions()
+     */
+    void setRegion(KisSelectionSP region);
+
     void run();
 
     KisPaintDeviceSP srcDevice() const;
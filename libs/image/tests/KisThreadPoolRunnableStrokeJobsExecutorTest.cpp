@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisThreadPoolRunnableStrokeJobsExecutorTest.h"
+
+#include <QTest>
+#include <QAtomicInt>
+
+#include "KisThreadPoolRunnableStrokeJobsExecutor.h"
+#include "KisRunnableStrokeJobData.h"
+
+
+void KisThreadPoolRunnableStrokeJobsExecutorTest::testSequentialJobsWaitForConcurrent()
+{
+    KisThreadPoolRunnableStrokeJobsExecutor executor;
+
+    const int numBatches = 10;
+    const int numConcurrentJobs = 32;
+
+    QAtomicInt counter;
+    QVector<int> counterAtSequentialJobs;
+
+    QVector<KisRunnableStrokeJobData*> jobs;
+
+    for (int i = 0; i < numBatches; i++) {
+        for (int j = 0; j < numConcurrentJobs; j++) {
+            jobs.append(new KisRunnableStrokeJobData(
+                [&counter] () {
+                    QThread::usleep(100);
+                    counter.ref();
+                },
+                KisStrokeJobData::CONCURRENT));
+        }
+
+        jobs.append(new KisRunnableStrokeJobData(
+            [&counter, &counterAtSequentialJobs] () {
+                counterAtSequentialJobs.append(counter.load());
+            },
+            KisStrokeJobData::SEQUENTIAL));
+    }
+
+    executor.addRunnableJobs(jobs);
+
+    QCOMPARE(counter.load(), numBatches * numConcurrentJobs);
+    QCOMPARE(counterAtSequentialJobs.size(), numBatches);
+
+    for (int i = 0; i < numBatches; i++) {
+        QCOMPARE(counterAtSequentialJobs[i], (i + 1) * numConcurrentJobs);
+    }
+}
+
+void KisThreadPoolRunnableStrokeJobsExecutorTest::testNestedJobs()
+{
+    KisThreadPoolRunnableStrokeJobsExecutor executor;
+
+    const int numOuterJobs = 4 * QThread::idealThreadCount();
+    const int numInnerJobs = 16;
+
+    QAtomicInt counter;
+
+    QVector<KisRunnableStrokeJobData*> jobs;
+
+    for (int i = 0; i < numOuterJobs; i++) {
+        jobs.append(new KisRunnableStrokeJobData(
+            [&executor, &counter] () {
+                QVector<KisRunnableStrokeJobData*> innerJobs;
+
+                for (int j = 0; j < numInnerJobs; j++) {
+                    innerJobs.append(new KisRunnableStrokeJobData(
+                        [&counter] () { counter.ref(); },
+                        KisStrokeJobData::CONCURRENT));
+                }
+
+                // the pool is busy with the outer jobs, so the inner ones
+                // are executed by the calling thread without a deadlock
+                executor.addRunnableJobs(innerJobs);
+            },
+            KisStrokeJobData::CONCURRENT));
+    }
+
+    executor.addRunnableJobs(jobs);
+
+    QCOMPARE(counter.load(), numOuterJobs * numInnerJobs);
+}
+
+QTEST_MAIN(KisThreadPoolRunnableStrokeJobsExecutorTest)
@@ -0,0 +1,289 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTracerTest.h"
+
+#include <QTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QThread>
+
+#include <functional>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "KisTracer.h"
+#include "kis_image.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device.h"
+#include "kis_simple_stroke_strategy.h"
+
+
+void KisTracerTest::testRingBuffer()
+{
+#if HAVE_KIS_TRACING
+    KisTracer tracer;
+    tracer.setBufferCapacity(4);
+
+    tracer.addInstant("test", "dropped");
+    QVERIFY(tracer.events().isEmpty());
+
+    tracer.start();
+
+    for (int i = 0; i < 6; i++) {
+        tracer.addCounter("test", "counter", i);
+    }
+
+    tracer.stop();
+
+    QVector<KisTracer::Event> events = tracer.events();
+    QCOMPARE(events.size(), 4);
+
+    for (int i = 0; i < events.size(); i++) {
+        QCOMPARE(events[i].type, KisTracer::Counter);
+        QCOMPARE(events[i].value, qint64(i + 2));
+    }
+
+    tracer.clear();
+    QVERIFY(tracer.events().isEmpty());
+#else
+    QSKIP("Krita is built without tracing support");
+#endif
+}
+
+namespace {
+int countThreadNames(const KisTracer &tracer)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(tracer.chromeTrace());
+
+    int numThreads = 0;
+    Q_FOREACH (const QJsonValue &value, doc.object().value("traceEvents").toArray()) {
+        if (value.toObject().value("ph").toString() == "M") {
+            numThreads++;
+        }
+    }
+
+    return numThreads;
+}
+
+class FunctionThread : public QThread
+{
+public:
+    FunctionThread(std::function<void()> func)
+        : m_func(func)
+    {
+    }
+
+protected:
+    void run() override {
+        m_func();
+    }
+
+private:
+    std::function<void()> m_func;
+};
+}
+
+void KisTracerTest::testThreadBuffers()
+{
+#if HAVE_KIS_TRACING
+    KisTracer tracer1;
+    QScopedPointer<KisTracer> tracer2(new KisTracer());
+
+    tracer1.start();
+
+    // the threads alternating between the tracers keep their buffers
+    FunctionThread thread1(
+        [&tracer1, &tracer2] () {
+            for (int i = 0; i < 10; i++) {
+                tracer1.addCounter("test", "counter1", i);
+                tracer2->addCounter("test", "counter2", i);
+            }
+        });
+    thread1.start();
+    QVERIFY(thread1.wait());
+
+    tracer1.addInstant("test", "main thread");
+
+    QCOMPARE(tracer1.events().size(), 11);
+    QCOMPARE(tracer2->events().size(), 10);
+    QCOMPARE(countThreadNames(tracer1), 2);
+
+    // the thread has finished, but its events are still available
+    for (int i = 0; i < 10; i++) {
+        QCOMPARE(tracer1.events()[i].value, qint64(i));
+    }
+
+    // the buffers of the finished threads are freed on clearing
+    tracer1.clear();
+    QVERIFY(tracer1.events().isEmpty());
+    QCOMPARE(countThreadNames(tracer1), 1);
+
+    // a thread that outlives its tracer doesn't touch its buffer
+    FunctionThread thread2(
+        [&tracer2] () {
+            tracer2->addInstant("test", "instant");
+            tracer2.reset();
+        });
+    thread2.start();
+    QVERIFY(thread2.wait());
+    QVERIFY(!tracer2);
+
+    tracer1.stop();
+#else
+    QSKIP("Krita is built without tracing support");
+#endif
+}
+
+struct FillJobData : public KisStrokeJobData
+{
+    FillJobData(const QRect &_rect)
+        : KisStrokeJobData(CONCURRENT),
+          rect(_rect)
+    {
+    }
+
+    QRect rect;
+};
+
+class FillStrokeStrategy : public KisSimpleStrokeStrategy
+{
+public:
+    FillStrokeStrategy(KisPaintLayerSP layer)
+        : KisSimpleStrokeStrategy("fill_stroke"),
+          m_layer(layer)
+    {
+        enableJob(KisSimpleStrokeStrategy::JOB_DOSTROKE);
+    }
+
+    void doStrokeCallback(KisStrokeJobData *data) override {
+        FillJobData *fillData = dynamic_cast<FillJobData*>(data);
+        KIS_ASSERT(fillData);
+
+        const KoColor color(Qt::red, m_layer->colorSpace());
+        m_layer->paintDevice()->fill(fillData->rect, color);
+        m_layer->setDirty(fillData->rect);
+    }
+
+private:
+    KisPaintLayerSP m_layer;
+};
+
+void KisTracerTest::testScriptedStroke()
+{
+#if HAVE_KIS_TRACING
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 512, 512, cs, "tracer test image");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+    image->initialRefreshGraph();
+
+    KisTracer *tracer = KisTracer::instance();
+    tracer->clear();
+    tracer->start();
+
+    const int numJobs = 8;
+
+    KisStrokeId id = image->startStroke(new FillStrokeStrategy(layer));
+    for (int i = 0; i < numJobs; i++) {
+        image->addJob(id, new FillJobData(QRect(i * 64, i * 64, 64, 64)));
+    }
+    image->endStroke(id);
+    image->waitForDone();
+
+    tracer->stop();
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(tracer->chromeTrace(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QVERIFY(doc.isObject());
+
+    const QJsonArray traceEvents = doc.object().value("traceEvents").toArray();
+    QVERIFY(!traceEvents.isEmpty());
+
+    int numStrokeStarts = 0;
+    int numStrokeEnds = 0;
+    int numStrokeJobs = 0;
+    int numMergeWalkers = 0;
+
+    QSet<int> threadsWithNames;
+    QSet<int> threadsWithEvents;
+    double lastTimestamp = -1.0;
+
+    Q_FOREACH (const QJsonValue &value, traceEvents) {
+        const QJsonObject event = value.toObject();
+        const QString phase = event.value("ph").toString();
+        const QString name = event.value("name").toString();
+        const int tid = event.value("tid").toInt();
+
+        QVERIFY(event.contains("pid"));
+
+        if (phase == "M") {
+            QCOMPARE(name, QString("thread_name"));
+            QVERIFY(!event.value("args").toObject().value("name").toString().isEmpty());
+            threadsWithNames.insert(tid);
+            continue;
+        }
+
+        threadsWithEvents.insert(tid);
+
+        const double timestamp = event.value("ts").toDouble(-1.0);
+        QVERIFY(timestamp >= lastTimestamp);
+        lastTimestamp = timestamp;
+
+        if (phase == "i") {
+            if (name == "stroke start") {
+                numStrokeStarts++;
+            } else if (name == "stroke end") {
+                numStrokeEnds++;
+            }
+        } else if (phase == "X") {
+            QVERIFY(event.value("dur").toDouble(-1.0) >= 0.0);
+
+            if (name == "stroke job") {
+                numStrokeJobs++;
+            } else if (name == "merge walker") {
+                const QJsonObject args = event.value("args").toObject();
+                const QRect rect(args.value("x").toInt(), args.value("y").toInt(),
+                                 args.value("width").toInt(), args.value("height").toInt());
+                QVERIFY(!rect.isEmpty());
+                QVERIFY(image->bounds().intersects(rect));
+                numMergeWalkers++;
+            }
+        }
+    }
+
+    QCOMPARE(numStrokeStarts, 1);
+    QCOMPARE(numStrokeEnds, 1);
+    QCOMPARE(numStrokeJobs, numJobs);
+    QVERIFY(numMergeWalkers > 0);
+
+    Q_FOREACH (int tid, threadsWithEvents) {
+        QVERIFY(threadsWithNames.contains(tid));
+    }
+
+    tracer->clear();
+#else
+    QSKIP("Krita is built without tracing support");
+#endif
+}
+
+QTEST_MAIN(KisTracerTest)
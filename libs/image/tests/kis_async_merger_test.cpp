@@ -287,5 +287,70 @@ void KisAsyncMergerTest::testSubgraphingWithoutUpdatingParent()
     }
 }
 
+    /*
+      +-----------+
+      |root       |
+      | paint 3   |  (opaque, covers the left half)
+      | paint 2   |  (semi-transparent)
+      | paint 1   |
+      +-----------+
+     */
+
+void KisAsyncMergerTest::testSkipCoveredLayers()
+{
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 256, 128, colorSpace, "covered layers test");
+
+    const QRect coveredRect(0, 0, 128, 128);
+    const QRect uncoveredRect(128, 0, 128, 128);
+
+    KisPaintDeviceSP device1 = new KisPaintDevice(colorSpace);
+    device1->fill(image->bounds(), KoColor(Qt::white, colorSpace));
+    KisLayerSP paintLayer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8, device1);
+
+    KisPaintDeviceSP device2 = new KisPaintDevice(colorSpace);
+    KisLayerSP paintLayer2 = new KisPaintLayer(image, "paint2", 128, device2);
+
+    KisPaintDeviceSP device3 = new KisPaintDevice(colorSpace);
+    device3->fill(coveredRect, KoColor(Qt::blue, colorSpace));
+    KisLayerSP paintLayer3 = new KisPaintLayer(image, "paint3", OPACITY_OPAQUE_U8, device3);
+
+    image->addNode(paintLayer1, image->rootLayer());
+    image->addNode(paintLayer2, image->rootLayer());
+    image->addNode(paintLayer3, image->rootLayer());
+
+    image->initialRefreshGraph();
+
+    KisMergeWalker walker(image->bounds());
+    KisAsyncMerger merger;
+
+    // only the uncovered part of the change should become visible
+    device2->fill(image->bounds(), KoColor(Qt::black, colorSpace));
+    walker.collectRects(paintLayer2, image->bounds());
+    merger.startMerge(walker);
+
+    KisPaintDeviceSP projection = image->projection();
+
+    KoColor blendedColor(colorSpace);
+    projection->pixel(200, 64, &blendedColor);
+
+    QVERIFY(projection->tileContentFlags(coveredRect) & KisTileContent::Uniform);
+    QVERIFY(projection->tileContentFlags(uncoveredRect) & KisTileContent::Uniform);
+
+    KoColor coveredColor(colorSpace);
+    projection->pixel(64, 64, &coveredColor);
+    QCOMPARE(coveredColor, KoColor(Qt::blue, colorSpace));
+
+    QVERIFY(blendedColor != KoColor(Qt::white, colorSpace));
+    QVERIFY(blendedColor != KoColor(Qt::black, colorSpace));
+
+    // the result is the same as the one of the full refresh
+    KisPaintDeviceSP mergedProjection = new KisPaintDevice(*projection);
+    image->refreshGraph();
+
+    QPoint pt;
+    QVERIFY(TestUtil::comparePaintDevices(pt, mergedProjection, projection));
+}
+
 QTEST_MAIN(KisAsyncMergerTest)
 
@@ -24,6 +24,8 @@
 #include "kis_fill_painter.h"
 
 #include <floodfill/kis_scanline_fill.h>
+#include <resources/KoPattern.h>
+#include "kis_datamanager.h"
 
 #define THRESHOLD 10
 
@@ -149,5 +151,96 @@ void KisFillPainterTest::benchmarkFillingScanlineSelection()
                                   "heavy_labyrinth_top_left_selection"));
 }
 
+static QImage createTestPattern(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32);
+
+    for (int y = 0; y < size.height(); y++) {
+        for (int x = 0; x < size.width(); x++) {
+            image.setPixel(x, y, qRgb(x * 255 / size.width(), y * 255 / size.height(), (x * y) & 0xff));
+        }
+    }
+
+    return image;
+}
+
+void KisFillPainterTest::testFillRectNoCompose_data()
+{
+    QTest::addColumn<QSize>("patternSize");
+    QTest::addColumn<QPoint>("deviceOffset");
+    QTest::addColumn<QRect>("fillRect");
+
+    QTest::newRow("aligned") << QSize(64, 32) << QPoint() << QRect(0, 0, 512, 512);
+    QTest::newRow("odd-pattern") << QSize(97, 41) << QPoint() << QRect(-50, 30, 700, 500);
+    QTest::newRow("device-offset") << QSize(97, 41) << QPoint(13, -7) << QRect(-50, 30, 700, 500);
+    QTest::newRow("small-rect") << QSize(100, 70) << QPoint(5, 5) << QRect(10, 10, 20, 30);
+    QTest::newRow("big-pattern") << QSize(300, 200) << QPoint(-20, 40) << QRect(0, 0, 900, 700);
+}
+
+void KisFillPainterTest::testFillRectNoCompose()
+{
+    QFETCH(QSize, patternSize);
+    QFETCH(QPoint, deviceOffset);
+    QFETCH(QRect, fillRect);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KoPattern pattern(createTestPattern(patternSize), "test_pattern", "");
+
+    KisPaintDeviceSP referenceDevice = new KisPaintDevice(cs);
+    referenceDevice->setX(deviceOffset.x());
+    referenceDevice->setY(deviceOffset.y());
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->setX(deviceOffset.x());
+    dev->setY(deviceOffset.y());
+
+    {
+        KisFillPainter gc(referenceDevice);
+        gc.fillRect(fillRect, &pattern);
+    }
+
+    {
+        KisFillPainter gc(dev);
+        gc.fillRectNoCompose(fillRect, &pattern);
+    }
+
+    QCOMPARE(dev->exactBounds(), referenceDevice->exactBounds());
+
+    QImage result = dev->convertToQImage(0, fillRect);
+    QImage reference = referenceDevice->convertToQImage(0, fillRect);
+
+    QCOMPARE(result, reference);
+}
+
+void KisFillPainterTest::testFillRectNoComposeSharesTiles()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KoPattern pattern(createTestPattern(QSize(32, 128)), "test_pattern", "");
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    {
+        KisFillPainter gc(dev);
+        gc.fillRectNoCompose(QRect(0, 0, 1024, 1024), &pattern);
+    }
+
+    KisDataManagerSP dm = dev->dataManager();
+
+    // the pattern repeats every tile horizontally and every second tile vertically
+    QCOMPARE(dm->getTile(0, 0, false)->tileData(), dm->getTile(5, 0, false)->tileData());
+    QCOMPARE(dm->getTile(0, 0, false)->tileData(), dm->getTile(3, 2, false)->tileData());
+    QCOMPARE(dm->getTile(0, 1, false)->tileData(), dm->getTile(7, 9, false)->tileData());
+    QVERIFY(dm->getTile(0, 0, false)->tileData() != dm->getTile(0, 1, false)->tileData());
+
+    // writing into a shared tile detaches it
+    KoColor color(Qt::red, cs);
+    dev->setPixel(5 * 64 + 3, 3, color);
+
+    QVERIFY(dm->getTile(0, 0, false)->tileData() != dm->getTile(5, 0, false)->tileData());
+
+    KoColor sample;
+    dev->pixel(3, 3, &sample);
+    QVERIFY(sample != color);
+}
 
 QTEST_MAIN(KisFillPainterTest)
@@ -36,6 +36,10 @@ private Q_SLOTS:
     void benchmarkFillPainterOffsetCompositioning();
     void benchmarkFillingScanlineColor();
     void benchmarkFillingScanlineSelection();
+
+    void testFillRectNoCompose_data();
+    void testFillRectNoCompose();
+    void testFillRectNoComposeSharesTiles();
 };
 
 #endif
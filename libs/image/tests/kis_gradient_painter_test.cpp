@@ -101,6 +101,9 @@ void testShapedGradientPainterImpl(const QPolygonF &selectionPolygon,
     gc.setGradient(gradient.data());
     gc.setGradientShape(KisGradientPainter::GradientShapePolygonal);
 
+    // the reference images are rendered with the legacy shape algorithm
+    gc.setUseDistanceTransformShape(false);
+
     gc.paintGradient(selectionPolygon.boundingRect().topLeft(),
                      selectionPolygon.boundingRect().bottomRight(),
                      KisGradientPainter::GradientRepeatNone,
@@ -334,4 +337,91 @@ void KisGradientPainterTest::testCachedStrategy()
     QVERIFY(maxError < 2 * maxRelError);
 }
 
+#include "KisShapeBurstGradientShapeStrategy.h"
+
+void KisGradientPainterTest::testShapeBurstStrategy()
+{
+    QPainterPath path;
+    path.addRect(QRectF(100, 100, 200, 100));
+
+    const QRect rc = path.boundingRect().toAlignedRect();
+    KisShapeBurstGradientShapeStrategy strategy(path, rc);
+
+    // the distance is measured to the nearest pixel outside the shape
+    QCOMPARE(strategy.valueAt(50, 50), 0.0);
+    QCOMPARE(strategy.valueAt(99, 150), 0.0);
+    QVERIFY(qFuzzyCompare(strategy.valueAt(100, 150), 1.0 / 50));
+    QVERIFY(qFuzzyCompare(strategy.valueAt(150, 110), 11.0 / 50));
+    QVERIFY(qFuzzyCompare(strategy.valueAt(200, 149), 1.0));
+    QVERIFY(qFuzzyCompare(strategy.valueAt(200, 150), 1.0));
+
+    // a batch of values must be the same as the separate values
+    QVector<double> values(rc.width() + 20);
+
+    for (int y = rc.y() - 5; y <= rc.bottom() + 5; y += 7) {
+        strategy.valuesAt(rc.x() - 10, y, values.size(), values.data());
+
+        for (int i = 0; i < values.size(); i++) {
+            QCOMPARE(values[i], strategy.valueAt(rc.x() - 10 + i, y));
+        }
+    }
+}
+
+void KisGradientPainterTest::testShapeBurstStrategyDownsampled()
+{
+    QPainterPath path;
+    path.addRect(QRectF(0, 0, 5000, 120));
+
+    const QRect rc = path.boundingRect().toAlignedRect();
+    KisShapeBurstGradientShapeStrategy strategy(path, rc);
+
+    QCOMPARE(strategy.valueAt(-10, 60), 0.0);
+    QVERIFY(qAbs(strategy.valueAt(2500, 60) - 1.0) < 0.05);
+    QVERIFY(qAbs(strategy.valueAt(2500, 30) - 0.5) < 0.05);
+    QVERIFY(strategy.valueAt(2500, 0) < 0.05);
+
+    QVector<double> values(100);
+    strategy.valuesAt(2450, 30, values.size(), values.data());
+
+    for (int i = 0; i < values.size(); i++) {
+        QCOMPARE(values[i], strategy.valueAt(2450 + i, 30));
+    }
+}
+
+void KisGradientPainterTest::testShapedGradientPainterDistanceTransform()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    QRect imageRect(0,0,300,300);
+
+    KisSelectionSP selection = new KisSelection();
+    KisPixelSelectionSP pixelSelection = selection->pixelSelection();
+    pixelSelection->select(QRect(100, 100, 100, 100));
+    pixelSelection->invalidateOutlineCache();
+
+    QLinearGradient testGradient;
+    testGradient.setColorAt(0.0, Qt::white);
+    testGradient.setColorAt(1.0, Qt::black);
+    QScopedPointer<KoStopGradient> gradient(
+        KoStopGradient::fromQGradient(&testGradient));
+
+    KisGradientPainter gc(dev, selection);
+    gc.setGradient(gradient.data());
+    gc.setGradientShape(KisGradientPainter::GradientShapePolygonal);
+    QVERIFY(gc.useDistanceTransformShape());
+
+    gc.paintGradient(QPointF(100, 100), QPointF(200, 200),
+                     KisGradientPainter::GradientRepeatNone,
+                     0, false, imageRect);
+
+    const QImage result = dev->convertToQImage(0, imageRect);
+
+    QCOMPARE(qAlpha(result.pixel(50, 50)), 0);
+    QCOMPARE(qAlpha(result.pixel(150, 150)), 255);
+    QVERIFY(qGray(result.pixel(150, 150)) < 10);
+    QVERIFY(qGray(result.pixel(100, 150)) > 240);
+    QVERIFY(qGray(result.pixel(125, 150)) > qGray(result.pixel(140, 150)));
+}
+
 QTEST_MAIN(KisGradientPainterTest)
@@ -37,6 +37,10 @@ private Q_SLOTS:
     void testSplitDisjointPaths();
 
     void testCachedStrategy();
+
+    void testShapeBurstStrategy();
+    void testShapeBurstStrategyDownsampled();
+    void testShapedGradientPainterDistanceTransform();
 };
 
 #endif
@@ -40,6 +40,7 @@
 #include "kis_layer_utils.h"
 #include "kis_annotation.h"
 #include "KisProofingConfiguration.h"
+#include "kis_projection_leaf.h"
 
 #include "kis_undo_stores.h"
 
@@ -1154,6 +1155,102 @@ void KisImageTest::testMergePassThroughOverPaintLayer()
     }
 }
 
+void KisImageTest::testPassThroughCache()
+{
+    const QRect refRect(0,0,512,512);
+    TestUtil::MaskParent p(refRect);
+
+    p.layer->paintDevice()->fill(QRect(50, 50, 300, 300), KoColor(Qt::white, p.image->colorSpace()));
+
+    KisGroupLayerSP group1 = new KisGroupLayer(p.image, "group1", 150);
+    KisPaintLayerSP layer2 = new KisPaintLayer(p.image, "paint2", 200);
+    KisPaintLayerSP layer3 = new KisPaintLayer(p.image, "paint3", OPACITY_OPAQUE_U8);
+    KisGroupLayerSP group4 = new KisGroupLayer(p.image, "group4", 100);
+    KisPaintLayerSP layer5 = new KisPaintLayer(p.image, "paint5", OPACITY_OPAQUE_U8);
+
+    group1->setPassThroughCacheEnabled(false);
+    group1->setPassThroughMode(true);
+    group4->setPassThroughCacheEnabled(false);
+    group4->setPassThroughMode(true);
+
+    layer2->paintDevice()->fill(QRect(100, 100, 100, 100), KoColor(Qt::red, p.image->colorSpace()));
+    layer3->paintDevice()->fill(QRect(150, 150, 100, 100), KoColor(Qt::green, p.image->colorSpace()));
+    layer5->paintDevice()->fill(QRect(200, 200, 100, 100), KoColor(Qt::blue, p.image->colorSpace()));
+
+    p.image->addNode(group1);
+    p.image->addNode(layer2, group1);
+    p.image->addNode(layer3, group1);
+    p.image->addNode(group4, group1);
+    p.image->addNode(layer5, group4);
+
+    p.image->initialRefreshGraph();
+
+    const QImage refImage = p.image->projection()->convertToQImage(0, refRect);
+
+    QVERIFY(!group1->passThroughCacheActive());
+    QCOMPARE(layer3->projectionLeaf()->parent(), p.image->root()->projectionLeaf());
+
+    group1->setPassThroughCacheEnabled(true);
+    p.image->waitForDone();
+
+    QVERIFY(group1->passThroughCacheActive());
+    QVERIFY(!group4->passThroughCacheActive());
+    QCOMPARE(layer3->projectionLeaf()->parent(), group1->projectionLeaf());
+    QCOMPARE(layer5->projectionLeaf()->parent(), group1->projectionLeaf());
+    QCOMPARE(group1->projectionLeaf()->opacity(), OPACITY_OPAQUE_U8);
+
+    QPoint pt;
+    QImage cachedImage = p.image->projection()->convertToQImage(0, refRect);
+    QVERIFY(TestUtil::compareQImages(pt, refImage, cachedImage, 2, 2));
+
+    // the changes outside the group reuse its projection
+    p.layer->paintDevice()->fill(QRect(0, 0, 100, 100), KoColor(Qt::black, p.image->colorSpace()));
+    p.layer->setDirty(QRect(0, 0, 100, 100));
+    p.image->waitForDone();
+    cachedImage = p.image->projection()->convertToQImage(0, refRect);
+
+    group1->setPassThroughCacheEnabled(false);
+    p.image->waitForDone();
+    p.image->refreshGraph();
+    const QImage changedRefImage = p.image->projection()->convertToQImage(0, refRect);
+    QVERIFY(TestUtil::compareQImages(pt, changedRefImage, cachedImage, 2, 2));
+
+    group1->setPassThroughCacheEnabled(true);
+    p.image->waitForDone();
+
+    // the opacity of the group is folded into its children
+    group1->setOpacity(OPACITY_OPAQUE_U8);
+    p.image->waitForDone();
+    QVERIFY(group1->passThroughCacheActive());
+    cachedImage = p.image->projection()->convertToQImage(0, refRect);
+
+    group1->setPassThroughCacheEnabled(false);
+    p.image->waitForDone();
+    p.image->refreshGraph();
+    const QImage opaqueRefImage = p.image->projection()->convertToQImage(0, refRect);
+    QVERIFY(opaqueRefImage != changedRefImage);
+    QVERIFY(TestUtil::compareQImages(pt, opaqueRefImage, cachedImage, 2, 2));
+
+    group1->setPassThroughCacheEnabled(true);
+    p.image->waitForDone();
+
+    // a blending mode that differs from Normal disables the cache
+    layer5->setCompositeOpId(COMPOSITE_MULT);
+    p.image->waitForDone();
+    QVERIFY(!group1->passThroughCacheActive());
+    QCOMPARE(layer3->projectionLeaf()->parent(), p.image->root()->projectionLeaf());
+
+    // switching the cache off regenerates the projection as well
+    const QImage uncachedImage = p.image->projection()->convertToQImage(0, refRect);
+    p.image->refreshGraph();
+    const QImage multRefImage = p.image->projection()->convertToQImage(0, refRect);
+    QVERIFY(multRefImage != opaqueRefImage);
+    QVERIFY(TestUtil::compareQImages(pt, multRefImage, uncachedImage, 2, 2));
+
+    layer5->setCompositeOpId(COMPOSITE_OVER);
+    p.image->waitForDone();
+    QVERIFY(group1->passThroughCacheActive());
+}
 
 
 QTEST_MAIN(KisImageTest)
@@ -56,6 +56,7 @@ private Q_SLOTS:
 
     void testMergePaintOverPassThroughLayer();
     void testMergePassThroughOverPaintLayer();
+    void testPassThroughCache();
 };
 
 #endif
@@ -1398,6 +1398,228 @@ void KisLazyBrushTest::multiwayCutBenchmark()
     // KIS_DUMP_DEVICE_2(filteredMainDev, mainRect, "2filtered", "dd");
 }
 
+#include "kis_selection.h"
+#include "kis_pixel_selection.h"
+#include "kis_image_config.h"
+
+void KisLazyBrushTest::testSplitIntoIndependentRegions()
+{
+    const QRect mainRect(0, 0, 200, 100);
+    const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+
+    KisImageConfig cfg(true);
+    const int wallThreshold = cfg.colorizeMaskRegionWallThreshold(true);
+    const int wallGrowRadius = cfg.colorizeMaskRegionWallGrowRadius(true);
+
+    KisPaintDeviceSP mainDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    mainDev->fill(QRect(100, 0, 6, 100), KoColor(Qt::black, mainDev->colorSpace()));
+
+    KisPaintDeviceSP filteredMainDev = KisPainter::convertToAlphaAsAlpha(mainDev);
+    KisLazyFillTools::normalizeAndInvertAlpha8Device(filteredMainDev, mainRect);
+
+    KisPaintDeviceSP aLabelDev = new KisPaintDevice(alpha8);
+    aLabelDev->fill(QRect(10, 10, 10, 10), KoColor(Qt::black, alpha8));
+    aLabelDev->fill(QRect(10, 70, 10, 10), KoColor(Qt::black, alpha8));
+
+    KisPaintDeviceSP bLabelDev = new KisPaintDevice(alpha8);
+    bLabelDev->fill(QRect(150, 10, 10, 10), KoColor(Qt::black, alpha8));
+
+    QVector<KisLazyFillTools::KeyStroke> strokes;
+    strokes << KisLazyFillTools::KeyStroke(aLabelDev, KoColor(Qt::red, mainDev->colorSpace()));
+    strokes << KisLazyFillTools::KeyStroke(bLabelDev, KoColor(Qt::green, mainDev->colorSpace()));
+
+    QVector<KisSelectionSP> regions =
+        KisLazyFillTools::splitIntoIndependentRegions(filteredMainDev, strokes, mainRect, mainRect,
+                                                      wallThreshold, wallGrowRadius);
+
+    QCOMPARE(regions.size(), 2);
+
+    QCOMPARE(regions[0]->selected(50, 50), MAX_SELECTED);
+    QCOMPARE(regions[0]->selected(150, 50), MIN_SELECTED);
+    QCOMPARE(regions[1]->selected(50, 50), MIN_SELECTED);
+    QCOMPARE(regions[1]->selected(150, 50), MAX_SELECTED);
+
+    // the regions are grown into the line art a bit
+    QCOMPARE(regions[0]->selected(101, 50), MAX_SELECTED);
+    QCOMPARE(regions[1]->selected(104, 50), MAX_SELECTED);
+
+    // ...but the strips of the neighbouring regions never overlap
+    QCOMPARE(regions[0]->selected(103, 50), MAX_SELECTED);
+    QCOMPARE(regions[1]->selected(103, 50), MIN_SELECTED);
+
+    for (int y = mainRect.top(); y <= mainRect.bottom(); y++) {
+        for (int x = mainRect.left(); x <= mainRect.right(); x++) {
+            QVERIFY(regions[0]->selected(x, y) == MIN_SELECTED ||
+                    regions[1]->selected(x, y) == MIN_SELECTED);
+        }
+    }
+
+    // the already existing regions are not generated again
+    QVector<KisSelectionSP> newRegions =
+        KisLazyFillTools::splitIntoIndependentRegions(filteredMainDev, strokes, mainRect, mainRect,
+                                                      wallThreshold, wallGrowRadius,
+                                                      QVector<KisSelectionSP>() << regions[0]);
+
+    QCOMPARE(newRegions.size(), 1);
+    QCOMPARE(newRegions[0]->selected(150, 50), MAX_SELECTED);
+    QCOMPARE(newRegions[0]->selected(103, 50), MIN_SELECTED);
+
+    // the seed rect limits the generated regions
+    newRegions =
+        KisLazyFillTools::splitIntoIndependentRegions(filteredMainDev, strokes, mainRect,
+                                                      QRect(140, 0, 60, 100),
+                                                      wallThreshold, wallGrowRadius);
+
+    QCOMPARE(newRegions.size(), 1);
+    QCOMPARE(newRegions[0]->selected(150, 50), MAX_SELECTED);
+
+    // the cut limited to a region never leaks outside of it
+    KisPaintDeviceSP resultColoring = new KisPaintDevice(mainDev->colorSpace());
+
+    KisMultiwayCut cut(filteredMainDev, resultColoring, mainRect);
+    cut.setRegion(regions[0]);
+    cut.addKeyStroke(new KisPaintDevice(*aLabelDev), KoColor(Qt::red, mainDev->colorSpace()));
+    cut.addKeyStroke(new KisPaintDevice(*bLabelDev), KoColor(Qt::green, mainDev->colorSpace()));
+    cut.run();
+
+    QVERIFY(resultColoring->exactBounds().right() < 106);
+    QVERIFY(!resultColoring->exactBounds().isEmpty());
+}
+
+void KisLazyBrushTest::multiwayCutRegionsBenchmark_data()
+{
+    QTest::addColumn<int>("mode");
+
+    QTest::newRow("full") << 0;
+    QTest::newRow("regions") << 1;
+    QTest::newRow("incremental") << 2;
+}
+
+void KisLazyBrushTest::multiwayCutRegionsBenchmark()
+{
+    QFETCH(int, mode);
+
+    const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+    KisPaintDeviceSP mainDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    KisImageConfig cfg(true);
+    const int wallThreshold = cfg.colorizeMaskRegionWallThreshold(true);
+    const int wallGrowRadius = cfg.colorizeMaskRegionWallGrowRadius(true);
+
+    const int numCells = 4;
+    const int cellSize = 128;
+    const int wallWidth = 6;
+    const QRect mainRect(0, 0, numCells * cellSize, numCells * cellSize);
+
+    const KoColor wallColor(Qt::black, mainDev->colorSpace());
+
+    for (int i = 1; i < numCells; i++) {
+        mainDev->fill(QRect(i * cellSize, 0, wallWidth, mainRect.height()), wallColor);
+        mainDev->fill(QRect(0, i * cellSize, mainRect.width(), wallWidth), wallColor);
+    }
+
+    KisPaintDeviceSP filteredMainDev = KisPainter::convertToAlphaAsAlpha(mainDev);
+    KisLazyFillTools::normalizeAndInvertAlpha8Device(filteredMainDev, mainRect);
+
+    // every cell has two strokes: a colored one and a transparent one
+
+    KisPaintDeviceSP colorLabelDev = new KisPaintDevice(alpha8);
+    KisPaintDeviceSP transparentLabelDev = new KisPaintDevice(alpha8);
+
+    for (int y = 0; y < numCells; y++) {
+        for (int x = 0; x < numCells; x++) {
+            const QPoint cellOrigin(x * cellSize + wallWidth, y * cellSize + wallWidth);
+            colorLabelDev->fill(QRect(cellOrigin + QPoint(20, 20), QSize(20, 20)), KoColor(Qt::black, alpha8));
+            transparentLabelDev->fill(QRect(cellOrigin + QPoint(80, 80), QSize(10, 10)), KoColor(Qt::black, alpha8));
+        }
+    }
+
+    QVector<KisLazyFillTools::KeyStroke> strokes;
+    strokes << KisLazyFillTools::KeyStroke(colorLabelDev, KoColor(Qt::red, mainDev->colorSpace()));
+    strokes << KisLazyFillTools::KeyStroke(transparentLabelDev, KoColor(Qt::transparent, mainDev->colorSpace()));
+
+    auto fillRegion = [&] (KisSelectionSP region, KisPaintDeviceSP result) {
+        KisMultiwayCut cut(filteredMainDev, result, mainRect);
+        cut.setRegion(region);
+
+        Q_FOREACH (const KisLazyFillTools::KeyStroke &stroke, strokes) {
+            cut.addKeyStroke(new KisPaintDevice(*stroke.dev), stroke.color);
+        }
+
+        cut.run();
+    };
+
+    KisPaintDeviceSP resultColoring = new KisPaintDevice(mainDev->colorSpace());
+
+    QVector<KisSelectionSP> regions;
+    if (mode == 2) {
+        regions = KisLazyFillTools::splitIntoIndependentRegions(filteredMainDev, strokes, mainRect, mainRect,
+                                                                wallThreshold, wallGrowRadius);
+    }
+
+    // the user adds a small stroke in one of the cells
+    const QRect changedRect(cellSize + 50, cellSize + 50, 5, 5);
+    colorLabelDev->fill(changedRect, KoColor(Qt::black, alpha8));
+
+    QBENCHMARK_ONCE {
+        if (mode == 0) {
+            KisMultiwayCut cut(filteredMainDev, resultColoring, mainRect);
+
+            Q_FOREACH (const KisLazyFillTools::KeyStroke &stroke, strokes) {
+                cut.addKeyStroke(new KisPaintDevice(*stroke.dev), stroke.color);
+            }
+
+            cut.run();
+
+        } else if (mode == 1) {
+            regions = KisLazyFillTools::splitIntoIndependentRegions(filteredMainDev, strokes, mainRect, mainRect,
+                                                                    wallThreshold, wallGrowRadius);
+
+            Q_FOREACH (KisSelectionSP region, regions) {
+                fillRegion(region, resultColoring);
+            }
+
+        } else {
+            QVector<KisSelectionSP> keptRegions;
+            QVector<KisSelectionSP> staleRegions;
+
+            Q_FOREACH (KisSelectionSP region, regions) {
+                if (region->selectedExactRect().intersects(changedRect)) {
+                    staleRegions << region;
+                } else {
+                    keptRegions << region;
+                }
+            }
+
+            QCOMPARE(staleRegions.size(), 1);
+
+            QVector<KisSelectionSP> newRegions =
+                KisLazyFillTools::splitIntoIndependentRegions(filteredMainDev, strokes, mainRect,
+                                                              changedRect | staleRegions.first()->selectedExactRect(),
+                                                              wallThreshold, wallGrowRadius,
+                                                              keptRegions);
+
+            QCOMPARE(newRegions.size(), 1);
+
+            Q_FOREACH (KisSelectionSP region, newRegions) {
+                fillRegion(region, resultColoring);
+            }
+        }
+    }
+
+    if (mode < 2) {
+        const KoColor expectedColor(Qt::red, mainDev->colorSpace());
+        KoColor pixel(mainDev->colorSpace());
+
+        for (int y = 0; y < numCells; y++) {
+            for (int x = 0; x < numCells; x++) {
+                const QPoint pt(x * cellSize + wallWidth + 30, y * cellSize + wallWidth + 30);
+                resultColoring->pixel(pt.x(), pt.y(), &pixel);
+                QCOMPARE(pixel, expectedColor);
+            }
+        }
+    }
+}
 
 
 QTEST_MAIN(KisLazyBrushTest)
@@ -40,6 +40,10 @@ private Q_SLOTS:
     void testEstimateTransparentPixels();
 
     void multiwayCutBenchmark();
+
+    void testSplitIntoIndependentRegions();
+    void multiwayCutRegionsBenchmark_data();
+    void multiwayCutRegionsBenchmark();
 };
 
 #endif /* __KIS_LAZY_BRUSH_TEST_H */
@@ -20,6 +20,7 @@
 #include <QTest>
 
 #include <QTime>
+#include <QtConcurrent>
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
@@ -27,6 +28,7 @@
 #include <KoStore.h>
 
 #include "kis_paint_device_writer.h"
+#include "kis_paint_device_lazy_loader.h"
 #include "kis_painter.h"
 #include "kis_types.h"
 #include "kis_paint_device.h"
@@ -824,6 +826,104 @@ void KisPaintDeviceTest::testExactBoundsNonTransparent()
     QCOMPARE(dev->nonDefaultPixelArea(), QRect(-1,-1,1002,1002));
 }
 
+void KisPaintDeviceTest::testExactBoundsTileCache()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const KoColor white(Qt::white, cs);
+    const KoColor transparent(Qt::transparent, cs);
+
+    QRect fillRect(100,100,300,200);
+    dev->fill(fillRect, white);
+    QCOMPARE(dev->exactBounds(), fillRect);
+
+    // a pixel changed inside an already scanned tile
+    dev->setPixel(99, 150, white);
+    QCOMPARE(dev->exactBounds(), fillRect | QRect(99,150,1,1));
+
+    // a pixel in a new tile
+    dev->setPixel(1000, 50, white);
+    QCOMPARE(dev->exactBounds(), QRect(99,50,902,250));
+
+    // the extreme pixels are removed
+    {
+        KisTransaction transaction(dev);
+
+        dev->setPixel(1000, 50, transparent);
+        dev->setPixel(99, 150, transparent);
+        QCOMPARE(dev->exactBounds(), fillRect);
+
+        dev->clear(QRect(300,0,200,400));
+        QCOMPARE(dev->exactBounds(), QRect(100,100,200,200));
+
+        // undo brings the old tiles back
+        transaction.revert();
+        QCOMPARE(dev->exactBounds(), QRect(99,50,902,250));
+    }
+
+    // the cached bounds of the tiles are in the coordinates of the data
+    dev->moveTo(-30, 20);
+    QCOMPARE(dev->exactBounds(), QRect(69,70,902,250));
+    dev->moveTo(0, 0);
+
+    // now the transparent pixels of the existing tiles are non-default
+    dev->setDefaultPixel(white);
+    QCOMPARE(dev->nonDefaultPixelArea(), QRect(64,0,960,320));
+
+    dev->setDefaultPixel(transparent);
+    QCOMPARE(dev->exactBounds(), QRect(99,50,902,250));
+    QCOMPARE(dev->nonDefaultPixelArea(), QRect(99,50,902,250));
+}
+
+KisPaintDeviceSP createSparsePaintDevice(const KoColorSpace *cs)
+{
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    const KoColor white(Qt::white, cs);
+
+    // a large layer with a few small strokes spread over it
+    for (int i = 0; i < 20; i++) {
+        dev->fill(QRect(500 * i, 13 * i * i, 30, 30), white);
+        dev->fill(QRect(9970 - 500 * i, 9970 - 13 * i * i, 30, 30), white);
+    }
+
+    return dev;
+}
+
+void KisPaintDeviceTest::benchmarkExactBoundsSparse()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = createSparsePaintDevice(cs);
+
+    QRect measuredRect;
+
+    QBENCHMARK {
+        // invalidate the cache
+        dev->setDirty();
+        measuredRect = dev->exactBounds();
+    }
+
+    QCOMPARE(measuredRect, QRect(0,0,10000,10000));
+}
+
+void KisPaintDeviceTest::benchmarkExactBoundsSparseAfterChange()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = createSparsePaintDevice(cs);
+
+    const KoColor white(Qt::white, cs);
+    QRect measuredRect;
+    int i = 0;
+
+    QBENCHMARK {
+        // a stroke at the edge of the layer
+        dev->setPixel(5000 + (i++ % 100), 0, white);
+        measuredRect = dev->exactBounds();
+    }
+
+    QCOMPARE(measuredRect, QRect(0,0,10000,10000));
+}
+
 KisPaintDeviceSP createWrapAroundPaintDevice(const KoColorSpace *cs)
 {
     struct TestingDefaultBounds : public KisDefaultBoundsBase {
@@ -2182,6 +2282,83 @@ void KisPaintDeviceTest::testCopyPaintDeviceWithFrames()
     QVERIFY(channel->keyframeAt(10));
 }
 
+void KisPaintDeviceTest::testTileContentFlags()
+{
+    using namespace KisTileContent;
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect tile1(0, 0, 64, 64);
+    const QRect tile2(64, 0, 64, 64);
+
+    // the default tile
+    QCOMPARE(dev->tileContentFlags(tile1), Flags(Uniform | Transparent));
+
+    dev->fill(tile1, KoColor(Qt::red, cs));
+    QCOMPARE(dev->tileContentFlags(tile1), Flags(Uniform | Opaque));
+
+    // the flags are cached, check that a write invalidates them
+    dev->setPixel(10, 10, KoColor(Qt::blue, cs));
+    QCOMPARE(dev->tileContentFlags(tile1), Flags(Opaque));
+
+    KoColor semiTransparent(Qt::blue, cs);
+    semiTransparent.setOpacity(quint8(128));
+    dev->setPixel(11, 10, semiTransparent);
+    QCOMPARE(dev->tileContentFlags(tile1), Flags(NoFlags));
+
+    // transparent pixels of different colors are not uniform
+    KoColor transparent(Qt::green, cs);
+    transparent.setOpacity(OPACITY_TRANSPARENT_U8);
+    dev->fill(tile2, transparent);
+    dev->setPixel(70, 10, KoColor(Qt::transparent, cs));
+    QCOMPARE(dev->tileContentFlags(tile2), Flags(Transparent));
+
+    // a part of the tile has the flags of the whole tile
+    QCOMPARE(dev->tileContentFlags(QRect(70, 20, 10, 10)), Flags(Transparent));
+    QCOMPARE(dev->tileContentFlags(tile1 | tile2), Flags(NoFlags));
+
+    // the flags follow the data when the transaction is reverted
+    dev->fill(tile1 | tile2, KoColor(Qt::red, cs));
+    QCOMPARE(dev->tileContentFlags(tile1 | tile2), Flags(Uniform | Opaque));
+
+    KisTransaction transaction(dev);
+    dev->fill(tile1, semiTransparent);
+    QCOMPARE(dev->tileContentFlags(tile1), Flags(Uniform));
+    QCOMPARE(dev->tileContentFlags(tile2), Flags(Uniform | Opaque));
+    transaction.revert();
+
+    QCOMPARE(dev->tileContentFlags(tile1 | tile2), Flags(Uniform | Opaque));
+}
+
+void KisPaintDeviceTest::testTileContentFlagsAlphaDescriptor()
+{
+    using namespace KisTileContent;
+
+    // 0x3C00 is unit alpha in F16, but not in U16
+    const quint8 pixel[] = {0x00, 0x3C};
+    KisDataManagerSP dm = new KisDataManager(sizeof(pixel), pixel);
+
+    AlphaDescriptor alphaF16;
+    alphaF16.offset = 0;
+    alphaF16.size = 2;
+    alphaF16.opaqueValue[0] = 0x00;
+    alphaF16.opaqueValue[1] = 0x3C;
+
+    AlphaDescriptor alphaU16;
+    alphaU16.offset = 0;
+    alphaU16.size = 2;
+    alphaU16.opaqueValue[0] = 0xFF;
+    alphaU16.opaqueValue[1] = 0xFF;
+
+    KisTileSP tile = dm->getTile(0, 0, false);
+
+    // the flags cached for one descriptor are not reused for another one
+    QCOMPARE(Flags(int(tile->contentFlags(alphaF16))), Flags(Uniform | Opaque));
+    QCOMPARE(Flags(int(tile->contentFlags(alphaU16))), Flags(Uniform));
+    QCOMPARE(Flags(int(tile->contentFlags(alphaF16))), Flags(Uniform | Opaque));
+}
+
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
 #include <boost/accumulators/statistics/variance.hpp>
@@ -2266,4 +2443,102 @@ void KisPaintDeviceTest::testCompositionAssociativity()
     }
 }
 
+class TestLazyLoader : public KisPaintDeviceLazyLoader
+{
+public:
+    TestLazyLoader(KisPaintDeviceSP src, const QRect &rc, QAtomicInt *loadCount, int delay = 0)
+        : m_rect(rc),
+          m_loadCount(loadCount),
+          m_delay(delay)
+    {
+        m_data.resize(rc.width() * rc.height() * src->pixelSize());
+        src->readBytes(reinterpret_cast<quint8*>(m_data.data()), rc);
+    }
+
+    bool load(KisPaintDevice *device) override {
+        m_loadCount->ref();
+        QTest::qSleep(m_delay);
+
+        device->writeBytes(reinterpret_cast<const quint8*>(m_data.constData()), m_rect);
+        return true;
+    }
+
+private:
+    QByteArray m_data;
+    QRect m_rect;
+    QAtomicInt *m_loadCount;
+    int m_delay;
+};
+
+void KisPaintDeviceTest::testLazyLoading()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect fillRect(10, 20, 100, 150);
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    src->fill(fillRect, KoColor(Qt::red, cs));
+
+    QAtomicInt loadCount;
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->setLazyLoader(new TestLazyLoader(src, fillRect, &loadCount));
+    QVERIFY(!dev->isMaterialized());
+
+    // neither the color space nor the profile need the data
+    QCOMPARE(dev->colorSpace(), cs);
+    QVERIFY(dev->setProfile(cs->profile()));
+    QVERIFY(!dev->isMaterialized());
+    QCOMPARE(int(loadCount), 0);
+
+    QCOMPARE(dev->exactBounds(), fillRect);
+    QVERIFY(dev->isMaterialized());
+    QCOMPARE(int(loadCount), 1);
+
+    QPoint pt;
+    QVERIFY(TestUtil::comparePaintDevices(pt, src, dev));
+
+    // a copy of a lazy device gets the loaded data
+    KisPaintDeviceSP lazyDev = new KisPaintDevice(cs);
+    lazyDev->setLazyLoader(new TestLazyLoader(src, fillRect, &loadCount));
+
+    KisPaintDeviceSP copy = new KisPaintDevice(*lazyDev);
+    QVERIFY(lazyDev->isMaterialized());
+    QVERIFY(copy->isMaterialized());
+    QCOMPARE(int(loadCount), 2);
+    QVERIFY(TestUtil::comparePaintDevices(pt, src, copy));
+
+    // a device destroyed before loading just drops the loader
+    KisPaintDeviceSP unusedDev = new KisPaintDevice(cs);
+    unusedDev->setLazyLoader(new TestLazyLoader(src, fillRect, &loadCount));
+    unusedDev = 0;
+    QCOMPARE(int(loadCount), 2);
+}
+
+void KisPaintDeviceTest::testLazyLoadingConcurrentAccess()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect fillRect(0, 0, 500, 500);
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    src->fill(fillRect, KoColor(Qt::green, cs));
+
+    QAtomicInt loadCount;
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->setLazyLoader(new TestLazyLoader(src, fillRect, &loadCount, 100));
+
+    QVector<QRect> results(8);
+
+    QtConcurrent::blockingMap(results,
+        [dev] (QRect &rc) {
+            rc = dev->exactBounds();
+        });
+
+    QCOMPARE(int(loadCount), 1);
+
+    Q_FOREACH (const QRect &rc, results) {
+        QCOMPARE(rc, fillRect);
+    }
+}
+
 QTEST_MAIN(KisPaintDeviceTest)
@@ -52,6 +52,9 @@ private Q_SLOTS:
     void testAmortizedExactBounds();
     void testNonDefaultPixelArea();
     void testExactBoundsNonTransparent();
+    void testExactBoundsTileCache();
+    void benchmarkExactBoundsSparse();
+    void benchmarkExactBoundsSparseAfterChange();
 
     void testReadBytesWrapAround();
     void testWrappedRandomAccessor();
@@ -78,6 +81,12 @@ private Q_SLOTS:
     void testLazyFrameCreation();
     void testCopyPaintDeviceWithFrames();
 
+    void testLazyLoading();
+    void testLazyLoadingConcurrentAccess();
+
+    void testTileContentFlags();
+    void testTileContentFlagsAlphaDescriptor();
+
     void testCompositionAssociativity();
 };
 
@@ -479,6 +479,81 @@ void KisPainterTest::testBitBltOldData()
     srcGc.deleteTransaction();
 }
 
+static void fillWithNoise(KisPaintDeviceSP dev, const QRect &rc, bool randomAlpha)
+{
+    const int pixelSize = dev->pixelSize();
+    QVector<quint8> bytes(rc.width() * rc.height() * pixelSize);
+
+    for (int i = 0; i < bytes.size(); i++) {
+        bytes[i] = qrand() & 0xff;
+    }
+
+    if (!randomAlpha) {
+        dev->colorSpace()->setOpacity(bytes.data(), OPACITY_OPAQUE_U8, rc.width() * rc.height());
+    }
+
+    dev->writeBytes(bytes.data(), rc);
+}
+
+void KisPainterTest::testBitBltContentFlags()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const int pixelSize = cs->pixelSize();
+    const QRect rc(0, 0, 320, 64);
+
+    /**
+     * Every tile of the source takes its own path in bitBlt: a transparent
+     * one, an opaque uniform one, a semi-transparent uniform one, an opaque
+     * noise and a generic noise
+     */
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+
+    KoColor transparent(Qt::blue, cs);
+    transparent.setOpacity(OPACITY_TRANSPARENT_U8);
+    KoColor semiTransparent(Qt::green, cs);
+    semiTransparent.setOpacity(quint8(100));
+
+    src->fill(QRect(0, 0, 64, 64), transparent);
+    src->fill(QRect(64, 0, 64, 64), KoColor(Qt::red, cs));
+    src->fill(QRect(128, 0, 64, 64), semiTransparent);
+    fillWithNoise(src, QRect(192, 0, 64, 64), false);
+    fillWithNoise(src, QRect(256, 0, 64, 64), true);
+
+    QVector<quint8> srcBytes(rc.width() * rc.height() * pixelSize);
+    src->readBytes(srcBytes.data(), rc);
+
+    const QStringList compositeOps({COMPOSITE_OVER, COMPOSITE_MULT});
+    const QVector<quint8> opacities({OPACITY_OPAQUE_U8, 128});
+
+    Q_FOREACH (const QString &compositeOp, compositeOps) {
+        Q_FOREACH (quint8 opacity, opacities) {
+            KisPaintDeviceSP dst = new KisPaintDevice(cs);
+            fillWithNoise(dst, rc, true);
+
+            QVector<quint8> expectedBytes(srcBytes.size());
+            dst->readBytes(expectedBytes.data(), rc);
+
+            cs->compositeOp(compositeOp)->composite(expectedBytes.data(), rc.width() * pixelSize,
+                                                    srcBytes.constData(), rc.width() * pixelSize,
+                                                    0, 0,
+                                                    rc.height(), rc.width(),
+                                                    opacity);
+
+            KisPainter gc(dst);
+            gc.setCompositeOp(compositeOp);
+            gc.setOpacity(opacity);
+            gc.bitBlt(rc.topLeft(), src, rc);
+            gc.end();
+
+            QVector<quint8> resultBytes(srcBytes.size());
+            dst->readBytes(resultBytes.data(), rc);
+
+            QVERIFY2(resultBytes == expectedBytes,
+                     qPrintable(QString("Failed for op %1 opacity %2").arg(compositeOp).arg(opacity)));
+        }
+    }
+}
+
 void KisPainterTest::benchmarkBitBlt()
 {
     quint8 p = 128;
@@ -795,6 +870,122 @@ void KisPainterTest::benchmarkMassiveBltFixed()
     }
 }
 
+#include <QPainterPath>
+#include "KisFakeRunnableStrokeJobsExecutor.h"
+
+void KisPainterTest::testFillPainterPathCoverage_data()
+{
+    QTest::addColumn<QPainterPath>("path");
+    QTest::addColumn<QRect>("requestedRect");
+    QTest::addColumn<bool>("useSelection");
+    QTest::addColumn<bool>("useJobsInterface");
+    QTest::addColumn<QPoint>("deviceOffset");
+
+    QPainterPath ellipse;
+    ellipse.addEllipse(QPointF(40.3, 37.7), 30.2, 20.6);
+
+    QPainterPath star;
+    star.setFillRule(Qt::OddEvenFill);
+    for (int i = 0; i < 5; i++) {
+        const qreal angle = 2 * M_PI * 2 * i / 5;
+        const QPointF pt(100.5 + 90.3 * cos(angle), 100.5 + 90.3 * sin(angle));
+        if (!i) {
+            star.moveTo(pt);
+        } else {
+            star.lineTo(pt);
+        }
+    }
+    star.closeSubpath();
+
+    // crosses several bands and the negative coordinates
+    QPainterPath lasso;
+    lasso.moveTo(-70.2, -30.5);
+    lasso.cubicTo(QPointF(400.1, -100.0), QPointF(250.0, 500.3), QPointF(300.7, 320.2));
+    lasso.lineTo(-10.3, 280.8);
+    lasso.closeSubpath();
+    lasso.addRect(QRectF(20.5, 20.5, 40.0, 40.0));
+
+    QTest::newRow("ellipse") << ellipse << QRect() << false << false << QPoint();
+    QTest::newRow("star") << star << QRect() << false << false << QPoint();
+    QTest::newRow("lasso") << lasso << QRect() << false << false << QPoint();
+    QTest::newRow("lasso-requested") << lasso << QRect(10, 15, 200, 150) << false << false << QPoint();
+    QTest::newRow("lasso-selection") << lasso << QRect() << true << false << QPoint();
+    QTest::newRow("lasso-jobs") << lasso << QRect() << true << true << QPoint();
+    QTest::newRow("lasso-jobs-offset") << lasso << QRect() << false << true << QPoint(13, -7);
+}
+
+void KisPainterTest::testFillPainterPathCoverage()
+{
+    QFETCH(QPainterPath, path);
+    QFETCH(QRect, requestedRect);
+    QFETCH(bool, useSelection);
+    QFETCH(bool, useJobsInterface);
+    QFETCH(QPoint, deviceOffset);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect = path.boundingRect().toAlignedRect().adjusted(-10, -10, 10, 10);
+
+    KisSelectionSP selection;
+    if (useSelection) {
+        selection = new KisSelection();
+        selection->pixelSelection()->select(QRect(0, 0, 150, 150), 200);
+    }
+
+    KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    // the bands should follow the tiles of the moved device
+    refDev->moveTo(deviceOffset);
+    dev->moveTo(deviceOffset);
+
+    fillWithNoise(refDev, imageRect, true);
+    dev->makeCloneFrom(refDev, imageRect);
+
+    auto fillPath =
+        [&] (KisPaintDeviceSP device, bool useCoverageRasterizer) {
+            KisFakeRunnableStrokeJobsExecutor executor;
+
+            KisPainter gc(device, selection);
+            if (useJobsInterface) {
+                gc.setRunnableStrokeJobsInterface(&executor);
+            }
+            gc.setUseCoverageRasterizer(useCoverageRasterizer);
+            gc.setFillStyle(KisPainter::FillStyleForegroundColor);
+            gc.setPaintColor(KoColor(Qt::red, cs));
+            gc.setOpacity(200);
+            gc.fillPainterPath(path, requestedRect);
+
+            QRect dirtyRect;
+            Q_FOREACH (const QRect &rc, gc.takeDirtyRegion()) {
+                dirtyRect |= rc;
+            }
+            return dirtyRect;
+        };
+
+    fillPath(refDev, false);
+    const QRect dirtyRect = fillPath(dev, true);
+
+    QRect expectedDirtyRect = path.boundingRect().toAlignedRect().adjusted(-1, -1, 1, 1);
+    if (requestedRect.isValid()) {
+        expectedDirtyRect &= requestedRect;
+    }
+    QVERIFY(expectedDirtyRect.contains(dirtyRect));
+
+    QImage refImage = refDev->convertToQImage(0, imageRect);
+    QImage image = dev->convertToQImage(0, imageRect);
+
+    /**
+     * The rasterizers round the coverage differently, and the even-odd
+     * rule is resolved approximately in the pixels where the edges cross
+     */
+    QPoint pt;
+    if (!TestUtil::compareQImages(pt, refImage, image, 2, 2, 8)) {
+        refImage.save(QString("fill_path_%1_ref.png").arg(QTest::currentDataTag()));
+        image.save(QString("fill_path_%1_coverage.png").arg(QTest::currentDataTag()));
+        QFAIL(QString("Images do not coincide at point %1, %2").arg(pt.x()).arg(pt.y()).toLatin1());
+    }
+}
+
 QTEST_MAIN(KisPainterTest)
 
 
@@ -51,6 +51,7 @@ private Q_SLOTS:
     void testSelectionBitBltEraseCompositeOp();
 
     void testBitBltOldData();
+    void testBitBltContentFlags();
     void benchmarkBitBlt();
     void benchmarkBitBltOldData();
 
@@ -64,6 +65,9 @@ private Q_SLOTS:
     void testMassiveBltFixedCornerCases();
 
     void benchmarkMassiveBltFixed();
+
+    void testFillPainterPathCoverage_data();
+    void testFillPainterPathCoverage();
 };
 
 #endif
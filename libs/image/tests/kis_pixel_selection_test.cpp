@@ -19,6 +19,9 @@
 #include "kis_pixel_selection_test.h"
 #include <QTest>
 
+#include <algorithm>
+#include <tuple>
+
 
 #include <kis_debug.h>
 #include <QRect>
@@ -378,5 +381,117 @@ void KisPixelSelectionTest::testOutlineCacheTransactions()
     }
 }
 
+/**
+ * Splits the outline into unit edges, so that the outlines can be
+ * compared regardless of how the edges are chained into polylines
+ */
+static QVector<QLine> outlineEdges(const QPainterPath &path)
+{
+    QVector<QLine> edges;
+
+    Q_FOREACH (const QPolygonF &polygon, path.toSubpathPolygons()) {
+        for (int i = 1; i < polygon.size(); i++) {
+            const QPoint p0 = polygon[i - 1].toPoint();
+            const QPoint p1 = polygon[i].toPoint();
+            const QPoint step((p1.x() > p0.x()) - (p1.x() < p0.x()),
+                              (p1.y() > p0.y()) - (p1.y() < p0.y()));
+
+            for (QPoint pt = p0; pt != p1; pt += step) {
+                const QPoint next = pt + step;
+                edges.append(pt.x() < next.x() || pt.y() < next.y() ?
+                             QLine(pt, next) : QLine(next, pt));
+            }
+        }
+    }
+
+    std::sort(edges.begin(), edges.end(),
+              [] (const QLine &a, const QLine &b) {
+                  return std::make_tuple(a.x1(), a.y1(), a.x2(), a.y2()) <
+                      std::make_tuple(b.x1(), b.y1(), b.x2(), b.y2());
+              });
+
+    return edges;
+}
+
+static QVector<QLine> referenceOutlineEdges(KisPixelSelectionSP psel)
+{
+    KisOutlineTileCache cache;
+    cache.update(psel.data(), psel->selectedExactRect());
+    return outlineEdges(cache.outline());
+}
+
+void KisPixelSelectionTest::testOutlineTileCache()
+{
+    KisPixelSelectionSP psel = new KisPixelSelection();
+    QVERIFY(psel->outlineTileCacheValid());
+
+    psel->select(QRect(10,10,300,200), MAX_SELECTED);
+    QVERIFY(!psel->outlineTileCacheValid());
+
+    psel->recalculateOutlineTileCache();
+    QVERIFY(psel->outlineTileCacheValid());
+    QCOMPARE(psel->outlineTileCache().outline().boundingRect(), QRectF(10,10,300,200));
+
+    KisOutlineTileCache cache;
+
+    // the right and the bottom edges belong to the next cells: 5x4 cells
+    QCOMPARE(cache.update(psel.data(), psel->selectedExactRect()), 20);
+    QCOMPARE(cache.numCells(), 20);
+    QCOMPARE(cache.outline().boundingRect(), QRectF(10,10,300,200));
+
+    // the segments of all the cells are stitched into a single closed polyline
+    QList<QPolygonF> polygons = cache.outline().toSubpathPolygons();
+    QCOMPARE(polygons.size(), 1);
+    QCOMPARE(polygons.first().size(), 5);
+    QCOMPARE(polygons.first().first(), polygons.first().last());
+
+    // nothing has changed
+    QCOMPARE(cache.update(psel.data(), psel->selectedExactRect()), 0);
+
+    // a hole inside a single cell, only the invalidated cell is read
+    psel->clear(QRect(150,100,10,10));
+    cache.invalidate(psel.data(), QRect(150,100,10,10));
+    QCOMPARE(cache.update(psel.data(), psel->selectedExactRect()), 1);
+    QCOMPARE(cache.outline().toSubpathPolygons().size(), 2);
+    QCOMPARE(outlineEdges(cache.outline()), referenceOutlineEdges(psel));
+
+    // a hole crossing the borders of four cells is stitched with the outer ones
+    psel->clear(QRect(120,120,20,20));
+    cache.invalidate(psel.data(), QRect(120,120,20,20));
+    QCOMPARE(cache.update(psel.data(), psel->selectedExactRect()), 4);
+    QCOMPARE(cache.outline().toSubpathPolygons().size(), 3);
+    QCOMPARE(outlineEdges(cache.outline()), referenceOutlineEdges(psel));
+
+    // growing the selection regenerates only the cells around the new area
+    psel->select(QRect(300,150,60,100), MAX_SELECTED);
+    cache.invalidate(psel.data(), QRect(300,150,60,100));
+    QVERIFY(cache.update(psel.data(), psel->selectedExactRect()) < cache.numCells());
+    QCOMPARE(outlineEdges(cache.outline()), referenceOutlineEdges(psel));
+
+    // a full invalidation rereads the cells, but keeps the unchanged ones
+    cache.invalidate();
+    QCOMPARE(cache.update(psel.data(), psel->selectedExactRect()), 0);
+
+    // the outline is clipped to the rect
+    QCOMPARE(cache.outline(QRect(0,0,64,64)).boundingRect(), QRectF(10,10,54,54));
+    QVERIFY(cache.outline(QRect(400,400,64,64)).isEmpty());
+
+    // with a dash period the clipped parts start in phase with the whole polyline
+    const QRectF dashedRect = cache.outline(QRect(100,0,64,64), 8.0).boundingRect();
+    QVERIFY(dashedRect.contains(cache.outline(QRect(100,0,64,64)).boundingRect()));
+    QVERIFY(QRectF(10,10,351,241).contains(dashedRect));
+
+    // moving the device doesn't change the cells' content
+    const QPoint oldOffset(psel->x(), psel->y());
+    psel->moveTo(QPoint(5,7));
+    QCOMPARE(cache.update(psel.data(), psel->selectedExactRect()), 0);
+    QCOMPARE(cache.outline().boundingRect(),
+             QRectF(10,10,350,240).translated(QPoint(5,7) - oldOffset));
+
+    psel->clear();
+    QVERIFY(psel->outlineTileCacheValid());
+    QVERIFY(psel->outlineTileCache().isEmpty());
+}
+
 QTEST_MAIN(KisPixelSelectionTest)
 
@@ -24,12 +24,16 @@
 #include <floodfill/kis_scanline_fill.h>
 #include <floodfill/kis_fill_interval.h>
 #include <floodfill/kis_fill_interval_map.h>
+#include <floodfill/kis_tile_parallel_fill.h>
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include "kis_types.h"
+#include "kis_global.h"
 #include "kis_paint_device.h"
+#include "kis_pixel_selection.h"
+#include "kis_random_accessor_ng.h"
 
 
 void KisScanlineFillTest::testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
@@ -295,4 +299,148 @@ void KisScanlineFillTest::testExternalFill()
     QCOMPARE(c, QColor(Qt::blue));
 }
 
+KisPaintDeviceSP createFillTestDevice(const QRect &rc, int seed)
+{
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    const QVector<KoColor> palette({
+        KoColor(QColor(200, 200, 200), dev->colorSpace()),
+        KoColor(QColor(190, 210, 200), dev->colorSpace()),
+        KoColor(QColor(20, 20, 20), dev->colorSpace()),
+        KoColor(QColor(100, 0, 0), dev->colorSpace())});
+
+    const int pixelSize = dev->pixelSize();
+
+    qsrand(seed);
+
+    KisRandomAccessorSP it = dev->createRandomAccessorNG(rc.x(), rc.y());
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        for (int x = rc.left(); x <= rc.right(); x++) {
+            const int index = qrand() % 100 < 70 ? 0 : qrand() % palette.size();
+
+            it->moveTo(x, y);
+            memcpy(it->rawData(), palette[index].data(), pixelSize);
+        }
+    }
+
+    // a few uniform tiles
+    dev->fill(QRect(rc.x() + 130, rc.y() + 70, 150, 140), palette[0]);
+
+    return dev;
+}
+
+void KisScanlineFillTest::testTileParallelFill_data()
+{
+    QTest::addColumn<QPoint>("deviceOffset");
+    QTest::addColumn<QRect>("boundingRect");
+    QTest::addColumn<QPoint>("startPoint");
+    QTest::addColumn<int>("threshold");
+
+    QTest::newRow("plain") << QPoint() << QRect(0, 0, 400, 300) << QPoint(150, 100) << 0;
+    QTest::newRow("threshold") << QPoint() << QRect(0, 0, 400, 300) << QPoint(150, 100) << 30;
+    QTest::newRow("offset") << QPoint(13, -7) << QRect(0, 0, 400, 300) << QPoint(150, 100) << 30;
+    QTest::newRow("clipped") << QPoint(5, 5) << QRect(37, 21, 250, 190) << QPoint(150, 100) << 30;
+    QTest::newRow("outside-of-data") << QPoint() << QRect(-100, -100, 600, 500) << QPoint(-50, -50) << 0;
+}
+
+void KisScanlineFillTest::testTileParallelFill()
+{
+    QFETCH(QPoint, deviceOffset);
+    QFETCH(QRect, boundingRect);
+    QFETCH(QPoint, startPoint);
+    QFETCH(int, threshold);
+
+    const QRect imageRect(0, 0, 400, 300);
+
+    KisPaintDeviceSP dev = createFillTestDevice(imageRect, 1);
+    dev->setX(deviceOffset.x());
+    dev->setY(deviceOffset.y());
+
+    const QRect checkRect = kisGrowRect(boundingRect | imageRect.translated(deviceOffset), 10);
+
+    KisTileParallelFill::clearCache();
+
+    // selection
+    KisPixelSelectionSP refSelection = new KisPixelSelection();
+    KisPixelSelectionSP selection = new KisPixelSelection();
+
+    {
+        KisScanlineFill fill(dev, startPoint, boundingRect);
+        fill.setThreshold(threshold);
+        fill.setUseTileParallelFill(false);
+        fill.fillSelection(refSelection);
+    }
+
+    {
+        KisScanlineFill fill(dev, startPoint, boundingRect);
+        fill.setThreshold(threshold);
+        QVERIFY(fill.useTileParallelFill());
+        fill.fillSelection(selection);
+    }
+
+    QVERIFY(!refSelection->exactBounds().isEmpty());
+    QCOMPARE(selection->convertToQImage(0, checkRect),
+             refSelection->convertToQImage(0, checkRect));
+
+    // in-place color fill, the masks are taken from the cache
+    KisPaintDeviceSP refDev = new KisPaintDevice(*dev);
+    const KoColor fillColor(Qt::blue, dev->colorSpace());
+
+    {
+        KisScanlineFill fill(refDev, startPoint, boundingRect);
+        fill.setThreshold(threshold);
+        fill.setUseTileParallelFill(false);
+        fill.fillColor(fillColor);
+    }
+
+    {
+        KisScanlineFill fill(dev, startPoint, boundingRect);
+        fill.setThreshold(threshold);
+        fill.fillColor(fillColor);
+    }
+
+    QCOMPARE(dev->convertToQImage(0, checkRect),
+             refDev->convertToQImage(0, checkRect));
+}
+
+void KisScanlineFillTest::testTileParallelFillCache()
+{
+    const QRect imageRect(0, 0, 400, 300);
+    const int threshold = 10;
+
+    KisPaintDeviceSP dev = createFillTestDevice(imageRect, 2);
+
+    KisTileParallelFill::clearCache();
+
+    auto checkFill = [&] (const QPoint &startPoint) {
+        KisPixelSelectionSP refSelection = new KisPixelSelection();
+        KisPixelSelectionSP selection = new KisPixelSelection();
+
+        KisScanlineFill refFill(dev, startPoint, imageRect);
+        refFill.setThreshold(threshold);
+        refFill.setUseTileParallelFill(false);
+        refFill.fillSelection(refSelection);
+
+        KisScanlineFill fill(dev, startPoint, imageRect);
+        fill.setThreshold(threshold);
+        fill.fillSelection(selection);
+
+        return selection->convertToQImage(0, imageRect) ==
+            refSelection->convertToQImage(0, imageRect);
+    };
+
+    QVERIFY(checkFill(QPoint(150, 100)));
+
+    // cut the uniform area with a wall, the changed tiles must be recalculated
+    dev->fill(QRect(200, 0, 3, 300), KoColor(Qt::black, dev->colorSpace()));
+    QVERIFY(checkFill(QPoint(150, 100)));
+
+    // the same reference color, but the other side of the wall
+    QVERIFY(checkFill(QPoint(250, 100)));
+
+    // a hole in the wall
+    dev->fill(QRect(200, 150, 3, 3), KoColor(QColor(200, 200, 200), dev->colorSpace()));
+    QVERIFY(checkFill(QPoint(250, 100)));
+}
+
 QTEST_MAIN(KisScanlineFillTest)
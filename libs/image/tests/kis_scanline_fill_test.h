@@ -39,6 +39,10 @@ private Q_SLOTS:
     void testClearNonZeroComponent();
     void testExternalFill();
 
+    void testTileParallelFill_data();
+    void testTileParallelFill();
+    void testTileParallelFillCache();
+
 private:
     void testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
                          const QVector<QColor> &expectedResult,
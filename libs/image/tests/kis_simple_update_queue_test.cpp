@@ -240,6 +240,70 @@ void KisSimpleUpdateQueueTest::testMixingTypes()
     QCOMPARE(walkersList[2]->type(), KisBaseRectsWalker::UPDATE_NO_FILTHY);
 }
 
+void KisSimpleUpdateQueueTest::testMergeManyLayers()
+{
+    QRect imageRect(0,0,1024,1024);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    const int numLayers = 20;
+    QVector<KisPaintLayerSP> layers;
+
+    image->lock();
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP paintLayer = new KisPaintLayer(image, QString("paint%1").arg(i), OPACITY_OPAQUE_U8);
+        image->addNode(paintLayer);
+        layers << paintLayer;
+    }
+    image->unlock();
+
+    KisTestableSimpleUpdateQueue queue;
+    KisWalkersList& walkersList = queue.getWalkersList();
+
+    // the rects of different layers are never merged
+    for (int i = 0; i < numLayers; i++) {
+        queue.addUpdateJob(layers[i], QRect(0,0,100,100), imageRect, 0);
+    }
+
+    // the rects lying in different cells of the patch grid
+    queue.addUpdateJob(layers[0], QRect(500,600,20,20), imageRect, 0);
+    queue.addUpdateJob(layers[0], QRect(900,900,20,20), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), numLayers + 2);
+
+    for (int i = 0; i < numLayers; i++) {
+        queue.addUpdateJob(layers[i], QRect(10,0,100,100), imageRect, 0);
+    }
+    queue.addUpdateJob(layers[0], QRect(515,600,20,20), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), numLayers + 2);
+
+    for (int i = 0; i < numLayers; i++) {
+        QVERIFY(checkWalker(walkersList[i], QRect(0,0,110,100)));
+        QCOMPARE(walkersList[i]->startNode(), KisNodeSP(layers[i]));
+    }
+
+    QVERIFY(checkWalker(walkersList[numLayers], QRect(500,600,35,20)));
+    QVERIFY(checkWalker(walkersList[numLayers + 1], QRect(900,900,20,20)));
+
+    // the merged walker can still be found at its new position
+    queue.addUpdateJob(layers[0], QRect(505,600,30,20), imageRect, 0);
+    QCOMPARE(walkersList.size(), numLayers + 2);
+    QVERIFY(checkWalker(walkersList[numLayers], QRect(500,600,35,20)));
+
+    KisTestableUpdaterContext context(1);
+    queue.processQueue(context);
+
+    QVERIFY(checkWalker(context.getJobs()[0]->walker(), QRect(0,0,110,100)));
+    QCOMPARE(walkersList.size(), numLayers + 1);
+
+    // the processed walker has left the index, so nothing is merged into it
+    queue.addUpdateJob(layers[0], QRect(10,0,100,100), imageRect, 0);
+    QCOMPARE(walkersList.size(), numLayers + 2);
+    QVERIFY(checkWalker(walkersList.last(), QRect(10,0,100,100)));
+}
+
 void KisSimpleUpdateQueueTest::testSpontaneousJobsCompression()
 {
     KisTestableSimpleUpdateQueue queue;
@@ -35,6 +35,7 @@ private Q_SLOTS:
     void testSplitFullRefresh();
     void testChecksum();
     void testMixingTypes();
+    void testMergeManyLayers();
     void testSpontaneousJobsCompression();
 };
 
@@ -59,6 +59,13 @@ private:
     }
 
     inline void unlockTile(KisTileSP &tile) {
+        if (m_writable)
+            tile->unlockForWrite();
+        else
+            tile->unlock();
+    }
+
+    inline void unlockOldTile(KisTileSP &tile) {
         tile->unlock();
     }
 
@@ -80,6 +87,7 @@ public:
     qint32 numContiguousColumns(qint32 x) const override;
     qint32 numContiguousRows(qint32 y) const override;
     qint32 rowStride(qint32 x, qint32 y) const override;
+    KisTileContent::Flags tileContentFlags(const KisTileContent::AlphaDescriptor &alpha) const override;
     qint32 x() const override;
     qint32 y() const override;
 
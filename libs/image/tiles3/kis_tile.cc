@@ -199,6 +199,8 @@ void KisTile::lockForWrite()
         m_COWMutex.unlock();
     }
 
+    m_tileData->markContentChanged();
+
     DEBUG_LOG_ACTION("lock [W]");
 }
 
@@ -208,6 +210,39 @@ void KisTile::unlock() const
     DEBUG_LOG_ACTION("unlock");
 }
 
+void KisTile::unlockForWrite()
+{
+    m_tileData->markContentChanged();
+    unlock();
+}
+
+bool KisTile::shareTileData(KisTileData *td, KisTileData *expectedData, qint32 expectedRevision)
+{
+    QMutexLocker locker(&m_swapBarrierLock);
+
+    /**
+     * A locked tile may be in the middle of copy-on-write, so
+     * we never touch it. The writers lock the tile before
+     * changing anything, so it is safe to check the data
+     * under the barrier.
+     */
+    if (m_lockCounter > 0 ||
+        m_tileData != expectedData ||
+        m_tileData->contentRevision() != expectedRevision) {
+
+        return false;
+    }
+
+    if (m_tileData == td) return true;
+
+    td->acquire();
+    KisTileData *oldTileData = m_tileData;
+    m_tileData = td;
+    oldTileData->release();
+
+    return true;
+}
+
 
 #include <stdio.h>
 void KisTile::debugPrintInfo()
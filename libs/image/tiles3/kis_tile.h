@@ -75,6 +75,25 @@ public:
     void lockForWrite();
     void unlock() const;
 
+    /**
+     * Unlocks the tile locked with lockForWrite() and notifies
+     * the tile data that its content has changed
+     */
+    void unlockForWrite();
+
+    /**
+     * Replaces the data of the tile with \p td, which must have
+     * exactly the same content. Used for sharing the data of
+     * uniform tiles. The data is replaced only when nobody has
+     * the tile locked and it is still \p expectedData with
+     * \p expectedRevision of the content, otherwise the call is
+     * a noop. The memento manager is not notified, since the
+     * content of the tile doesn't change.
+     *
+     * \return true if the data has been replaced
+     */
+    bool shareTileData(KisTileData *td, KisTileData *expectedData, qint32 expectedRevision);
+
     /* this allows us work directly on tile's data */
     inline quint8 *data() const {
         return m_tileData->data();
@@ -83,6 +102,14 @@ public:
         m_tileData->setData(data);
     }
 
+    /**
+     * Returns KisTileContent flags of the tile. The tile
+     * should be locked by the caller.
+     */
+    inline quint32 contentFlags(const KisTileContent::AlphaDescriptor &alpha) const {
+        return m_tileData->contentFlags(alpha);
+    }
+
     inline qint32 row() const {
         return m_row;
     }
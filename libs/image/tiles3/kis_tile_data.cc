@@ -22,6 +22,7 @@
 
 #include <kis_debug.h>
 
+#include <atomic>
 #include <boost/pool/singleton_pool.hpp>
 #include "kis_tile_data_store_iterators.h"
 
@@ -35,6 +36,14 @@ typedef boost::singleton_pool<KisTileData, TILE_SIZE_8BPP, boost::default_user_a
 const qint32 KisTileData::WIDTH = __TILE_DATA_WIDTH;
 const qint32 KisTileData::HEIGHT = __TILE_DATA_HEIGHT;
 
+namespace {
+std::atomic<quint64> s_lastSerialNumber(0);
+
+inline quint64 nextSerialNumber() {
+    return ++s_lastSerialNumber;
+}
+}
+
 
 KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store)
     : m_state(NORMAL),
@@ -43,7 +52,12 @@ KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataSt
       m_usersCount(0),
       m_refCount(0),
       m_pixelSize(pixelSize),
-      m_store(store)
+      m_store(store),
+      m_contentRevision(0),
+      m_contentFlagsCalculated(false),
+      m_contentFlagsRevision(0),
+      m_cachedContentFlags(0),
+      m_serialNumber(nextSerialNumber())
 {
     m_store->checkFreeMemory();
     m_data = allocateData(m_pixelSize);
@@ -70,7 +84,12 @@ KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
       m_usersCount(0),
       m_refCount(0),
       m_pixelSize(rhs.m_pixelSize),
-      m_store(rhs.m_store)
+      m_store(rhs.m_store),
+      m_contentRevision(0),
+      m_contentFlagsCalculated(false),
+      m_contentFlagsRevision(0),
+      m_cachedContentFlags(0),
+      m_serialNumber(nextSerialNumber())
 {
     if(checkFreeMemory) {
         m_store->checkFreeMemory();
@@ -86,6 +105,36 @@ KisTileData::~KisTileData()
     releaseMemory();
 }
 
+quint32 KisTileData::contentFlags(const KisTileContent::AlphaDescriptor &alpha) const
+{
+    /**
+     * The revision is read before the data, so if a writer changes the
+     * data while we are calculating the flags, the revision will have
+     * changed by the time it unlocks the tile and our result will be
+     * ignored by the next request.
+     */
+    const qint32 revision = m_contentRevision.loadAcquire();
+
+    QMutexLocker l(&m_contentFlagsLock);
+
+    if (m_contentFlagsCalculated &&
+        m_contentFlagsRevision == revision &&
+        m_contentFlagsAlpha == alpha) {
+
+        return m_cachedContentFlags;
+    }
+
+    Q_ASSERT(m_data);
+    const quint32 flags = KisTileContent::calculateFlags(m_data, WIDTH * HEIGHT, m_pixelSize, alpha);
+
+    m_contentFlagsCalculated = true;
+    m_contentFlagsRevision = revision;
+    m_contentFlagsAlpha = alpha;
+    m_cachedContentFlags = flags;
+
+    return flags;
+}
+
 void KisTileData::fillWithPixel(const quint8 *defPixel)
 {
     quint8 *it = m_data;
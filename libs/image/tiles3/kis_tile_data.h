@@ -38,6 +38,19 @@ inline quint8* KisTileData::data() const {
 void KisTileData::setData(const quint8 *data) {
     Q_ASSERT(m_data);
     memcpy(m_data, data, m_pixelSize*WIDTH*HEIGHT);
+    markContentChanged();
+}
+
+inline void KisTileData::markContentChanged() {
+    m_contentRevision.ref();
+}
+
+inline qint32 KisTileData::contentRevision() const {
+    return m_contentRevision.loadAcquire();
+}
+
+inline quint64 KisTileData::serialNumber() const {
+    return m_serialNumber;
 }
 
 inline quint32 KisTileData::pixelSize() const {
@@ -19,10 +19,12 @@
 #define KIS_TILE_DATA_INTERFACE_H_
 
 #include <QReadWriteLock>
+#include <QMutex>
 #include <QAtomicInt>
 
 #include "kis_lockless_stack.h"
 #include "swap/kis_chunk_allocator.h"
+#include "kis_tile_content_flags.h"
 
 class KisTileData;
 class KisTileDataStore;
@@ -68,6 +70,39 @@ public:
     inline void setData(const quint8 *data);
     inline quint32 pixelSize() const;
 
+    /**
+     * Returns KisTileContent flags of the data. The flags are
+     * calculated on the first request and are cached until the
+     * content of the tile changes.
+     *
+     * The caller must ensure the data is not swapped out,
+     * that is, the tile should be locked.
+     */
+    quint32 contentFlags(const KisTileContent::AlphaDescriptor &alpha) const;
+
+    /**
+     * Invalidates the cached content flags. Called by KisTile
+     * when the tile is locked and unlocked for writing, so the
+     * flags calculated in the middle of the write are dropped
+     * as well.
+     */
+    inline void markContentChanged();
+
+    /**
+     * Returns the number of times the content has been marked as
+     * changed. Two equal values mean the data has not been written
+     * in between.
+     */
+    inline qint32 contentRevision() const;
+
+    /**
+     * Returns a number unique for every tile data object ever
+     * created. Together with contentRevision() it identifies
+     * the content of the tile, even if the object is freed and
+     * another one is allocated at the same address.
+     */
+    inline quint64 serialNumber() const;
+
     /**
      * Increments usersCount of a TD and refs shared pointer counter
      * Used by KisTile for COW
@@ -264,6 +299,23 @@ private:
     //qint32 m_timeStamp;
 
     KisTileDataStore *m_store;
+
+    /**
+     * Incremented on every change of the data. The cached content
+     * flags are valid only for the revision and the alpha descriptor
+     * they were calculated for: the same data may be shared by the
+     * devices of different color spaces with equal pixel size.
+     */
+    QAtomicInt m_contentRevision;
+
+    mutable QMutex m_contentFlagsLock;
+    mutable bool m_contentFlagsCalculated;
+    mutable qint32 m_contentFlagsRevision;
+    mutable quint32 m_cachedContentFlags;
+    mutable KisTileContent::AlphaDescriptor m_contentFlagsAlpha;
+
+    const quint64 m_serialNumber;
+
 public:
     static const qint32 WIDTH;
     static const qint32 HEIGHT;
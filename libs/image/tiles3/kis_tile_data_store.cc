@@ -29,6 +29,13 @@
 
 Q_GLOBAL_STATIC(KisTileDataStore, s_instance)
 
+/**
+ * The number of colors the store can share at the same time. Every
+ * shared color keeps one tile data alive, even if all its tiles are gone,
+ * until a new color pushes it out.
+ */
+const int MAX_UNIFORM_TILE_DATA = 256;
+
 //#define DEBUG_PRECLONE
 
 #ifdef DEBUG_PRECLONE
@@ -82,6 +89,8 @@ KisTileDataStore::~KisTileDataStore()
     m_pooler.terminatePooler();
     m_swapper.terminateSwapper();
 
+    dropAllUniformTileData();
+
     if(numTiles() > 0) {
          errKrita << "Warning: some tiles have leaked:";
          errKrita << "\tTiles in memory:" << numTilesInMemory() << "\n"
@@ -102,12 +111,27 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
         m_pooler.forceUpdateMemoryStats();
     }
 
-    QMutexLocker lock(&m_listLock);
-
     MemoryStatistics stats;
 
     const qint64 metricCoeff = KisTileData::WIDTH * KisTileData::HEIGHT;
 
+    {
+        QMutexLocker lock(&m_uniformTileDataLock);
+
+        stats.uniformTilesSavedSize = 0;
+
+        /**
+         * One user belongs to the store, and one tile would
+         * need its own data anyway
+         */
+        Q_FOREACH (KisTileData *td, m_uniformTileData) {
+            stats.uniformTilesSavedSize +=
+                qint64(qMax(0, td->numUsers() - 2)) * td->pixelSize() * metricCoeff;
+        }
+    }
+
+    QMutexLocker lock(&m_listLock);
+
     stats.realMemorySize = m_pooler.lastRealMemoryMetric() * metricCoeff;
     stats.historicalMemorySize = m_pooler.lastHistoricalMemoryMetric() * metricCoeff;
     stats.poolSize = m_pooler.lastPoolMemoryMetric() * metricCoeff;
@@ -119,6 +143,60 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
     return stats;
 }
 
+KisTileData* KisTileDataStore::acquireUniformTileData(qint32 pixelSize, const quint8 *pixel,
+                                                      const KisTileContent::AlphaDescriptor &alpha)
+{
+    QByteArray key(reinterpret_cast<const char*>(pixel), pixelSize);
+    key.append(reinterpret_cast<const char*>(&alpha.offset), sizeof(alpha.offset));
+    key.append(reinterpret_cast<const char*>(&alpha.size), sizeof(alpha.size));
+    key.append(reinterpret_cast<const char*>(alpha.opaqueValue), sizeof(alpha.opaqueValue));
+
+    QMutexLocker lock(&m_uniformTileDataLock);
+
+    KisTileData *td = m_uniformTileData.value(key, 0);
+
+    if (!td) {
+        dropUnusedUniformTileData();
+        if (m_uniformTileData.size() >= MAX_UNIFORM_TILE_DATA) return 0;
+
+        td = allocTileData(pixelSize, pixel);
+        td->acquire();
+        m_uniformTileData.insert(key, td);
+    }
+
+    td->acquire();
+    return td;
+}
+
+void KisTileDataStore::dropUnusedUniformTileData()
+{
+    /**
+     * This function is called with m_uniformTileDataLock acquired.
+     * The users are added under the same lock, so a tile data with
+     * the only user cannot get a new one behind our back.
+     */
+
+    auto it = m_uniformTileData.begin();
+    while (it != m_uniformTileData.end()) {
+        if (it.value()->numUsers() <= 1) {
+            it.value()->release();
+            it = m_uniformTileData.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void KisTileDataStore::dropAllUniformTileData()
+{
+    QMutexLocker lock(&m_uniformTileDataLock);
+
+    Q_FOREACH (KisTileData *td, m_uniformTileData) {
+        td->release();
+    }
+    m_uniformTileData.clear();
+}
+
 inline void KisTileDataStore::registerTileDataImp(KisTileData *td)
 {
     td->m_listIterator = m_tileDataList.insert(m_tileDataList.end(), td);
@@ -333,6 +411,8 @@ void KisTileDataStore::debugSwapAll()
 
 void KisTileDataStore::debugClear()
 {
+    dropAllUniformTileData();
+
     QMutexLocker lock(&m_listLock);
 
     Q_FOREACH (KisTileData *item, m_tileDataList) {
@@ -21,6 +21,8 @@
 #include "kritaimage_export.h"
 
 #include <QReadWriteLock>
+#include <QByteArray>
+#include <QHash>
 #include "kis_tile_data_interface.h"
 
 #include "kis_tile_data_pooler.h"
@@ -51,6 +53,12 @@ public:
         qint64 poolSize;
 
         qint64 swapSize;
+
+        /**
+         * The amount of memory the uniform tiles would occupy
+         * if they didn't share their data
+         */
+        qint64 uniformTilesSavedSize;
     };
 
     MemoryStatistics memoryStatistics();
@@ -94,6 +102,24 @@ public:
         return allocTileData(pixelSize, defPixel);
     }
 
+    /**
+     * Returns a tile data filled with \p pixel, which is shared by all
+     * the uniform tiles of this color. The tile data is returned already
+     * acquired, the caller should release it when it is not needed
+     * anymore.
+     *
+     * The store keeps its own user of the tile data, so every write
+     * into a tile using it will copy the data first, the same way it
+     * happens with the default tile data of a data manager.
+     *
+     * The tile data is shared only between the callers with equal
+     * \p alpha, because its cached content flags depend on it.
+     *
+     * Returns null if there are too many colors shared already.
+     */
+    KisTileData* acquireUniformTileData(qint32 pixelSize, const quint8 *pixel,
+                                        const KisTileContent::AlphaDescriptor &alpha);
+
     // Called by The Memento Manager after every commit
     inline void kickPooler() {
         m_pooler.kick();
@@ -140,6 +166,9 @@ private:
     inline void unregisterTileDataImp(KisTileData *td);
     void freeRegisteredTiles();
 
+    void dropUnusedUniformTileData();
+    void dropAllUniformTileData();
+
     friend class DeadlockyThread;
     friend class KisLowMemoryTests;
     void debugSwapAll();
@@ -171,6 +200,14 @@ private:
      * metric = num_bytes / (KisTileData::WIDTH * KisTileData::HEIGHT)
      */
     qint64 m_memoryMetric;
+
+    /**
+     * The shared data of uniform tiles, keyed by the bytes of the pixel
+     * followed by the alpha descriptor of the color space.
+     * Every tile data in the hash has one user owned by the store.
+     */
+    QMutex m_uniformTileDataLock;
+    QHash<QByteArray, KisTileData*> m_uniformTileData;
 };
 
 template<typename T>
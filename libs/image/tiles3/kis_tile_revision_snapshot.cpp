@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_revision_snapshot.h"
+
+#include <QHash>
+#include <QPair>
+
+#include "kis_tile_data.h"
+
+
+struct KisTileRevisionSnapshot::Private
+{
+    typedef QPair<qint32, qint32> TileIndex;
+
+    ~Private() {
+        Q_FOREACH (KisTileData *tileData, tiles) {
+            tileData->release();
+        }
+    }
+
+    QHash<TileIndex, KisTileData*> tiles;
+    QByteArray defaultPixel;
+};
+
+KisTileRevisionSnapshot::KisTileRevisionSnapshot()
+{
+}
+
+KisTileRevisionSnapshot::~KisTileRevisionSnapshot()
+{
+}
+
+bool KisTileRevisionSnapshot::isNull() const
+{
+    return !m_d;
+}
+
+int KisTileRevisionSnapshot::numTiles() const
+{
+    return m_d ? m_d->tiles.size() : 0;
+}
+
+QByteArray KisTileRevisionSnapshot::defaultPixel() const
+{
+    return m_d ? m_d->defaultPixel : QByteArray();
+}
+
+void KisTileRevisionSnapshot::setDefaultPixel(const quint8 *defaultPixel, int pixelSize)
+{
+    if (!m_d) m_d.reset(new Private);
+    m_d->defaultPixel = QByteArray(reinterpret_cast<const char*>(defaultPixel), pixelSize);
+}
+
+void KisTileRevisionSnapshot::addTile(qint32 col, qint32 row, KisTileData *tileData)
+{
+    if (!m_d) m_d.reset(new Private);
+
+    tileData->acquire();
+    m_d->tiles.insert(Private::TileIndex(col, row), tileData);
+}
+
+QVector<QRect> KisTileRevisionSnapshot::changedTiles(const KisTileRevisionSnapshot &older) const
+{
+    typedef QHash<Private::TileIndex, KisTileData*> TilesHash;
+
+    static const TilesHash emptyHash;
+    const TilesHash &newTiles = m_d ? m_d->tiles : emptyHash;
+    const TilesHash &oldTiles = older.m_d ? older.m_d->tiles : emptyHash;
+
+    auto tileRect = [] (const Private::TileIndex &index) {
+        return QRect(index.first * KisTileData::WIDTH,
+                     index.second * KisTileData::HEIGHT,
+                     KisTileData::WIDTH, KisTileData::HEIGHT);
+    };
+
+    QVector<QRect> result;
+
+    for (auto it = newTiles.constBegin(); it != newTiles.constEnd(); ++it) {
+        if (oldTiles.value(it.key()) != it.value()) {
+            result << tileRect(it.key());
+        }
+    }
+
+    // the removed tiles now contain the default pixel
+    for (auto it = oldTiles.constBegin(); it != oldTiles.constEnd(); ++it) {
+        if (!newTiles.contains(it.key())) {
+            result << tileRect(it.key());
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_REVISION_SNAPSHOT_H
+#define __KIS_TILE_REVISION_SNAPSHOT_H
+
+#include <QByteArray>
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+class KisTileData;
+class KisTiledDataManager;
+
+/**
+ * A snapshot of the identity of the tiles of a data manager, created
+ * by KisTiledDataManager::takeRevisionSnapshot().
+ *
+ * The snapshot holds a user reference to every tile data it has seen,
+ * so the tile data cannot be freed and reused while the snapshot
+ * exists, and every write into the tile has to copy-on-write it. It
+ * means that a tile has changed since the snapshot was taken if and
+ * only if its tile data object is different now. That makes comparing
+ * two snapshots an O(number of tiles) operation, without touching the
+ * pixel data at all.
+ *
+ * The snapshot is implicitly shared.
+ */
+class KRITAIMAGE_EXPORT KisTileRevisionSnapshot
+{
+public:
+    KisTileRevisionSnapshot();
+    ~KisTileRevisionSnapshot();
+
+    bool isNull() const;
+    int numTiles() const;
+    QByteArray defaultPixel() const;
+
+    /**
+     * \return the rects of the tiles, which have been changed, added
+     *         or removed since the \p older snapshot was taken. The rects
+     *         are in the coordinates of the data manager.
+     */
+    QVector<QRect> changedTiles(const KisTileRevisionSnapshot &older) const;
+
+private:
+    friend class KisTiledDataManager;
+    void setDefaultPixel(const quint8 *defaultPixel, int pixelSize);
+    void addTile(qint32 col, qint32 row, KisTileData *tileData);
+
+private:
+    struct Private;
+    QSharedPointer<Private> m_d;
+};
+
+#endif /* __KIS_TILE_REVISION_SNAPSHOT_H */
@@ -76,6 +76,7 @@ KisTiledDataManager::KisTiledDataManager(const KisTiledDataManager &dm)
      * has already been made shared in m_hashTable(dm->m_hashTable)
      */
     memcpy(m_defaultPixel, dm.m_defaultPixel, m_pixelSize);
+    m_alphaDescriptor = dm.m_alphaDescriptor;
 
     m_extentMinX = dm.m_extentMinX;
     m_extentMinY = dm.m_extentMinY;
@@ -192,6 +193,8 @@ bool KisTiledDataManager::read(QIODevice *stream)
         }
     }
 
+    shareUniformTilesImpl(extentImpl());
+
     m_mementoManager->commit();
     return readSuccess;
 }
@@ -309,9 +312,69 @@ void KisTiledDataManager::purge(const QRect& area)
         m_hashTable->deleteTile(tile);
     }
 
+    shareUniformTilesImpl(area);
+
     recalculateExtent();
 }
 
+void KisTiledDataManager::shareUniformTilesImpl(const QRect &area)
+{
+    const qint32 pixelSize = this->pixelSize();
+    const qint32 numPixels = KisTileData::WIDTH * KisTileData::HEIGHT;
+    const KisTileContent::AlphaDescriptor noAlpha;
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    QByteArray pixel(pixelSize, 0);
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        iter.next();
+
+        if (!tile->extent().intersects(area)) continue;
+
+        tile->lockForRead();
+
+        /**
+         * Keep the tile data alive until the tile is checked
+         * again, so that it cannot be freed and replaced with
+         * a new one at the same address meanwhile
+         */
+        KisTileData *td = tile->tileData();
+        td->ref();
+        const qint32 revision = td->contentRevision();
+
+        /**
+         * We cannot use the cached flags of the tile data, they
+         * might have been calculated for another alpha channel
+         */
+        const bool isUniform =
+            KisTileContent::calculateFlags(td->data(), numPixels, pixelSize, noAlpha) &
+            KisTileContent::Uniform;
+
+        if (isUniform) {
+            memcpy(pixel.data(), td->data(), pixelSize);
+        }
+
+        tile->unlock();
+
+        if (isUniform) {
+            KisTileData *uniformTD =
+                store->acquireUniformTileData(pixelSize,
+                                              reinterpret_cast<const quint8*>(pixel.constData()),
+                                              m_alphaDescriptor);
+
+            if (uniformTD) {
+                tile->shareTileData(uniformTD, td, revision);
+                uniformTD->release();
+            }
+        }
+
+        td->deref();
+    }
+}
+
 quint8* KisTiledDataManager::duplicatePixel(qint32 num, const quint8 *pixel)
 {
     const qint32 pixelSize = this->pixelSize();
@@ -369,8 +432,12 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
         clearRect.width() >= KisTileData::WIDTH &&
         clearRect.height() >= KisTileData::HEIGHT) {
 
-        td = KisTileDataStore::instance()->createDefaultTileData(pixelSize, clearPixel);
-        td->acquire();
+        td = KisTileDataStore::instance()->acquireUniformTileData(pixelSize, clearPixel, m_alphaDescriptor);
+
+        if (!td) {
+            td = KisTileDataStore::instance()->createDefaultTileData(pixelSize, clearPixel);
+            td->acquire();
+        }
     }
 
     bool needsRecalculateExtent = false;
@@ -587,6 +654,24 @@ void KisTiledDataManager::bitBltRoughOldData(KisTiledDataManager *srcDM, const Q
     bitBltRoughImpl<true>(srcDM, rect);
 }
 
+void KisTiledDataManager::shareTile(KisTiledDataManager *srcDM, qint32 srcColumn, qint32 srcRow,
+                                    qint32 column, qint32 row)
+{
+    QWriteLocker locker(&m_lock);
+
+    KisTileSP srcTile = srcDM->getTile(srcColumn, srcRow, false);
+
+    m_hashTable->deleteTile(column, row);
+
+    srcTile->lockForRead();
+    KisTileData *td = srcTile->tileData();
+    KisTileSP clonedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
+    srcTile->unlock();
+
+    m_hashTable->addTile(clonedTile);
+    updateExtent(column, row);
+}
+
 void KisTiledDataManager::setExtent(qint32 x, qint32 y, qint32 w, qint32 h)
 {
     setExtent(QRect(x, y, w, h));
@@ -634,7 +719,7 @@ void KisTiledDataManager::setExtent(QRect newRect)
                         }
                     }
                 }
-                tile->unlock();
+                tile->unlockForWrite();
                 iter.next();
             } else {
                 iter.deleteCurrent();
@@ -645,6 +730,24 @@ void KisTiledDataManager::setExtent(QRect newRect)
     recalculateExtent();
 }
 
+KisTileRevisionSnapshot KisTiledDataManager::takeRevisionSnapshot() const
+{
+    QReadLocker locker(&m_lock);
+
+    KisTileRevisionSnapshot snapshot;
+    snapshot.setDefaultPixel(m_defaultPixel, m_pixelSize);
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        snapshot.addTile(tile->col(), tile->row(), tile->tileData());
+        iter.next();
+    }
+
+    return snapshot;
+}
+
 void KisTiledDataManager::recalculateExtent()
 {
     m_extentMinX = qint32_MAX;
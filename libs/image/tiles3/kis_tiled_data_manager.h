@@ -32,6 +32,7 @@
 #include "kis_tile_hash_table.h"
 #include "kis_memento_manager.h"
 #include "kis_memento.h"
+#include "kis_tile_revision_snapshot.h"
 
 
 class KisTiledDataManager;
@@ -88,6 +89,20 @@ public:
         return m_defaultPixel;
     }
 
+    /**
+     * Describes the alpha channel of the pixels stored in the data
+     * manager. The uniform tiles are shared only between the data
+     * managers with equal descriptors, so that the content flags cached
+     * in the shared tile data are calculated for the right alpha channel.
+     */
+    void setAlphaDescriptor(const KisTileContent::AlphaDescriptor &alpha) {
+        m_alphaDescriptor = alpha;
+    }
+
+    const KisTileContent::AlphaDescriptor& alphaDescriptor() const {
+        return m_alphaDescriptor;
+    }
+
     /**
      * Every iterator fetches both types of tiles all the time: old and new.
      * For projection devices these tiles are **always** the same, but doing
@@ -124,6 +139,15 @@ public:
         return tile ? tile : getTile(col, row, false);
     }
 
+    /**
+     * Returns the tile at (\p col, \p row) or null, if the
+     * data manager has no tile there, that is, the area is
+     * filled with the default pixel
+     */
+    inline KisTileSP getExistingTile(qint32 col, qint32 row) {
+        return m_hashTable->getExistingTile(col, row);
+    }
+
     KisMementoSP getMemento() {
         QWriteLocker locker(&m_lock);
         KisMementoSP memento = m_mementoManager->getMemento();
@@ -185,6 +209,15 @@ public:
 
     static void releaseInternalPools();
 
+    /**
+     * Takes a snapshot of the identity of all the tiles of the data
+     * manager. Comparing it to a later snapshot tells which tiles have
+     * been changed in between.
+     *
+     * \see KisTileRevisionSnapshot
+     */
+    KisTileRevisionSnapshot takeRevisionSnapshot() const;
+
 protected:
     /**
      * Reads and writes the tiles 
@@ -192,6 +225,11 @@ protected:
     bool write(KisPaintDeviceWriter &store);
     bool read(QIODevice *stream);
 
+    /**
+     * Drops the tiles filled with the default pixel and makes
+     * the tiles filled with any other single color share their
+     * data (see KisTileDataStore::acquireUniformTileData())
+     */
     void purge(const QRect& area);
 
     inline quint32 pixelSize() const {
@@ -242,6 +280,15 @@ public:
      */
     void bitBltRoughOldData(KisTiledDataManager *srcDM, const QRect &rect);
 
+    /**
+     * Makes the tile (\p column, \p row) share the data of the tile
+     * (\p srcColumn, \p srcRow) of \p srcDM using copy-on-write, the
+     * same way bitBltRough() does. \p srcDM may be this datamanager
+     * itself, which allows filling repeated content by reference.
+     */
+    void shareTile(KisTiledDataManager *srcDM, qint32 srcColumn, qint32 srcRow,
+                   qint32 column, qint32 row);
+
     /**
      * write the specified data to x, y. There is no checking on pixelSize!
      */
@@ -319,6 +366,7 @@ private:
     KisMementoManager *m_mementoManager;
     quint8* m_defaultPixel;
     qint32 m_pixelSize;
+    KisTileContent::AlphaDescriptor m_alphaDescriptor;
 
     /**
      * Extents stuff
@@ -353,6 +401,8 @@ private:
 
     quint8* duplicatePixel(qint32 num, const quint8 *pixel);
 
+    void shareUniformTilesImpl(const QRect &area);
+
     template<bool useOldSrcData>
         void bitBltImpl(KisTiledDataManager *srcDM, const QRect &rect);
     template<bool useOldSrcData>
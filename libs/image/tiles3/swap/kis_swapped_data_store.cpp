@@ -22,6 +22,7 @@
 #include "kis_image_config.h"
 
 #include "kis_tile_compressor_2.h"
+#include "KisTracer.h"
 
 //#define COMPRESSOR_VERSION 2
 
@@ -92,6 +93,8 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
 {
     Q_ASSERT(!td->data());
+    KIS_TRACE_SCOPE("tiles", "tile swap-in");
+
     QMutexLocker locker(&m_lock);
 
     // see comment in swapOutTileData()
@@ -181,5 +181,47 @@ void KisTileDataStoreTest::testSwapping()
     }
 }
 
+void KisTileDataStoreTest::testSwappingUniformTiles()
+{
+    KisTileDataStore::instance()->debugClear();
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    quint8 oddPixel1 = 140;
+    quint8 oddPixel2 = 141;
+    KisTiledDataManager dm(pixelSize, &defaultPixel);
+
+    dm.clear(QRect(0, 0, 256, 256), &oddPixel1);
+
+    KisTileSP tile1 = dm.getTile(0, 0, false);
+    KisTileSP tile2 = dm.getTile(1, 1, false);
+    QCOMPARE(tile1->tileData(), tile2->tileData());
+
+    KisTileDataStore::instance()->debugSwapAll();
+
+    tile1->lockForRead();
+    QVERIFY(memoryIsFilled(oddPixel1, tile1->data(), TILESIZE));
+    tile1->unlock();
+
+    KisTileDataStore::instance()->debugSwapAll();
+
+    tile2->lockForWrite();
+    QVERIFY(memoryIsFilled(oddPixel1, tile2->data(), TILESIZE));
+    memset(tile2->data(), oddPixel2, TILESIZE);
+    tile2->unlockForWrite();
+
+    QVERIFY(tile1->tileData() != tile2->tileData());
+
+    KisTileDataStore::instance()->debugSwapAll();
+
+    tile1->lockForRead();
+    QVERIFY(memoryIsFilled(oddPixel1, tile1->data(), TILESIZE));
+    tile1->unlock();
+
+    tile2->lockForRead();
+    QVERIFY(memoryIsFilled(oddPixel2, tile2->data(), TILESIZE));
+    tile2->unlock();
+}
+
 QTEST_MAIN(KisTileDataStoreTest)
 
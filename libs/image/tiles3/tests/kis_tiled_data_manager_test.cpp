@@ -20,6 +20,8 @@
 #include <QTest>
 
 #include "tiles3/kis_tiled_data_manager.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "kis_datamanager.h"
 
 #include "tiles_test_utils.h"
 
@@ -541,6 +543,137 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
 
 //#include <valgrind/callgrind.h>
 
+void KisTiledDataManagerTest::testRevisionSnapshot()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    dm.clear(0, 0, 128, 64, &oddPixel1);
+
+    KisTileRevisionSnapshot snapshot1 = dm.takeRevisionSnapshot();
+    QCOMPARE(snapshot1.numTiles(), 2);
+    QCOMPARE(snapshot1.defaultPixel(), QByteArray(1, char(defaultPixel)));
+
+    // nothing has changed
+    QVERIFY(dm.takeRevisionSnapshot().changedTiles(snapshot1).isEmpty());
+
+    // writing into a tile without a transaction changes its identity as well
+    dm.clear(10, 10, 10, 10, &oddPixel2);
+
+    KisTileRevisionSnapshot snapshot2 = dm.takeRevisionSnapshot();
+    QCOMPARE(snapshot2.changedTiles(snapshot1), QVector<QRect>() << QRect(0, 0, 64, 64));
+
+    // the snapshot keeps the old data alive
+    QVERIFY(dm.takeRevisionSnapshot().changedTiles(snapshot2).isEmpty());
+
+    // new tiles
+    dm.clear(200, 200, 10, 10, &oddPixel2);
+    QCOMPARE(dm.takeRevisionSnapshot().changedTiles(snapshot2), QVector<QRect>() << QRect(192, 192, 64, 64));
+
+    // removed tiles
+    KisTileRevisionSnapshot snapshot3 = dm.takeRevisionSnapshot();
+    dm.clear();
+    QCOMPARE(dm.takeRevisionSnapshot().changedTiles(snapshot3).size(), 3);
+}
+
+void KisTiledDataManagerTest::testUniformTileSharing()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm1(1, &defaultPixel);
+    KisTiledDataManager dm2(1, &defaultPixel);
+
+    quint8 oddPixel1 = 140;
+    quint8 oddPixel2 = 141;
+
+    QRect rect(0,0,256,256);
+    QRect tilesRect(0,0,4,4);
+    QRect holeRect(10,10,20,20);
+
+    // all the tiles of the same color share the same data
+    dm1.clear(rect, &oddPixel1);
+    dm2.clear(rect, &oddPixel1);
+    QVERIFY(checkTilesShared(&dm1, &dm2, false, false, tilesRect));
+
+    KisTileDataStore::MemoryStatistics stats =
+        KisTileDataStore::instance()->memoryStatistics();
+    QVERIFY(stats.uniformTilesSavedSize >= 30 * TILESIZE);
+
+    // writing into a tile detaches it from the others
+    KisMementoSP memento = dm1.getMemento();
+    dm1.clear(holeRect, &oddPixel2);
+    dm1.commit();
+
+    QVERIFY(checkTilesNotShared(&dm1, &dm2, false, false, QRect(0,0,1,1)));
+    QVERIFY(checkTilesShared(&dm1, &dm2, false, false, QRect(1,0,3,1)));
+
+    quint8 *buffer = new quint8[rect.width()*rect.height()];
+
+    dm1.readBytes(buffer, rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(checkHole(buffer, oddPixel2, holeRect,
+                      oddPixel1, rect));
+
+    dm2.readBytes(buffer, rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(memoryIsFilled(oddPixel1, buffer, rect.width()*rect.height()));
+
+    // undo restores the original color
+    dm1.rollback(memento);
+
+    dm1.readBytes(buffer, rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(memoryIsFilled(oddPixel1, buffer, rect.width()*rect.height()));
+
+    delete[] buffer;
+}
+
+void KisTiledDataManagerTest::testPurgeSharesUniformTiles()
+{
+    quint8 defaultPixel = 0;
+    KisDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 150;
+    quint8 oddPixel2 = 151;
+
+    QRect rect(0,0,128,64);
+
+    /**
+     * Writing pixels directly makes every tile to have
+     * its own data
+     */
+    QVector<quint8> pixels(rect.width() * rect.height(), oddPixel1);
+    dm.writeBytes(pixels.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(dm.getTile(0, 0, false)->tileData() != dm.getTile(1, 0, false)->tileData());
+
+    KisTileData *oldTileData = dm.getTile(0, 0, false)->tileData();
+    dm.purge(rect);
+
+    KisTileSP tile00 = dm.getTile(0, 0, false);
+    KisTileSP tile10 = dm.getTile(1, 0, false);
+    QVERIFY(tile00->tileData() != oldTileData);
+    QCOMPARE(tile00->tileData(), tile10->tileData());
+
+    // writing into one of the tiles should not change the other
+    KisMementoSP memento = dm.getMemento();
+    dm.setPixel(0, 0, &oddPixel2);
+    dm.commit();
+
+    QVERIFY(tile00->tileData() != tile10->tileData());
+
+    tile10->lockForRead();
+    QVERIFY(memoryIsFilled(oddPixel1, tile10->data(), TILESIZE));
+    tile10->unlock();
+
+    quint8 pixel = 0;
+    dm.readBytes(&pixel, 0, 0, 1, 1);
+    QCOMPARE(pixel, oddPixel2);
+
+    dm.rollback(memento);
+
+    dm.readBytes(&pixel, 0, 0, 1, 1);
+    QCOMPARE(pixel, oddPixel1);
+}
+
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
 {
     quint8 defaultPixel = 0;
@@ -52,6 +52,9 @@ private Q_SLOTS:
     void testTransactions();
     void testPurgeHistory();
     void testUndoSetDefaultPixel();
+    void testRevisionSnapshot();
+    void testUniformTileSharing();
+    void testPurgeSharesUniformTiles();
 
     void benchmarkReadOnlyTileLazy();
     void benchmarkSharedPointers();
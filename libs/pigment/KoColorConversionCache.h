@@ -24,13 +24,14 @@ class KoCachedColorConversionTransformation;
 class KoColorSpace;
 
 #include "KoColorConversionTransformation.h"
+#include "kritapigment_export.h"
 
 /**
  * This class holds a cache of KoColorConversionTransformations.
  *
  * This class is not part of public API, and can be changed without notice.
  */
-class KoColorConversionCache
+class KRITAPIGMENT_EXPORT KoColorConversionCache
 {
 public:
     struct CachedTransformation;
@@ -68,7 +69,7 @@ private:
  *
  * This class is not part of public API, and can be changed without notice.
  */
-class KoCachedColorConversionTransformation
+class KRITAPIGMENT_EXPORT KoCachedColorConversionTransformation
 {
     friend class KoColorConversionCache;
 private:
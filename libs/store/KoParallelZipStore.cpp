@@ -0,0 +1,906 @@
+/* This file is part of the KDE project
+   Copyright (C) 2018 Krita developers
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+*/
+
+#include "KoParallelZipStore.h"
+#include "KoStore_p.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <KCompressionDevice>
+
+#include <StoreDebug.h>
+
+namespace {
+
+const quint32 localFileHeaderSignature = 0x04034b50;
+const quint32 centralFileHeaderSignature = 0x02014b50;
+const quint32 endOfCentralDirectorySignature = 0x06054b50;
+const quint32 zip64EndOfCentralDirectorySignature = 0x06064b50;
+const quint32 zip64EndOfCentralDirectoryLocatorSignature = 0x07064b50;
+
+const int localFileHeaderSize = 30;
+const int centralFileHeaderSize = 46;
+const int endOfCentralDirectorySize = 22;
+const int zip64EndOfCentralDirectorySize = 56;
+const int zip64EndOfCentralDirectoryLocatorSize = 20;
+
+const quint16 zip64ExtraFieldTag = 0x0001;
+
+/**
+ * The values that don't fit the fields of the plain zip records are
+ * replaced by these markers and stored in the zip64 records instead
+ */
+const quint32 zip64Marker32 = 0xffffffff;
+const quint16 zip64Marker16 = 0xffff;
+
+const quint16 methodStored = 0;
+const quint16 methodDeflated = 8;
+
+const quint16 flagEncrypted = 0x0001;
+const quint16 flagUtf8Names = 0x0800;
+
+const quint16 versionNeededToExtract = 20;
+const quint16 versionNeededToExtractZip64 = 45;
+const quint16 versionMadeBy = (3 << 8) | 45; // unix, zip 4.5
+
+/**
+ * The amount of the uncompressed data waiting for compression, after
+ * which closing a file blocks until the oldest pending file is written
+ */
+const qint64 maxPendingBytes = 256 * 1024 * 1024;
+
+quint32 calculateCrc32(const char *data, qint64 size)
+{
+    static const QVector<quint32> table = [] () {
+        QVector<quint32> table(256);
+        for (quint32 i = 0; i < 256; i++) {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    quint32 crc = 0xffffffff;
+    const uchar *ptr = reinterpret_cast<const uchar*>(data);
+
+    for (qint64 i = 0; i < size; i++) {
+        crc = table[(crc ^ ptr[i]) & 0xff] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xffffffff;
+}
+
+QByteArray deflateRaw(const QByteArray &data)
+{
+    QByteArray result;
+    QBuffer buffer(&result);
+    buffer.open(QIODevice::WriteOnly);
+
+    // the same way KZip does it: gzip without the headers is raw deflate
+    KCompressionDevice device(&buffer, false, KCompressionDevice::GZip);
+    device.setSkipHeaders();
+
+    if (!device.open(QIODevice::WriteOnly) ||
+        device.write(data) != data.size()) {
+
+        return QByteArray();
+    }
+
+    device.close();
+    return result;
+}
+
+struct ZipEntry {
+    QString name;
+    quint16 method = methodStored;
+    quint32 crc = 0;
+    qint64 compressedSize = 0;
+    qint64 uncompressedSize = 0;
+    qint64 headerOffset = 0;
+    qint64 dataOffset = 0;
+};
+
+struct CompressedFile {
+    QByteArray data;
+    quint16 method = methodStored;
+    quint32 crc = 0;
+    qint64 uncompressedSize = 0;
+};
+
+CompressedFile compressFile(const QByteArray &data, bool useCompression)
+{
+    CompressedFile result;
+    result.uncompressedSize = data.size();
+    result.crc = calculateCrc32(data.constData(), data.size());
+
+    if (useCompression && !data.isEmpty()) {
+        QByteArray deflated = deflateRaw(data);
+
+        // incompressible data (e.g. PNG previews) is just stored
+        if (!deflated.isEmpty() && deflated.size() < data.size()) {
+            result.data = deflated;
+            result.method = methodDeflated;
+            return result;
+        }
+    }
+
+    result.data = data;
+    result.method = methodStored;
+    return result;
+}
+
+/**
+ * Collects the values of a zip64 extended information extra field.
+ * Only the values that overflow the plain fields are stored there.
+ */
+struct Zip64ExtraField {
+    void add(qint64 value) {
+        values << quint64(value);
+    }
+
+    bool isEmpty() const {
+        return values.isEmpty();
+    }
+
+    QByteArray toByteArray() const {
+        if (values.isEmpty()) return QByteArray();
+
+        QByteArray result;
+        QDataStream stream(&result, QIODevice::WriteOnly);
+        stream.setByteOrder(QDataStream::LittleEndian);
+
+        stream << zip64ExtraFieldTag << quint16(values.size() * 8);
+        Q_FOREACH (quint64 value, values) {
+            stream << value;
+        }
+
+        return result;
+    }
+
+    QVector<quint64> values;
+};
+
+struct PendingFile {
+    QString name;
+    qint64 size = 0;
+    QFuture<CompressedFile> future;
+};
+
+template <typename T>
+inline T readLE(const char *ptr) {
+    return qFromLittleEndian<T>(reinterpret_cast<const uchar*>(ptr));
+}
+
+}
+
+struct KoParallelZipStore::Private
+{
+    QIODevice *device = 0;
+    QScopedPointer<QIODevice> ownDevice;
+    bool deviceOpenedByStore = false;
+
+    // Read mode
+
+    QByteArray archiveData;
+    QFileDevice *mappedFile = 0;
+    uchar *mappedData = 0;
+
+    const char *archive = 0;
+    qint64 archiveSize = 0;
+
+    QHash<QString, ZipEntry> entries;
+    QSet<QString> directories;
+
+    bool readCentralDirectory();
+    bool readZip64ExtraField(const char *extra, int extraLength, ZipEntry *entry,
+                             bool hasUncompressedSize, bool hasCompressedSize, bool hasHeaderOffset) const;
+    void addEntry(const ZipEntry &entry);
+    QIODevice* createReadDevice(const ZipEntry &entry) const;
+
+    // Write mode
+
+    QThreadPool threadPool;
+
+    QByteArray currentFile;
+    bool compressionEnabled = true;
+    bool currentFileCompressed = true;
+
+    QList<PendingFile> pendingFiles;
+    qint64 pendingBytes = 0;
+
+    QVector<ZipEntry> writtenEntries;
+    qint64 writePos = 0;
+    bool writeFailed = false;
+
+    quint16 dosTime = 0;
+    quint16 dosDate = 0;
+
+    bool write(const QByteArray &data);
+    bool writeFile(const QString &name, const CompressedFile &file);
+    bool writePendingFiles(bool waitForAll);
+    bool writeCentralDirectory();
+};
+
+KoParallelZipStore::KoParallelZipStore(const QString &fileName, Mode mode, const QByteArray &appIdentification,
+                                       bool writeMimetype)
+    : KoStore(mode, writeMimetype),
+      m_d(new Private)
+{
+    Q_D(KoStore);
+
+    d->localFileName = fileName;
+
+    if (mode == Write) {
+        m_d->ownDevice.reset(new QSaveFile(fileName));
+    } else {
+        m_d->ownDevice.reset(new QFile(fileName));
+    }
+    m_d->device = m_d->ownDevice.data();
+
+    init(appIdentification);
+}
+
+KoParallelZipStore::KoParallelZipStore(QIODevice *dev, Mode mode, const QByteArray &appIdentification,
+                                       bool writeMimetype)
+    : KoStore(mode, writeMimetype),
+      m_d(new Private)
+{
+    m_d->device = dev;
+    init(appIdentification);
+}
+
+KoParallelZipStore::~KoParallelZipStore()
+{
+    Q_D(KoStore);
+
+    if (!d->finalized) {
+        finalize(); // ### no error checking when the app forgot to call finalize itself
+    }
+
+    // make sure no stream refers to the mapped memory anymore
+    delete d->stream;
+    d->stream = 0;
+
+    if (m_d->mappedData) {
+        m_d->mappedFile->unmap(m_d->mappedData);
+    }
+
+    if (m_d->deviceOpenedByStore && m_d->device->isOpen()) {
+        m_d->device->close();
+    }
+}
+
+void KoParallelZipStore::init(const QByteArray &appIdentification)
+{
+    Q_D(KoStore);
+
+    const QIODevice::OpenMode openMode =
+        d->mode == Write ? QIODevice::WriteOnly : QIODevice::ReadOnly;
+
+    if (!m_d->device->isOpen()) {
+        d->good = m_d->device->open(openMode);
+        m_d->deviceOpenedByStore = d->good;
+    } else {
+        d->good = m_d->device->openMode() & openMode;
+    }
+
+    if (!d->good) return;
+
+    if (d->mode == Write) {
+        m_d->threadPool.setMaxThreadCount(QThread::idealThreadCount());
+        m_d->writePos = m_d->device->pos();
+
+        const QDateTime now = QDateTime::currentDateTime();
+        m_d->dosTime = (now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() >> 1);
+        m_d->dosDate = ((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day();
+
+        // the identification must be the first file and must not be compressed
+        if (d->writeMimetype) {
+            m_d->writeFile(QLatin1String("mimetype"), compressFile(appIdentification, false));
+        }
+
+        d->good = !m_d->writeFailed;
+    } else {
+        m_d->mappedFile = qobject_cast<QFileDevice*>(m_d->device);
+        if (m_d->mappedFile && m_d->mappedFile->size() > 0) {
+            m_d->mappedData = m_d->mappedFile->map(0, m_d->mappedFile->size());
+        }
+
+        if (m_d->mappedData) {
+            m_d->archive = reinterpret_cast<const char*>(m_d->mappedData);
+            m_d->archiveSize = m_d->mappedFile->size();
+        } else {
+            m_d->device->seek(0);
+            m_d->archiveData = m_d->device->readAll();
+            m_d->archive = m_d->archiveData.constData();
+            m_d->archiveSize = m_d->archiveData.size();
+        }
+
+        d->good = m_d->readCentralDirectory();
+    }
+}
+
+void KoParallelZipStore::setCompressionEnabled(bool e)
+{
+    m_d->compressionEnabled = e;
+}
+
+QStringList KoParallelZipStore::directoryList() const
+{
+    QStringList retval;
+    Q_FOREACH (const QString &dir, m_d->directories) {
+        if (!dir.contains('/')) {
+            retval << dir;
+        }
+    }
+    return retval;
+}
+
+bool KoParallelZipStore::supportsConcurrentReading() const
+{
+    Q_D(const KoStore);
+    return d->mode == Read && d->good;
+}
+
+bool KoParallelZipStore::doFinalize()
+{
+    Q_D(KoStore);
+
+    if (d->mode != Write || !d->good) {
+        return true;
+    }
+
+    bool result =
+        m_d->writePendingFiles(true) &&
+        m_d->writeCentralDirectory();
+
+    QSaveFile *saveFile = qobject_cast<QSaveFile*>(m_d->device);
+
+    if (saveFile && m_d->ownDevice) {
+        result = result && saveFile->commit();
+    } else if (!saveFile) {
+        // the caller is responsible for committing the QSaveFile
+        m_d->device->close();
+    }
+
+    return result;
+}
+
+bool KoParallelZipStore::openWrite(const QString &name)
+{
+    Q_UNUSED(name);
+    Q_D(KoStore);
+
+    m_d->currentFile.clear();
+    m_d->currentFileCompressed = m_d->compressionEnabled;
+
+    QBuffer *buffer = new QBuffer(&m_d->currentFile);
+    buffer->open(QIODevice::WriteOnly);
+
+    d->stream = buffer;
+    return !m_d->writeFailed;
+}
+
+bool KoParallelZipStore::closeWrite()
+{
+    Q_D(KoStore);
+
+    const QByteArray data = m_d->currentFile;
+    m_d->currentFile = QByteArray();
+
+    PendingFile file;
+    file.name = d->fileName;
+    file.size = data.size();
+    file.future = QtConcurrent::run(&m_d->threadPool, compressFile, data, m_d->currentFileCompressed);
+
+    m_d->pendingFiles.append(file);
+    m_d->pendingBytes += file.size;
+
+    debugStore << "Queued file" << d->fileName << "for compression, size" << file.size;
+
+    return m_d->writePendingFiles(false);
+}
+
+bool KoParallelZipStore::openRead(const QString &name)
+{
+    Q_D(KoStore);
+
+    QHash<QString, ZipEntry>::const_iterator it = m_d->entries.constFind(name);
+    if (it == m_d->entries.constEnd()) {
+        return false;
+    }
+
+    delete d->stream;
+    d->stream = m_d->createReadDevice(*it);
+    d->size = it->uncompressedSize;
+
+    return d->stream;
+}
+
+bool KoParallelZipStore::enterRelativeDirectory(const QString &dirName)
+{
+    Q_D(KoStore);
+
+    if (d->mode == Read) {
+        return m_d->directories.contains(currentPath() + dirName);
+    }
+
+    return true;
+}
+
+bool KoParallelZipStore::enterAbsoluteDirectory(const QString &path)
+{
+    Q_D(KoStore);
+
+    if (d->mode == Read) {
+        QString dir = path;
+        if (dir.endsWith('/')) {
+            dir.chop(1);
+        }
+
+        return dir.isEmpty() || m_d->directories.contains(dir);
+    }
+
+    return true;
+}
+
+bool KoParallelZipStore::fileExists(const QString &absPath) const
+{
+    return m_d->entries.contains(absPath);
+}
+
+bool KoParallelZipStore::doReadFileConcurrently(const QString &absPath, QByteArray *data) const
+{
+    QHash<QString, ZipEntry>::const_iterator it = m_d->entries.constFind(absPath);
+    if (it == m_d->entries.constEnd()) {
+        return false;
+    }
+
+    const ZipEntry &entry = *it;
+
+    if (entry.method == methodStored) {
+        *data = QByteArray(m_d->archive + entry.dataOffset, entry.uncompressedSize);
+    } else {
+        QScopedPointer<QIODevice> device(m_d->createReadDevice(entry));
+        if (!device) return false;
+
+        data->resize(entry.uncompressedSize);
+
+        qint64 totalRead = 0;
+        while (totalRead < entry.uncompressedSize) {
+            const qint64 bytesRead = device->read(data->data() + totalRead, entry.uncompressedSize - totalRead);
+            if (bytesRead <= 0) break;
+            totalRead += bytesRead;
+        }
+
+        if (totalRead != entry.uncompressedSize) {
+            warnStore << "Could not decompress" << absPath;
+            return false;
+        }
+    }
+
+    if (calculateCrc32(data->constData(), data->size()) != entry.crc) {
+        warnStore << "CRC mismatch in" << absPath;
+        return false;
+    }
+
+    return true;
+}
+
+bool KoParallelZipStore::Private::readCentralDirectory()
+{
+    if (archiveSize < endOfCentralDirectorySize) return false;
+
+    // the end of central directory record is followed by a comment of up to 64 KiB
+    qint64 eocdPos = archiveSize - endOfCentralDirectorySize;
+    const qint64 minEocdPos = qMax(qint64(0), eocdPos - 0xffff);
+
+    while (eocdPos >= minEocdPos &&
+           readLE<quint32>(archive + eocdPos) != endOfCentralDirectorySignature) {
+        eocdPos--;
+    }
+
+    if (eocdPos < minEocdPos) {
+        warnStore << "Not a zip archive";
+        return false;
+    }
+
+    const char *eocd = archive + eocdPos;
+    qint64 numEntries = readLE<quint16>(eocd + 10);
+    qint64 directorySize = readLE<quint32>(eocd + 12);
+    qint64 directoryOffset = readLE<quint32>(eocd + 16);
+
+    // the central directory is followed by the zip64 records, if any
+    qint64 directoryEnd = eocdPos;
+
+    if (numEntries == zip64Marker16 ||
+        directorySize == zip64Marker32 ||
+        directoryOffset == zip64Marker32) {
+
+        const qint64 locatorPos = eocdPos - zip64EndOfCentralDirectoryLocatorSize;
+
+        if (locatorPos < 0 ||
+            readLE<quint32>(archive + locatorPos) != zip64EndOfCentralDirectoryLocatorSignature) {
+
+            warnStore << "Broken zip64 end of central directory locator";
+            return false;
+        }
+
+        const qint64 zip64EocdPos = readLE<quint64>(archive + locatorPos + 8);
+
+        if (zip64EocdPos < 0 ||
+            zip64EocdPos + zip64EndOfCentralDirectorySize > locatorPos ||
+            readLE<quint32>(archive + zip64EocdPos) != zip64EndOfCentralDirectorySignature) {
+
+            warnStore << "Broken zip64 end of central directory";
+            return false;
+        }
+
+        const char *zip64Eocd = archive + zip64EocdPos;
+        numEntries = readLE<quint64>(zip64Eocd + 32);
+        directorySize = readLE<quint64>(zip64Eocd + 40);
+        directoryOffset = readLE<quint64>(zip64Eocd + 48);
+        directoryEnd = zip64EocdPos;
+    }
+
+    if (numEntries < 0 || directoryOffset < 0 || directorySize < 0 ||
+        directoryOffset + directorySize > directoryEnd) {
+
+        warnStore << "Broken zip central directory";
+        return false;
+    }
+
+    qint64 pos = directoryOffset;
+
+    for (qint64 i = 0; i < numEntries; i++) {
+        if (pos + centralFileHeaderSize > directoryEnd) return false;
+
+        const char *header = archive + pos;
+        if (readLE<quint32>(header) != centralFileHeaderSignature) return false;
+
+        const quint16 flags = readLE<quint16>(header + 8);
+        const quint16 nameLength = readLE<quint16>(header + 28);
+        const quint16 extraLength = readLE<quint16>(header + 30);
+        const quint16 commentLength = readLE<quint16>(header + 32);
+
+        ZipEntry entry;
+        entry.method = readLE<quint16>(header + 10);
+        entry.crc = readLE<quint32>(header + 16);
+        entry.compressedSize = readLE<quint32>(header + 20);
+        entry.uncompressedSize = readLE<quint32>(header + 24);
+        entry.headerOffset = readLE<quint32>(header + 42);
+
+        if (pos + centralFileHeaderSize + nameLength + extraLength > directoryEnd) return false;
+
+        const QByteArray rawName(header + centralFileHeaderSize, nameLength);
+        entry.name = flags & flagUtf8Names ? QString::fromUtf8(rawName) : QFile::decodeName(rawName);
+
+        const bool hasZip64UncompressedSize = entry.uncompressedSize == zip64Marker32;
+        const bool hasZip64CompressedSize = entry.compressedSize == zip64Marker32;
+        const bool hasZip64HeaderOffset = entry.headerOffset == zip64Marker32;
+
+        if ((hasZip64UncompressedSize || hasZip64CompressedSize || hasZip64HeaderOffset) &&
+            !readZip64ExtraField(header + centralFileHeaderSize + nameLength, extraLength, &entry,
+                                 hasZip64UncompressedSize, hasZip64CompressedSize, hasZip64HeaderOffset)) {
+
+            warnStore << "Broken zip64 extra field of" << entry.name;
+            return false;
+        }
+
+        pos += centralFileHeaderSize + nameLength + extraLength + commentLength;
+
+        if (entry.name.endsWith('/')) {
+            entry.name.chop(1);
+            directories.insert(entry.name);
+            continue;
+        }
+
+        if (flags & flagEncrypted) {
+            warnStore << "Encrypted zip entries are not supported:" << entry.name;
+            return false;
+        }
+
+        if (entry.method != methodStored && entry.method != methodDeflated) {
+            warnStore << "Unsupported compression method" << entry.method << "of" << entry.name;
+            return false;
+        }
+
+        if (entry.compressedSize < 0 || entry.uncompressedSize < 0 || entry.headerOffset < 0 ||
+            entry.headerOffset + localFileHeaderSize > archiveSize) {
+
+            return false;
+        }
+
+        const char *localHeader = archive + entry.headerOffset;
+        if (readLE<quint32>(localHeader) != localFileHeaderSignature) return false;
+
+        entry.dataOffset =
+            entry.headerOffset + localFileHeaderSize +
+            readLE<quint16>(localHeader + 26) +
+            readLE<quint16>(localHeader + 28);
+
+        if (entry.dataOffset + entry.compressedSize > archiveSize) return false;
+
+        addEntry(entry);
+    }
+
+    return true;
+}
+
+bool KoParallelZipStore::Private::readZip64ExtraField(const char *extra, int extraLength, ZipEntry *entry,
+                                                     bool hasUncompressedSize, bool hasCompressedSize,
+                                                     bool hasHeaderOffset) const
+{
+    int pos = 0;
+
+    while (pos + 4 <= extraLength) {
+        const quint16 tag = readLE<quint16>(extra + pos);
+        const quint16 size = readLE<quint16>(extra + pos + 2);
+
+        pos += 4;
+        if (pos + size > extraLength) return false;
+
+        if (tag == zip64ExtraFieldTag) {
+            const char *value = extra + pos;
+            const char *end = value + size;
+
+            // the values are stored in this order, only the overflowed ones
+            if (hasUncompressedSize) {
+                if (value + 8 > end) return false;
+                entry->uncompressedSize = readLE<quint64>(value);
+                value += 8;
+            }
+
+            if (hasCompressedSize) {
+                if (value + 8 > end) return false;
+                entry->compressedSize = readLE<quint64>(value);
+                value += 8;
+            }
+
+            if (hasHeaderOffset) {
+                if (value + 8 > end) return false;
+                entry->headerOffset = readLE<quint64>(value);
+            }
+
+            return true;
+        }
+
+        pos += size;
+    }
+
+    return false;
+}
+
+void KoParallelZipStore::Private::addEntry(const ZipEntry &entry)
+{
+    entries.insert(entry.name, entry);
+
+    int slashPos = entry.name.indexOf('/');
+    while (slashPos > 0) {
+        directories.insert(entry.name.left(slashPos));
+        slashPos = entry.name.indexOf('/', slashPos + 1);
+    }
+}
+
+QIODevice* KoParallelZipStore::Private::createReadDevice(const ZipEntry &entry) const
+{
+    QBuffer *buffer = new QBuffer();
+    buffer->setData(QByteArray::fromRawData(archive + entry.dataOffset, entry.compressedSize));
+    buffer->open(QIODevice::ReadOnly);
+
+    if (entry.method == methodStored) {
+        return buffer;
+    }
+
+    KCompressionDevice *device = new KCompressionDevice(buffer, true, KCompressionDevice::GZip);
+    device->setSkipHeaders();
+
+    if (!device->open(QIODevice::ReadOnly)) {
+        delete device;
+        return 0;
+    }
+
+    return device;
+}
+
+bool KoParallelZipStore::Private::write(const QByteArray &data)
+{
+    if (writeFailed) return false;
+
+    if (device->write(data) != data.size()) {
+        errorStore << "Could not write into the zip archive:" << device->errorString() << endl;
+        writeFailed = true;
+        return false;
+    }
+
+    writePos += data.size();
+    return true;
+}
+
+bool KoParallelZipStore::Private::writeFile(const QString &name, const CompressedFile &file)
+{
+    const QByteArray encodedName = name.toUtf8();
+
+    ZipEntry entry;
+    entry.name = name;
+    entry.method = file.method;
+    entry.crc = file.crc;
+    entry.compressedSize = file.data.size();
+    entry.uncompressedSize = file.uncompressedSize;
+    entry.headerOffset = writePos;
+
+    /**
+     * The local header stores either both sizes in the zip64 extra
+     * field or none of them
+     */
+    Zip64ExtraField zip64Field;
+
+    if (entry.uncompressedSize >= zip64Marker32 || entry.compressedSize >= zip64Marker32) {
+        zip64Field.add(entry.uncompressedSize);
+        zip64Field.add(entry.compressedSize);
+    }
+
+    const QByteArray extraField = zip64Field.toByteArray();
+
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream << localFileHeaderSignature
+           << (zip64Field.isEmpty() ? versionNeededToExtract : versionNeededToExtractZip64)
+           << flagUtf8Names
+           << entry.method
+           << dosTime
+           << dosDate
+           << entry.crc
+           << (zip64Field.isEmpty() ? quint32(entry.compressedSize) : zip64Marker32)
+           << (zip64Field.isEmpty() ? quint32(entry.uncompressedSize) : zip64Marker32)
+           << quint16(encodedName.size())
+           << quint16(extraField.size());
+
+    stream.writeRawData(encodedName.constData(), encodedName.size());
+    stream.writeRawData(extraField.constData(), extraField.size());
+
+    if (!write(header) || !write(file.data)) {
+        return false;
+    }
+
+    writtenEntries << entry;
+    return true;
+}
+
+bool KoParallelZipStore::Private::writePendingFiles(bool waitForAll)
+{
+    while (!pendingFiles.isEmpty()) {
+        const PendingFile &file = pendingFiles.first();
+
+        const bool shouldWait = waitForAll || pendingBytes > maxPendingBytes;
+        if (!shouldWait && !file.future.isFinished()) break;
+
+        const CompressedFile compressed = file.future.result();
+        const QString name = file.name;
+
+        pendingBytes -= file.size;
+        pendingFiles.removeFirst();
+
+        if (!writeFile(name, compressed)) {
+            return false;
+        }
+    }
+
+    return !writeFailed;
+}
+
+bool KoParallelZipStore::Private::writeCentralDirectory()
+{
+    const qint64 directoryOffset = writePos;
+
+    QByteArray directory;
+    QDataStream stream(&directory, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    Q_FOREACH (const ZipEntry &entry, writtenEntries) {
+        const QByteArray encodedName = entry.name.toUtf8();
+
+        const bool zip64UncompressedSize = entry.uncompressedSize >= zip64Marker32;
+        const bool zip64CompressedSize = entry.compressedSize >= zip64Marker32;
+        const bool zip64HeaderOffset = entry.headerOffset >= zip64Marker32;
+
+        Zip64ExtraField zip64Field;
+        if (zip64UncompressedSize) zip64Field.add(entry.uncompressedSize);
+        if (zip64CompressedSize) zip64Field.add(entry.compressedSize);
+        if (zip64HeaderOffset) zip64Field.add(entry.headerOffset);
+
+        const QByteArray extraField = zip64Field.toByteArray();
+
+        stream << centralFileHeaderSignature
+               << versionMadeBy
+               << (zip64Field.isEmpty() ? versionNeededToExtract : versionNeededToExtractZip64)
+               << flagUtf8Names
+               << entry.method
+               << dosTime
+               << dosDate
+               << entry.crc
+               << (zip64CompressedSize ? zip64Marker32 : quint32(entry.compressedSize))
+               << (zip64UncompressedSize ? zip64Marker32 : quint32(entry.uncompressedSize))
+               << quint16(encodedName.size())
+               << quint16(extraField.size())
+               << quint16(0) // comment length
+               << quint16(0) // disk number
+               << quint16(0) // internal attributes
+               << quint32(0100644 << 16) // external attributes: a regular file, rw-r--r--
+               << (zip64HeaderOffset ? zip64Marker32 : quint32(entry.headerOffset));
+
+        stream.writeRawData(encodedName.constData(), encodedName.size());
+        stream.writeRawData(extraField.constData(), extraField.size());
+    }
+
+    const qint64 directorySize = directory.size();
+    const qint64 numEntries = writtenEntries.size();
+
+    const bool needsZip64 =
+        numEntries >= zip64Marker16 ||
+        directorySize >= zip64Marker32 ||
+        directoryOffset >= zip64Marker32;
+
+    if (needsZip64) {
+        const qint64 zip64EocdOffset = directoryOffset + directorySize;
+
+        stream << zip64EndOfCentralDirectorySignature
+               << quint64(zip64EndOfCentralDirectorySize - 12) // size of the rest of the record
+               << versionMadeBy
+               << versionNeededToExtractZip64
+               << quint32(0) // number of this disk
+               << quint32(0) // disk with the central directory
+               << quint64(numEntries)
+               << quint64(numEntries)
+               << quint64(directorySize)
+               << quint64(directoryOffset);
+
+        stream << zip64EndOfCentralDirectoryLocatorSignature
+               << quint32(0) // disk with the zip64 end of central directory
+               << quint64(zip64EocdOffset)
+               << quint32(1); // total number of disks
+    }
+
+    stream << endOfCentralDirectorySignature
+           << quint16(0) // number of this disk
+           << quint16(0) // disk with the central directory
+           << (needsZip64 ? zip64Marker16 : quint16(numEntries))
+           << (needsZip64 ? zip64Marker16 : quint16(numEntries))
+           << (needsZip64 ? zip64Marker32 : quint32(directorySize))
+           << (needsZip64 ? zip64Marker32 : quint32(directoryOffset))
+           << quint16(0); // comment length
+
+    return write(directory);
+}
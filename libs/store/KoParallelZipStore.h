@@ -0,0 +1,84 @@
+/* This file is part of the KDE project
+   Copyright (C) 2018 Krita developers
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+*/
+
+#ifndef koParallelZipStore_h
+#define koParallelZipStore_h
+
+#include "KoStore.h"
+
+#include <QScopedPointer>
+
+/**
+ * A zip store, which does the heavy lifting in parallel.
+ *
+ * When writing, every file is buffered in memory on close() and
+ * deflated on a thread pool, while the caller continues producing the
+ * next files. The compressed files are written into the archive in the
+ * order they were closed, so the archive is the same as the one written
+ * by KoZipStore (the "mimetype" file goes first and is not compressed).
+ *
+ * When reading, the archive is memory-mapped (or read into memory, if
+ * the device is not a file) and every file can be decompressed
+ * independently, which allows reading different files from several
+ * threads with readFileConcurrently().
+ *
+ * Archives with more than 65535 entries or bigger than 4 GiB are
+ * written and read with the zip64 records. Encrypted entries are not
+ * supported, the store reports bad() for them, so the caller can fall
+ * back to KoZipStore.
+ */
+class KoParallelZipStore : public KoStore
+{
+public:
+    KoParallelZipStore(const QString &fileName, Mode mode, const QByteArray &appIdentification,
+                       bool writeMimetype = true);
+    KoParallelZipStore(QIODevice *dev, Mode mode, const QByteArray &appIdentification,
+                       bool writeMimetype = true);
+    ~KoParallelZipStore() override;
+
+    void setCompressionEnabled(bool e) override;
+
+    QStringList directoryList() const override;
+
+    bool supportsConcurrentReading() const override;
+
+protected:
+    bool doFinalize() override;
+    bool openWrite(const QString &name) override;
+    bool openRead(const QString &name) override;
+    bool closeWrite() override;
+    bool closeRead() override {
+        return true;
+    }
+    bool enterRelativeDirectory(const QString &dirName) override;
+    bool enterAbsoluteDirectory(const QString &path) override;
+    bool fileExists(const QString &absPath) const override;
+    bool doReadFileConcurrently(const QString &absPath, QByteArray *data) const override;
+
+private:
+    void init(const QByteArray &appIdentification);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+
+    Q_DECLARE_PRIVATE(KoStore)
+};
+
+#endif
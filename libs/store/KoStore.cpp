@@ -23,6 +23,7 @@
 #include "KoStore_p.h"
 
 #include "KoZipStore.h"
+#include "KoParallelZipStore.h"
 #include "KoDirectoryStore.h"
 
 #include <QBuffer>
@@ -65,6 +66,8 @@ KoStore* KoStore::createStore(const QString& fileName, Mode mode, const QByteArr
     switch (backend) {
     case Zip:
         return new KoZipStore(fileName, mode, appIdentification, writeMimetype);
+    case ParallelZip:
+        return new KoParallelZipStore(fileName, mode, appIdentification, writeMimetype);
     case Directory:
         return new KoDirectoryStore(fileName /* should be a dir name.... */, mode, writeMimetype);
     default:
@@ -91,6 +94,8 @@ KoStore* KoStore::createStore(QIODevice *device, Mode mode, const QByteArray & a
         // fallback
     case Zip:
         return new KoZipStore(device, mode, appIdentification, writeMimetype);
+    case ParallelZip:
+        return new KoParallelZipStore(device, mode, appIdentification, writeMimetype);
     default:
         warnStore << "Unsupported backend requested for KoStore : " << backend;
         return 0;
@@ -415,6 +420,34 @@ void KoStore::setCompressionEnabled(bool /*e*/)
 {
 }
 
+bool KoStore::supportsConcurrentReading() const
+{
+    return false;
+}
+
+bool KoStore::readFileConcurrently(const QString &fileName, QByteArray *data)
+{
+    Q_D(KoStore);
+
+    if (d->mode != Read) {
+        errorStore << "KoStore: Can not read from store that is opened for writing" << endl;
+        return false;
+    }
+
+    if (!supportsConcurrentReading()) {
+        return extractFile(fileName, *data);
+    }
+
+    return doReadFileConcurrently(d->toExternalNaming(fileName), data);
+}
+
+bool KoStore::doReadFileConcurrently(const QString &absPath, QByteArray *data) const
+{
+    Q_UNUSED(absPath);
+    Q_UNUSED(data);
+    return false;
+}
+
 bool KoStore::isEncrypted()
 {
     return false;
@@ -40,7 +40,7 @@ class KRITASTORE_EXPORT KoStore
 public:
 
     enum Mode { Read, Write };
-    enum Backend { Auto, Zip, Directory };
+    enum Backend { Auto, Zip, Directory, ParallelZip };
 
     /**
      * Open a store (i.e. the representation on disk of a Krita document).
@@ -284,6 +284,25 @@ public:
      */
     virtual void setCompressionEnabled(bool e);
 
+    /**
+     * @return true if the files of the store opened for reading can be
+     * read with readFileConcurrently() from several threads at once
+     */
+    virtual bool supportsConcurrentReading() const;
+
+    /**
+     * Reads the whole file @p fileName into @p data without opening
+     * it with open(). If supportsConcurrentReading() returns true, the
+     * method can be called from several threads at the same time, e.g.
+     * for decoding the layers in parallel. Otherwise, the method is
+     * equivalent to extractFile().
+     *
+     * A relative @p fileName is resolved against the current directory,
+     * which must not be changed while other threads are reading. Pass
+     * absolute names ("tar:/...") to avoid that.
+     */
+    bool readFileConcurrently(const QString &fileName, QByteArray *data);
+
 protected:
     KoStore(Mode mode, bool writeMimetype = true);
 
@@ -337,6 +356,13 @@ protected:
      */
     virtual bool fileExists(const QString &absPath) const = 0;
 
+    /**
+     * Reads the file for readFileConcurrently(). Must be thread-safe
+     * if supportsConcurrentReading() returns true.
+     * @param absPath the absolute path inside the store
+     */
+    virtual bool doReadFileConcurrently(const QString &absPath, QByteArray *data) const;
+
 protected:
     KoStorePrivate *d_ptr;
 
@@ -0,0 +1,128 @@
+/* This file is part of the KDE project
+ * Copyright (C) 2018 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoParallelZipStoreBenchmark.h"
+
+#include <KoStore.h>
+
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtConcurrent>
+
+namespace {
+
+const QByteArray mimetype("application/x-krita");
+
+const int numFiles = 200;
+const int fileSize = 1024 * 1024;
+
+/**
+ * A semi-compressible chunk of data, resembling the raw layer data
+ */
+QByteArray generateFileData(int seed, int size)
+{
+    QByteArray data(size, 0);
+
+    quint32 value = seed * 2654435761u;
+    for (int i = 0; i < size; i++) {
+        value = value * 1103515245u + 12345u;
+        data[i] = i % 4 == 3 ? char(0xff) : char((value >> 24) & 0x0f);
+    }
+
+    return data;
+}
+
+QString fileName(int index)
+{
+    return QString("layers/layer%1").arg(index);
+}
+
+void writeArchive(KoStore::Backend backend, const QString &path)
+{
+    QScopedPointer<KoStore> store(KoStore::createStore(path, KoStore::Write, mimetype, backend));
+    QVERIFY(!store->bad());
+
+    for (int i = 0; i < numFiles; i++) {
+        QVERIFY(store->open(fileName(i)));
+        QCOMPARE(store->write(generateFileData(i, fileSize)), qint64(fileSize));
+        QVERIFY(store->close());
+    }
+
+    QVERIFY(store->finalize());
+}
+
+}
+
+void KoParallelZipStoreBenchmark::benchmarkWriteZip()
+{
+    QTemporaryDir dir;
+
+    QBENCHMARK_ONCE {
+        writeArchive(KoStore::Zip, dir.path() + "/benchmark.kra");
+    }
+}
+
+void KoParallelZipStoreBenchmark::benchmarkWriteParallelZip()
+{
+    QTemporaryDir dir;
+
+    QBENCHMARK_ONCE {
+        writeArchive(KoStore::ParallelZip, dir.path() + "/benchmark.kra");
+    }
+}
+
+void KoParallelZipStoreBenchmark::benchmarkReadSequential()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/benchmark.kra";
+    writeArchive(KoStore::ParallelZip, path);
+
+    QBENCHMARK_ONCE {
+        QScopedPointer<KoStore> store(KoStore::createStore(path, KoStore::Read, mimetype, KoStore::Zip));
+
+        QByteArray data;
+        for (int i = 0; i < numFiles; i++) {
+            QVERIFY(store->extractFile(fileName(i), data));
+        }
+    }
+}
+
+void KoParallelZipStoreBenchmark::benchmarkReadConcurrent()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/benchmark.kra";
+    writeArchive(KoStore::ParallelZip, path);
+
+    QVector<int> indexes;
+    for (int i = 0; i < numFiles; i++) {
+        indexes << i;
+    }
+
+    QBENCHMARK_ONCE {
+        QScopedPointer<KoStore> store(KoStore::createStore(path, KoStore::Read, mimetype, KoStore::ParallelZip));
+
+        QtConcurrent::blockingMap(indexes,
+            [&store] (int index) {
+                QByteArray data;
+                store->readFileConcurrently(fileName(index), &data);
+            });
+    }
+}
+
+QTEST_GUILESS_MAIN(KoParallelZipStoreBenchmark)
@@ -0,0 +1,320 @@
+/* This file is part of the KDE project
+ * Copyright (C) 2018 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoParallelZipStore.h"
+
+#include <KoStore.h>
+
+#include <QBuffer>
+#include <QFileInfo>
+#include <QtEndian>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtConcurrent>
+
+namespace {
+
+const QByteArray mimetype("application/x-krita");
+
+/**
+ * A semi-compressible chunk of data, resembling the raw layer data
+ */
+QByteArray generateFileData(int seed, int size)
+{
+    QByteArray data(size, 0);
+
+    quint32 value = seed * 2654435761u;
+    for (int i = 0; i < size; i++) {
+        value = value * 1103515245u + 12345u;
+        data[i] = i % 4 == 3 ? char(0xff) : char((value >> 24) & 0x0f);
+    }
+
+    return data;
+}
+
+QString fileName(int index)
+{
+    return QString("layers/layer%1").arg(index);
+}
+
+void writeArchive(KoStore::Backend backend, const QString &path, int numFiles, int fileSize)
+{
+    QScopedPointer<KoStore> store(KoStore::createStore(path, KoStore::Write, mimetype, backend));
+    QVERIFY(!store->bad());
+
+    QVERIFY(store->open("maindoc.xml"));
+    QVERIFY(store->write(QByteArray("<DOC/>")) > 0);
+    QVERIFY(store->close());
+
+    for (int i = 0; i < numFiles; i++) {
+        QVERIFY(store->open(fileName(i)));
+        QCOMPARE(store->write(generateFileData(i, fileSize)), qint64(fileSize));
+        QVERIFY(store->close());
+    }
+
+    QVERIFY(store->finalize());
+}
+
+void verifyArchive(KoStore::Backend backend, const QString &path, int numFiles, int fileSize)
+{
+    QScopedPointer<KoStore> store(KoStore::createStore(path, KoStore::Read, mimetype, backend));
+    QVERIFY(!store->bad());
+
+    QVERIFY(store->hasFile("mimetype"));
+
+    QByteArray data;
+    QVERIFY(store->extractFile("mimetype", data));
+    QCOMPARE(data, mimetype);
+
+    QVERIFY(store->extractFile("maindoc.xml", data));
+    QCOMPARE(data, QByteArray("<DOC/>"));
+
+    QVERIFY(!store->enterDirectory("nonexistent"));
+    QVERIFY(store->enterDirectory("layers"));
+    QVERIFY(store->hasFile("layer0"));
+    QVERIFY(store->leaveDirectory());
+
+    for (int i = 0; i < numFiles; i++) {
+        QVERIFY(store->open(fileName(i)));
+        QCOMPARE(store->size(), qint64(fileSize));
+        QCOMPARE(store->read(fileSize), generateFileData(i, fileSize));
+        QVERIFY(store->close());
+    }
+}
+
+/**
+ * Returns the number of entries stored in the plain end of central
+ * directory record of the archive, 0xffff means the zip64 one is used
+ */
+quint16 plainEndOfCentralDirectoryEntries(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+
+    file.seek(file.size() - 22);
+    const QByteArray eocd = file.read(22);
+    if (!eocd.startsWith("PK\x05\x06")) return 0;
+
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(eocd.constData() + 10));
+}
+}
+
+void TestKoParallelZipStore::testRoundtrip()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/roundtrip.kra";
+
+    writeArchive(KoStore::ParallelZip, path, 20, 100000);
+    verifyArchive(KoStore::ParallelZip, path, 20, 100000);
+}
+
+void TestKoParallelZipStore::testReadKoZipStoreArchive()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/kozip.kra";
+
+    writeArchive(KoStore::Zip, path, 20, 100000);
+    verifyArchive(KoStore::ParallelZip, path, 20, 100000);
+}
+
+void TestKoParallelZipStore::testWriteKoZipStoreCompatible()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/parallel.kra";
+
+    writeArchive(KoStore::ParallelZip, path, 20, 100000);
+    verifyArchive(KoStore::Zip, path, 20, 100000);
+
+    // the mimetype must be the first file and must be stored uncompressed
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray header = file.read(30 + 8 + mimetype.size());
+    QVERIFY(header.startsWith("PK\x03\x04"));
+    QCOMPARE(header.mid(8, 2), QByteArray(2, '\0'));
+    QCOMPARE(header.mid(30, 8), QByteArray("mimetype"));
+    QCOMPARE(header.mid(38), mimetype);
+}
+
+void TestKoParallelZipStore::testUncompressedFiles()
+{
+    QByteArray archive;
+    QBuffer buffer(&archive);
+
+    const QByteArray data = generateFileData(1, 50000);
+
+    {
+        QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Write, mimetype, KoStore::ParallelZip));
+        QVERIFY(!store->bad());
+
+        store->setCompressionEnabled(false);
+        QVERIFY(store->open("stored"));
+        store->write(data);
+        QVERIFY(store->close());
+
+        store->setCompressionEnabled(true);
+        QVERIFY(store->open("deflated"));
+        store->write(data);
+        QVERIFY(store->close());
+
+        QVERIFY(store->open("empty"));
+        QVERIFY(store->close());
+
+        QVERIFY(store->finalize());
+    }
+
+    QVERIFY(archive.contains(data));
+
+    buffer.close();
+
+    QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Read, mimetype, KoStore::ParallelZip));
+    QVERIFY(!store->bad());
+
+    QByteArray result;
+    QVERIFY(store->extractFile("stored", result));
+    QCOMPARE(result, data);
+    QVERIFY(store->extractFile("deflated", result));
+    QCOMPARE(result, data);
+    QVERIFY(store->extractFile("empty", result));
+    QVERIFY(result.isEmpty());
+}
+
+void TestKoParallelZipStore::testConcurrentReading()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/concurrent.kra";
+
+    const int numFiles = 50;
+    const int fileSize = 100000;
+
+    writeArchive(KoStore::ParallelZip, path, numFiles, fileSize);
+
+    QScopedPointer<KoStore> store(KoStore::createStore(path, KoStore::Read, mimetype, KoStore::ParallelZip));
+    QVERIFY(store->supportsConcurrentReading());
+
+    QVector<int> indexes;
+    for (int i = 0; i < numFiles; i++) {
+        indexes << i;
+    }
+
+    QVector<QByteArray> results(numFiles);
+
+    // the sequential API is used at the same time to check it is not affected
+    QVERIFY(store->open("maindoc.xml"));
+
+    QtConcurrent::blockingMap(indexes,
+        [&store, &results] (int index) {
+            store->readFileConcurrently(fileName(index), &results[index]);
+        });
+
+    QCOMPARE(store->read(6), QByteArray("<DOC/>"));
+    QVERIFY(store->close());
+
+    for (int i = 0; i < numFiles; i++) {
+        QCOMPARE(results[i], generateFileData(i, fileSize));
+    }
+
+    // relative names are resolved against the current directory
+    QVERIFY(store->enterDirectory("layers"));
+    QByteArray data;
+    QVERIFY(store->readFileConcurrently("layer3", &data));
+    QCOMPARE(data, generateFileData(3, fileSize));
+    QVERIFY(!store->readFileConcurrently("nonexistent", &data));
+
+    // KoZipStore falls back to the sequential reading
+    QScopedPointer<KoStore> zipStore(KoStore::createStore(path, KoStore::Read, mimetype, KoStore::Zip));
+    QVERIFY(!zipStore->supportsConcurrentReading());
+    QVERIFY(zipStore->readFileConcurrently(fileName(3), &data));
+    QCOMPARE(data, generateFileData(3, fileSize));
+}
+
+void TestKoParallelZipStore::testBrokenArchive()
+{
+    QByteArray archive("this is not a zip file");
+    QBuffer buffer(&archive);
+
+    QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Read, mimetype, KoStore::ParallelZip));
+    QVERIFY(store->bad());
+    QVERIFY(!store->supportsConcurrentReading());
+}
+
+void TestKoParallelZipStore::testZip64ManyEntries()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/many.kra";
+
+    // mimetype + maindoc.xml + the layers overflow the 16-bit counter
+    const int numFiles = 0xffff;
+    const int fileSize = 16;
+
+    writeArchive(KoStore::ParallelZip, path, numFiles, fileSize);
+    QCOMPARE(plainEndOfCentralDirectoryEntries(path), quint16(0xffff));
+
+    verifyArchive(KoStore::ParallelZip, path, numFiles, fileSize);
+}
+
+void TestKoParallelZipStore::testZip64BigOffsets()
+{
+    if (sizeof(void*) < 8) {
+        QSKIP("The archive cannot be mapped into memory on a 32-bit system");
+    }
+
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/big.kra";
+
+    /**
+     * The archive is written after a 4.5 GiB hole, so all the headers and
+     * the central directory are stored past the 32-bit limit. The hole is
+     * a sparse region on the filesystems supporting that.
+     */
+    const qint64 holeSize = Q_INT64_C(0x120000000);
+
+    const int numFiles = 5;
+    const int fileSize = 100000;
+
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+
+        if (!file.resize(holeSize) || !file.seek(holeSize)) {
+            QSKIP("The filesystem cannot hold a file bigger than 4 GiB");
+        }
+
+        QScopedPointer<KoStore> store(KoStore::createStore(&file, KoStore::Write, mimetype, KoStore::ParallelZip));
+        QVERIFY(!store->bad());
+
+        QVERIFY(store->open("maindoc.xml"));
+        QVERIFY(store->write(QByteArray("<DOC/>")) > 0);
+        QVERIFY(store->close());
+
+        for (int i = 0; i < numFiles; i++) {
+            QVERIFY(store->open(fileName(i)));
+            QCOMPARE(store->write(generateFileData(i, fileSize)), qint64(fileSize));
+            QVERIFY(store->close());
+        }
+
+        QVERIFY(store->finalize());
+    }
+
+    QVERIFY(QFileInfo(path).size() > holeSize);
+    QCOMPARE(plainEndOfCentralDirectoryEntries(path), quint16(0xffff));
+
+    verifyArchive(KoStore::ParallelZip, path, numFiles, fileSize);
+}
+
+QTEST_GUILESS_MAIN(TestKoParallelZipStore)
@@ -66,6 +66,7 @@
 #include "KisDocument.h"
 #include "KisMainWindow.h"
 #include "KisAutoSaveRecoveryDialog.h"
+#include "KisAutosaveJournal.h"
 #include "KisPart.h"
 #include <kis_icon.h>
 #include "kis_md5_generator.h"
@@ -681,6 +682,7 @@ void KisApplication::checkAutosaveFiles()
             Q_FOREACH (const QString &autosaveFile, autosaveFiles) {
                 if (!filesToRecover.contains(autosaveFile)) {
                     QFile::remove(dir.absolutePath() + "/" + autosaveFile);
+                    QFile::remove(KisAutosaveJournal::journalFileName(dir.absolutePath() + "/" + autosaveFile));
                 }
             }
             autosaveFiles = filesToRecover;
@@ -18,6 +18,7 @@
 */
 
 #include "KisAutoSaveRecoveryDialog.h"
+#include "KisAutosaveJournal.h"
 
 #include <KoStore.h>
 
@@ -225,10 +226,20 @@ KisAutoSaveRecoveryDialog::KisAutoSaveRecoveryDialog(const QStringList &filename
             delete store;
         }
 
-        // get the date
+        // get the date, the incremental autosaves are appended to the journal
         QDateTime date = QFileInfo(path).lastModified();
+
+        const int numDeltaRecords = KisAutosaveJournal::countDeltaRecords(path);
+        if (numDeltaRecords > 0) {
+            date = qMax(date, QFileInfo(KisAutosaveJournal::journalFileName(path)).lastModified());
+        }
+
         file->date = "(" + date.toString(Qt::LocalDate) + ")";
 
+        if (numDeltaRecords > 0) {
+            file->date += " " + i18np("+ 1 incremental save", "+ %1 incremental saves", numDeltaRecords);
+        }
+
         fileItems.append(file);
     }
 
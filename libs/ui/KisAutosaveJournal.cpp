@@ -0,0 +1,671 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisAutosaveJournal.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QUuid>
+#include <QVector>
+
+#include <klocalizedstring.h>
+
+#include <KoColorSpace.h>
+#include <KoColorProfile.h>
+
+#include "kis_debug.h"
+#include "kis_image.h"
+#include "kis_image_animation_interface.h"
+#include "kis_node.h"
+#include "kis_paint_device.h"
+#include "kis_paint_layer.h"
+#include "kis_mask.h"
+#include "kis_transform_mask.h"
+#include "kis_transform_mask_params_interface.h"
+#include "kis_selection.h"
+#include "kis_pixel_selection.h"
+#include "kis_selection_based_layer.h"
+#include "kis_clone_layer.h"
+#include "kis_node_filter_interface.h"
+#include "filter/kis_filter_configuration.h"
+#include "kis_datamanager.h"
+#include "kis_layer_utils.h"
+#include "kis_file_layer.h"
+#include "flake/kis_shape_layer.h"
+
+
+namespace {
+
+const quint32 journalMagic = 0x4b52414a; // "KRAJ"
+const quint32 journalVersion = 2;
+const quint32 recordMagic = 0x52454344; // "RECD"
+const quint32 recordEndMagic = 0x454e4452; // "ENDR"
+
+enum DeviceKind {
+    NodePaintDevice = 0,
+    NodeSelection = 1
+};
+
+struct TrackedDevice {
+    QUuid nodeUuid;
+    DeviceKind kind = NodePaintDevice;
+
+    /**
+     * Derived devices (e.g. the projection of a shape layer) are not
+     * written into the journal. Any change in them means that some data
+     * we cannot track has changed, so a full save is needed.
+     */
+    bool isDerived = false;
+
+    // the device of the cloned image, valid until the save is completed
+    KisPaintDeviceSP device;
+
+    KisTileRevisionSnapshot snapshot;
+};
+
+struct TrackedState {
+    QByteArray signature;
+    QHash<QString, TrackedDevice> devices;
+    bool isTrackable = true;
+
+    void dropDevices() {
+        for (auto it = devices.begin(); it != devices.end(); ++it) {
+            it->device = 0;
+        }
+    }
+};
+
+struct DeltaDevice {
+    QUuid nodeUuid;
+    DeviceKind kind;
+    KisPaintDeviceSP device;
+    QVector<QRect> rects;
+};
+
+QString deviceKey(const QUuid &uuid, DeviceKind kind)
+{
+    return uuid.toString() + QLatin1Char(':') + QString::number(int(kind));
+}
+
+/**
+ * The nodes whose data is fully described by the structure signature
+ * and the tracked devices. Any other node type (e.g. a colorize mask)
+ * makes every autosave a full one.
+ */
+bool isTrackableNodeType(KisNodeSP node)
+{
+    static const QSet<QString> trackableTypes = {
+        "KisGroupLayer", "KisPaintLayer", "KisAdjustmentLayer",
+        "KisGeneratorLayer", "KisCloneLayer", "KisShapeLayer",
+        "KisFileLayer", "KisSelectionMask", "KisTransparencyMask",
+        "KisFilterMask", "KisTransformMask"
+    };
+
+    return trackableTypes.contains(node->metaObject()->className());
+}
+
+KisSelectionSP nodeSelection(KisNodeSP node)
+{
+    if (KisMask *mask = dynamic_cast<KisMask*>(node.data())) {
+        return mask->selection();
+    } else if (KisSelectionBasedLayer *layer = dynamic_cast<KisSelectionBasedLayer*>(node.data())) {
+        return layer->internalSelection();
+    }
+
+    return 0;
+}
+
+KisPaintDeviceSP trackedDevice(KisNodeSP node, DeviceKind kind)
+{
+    if (kind == NodePaintDevice) {
+        return dynamic_cast<KisPaintLayer*>(node.data()) ? node->paintDevice() : 0;
+    }
+
+    KisSelectionSP selection = nodeSelection(node);
+    return selection ? KisPaintDeviceSP(selection->pixelSelection()) : 0;
+}
+
+void addDevice(KisNodeSP node, DeviceKind kind, KisPaintDeviceSP device,
+               bool isDerived, QDataStream &signature, TrackedState *state)
+{
+    signature << qint32(kind) << isDerived
+              << device->x() << device->y()
+              << device->colorSpace()->id()
+              << qint32(device->pixelSize());
+
+    TrackedDevice tracked;
+    tracked.nodeUuid = node->uuid();
+    tracked.kind = kind;
+    tracked.isDerived = isDerived;
+    tracked.device = device;
+    tracked.snapshot = device->dataManager()->takeRevisionSnapshot();
+
+    state->devices.insert(deviceKey(tracked.nodeUuid, kind), tracked);
+}
+
+void collectNode(KisNodeSP node, QDataStream &signature, TrackedState *state)
+{
+    if (!isTrackableNodeType(node)) {
+        state->isTrackable = false;
+    }
+
+    signature << node->uuid().toString()
+              << QString(node->metaObject()->className())
+              << node->name()
+              << node->opacity()
+              << node->visible()
+              << node->compositeOpId()
+              << (node->colorSpace() ? node->colorSpace()->id() : QString())
+              << qint32(node->childCount());
+
+    Q_FOREACH (const KisBaseNode::Property &prop, node->sectionModelProperties()) {
+        signature << prop.name << prop.state.toString();
+    }
+
+    if (KisNodeFilterInterface *filterNode = dynamic_cast<KisNodeFilterInterface*>(node.data())) {
+        signature << (filterNode->filter() ? filterNode->filter()->toXML() : QString());
+    }
+
+    if (KisTransformMask *mask = dynamic_cast<KisTransformMask*>(node.data())) {
+        QDomDocument doc;
+        QDomElement root = doc.createElement("params");
+        doc.appendChild(root);
+        if (mask->transformParams()) {
+            mask->transformParams()->toXML(&root);
+        }
+        signature << doc.toString();
+    }
+
+    if (KisCloneLayer *layer = dynamic_cast<KisCloneLayer*>(node.data())) {
+        signature << (layer->copyFrom() ? layer->copyFrom()->uuid().toString() : QString());
+    }
+
+    if (KisFileLayer *layer = dynamic_cast<KisFileLayer*>(node.data())) {
+        signature << layer->path();
+    }
+
+    if (dynamic_cast<KisPaintLayer*>(node.data())) {
+        addDevice(node, NodePaintDevice, node->paintDevice(), false, signature, state);
+    } else if (dynamic_cast<KisShapeLayer*>(node.data())) {
+        addDevice(node, NodePaintDevice, node->paintDevice(), true, signature, state);
+    }
+
+    KisSelectionSP selection = nodeSelection(node);
+    if (selection) {
+        addDevice(node, NodeSelection, selection->pixelSelection(),
+                  selection->hasShapeSelection(), signature, state);
+    }
+
+    node = node->firstChild();
+    while (node) {
+        collectNode(node, signature, state);
+        node = node->nextSibling();
+    }
+}
+
+TrackedState collectState(KisImageSP image)
+{
+    TrackedState state;
+
+    QDataStream signature(&state.signature, QIODevice::WriteOnly);
+    signature << image->width() << image->height()
+              << image->xRes() << image->yRes()
+              << image->colorSpace()->id()
+              << (image->colorSpace()->profile() ? image->colorSpace()->profile()->name() : QString());
+
+    collectNode(image->root(), signature, &state);
+
+    if (image->animationInterface()->hasAnimation()) {
+        state.isTrackable = false;
+    }
+
+    return state;
+}
+
+/**
+ * The hash of the tail of the base file. The tail of a .kra file is the
+ * zip central directory, which has the checksums of all the files in the
+ * archive, so it identifies the content of the base without reading all
+ * of it.
+ */
+QByteArray baseFileFingerprint(const QString &baseFileName)
+{
+    const qint64 tailSize = 64 * 1024;
+
+    QFile file(baseFileName);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    const qint64 size = qMin(tailSize, file.size());
+    if (!file.seek(file.size() - size)) return QByteArray();
+
+    return QCryptographicHash::hash(file.read(size), QCryptographicHash::Sha1);
+}
+
+bool readJournalHeader(QDataStream &stream, const QString &baseFileName)
+{
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 baseSize = 0;
+    qint64 baseModified = 0;
+    QByteArray baseFingerprint;
+
+    stream >> magic >> version;
+
+    if (stream.status() != QDataStream::Ok ||
+        magic != journalMagic ||
+        version != journalVersion) {
+
+        return false;
+    }
+
+    stream >> baseSize >> baseModified >> baseFingerprint;
+
+    const QFileInfo info(baseFileName);
+
+    return stream.status() == QDataStream::Ok &&
+        baseSize == info.size() &&
+        baseModified == info.lastModified().toMSecsSinceEpoch() &&
+        !baseFingerprint.isEmpty() &&
+        baseFingerprint == baseFileFingerprint(baseFileName);
+}
+
+struct DeltaTile {
+    QRect rect;
+    QByteArray data;
+};
+
+struct DeltaRecordDevice {
+    QUuid nodeUuid;
+    DeviceKind kind;
+    qint32 pixelSize;
+    QVector<DeltaTile> tiles;
+};
+
+/**
+ * Reads the next complete record. Returns false if the record is
+ * truncated or broken.
+ */
+bool readRecord(QDataStream &stream, QVector<DeltaRecordDevice> *record)
+{
+    quint32 magic = 0;
+    qint32 numDevices = 0;
+
+    stream >> magic >> numDevices;
+    if (stream.status() != QDataStream::Ok || magic != recordMagic || numDevices < 0) {
+        return false;
+    }
+
+    for (int i = 0; i < numDevices; i++) {
+        DeltaRecordDevice device;
+        QString uuid;
+        qint32 kind = 0;
+        qint32 numTiles = 0;
+
+        stream >> uuid >> kind >> device.pixelSize >> numTiles;
+        if (stream.status() != QDataStream::Ok || numTiles < 0) {
+            return false;
+        }
+
+        device.nodeUuid = QUuid(uuid);
+        device.kind = DeviceKind(kind);
+
+        for (int j = 0; j < numTiles; j++) {
+            DeltaTile tile;
+            stream >> tile.rect >> tile.data;
+            device.tiles << tile;
+        }
+
+        if (stream.status() != QDataStream::Ok) {
+            return false;
+        }
+
+        *record << device;
+    }
+
+    stream >> magic;
+    return stream.status() == QDataStream::Ok && magic == recordEndMagic;
+}
+
+}
+
+struct KisAutosaveJournal::Private
+{
+    QString baseFileName;
+    bool hasBase = false;
+    qint64 baseFileSize = 0;
+    qint64 baseFileModified = 0;
+    QByteArray baseFileFingerprint;
+
+    qint64 journalSize = 0;
+    int numDeltaRecords = 0;
+
+    int maxDeltaRecords = 20;
+    qreal compactionRatio = 0.5;
+
+    TrackedState committedState;
+
+    SaveMode pendingMode = FullSave;
+    QString pendingBaseFileName;
+    TrackedState pendingState;
+    QVector<DeltaDevice> pendingDeltas;
+    qint64 pendingJournalSize = 0;
+
+    SaveMode decideSaveMode();
+};
+
+KisAutosaveJournal::KisAutosaveJournal()
+    : m_d(new Private)
+{
+}
+
+KisAutosaveJournal::~KisAutosaveJournal()
+{
+}
+
+KisAutosaveJournal::SaveMode KisAutosaveJournal::Private::decideSaveMode()
+{
+    if (!hasBase || pendingBaseFileName != baseFileName) return FullSave;
+    if (!pendingState.isTrackable) return FullSave;
+    if (pendingState.signature != committedState.signature) return FullSave;
+    if (numDeltaRecords >= maxDeltaRecords) return FullSave;
+    if (journalSize > compactionRatio * baseFileSize) return FullSave;
+
+    qint64 estimatedSize = 0;
+
+    for (auto it = pendingState.devices.constBegin(); it != pendingState.devices.constEnd(); ++it) {
+        const TrackedDevice &newDevice = it.value();
+        const TrackedDevice oldDevice = committedState.devices.value(it.key());
+
+        if (oldDevice.snapshot.isNull() ||
+            newDevice.snapshot.defaultPixel() != oldDevice.snapshot.defaultPixel()) {
+
+            return FullSave;
+        }
+
+        const QVector<QRect> rects = newDevice.snapshot.changedTiles(oldDevice.snapshot);
+        if (rects.isEmpty()) continue;
+
+        if (newDevice.isDerived) return FullSave;
+
+        DeltaDevice delta;
+        delta.nodeUuid = newDevice.nodeUuid;
+        delta.kind = newDevice.kind;
+        delta.device = newDevice.device;
+
+        Q_FOREACH (const QRect &rc, rects) {
+            delta.rects << rc.translated(delta.device->x(), delta.device->y());
+            estimatedSize += rc.width() * rc.height() * delta.device->pixelSize();
+        }
+
+        pendingDeltas << delta;
+    }
+
+    /**
+     * The document is modified, but not a single tile has changed,
+     * it means that the change is something we cannot track
+     */
+    if (pendingDeltas.isEmpty()) return FullSave;
+
+    /**
+     * A big part of the image has changed (e.g. a filter has been
+     * applied), it is time to compact the journal
+     */
+    if (journalSize + estimatedSize > compactionRatio * baseFileSize) return FullSave;
+
+    return DeltaSave;
+}
+
+KisAutosaveJournal::SaveMode KisAutosaveJournal::prepareSave(KisImageSP clonedImage, const QString &baseFileName)
+{
+    m_d->pendingBaseFileName = baseFileName;
+    m_d->pendingState = collectState(clonedImage);
+    m_d->pendingDeltas.clear();
+
+    m_d->pendingMode = m_d->decideSaveMode();
+
+    if (m_d->pendingMode == FullSave) {
+        m_d->pendingDeltas.clear();
+        m_d->pendingState.dropDevices();
+    }
+
+    return m_d->pendingMode;
+}
+
+KisImportExportFilter::ConversionStatus KisAutosaveJournal::writePendingDelta()
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(m_d->pendingMode == DeltaSave, KisImportExportFilter::InternalError);
+
+    QFile file(journalFileName(m_d->baseFileName));
+    if (!file.open(QIODevice::ReadWrite)) {
+        return KisImportExportFilter::CreationError;
+    }
+
+    // the journal has been removed or truncated by someone else
+    if (file.size() < m_d->journalSize) {
+        return KisImportExportFilter::CreationError;
+    }
+
+    // drop the tail of a record that failed to be written
+    if (file.size() > m_d->journalSize && !file.resize(m_d->journalSize)) {
+        return KisImportExportFilter::CreationError;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    if (m_d->journalSize == 0) {
+        stream << journalMagic << journalVersion
+               << m_d->baseFileSize << m_d->baseFileModified
+               << m_d->baseFileFingerprint;
+    } else {
+        file.seek(m_d->journalSize);
+    }
+
+    stream << recordMagic << qint32(m_d->pendingDeltas.size());
+
+    QByteArray buffer;
+
+    Q_FOREACH (const DeltaDevice &delta, m_d->pendingDeltas) {
+        const int pixelSize = delta.device->pixelSize();
+
+        stream << delta.nodeUuid.toString()
+               << qint32(delta.kind)
+               << qint32(pixelSize)
+               << qint32(delta.rects.size());
+
+        Q_FOREACH (const QRect &rc, delta.rects) {
+            buffer.resize(rc.width() * rc.height() * pixelSize);
+            delta.device->readBytes(reinterpret_cast<quint8*>(buffer.data()), rc);
+            stream << rc << qCompress(buffer, 1);
+        }
+    }
+
+    stream << recordEndMagic;
+
+    if (stream.status() != QDataStream::Ok || !file.flush()) {
+        return KisImportExportFilter::CreationError;
+    }
+
+    m_d->pendingJournalSize = file.pos();
+    return KisImportExportFilter::OK;
+}
+
+void KisAutosaveJournal::commitPendingSave(bool success)
+{
+    if (success) {
+        if (m_d->pendingMode == FullSave) {
+            if (!m_d->baseFileName.isEmpty() && m_d->baseFileName != m_d->pendingBaseFileName) {
+                QFile::remove(journalFileName(m_d->baseFileName));
+            }
+            QFile::remove(journalFileName(m_d->pendingBaseFileName));
+
+            const QFileInfo info(m_d->pendingBaseFileName);
+
+            m_d->hasBase = true;
+            m_d->baseFileName = m_d->pendingBaseFileName;
+            m_d->baseFileSize = info.size();
+            m_d->baseFileModified = info.lastModified().toMSecsSinceEpoch();
+            m_d->baseFileFingerprint = baseFileFingerprint(m_d->pendingBaseFileName);
+            m_d->journalSize = 0;
+            m_d->numDeltaRecords = 0;
+        } else {
+            m_d->journalSize = m_d->pendingJournalSize;
+            m_d->numDeltaRecords++;
+        }
+
+        m_d->committedState = m_d->pendingState;
+        m_d->committedState.dropDevices();
+
+    } else {
+        /**
+         * The base file or the journal might be broken now, but we
+         * should not remove anything, since it might be the only thing
+         * left. The next autosave will try to write a full file again.
+         */
+        m_d->hasBase = false;
+    }
+
+    m_d->pendingState = TrackedState();
+    m_d->pendingDeltas.clear();
+    m_d->pendingBaseFileName.clear();
+    m_d->pendingJournalSize = 0;
+}
+
+void KisAutosaveJournal::reset()
+{
+    if (!m_d->baseFileName.isEmpty()) {
+        QFile::remove(journalFileName(m_d->baseFileName));
+    }
+
+    m_d->hasBase = false;
+    m_d->baseFileName.clear();
+    m_d->journalSize = 0;
+    m_d->numDeltaRecords = 0;
+    m_d->committedState = TrackedState();
+}
+
+int KisAutosaveJournal::numDeltaRecords() const
+{
+    return m_d->numDeltaRecords;
+}
+
+void KisAutosaveJournal::setMaxDeltaRecords(int value)
+{
+    m_d->maxDeltaRecords = value;
+}
+
+void KisAutosaveJournal::setCompactionRatio(qreal ratio)
+{
+    m_d->compactionRatio = ratio;
+}
+
+QString KisAutosaveJournal::journalFileName(const QString &baseFileName)
+{
+    return baseFileName + QLatin1String(".delta");
+}
+
+int KisAutosaveJournal::countDeltaRecords(const QString &baseFileName)
+{
+    QFile file(journalFileName(baseFileName));
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    if (!readJournalHeader(stream, baseFileName)) return 0;
+
+    int numRecords = 0;
+    QVector<DeltaRecordDevice> record;
+
+    while (!stream.atEnd() && readRecord(stream, &record)) {
+        record.clear();
+        numRecords++;
+    }
+
+    return numRecords;
+}
+
+bool KisAutosaveJournal::replayDeltas(const QString &baseFileName, KisImageSP image, QString *errorMessage)
+{
+    QFile file(journalFileName(baseFileName));
+    if (!file.exists()) return true;
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) {
+            *errorMessage = i18n("Could not open the autosave journal %1", file.fileName());
+        }
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    if (!readJournalHeader(stream, baseFileName)) {
+        if (errorMessage) {
+            *errorMessage = i18n("The autosave journal %1 does not belong to the autosaved file", file.fileName());
+        }
+        return false;
+    }
+
+    QVector<DeltaRecordDevice> record;
+
+    while (!stream.atEnd() && readRecord(stream, &record)) {
+        QVector<KisPaintDeviceSP> devices;
+
+        // check the whole record before applying anything
+        Q_FOREACH (const DeltaRecordDevice &delta, record) {
+            KisNodeSP node = KisLayerUtils::findNodeByUuid(image->root(), delta.nodeUuid);
+            KisPaintDeviceSP device = node ? trackedDevice(node, delta.kind) : 0;
+
+            if (!device || device->pixelSize() != delta.pixelSize) {
+                if (errorMessage) {
+                    *errorMessage = i18n("The autosave journal %1 does not match the autosaved file", file.fileName());
+                }
+                return false;
+            }
+
+            devices << device;
+        }
+
+        for (int i = 0; i < record.size(); i++) {
+            const DeltaRecordDevice &delta = record[i];
+            KisPaintDeviceSP device = devices[i];
+
+            Q_FOREACH (const DeltaTile &tile, delta.tiles) {
+                const QByteArray data = qUncompress(tile.data);
+                KIS_SAFE_ASSERT_RECOVER(data.size() == tile.rect.width() * tile.rect.height() * delta.pixelSize) { continue; }
+
+                device->writeBytes(reinterpret_cast<const quint8*>(data.constData()), tile.rect);
+            }
+
+            if (KisPixelSelection *selection = dynamic_cast<KisPixelSelection*>(device.data())) {
+                selection->invalidateOutlineCache();
+            }
+        }
+
+        record.clear();
+    }
+
+    return true;
+}
@@ -0,0 +1,143 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISAUTOSAVEJOURNAL_H
+#define KISAUTOSAVEJOURNAL_H
+
+#include <QScopedPointer>
+#include <QString>
+
+#include "kis_types.h"
+#include "KisImportExportFilter.h"
+#include "kritaui_export.h"
+
+/**
+ * KisAutosaveJournal makes autosaving of big documents cheap.
+ *
+ * The first autosave writes the full .kra file (the "base"). The
+ * following autosaves only append the tiles of the raster data,
+ * which have been changed since the previous autosave, to a sidecar
+ * file lying next to the base (the "delta journal"). The changed tiles
+ * are found by comparing KisTileRevisionSnapshot's of the paint devices,
+ * so nothing but the changed tiles is ever read.
+ *
+ * Everything that cannot be represented as a set of changed tiles
+ * (layer structure and properties, vector data, animation, color space
+ * etc.) causes a full autosave, which also compacts the journal by
+ * removing it.
+ *
+ * The workflow is the following:
+ *
+ * 1) KisDocument clones the image and calls prepareSave(). The journal
+ *    decides whether a full or a delta save is needed.
+ *
+ * 2) For a full save the document saves the clone as usual, for a delta
+ *    one it calls writePendingDelta() in a background thread.
+ *
+ * 3) When the saving is completed, commitPendingSave() is called.
+ *
+ * On recovery KisDocument loads the base file and calls replayDeltas()
+ * to apply all the complete records of the journal. The journal keeps
+ * the size, the modification time and the hash of the tail of the base
+ * file, so it is never applied to a base it was not written for.
+ */
+class KRITAUI_EXPORT KisAutosaveJournal
+{
+public:
+    enum SaveMode {
+        FullSave,
+        DeltaSave
+    };
+
+public:
+    KisAutosaveJournal();
+    ~KisAutosaveJournal();
+
+    /**
+     * Compares the state of \p clonedImage to the state committed
+     * during the previous autosave into \p baseFileName and decides
+     * how the image should be saved.
+     *
+     * The image must not change until the saving is completed, so
+     * pass a clone of the document's image here.
+     */
+    SaveMode prepareSave(KisImageSP clonedImage, const QString &baseFileName);
+
+    /**
+     * Appends a record with the changed tiles to the journal. Can be
+     * called from a non-GUI thread. Valid only after prepareSave()
+     * has returned DeltaSave.
+     */
+    KisImportExportFilter::ConversionStatus writePendingDelta();
+
+    /**
+     * Finishes the save initiated by prepareSave(). If the save has
+     * succeeded, the saved state becomes the base for the next delta.
+     */
+    void commitPendingSave(bool success);
+
+    /**
+     * Forgets the base and removes the journal file. The next autosave
+     * will be a full one.
+     */
+    void reset();
+
+    /**
+     * The number of delta records written after the last full save
+     */
+    int numDeltaRecords() const;
+
+    /**
+     * The maximum number of records in the journal. When the number is
+     * reached, the next autosave is a full one.
+     */
+    void setMaxDeltaRecords(int value);
+
+    /**
+     * The journal is compacted (that is, a full save is done) when
+     * it grows bigger than \p ratio of the size of the base file.
+     */
+    void setCompactionRatio(qreal ratio);
+
+    static QString journalFileName(const QString &baseFileName);
+
+    /**
+     * \return the number of the complete records in the journal of
+     *         \p baseFileName, or zero if the journal is missing or
+     *         does not belong to the base file
+     */
+    static int countDeltaRecords(const QString &baseFileName);
+
+    /**
+     * Applies the journal of \p baseFileName to \p image, which should
+     * have just been loaded from \p baseFileName. The records are
+     * applied up to the first incomplete one (e.g. the one being written
+     * when Krita crashed).
+     *
+     * The image projection is not updated.
+     *
+     * @return false if the journal is present but cannot be applied
+     */
+    static bool replayDeltas(const QString &baseFileName, KisImageSP image, QString *errorMessage = 0);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISAUTOSAVEJOURNAL_H
@@ -74,6 +74,7 @@
 #include <QWidget>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QtConcurrent>
 
 // Krita Image
 #include <kis_config.h>
@@ -118,6 +119,7 @@
 #include <mutex>
 #include "kis_config_notifier.h"
 #include "kis_async_action_feedback.h"
+#include "KisAutosaveJournal.h"
 
 
 // Define the protocol used here for embedded documents' URL
@@ -288,6 +290,12 @@ public:
     bool isAutosaving = false;
     bool disregardAutosaveFailure = false;
 
+    /**
+     * Set while an autosaved file is being opened for recovery, only
+     * then the autosave journal lying next to it is replayed
+     */
+    bool openingAutosaveFile = false;
+
     KUndo2Stack *undoStack = 0;
 
     KisGuidesConfig guidesConfig;
@@ -321,6 +329,7 @@ public:
     StdLockableWrapper<QMutex> savingLock;
 
     bool modifiedWhileSaving = false;
+    QScopedPointer<KisAutosaveJournal> autosaveJournal;
     QScopedPointer<KisDocument> backgroundSaveDocument;
     QPointer<KoUpdater> savingUpdater;
     QFuture<KisImportExportFilter::ConversionStatus> childSavingFuture;
@@ -707,6 +716,26 @@ bool KisDocument::initiateSavingInBackground(const QString actionName,
     connect(this, SIGNAL(sigCompleteBackgroundSaving(KritaUtils::ExportFileJob,KisImportExportFilter::ConversionStatus,QString)),
             receiverObject, receiverMethod, Qt::UniqueConnection);
 
+    if (d->backgroundSaveJob.flags & KritaUtils::SaveInAutosaveMode) {
+        KisConfig cfg;
+
+        if (cfg.autoSaveIncremental()) {
+            if (!d->autosaveJournal) {
+                d->autosaveJournal.reset(new KisAutosaveJournal());
+            }
+
+            KisAutosaveJournal::SaveMode mode =
+                d->autosaveJournal->prepareSave(d->backgroundSaveDocument->image(), job.filePath);
+
+            if (mode == KisAutosaveJournal::DeltaSave) {
+                return d->backgroundSaveDocument->startDeltaExportInBackground(d->autosaveJournal.data());
+            }
+        } else if (d->autosaveJournal) {
+            d->autosaveJournal->reset();
+            d->autosaveJournal.reset();
+        }
+    }
+
     bool started =
         d->backgroundSaveDocument->startExportInBackground(actionName,
                                                            job.filePath,
@@ -769,6 +798,10 @@ void KisDocument::slotCompleteAutoSaving(const KritaUtils::ExportFileJob &job, K
 
     const QString fileName = QFileInfo(job.filePath).fileName();
 
+    if (d->autosaveJournal) {
+        d->autosaveJournal->commitPendingSave(status == KisImportExportFilter::OK);
+    }
+
     if (status != KisImportExportFilter::OK) {
         const int emergencyAutoSaveInterval = 10; // sec
         setAutoSaveDelay(emergencyAutoSaveInterval);
@@ -826,6 +859,23 @@ bool KisDocument::startExportInBackground(const QString &actionName,
     return true;
 }
 
+bool KisDocument::startDeltaExportInBackground(KisAutosaveJournal *journal)
+{
+    d->savingImage = d->image;
+
+    d->childSavingFuture =
+        QtConcurrent::run(journal, &KisAutosaveJournal::writePendingDelta);
+
+    typedef QFutureWatcher<KisImportExportFilter::ConversionStatus> StatusWatcher;
+    StatusWatcher *watcher = new StatusWatcher();
+    watcher->setFuture(d->childSavingFuture);
+
+    connect(watcher, SIGNAL(finished()), SLOT(finishExportInBackground()));
+    connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+
+    return true;
+}
+
 void KisDocument::finishExportInBackground()
 {
     KIS_SAFE_ASSERT_RECOVER(d->childSavingFuture.isFinished()) {
@@ -994,7 +1044,9 @@ bool KisDocument::openUrl(const QUrl &_url, OpenFlags flags)
         }
     }
 
+    d->openingAutosaveFile = autosaveOpened || flags & RecoveryFile;
     bool ret = openUrlInternal(url);
+    d->openingAutosaveFile = false;
 
     if (autosaveOpened || flags & RecoveryFile) {
         setReadWrite(true); // enable save button
@@ -1114,6 +1166,29 @@ bool KisDocument::openFile()
         setUrl(QUrl());
     }
 
+    /**
+     * The autosaved file may be followed by the journal of
+     * the incremental autosaves, apply them as well. The journal
+     * is never applied to the files opened the usual way.
+     */
+    const QRegularExpression autosavePattern("^\\..+-autosave.kra$");
+
+    if (d->openingAutosaveFile &&
+        autosavePattern.match(QFileInfo(filename).fileName()).hasMatch() &&
+        QFile::exists(KisAutosaveJournal::journalFileName(filename))) {
+
+        QString journalError;
+
+        if (KisAutosaveJournal::replayDeltas(filename, d->image, &journalError)) {
+            d->image->initialRefreshGraph();
+        } else {
+            DlgLoadMessages dlg(i18nc("@title:window", "Krita"),
+                                i18n("There were problems opening %1.", prettyPathOrUrl()),
+                                QStringList() << journalError);
+            dlg.exec();
+        }
+    }
+
     setMimeTypeAfterLoading(typeName);
     emit sigLoadingFinished();
 
@@ -1302,6 +1377,14 @@ void KisDocument::removeAutoSaveFiles()
         //qDebug() << "\tremoving autsavefile 2" << asf;
         QFile::remove(asf);
     }
+
+    // and the incremental autosave journals
+    QFile::remove(KisAutosaveJournal::journalFileName(generateAutoSaveFileName(localFilePath())));
+    QFile::remove(KisAutosaveJournal::journalFileName(asf));
+
+    if (d->autosaveJournal) {
+        d->autosaveJournal->reset();
+    }
 }
 
 KoUnit KisDocument::unit() const
@@ -59,6 +59,7 @@ class KisPaintingAssistant;
 class KisPart;
 class KisGridConfig;
 class KisGuidesConfig;
+class KisAutosaveJournal;
 class QDomDocument;
 
 class KisPart;
@@ -455,6 +456,8 @@ private:
                                  bool showWarnings,
                                  KisPropertiesConfigurationSP exportConfiguration);
 
+    bool startDeltaExportInBackground(KisAutosaveJournal *journal);
+
     /**
      * Generate a name for the document.
      */
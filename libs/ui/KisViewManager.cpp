@@ -37,6 +37,7 @@
 #include <QStandardPaths>
 #include <QDesktopWidget>
 #include <QDesktopServices>
+#include <QFileInfo>
 #include <QGridLayout>
 #include <QMainWindow>
 #include <QMenu>
@@ -73,6 +74,8 @@
 #include <KoDocumentInfo.h>
 #include <KoGlobal.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoFileDialog.h>
+#include <KisTracer.h>
 
 #include "input/kis_input_manager.h"
 #include "canvas/kis_canvas2.h"
@@ -671,6 +674,9 @@ void KisViewManager::createActions()
     KisAction *tabletDebugger = actionManager()->createAction("tablet_debugger");
     connect(tabletDebugger, SIGNAL(triggered()), this, SLOT(toggleTabletLogger()));
 
+    KisAction *traceRecording = actionManager()->createAction("record_performance_trace");
+    connect(traceRecording, SIGNAL(toggled(bool)), this, SLOT(slotToggleTraceRecording(bool)));
+
     d->createTemplate = actionManager()->createAction("create_template");
     connect(d->createTemplate, SIGNAL(triggered()), this, SLOT(slotCreateTemplate()));
 
@@ -1234,6 +1240,35 @@ void KisViewManager::toggleTabletLogger()
     d->inputManager.toggleTabletLogger();
 }
 
+void KisViewManager::slotToggleTraceRecording(bool value)
+{
+    KisTracer *tracer = KisTracer::instance();
+
+    if (value) {
+        tracer->clear();
+        tracer->start();
+        return;
+    }
+
+    tracer->stop();
+
+    KoFileDialog dialog(mainWindow(), KoFileDialog::SaveFile, "PerformanceTrace");
+    dialog.setCaption(i18n("Save Performance Trace"));
+    dialog.setMimeTypeFilters(QStringList() << "application/json");
+
+    QString fileName = dialog.filename();
+    if (fileName.isEmpty()) return;
+
+    if (QFileInfo(fileName).suffix().isEmpty()) {
+        fileName += ".json";
+    }
+
+    if (!tracer->saveChromeTrace(fileName)) {
+        QMessageBox::critical(mainWindow(), i18nc("@title:window", "Couldn't save performance trace"),
+                              i18n("Could not write the trace to %1", fileName));
+    }
+}
+
 void KisViewManager::openResourcesDirectory()
 {
     QString dir = KoResourcePaths::locateLocal("data", "");
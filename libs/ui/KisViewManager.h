@@ -249,6 +249,7 @@ private Q_SLOTS:
     void slotSaveIncrementalBackup();
     void showStatusBar(bool toggled);
     void toggleTabletLogger();
+    void slotToggleTraceRecording(bool value);
     void openResourcesDirectory();
     void initializeStatusBarVisibility();
     void guiUpdateTimeout();
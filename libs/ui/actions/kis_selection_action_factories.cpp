@@ -419,12 +419,14 @@ void KisSelectionToVectorActionFactory::run(KisViewManager *view)
 {
     KisSelectionSP selection = view->selection();
 
-    if (selection->hasShapeSelection() ||
-        !selection->outlineCacheValid()) {
-
+    if (selection->hasShapeSelection()) {
         return;
     }
 
+    if (!selection->outlineCacheValid()) {
+        selection->recalculateOutlineCache();
+    }
+
     QPainterPath selectionOutline = selection->outlineCache();
     QTransform transform = view->canvasBase()->coordinatesConverter()->imageToDocumentTransform();
 
@@ -464,7 +466,7 @@ void KisSelectionToShapeActionFactory::run(KisViewManager *view)
 {
     KisSelectionSP selection = view->selection();
     if (!selection->outlineCacheValid()) {
-        return;
+        selection->recalculateOutlineCache();
     }
 
     QPainterPath selectionOutline = selection->outlineCache();
@@ -35,6 +35,7 @@
 #include <KoSelection.h>
 #include <KoUnit.h>
 #include "kis_image_view_converter.h"
+#include "kis_config.h"
 
 #include <kis_debug.h>
 
@@ -53,6 +54,7 @@ KisShapeLayerCanvas::KisShapeLayerCanvas(KisShapeLayer *parent, KisImageWSP imag
         , m_parentLayer(parent)
 {
     m_shapeManager->selection()->setActiveLayer(parent);
+    m_shapeManager->setRenderCacheMemoryLimit(qint64(KisConfig().vectorShapeRenderCacheSize()) * 1024 * 1024);
     connect(this, SIGNAL(forwardRepaint()), SLOT(repaint()), Qt::QueuedConnection);
 }
 
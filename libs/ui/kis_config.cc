@@ -675,6 +675,17 @@ int KisConfig::openGLTextureSize(bool defaultValue) const
     return (defaultValue ? 256 : m_cfg.readEntry("textureSize", 256));
 }
 
+int KisConfig::vectorShapeRenderCacheSize(bool defaultValue) const
+{
+    // in MiB, zero disables caching of the rendered vector shapes
+    return (defaultValue ? 0 : m_cfg.readEntry("vectorShapeRenderCacheSize", 0));
+}
+
+void KisConfig::setVectorShapeRenderCacheSize(int value) const
+{
+    m_cfg.writeEntry("vectorShapeRenderCacheSize", value);
+}
+
 bool KisConfig::disableVSync(bool defaultValue) const
 {
     return (defaultValue ? true : m_cfg.readEntry("disableVSync", true));
@@ -1002,6 +1013,26 @@ void KisConfig::setAutoSaveInterval(int seconds)  const
     return m_cfg.writeEntry("AutoSaveInterval", seconds);
 }
 
+bool KisConfig::autoSaveIncremental(bool defaultValue) const
+{
+    return (defaultValue ? true : m_cfg.readEntry("AutoSaveIncremental", true));
+}
+
+void KisConfig::setAutoSaveIncremental(bool value) const
+{
+    m_cfg.writeEntry("AutoSaveIncremental", value);
+}
+
+bool KisConfig::lazyLayerLoading(bool defaultValue) const
+{
+    return (defaultValue ? true : m_cfg.readEntry("LazyLayerLoading", true));
+}
+
+void KisConfig::setLazyLayerLoading(bool value) const
+{
+    m_cfg.writeEntry("LazyLayerLoading", value);
+}
+
 bool KisConfig::backupFile(bool defaultValue) const
 {
     return (defaultValue ? true : m_cfg.readEntry("CreateBackupFile", true));
@@ -183,6 +183,9 @@ public:
     int openGLTextureSize(bool defaultValue = false) const;
     int textureOverlapBorder() const;
 
+    int vectorShapeRenderCacheSize(bool defaultValue = false) const;
+    void setVectorShapeRenderCacheSize(int value) const;
+
     quint32 getGridMainStyle(bool defaultValue = false) const;
     void setGridMainStyle(quint32 v) const;
 
@@ -260,6 +263,12 @@ public:
     int autoSaveInterval(bool defaultValue = false) const;
     void setAutoSaveInterval(int seconds) const;
 
+    bool autoSaveIncremental(bool defaultValue = false) const;
+    void setAutoSaveIncremental(bool value) const;
+
+    bool lazyLayerLoading(bool defaultValue = false) const;
+    void setLazyLayerLoading(bool value) const;
+
     bool backupFile(bool defaultValue = false) const;
     void setBackupFile(bool backupFile) const;
 
@@ -20,6 +20,8 @@
 #include <QPainter>
 #include <QVarLengthArray>
 
+#include <cmath>
+
 #include <kis_debug.h>
 #include <klocalizedstring.h>
 
@@ -90,13 +92,23 @@ void KisSelectionDecoration::selectionChanged()
     KisSelectionSP selection = view()->selection();
 
     if (selection && selectionIsActive()) {
-        if ((m_mode == Ants && selection->outlineCacheValid()) ||
+        // shape selections have cheap vector outlines, pixel ones use the tile cache
+        const bool useOutlineTiles = !selection->hasShapeSelection();
+
+        if ((m_mode == Ants && !useOutlineTiles && selection->outlineCacheValid()) ||
+            (m_mode == Ants && useOutlineTiles && selection->outlineTileCacheValid()) ||
             (m_mode == Mask && selection->thumbnailImageValid())) {
 
             m_signalCompressor.stop();
 
             if (m_mode == Ants) {
-                m_outlinePath = selection->outlineCache();
+                if (useOutlineTiles) {
+                    m_outlineTiles = selection->outlineTileCache();
+                    m_outlinePath = QPainterPath();
+                } else {
+                    m_outlinePath = selection->outlineCache();
+                    m_outlineTiles.clear();
+                }
                 m_antsTimer->start();
             } else {
                 m_thumbnailImage = selection->thumbnailImage();
@@ -112,6 +124,7 @@ void KisSelectionDecoration::selectionChanged()
     } else {
         m_signalCompressor.stop();
         m_outlinePath = QPainterPath();
+        m_outlineTiles.clear();
         m_thumbnailImage = QImage();
         m_thumbnailImageTransform = QTransform();
         view()->canvasBase()->updateCanvas();
@@ -144,11 +157,10 @@ void KisSelectionDecoration::antsAttackEvent()
 
 void KisSelectionDecoration::drawDecoration(QPainter& gc, const QRectF& updateRect, const KisCoordinatesConverter *converter, KisCanvas2 *canvas)
 {
-    Q_UNUSED(updateRect);
     Q_UNUSED(canvas);
 
     if (!selectionIsActive()) return;
-    if ((m_mode == Ants && m_outlinePath.isEmpty()) ||
+    if ((m_mode == Ants && m_outlinePath.isEmpty() && m_outlineTiles.isEmpty()) ||
         (m_mode == Mask && m_thumbnailImage.isNull())) return;
 
     KisConfig cfg;
@@ -182,13 +194,31 @@ void KisSelectionDecoration::drawDecoration(QPainter& gc, const QRectF& updateRe
     } else /* if (m_mode == Ants) */ {
         gc.setRenderHints(QPainter::Antialiasing | QPainter::HighQualityAntialiasing, cfg.antialiasSelectionOutline());
 
+        QPainterPath outline = m_outlinePath;
+
+        if (!m_outlineTiles.isEmpty()) {
+            // stroke only the segments lying in the updated area
+            const QRect imageUpdateRect =
+                converter->documentToImage(updateRect).toAlignedRect().adjusted(-1, -1, 1, 1);
+
+            /**
+             * The pens are cosmetic, so the period of the ants in image
+             * pixels depends on the zoom. The clipped parts of the outline
+             * start in phase with the ants of the neighbouring areas.
+             */
+            const qreal zoom = std::sqrt(qAbs(transform.determinant()));
+            const qreal dashPeriod = zoom > 0.0 ? ANT_ADVANCE_WIDTH / zoom : 0.0;
+
+            outline = m_outlineTiles.outline(imageUpdateRect, dashPeriod);
+        }
+
         // render selection outline in white
         gc.setPen(m_outlinePen);
-        gc.drawPath(m_outlinePath);
+        gc.drawPath(outline);
 
         // render marching ants in black (above the white outline)
         gc.setPen(m_antsPen);
-        gc.drawPath(m_outlinePath);
+        gc.drawPath(outline);
     }
     gc.restore();
 }
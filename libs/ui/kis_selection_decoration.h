@@ -23,6 +23,7 @@
 #include <QPen>
 
 #include <kis_signal_compressor.h>
+#include <kis_outline_tile_cache.h>
 #include "canvas/kis_canvas_decoration.h"
 
 class KisView;
@@ -58,6 +59,7 @@ private:
 private:
     KisSignalCompressor m_signalCompressor;
     QPainterPath m_outlinePath;
+    KisOutlineTileCache m_outlineTiles;
     QImage m_thumbnailImage;
     QTransform m_thumbnailImageTransform;
     QTimer* m_antsTimer;
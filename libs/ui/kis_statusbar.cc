@@ -295,8 +295,9 @@ void KisStatusBar::updateMemoryStatus()
                   "  image data:\t %3 / %4\n"
                   "  pool:\t\t %5 / %6\n"
                   "  undo data:\t %7\n"
+                  "  saved by sharing:\t %8\n"
                   "\n"
-                  "Swap used:\t %8",
+                  "Swap used:\t %9",
                   formatSize(stats.totalMemorySize),
                   formatSize(stats.totalMemoryLimit),
 
@@ -307,6 +308,7 @@ void KisStatusBar::updateMemoryStatus()
                   formatSize(stats.tilesPoolLimit),
 
                   formatSize(stats.historicalMemorySize),
+                  formatSize(stats.uniformTilesSavedSize),
                   formatSize(stats.swapSize));
 
     QString longStats = imageStatsMsg + "\n" + memoryStatsMsg;
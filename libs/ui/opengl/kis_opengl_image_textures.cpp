@@ -24,6 +24,7 @@
 #include <QMessageBox>
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QtConcurrent>
 
 #include <KoColorSpaceRegistry.h>
 #include <KoColorProfile.h>
@@ -56,6 +57,16 @@
 
 KisOpenGLImageTextures::ImageTexturesMap KisOpenGLImageTextures::imageTexturesMap;
 
+namespace {
+KisTextureTileInfoPoolSP getInfoChunksPool(int tileWidth, int tileHeight)
+{
+    // we use local static object for creating pools shared among
+    // different images
+    static KisTextureTileInfoPoolRegistry s_poolRegistry;
+    return s_poolRegistry.getPool(tileWidth, tileHeight);
+}
+}
+
 KisOpenGLImageTextures::KisOpenGLImageTextures()
     : m_image(0)
     , m_monitorProfile(0)
@@ -108,10 +119,7 @@ void KisOpenGLImageTextures::initGL(QOpenGLFunctions *f)
 
     getTextureSize(&m_texturesInfo);
 
-    // we use local static object for creating pools shared among
-    // different images
-    static KisTextureTileInfoPoolRegistry s_poolRegistry;
-    m_infoChunksPool = s_poolRegistry.getPool(m_texturesInfo.width, m_texturesInfo.height);
+    m_infoChunksPool = getInfoChunksPool(m_texturesInfo.width, m_texturesInfo.height);
 
     m_glFuncs->glGenTextures(1, &m_checkerTexture);
     createImageTextureTiles();
@@ -120,6 +128,17 @@ void KisOpenGLImageTextures::initGL(QOpenGLFunctions *f)
     recalculateCache(info);
 }
 
+void KisOpenGLImageTextures::testingInitHeadless(const KoColorSpace *dstColorSpace)
+{
+    getTextureSize(&m_texturesInfo);
+    m_infoChunksPool = getInfoChunksPool(m_texturesInfo.width, m_texturesInfo.height);
+
+    m_tilesDestinationColorSpace = dstColorSpace;
+    m_storedImageBounds = m_image->bounds();
+    m_numCols = xToCol(m_image->width()) + 1;
+    m_initialized = true;
+}
+
 KisOpenGLImageTextures::~KisOpenGLImageTextures()
 {
     ImageTexturesMap::iterator it = imageTexturesMap.find(m_image);
@@ -132,7 +151,10 @@ KisOpenGLImageTextures::~KisOpenGLImageTextures()
     }
 
     destroyImageTextureTiles();
-    m_glFuncs->glDeleteTextures(1, &m_checkerTexture);
+
+    if (m_glFuncs) {
+        m_glFuncs->glDeleteTextures(1, &m_checkerTexture);
+    }
 }
 
 KisImageSP KisOpenGLImageTextures::image() const
@@ -340,23 +362,6 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect,
                                                      m_infoChunksPool));
             // Don't update empty tiles
             if (tileInfo->valid()) {
-                tileInfo->retrieveData(srcImage->projection(), channelFlags, m_onlyOneChannelSelected, m_selectedChannelIndex);
-
-                //create transform
-                if (m_createNewProofingTransform) {
-                    const KoColorSpace *proofingSpace = KoColorSpaceRegistry::instance()->colorSpace(m_proofingConfig->proofingModel,m_proofingConfig->proofingDepth,m_proofingConfig->proofingProfile);
-                    m_proofingTransform.reset(tileInfo->generateProofingTransform(dstCS, proofingSpace, m_renderingIntent, m_proofingConfig->intent, m_proofingConfig->conversionFlags, m_proofingConfig->warningColor, m_proofingConfig->adaptationState));
-                    m_createNewProofingTransform = false;
-                }
-
-                if (convertColorSpace) {
-                    if (m_proofingConfig && m_proofingTransform && m_proofingConfig->conversionFlags.testFlag(KoColorConversionTransformation::SoftProofing)) {
-                        tileInfo->proofTo(dstCS, m_proofingConfig->conversionFlags, m_proofingTransform.data());
-                    } else {
-                        tileInfo->convertTo(dstCS, m_renderingIntent, m_conversionFlags);
-                    }
-                }
-
                 info->tileList.append(tileInfo);
             }
             else {
@@ -365,6 +370,68 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect,
         }
     }
 
+    if (info->tileList.isEmpty()) {
+        info->assignDirtyImageRect(rect);
+        info->assignLevelOfDetail(levelOfDetail);
+        return info;
+    }
+
+    KisPaintDeviceSP projection = srcImage->projection();
+
+    //create transform
+    if (m_createNewProofingTransform) {
+        const KoColorSpace *proofingSpace = KoColorSpaceRegistry::instance()->colorSpace(m_proofingConfig->proofingModel,m_proofingConfig->proofingDepth,m_proofingConfig->proofingProfile);
+        KoColor gamutWarning = m_proofingConfig->warningColor;
+        m_proofingTransform.reset(projection->colorSpace()->createProofingTransform(dstCS, proofingSpace, m_renderingIntent, m_proofingConfig->intent, m_proofingConfig->conversionFlags, gamutWarning.data(), m_proofingConfig->adaptationState));
+        m_createNewProofingTransform = false;
+    }
+
+    const bool useSoftProofing =
+        convertColorSpace &&
+        m_proofingConfig && m_proofingTransform &&
+        m_proofingConfig->conversionFlags.testFlag(KoColorConversionTransformation::SoftProofing);
+
+    /**
+     * Without the channel swizzling the pixels can be converted
+     * right from the tiles of the projection
+     */
+    const bool useDirectConversion = convertColorSpace && !useSoftProofing && channelFlags.isEmpty();
+
+    auto retrieveTile =
+        [&] (KisTextureTileUpdateInfoSP tileInfo) {
+            if (useDirectConversion) {
+                tileInfo->retrieveConvertedData(projection, dstCS, m_renderingIntent, m_conversionFlags);
+            } else {
+                tileInfo->retrieveData(projection, channelFlags, m_onlyOneChannelSelected, m_selectedChannelIndex);
+
+                if (convertColorSpace && !useSoftProofing) {
+                    tileInfo->convertTo(dstCS, m_renderingIntent, m_conversionFlags);
+                }
+            }
+        };
+
+    /**
+     * The color conversion is the most expensive part of the update, so
+     * big updates are split between the threads. The channel swizzling
+     * reads the config, so it is done in the current thread only.
+     */
+    const int minTilesForParallelUpdate = 4;
+
+    if (info->tileList.size() >= minTilesForParallelUpdate && channelFlags.isEmpty()) {
+        QtConcurrent::blockingMap(info->tileList, retrieveTile);
+    } else {
+        Q_FOREACH (KisTextureTileUpdateInfoSP tileInfo, info->tileList) {
+            retrieveTile(tileInfo);
+        }
+    }
+
+    // the proofing transform is shared, so it cannot be used concurrently
+    if (useSoftProofing) {
+        Q_FOREACH (KisTextureTileUpdateInfoSP tileInfo, info->tileList) {
+            tileInfo->proofTo(dstCS, m_proofingConfig->conversionFlags, m_proofingTransform.data());
+        }
+    }
+
     info->assignDirtyImageRect(rect);
     info->assignLevelOfDetail(levelOfDetail);
     return info;
@@ -83,6 +83,13 @@ public:
      */
     void initGL(QOpenGLFunctions *f);
 
+    /**
+     * Initializes the textures without an OpenGL context, so that
+     * updateCache() could be run in benchmarks. The textures are never
+     * uploaded, so recalculateCache() must not be called.
+     */
+    void testingInitHeadless(const KoColorSpace *dstColorSpace);
+
     void setChannelFlags(const QBitArray &channelFlags);
     void setProofingConfig(KisProofingConfigurationSP);
 
@@ -21,6 +21,7 @@
 #include "kis_texture_tile_update_info.h"
 
 #include <kis_debug.h>
+#include <KisTracer.h>
 #if !defined(QT_OPENGL_ES)
 #include <QOpenGLBuffer>
 #endif
@@ -157,6 +158,9 @@ void KisTextureTile::setCurrentLodPlane(int lod)
 
 void KisTextureTile::update(const KisTextureTileUpdateInfo &updateInfo)
 {
+    KIS_TRACE_SCOPE_RECT("opengl", "texture upload",
+                         QRect(updateInfo.realPatchOffset(), updateInfo.realPatchSize()));
+
     f->initializeOpenGLFunctions();
     f->glBindTexture(GL_TEXTURE_2D, m_textureId);
 
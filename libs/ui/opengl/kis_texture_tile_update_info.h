@@ -23,8 +23,11 @@
 #include <QScopedArrayPointer>
 
 #include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorConversionCache.h>
 #include "kis_image.h"
 #include "kis_paint_device.h"
+#include "kis_sequential_iterator.h"
 #include "kis_config.h"
 #include <KoColorConversionTransformation.h>
 #include <KoChannelInfo.h>
@@ -192,6 +195,60 @@ public:
 
     }
 
+    /**
+     * Reads the patch from \p projectionDevice and converts it into \p dstCS
+     * in a single pass: the pixels are converted right from the tiles
+     * of the device into the patch buffer, without an intermediate copy.
+     *
+     * It is equivalent to retrieveData() with empty channel flags
+     * followed by convertTo().
+     */
+    void retrieveConvertedData(KisPaintDeviceSP projectionDevice,
+                               const KoColorSpace* dstCS,
+                               KoColorConversionTransformation::Intent renderingIntent,
+                               KoColorConversionTransformation::ConversionFlags conversionFlags)
+    {
+        const KoColorSpace *srcCS = projectionDevice->colorSpace();
+
+        if ((dstCS == srcCS || *dstCS == *srcCS) &&
+            conversionFlags == KoColorConversionTransformation::Empty) {
+
+            retrieveData(projectionDevice, QBitArray(), false, 0);
+            return;
+        }
+
+        m_patchColorSpace = dstCS;
+        m_patchPixels.allocate(dstCS->pixelSize());
+
+        if (!m_patchRect.isValid()) return;
+
+        const int srcPixelSize = srcCS->pixelSize();
+        const int dstPixelSize = dstCS->pixelSize();
+        quint8 *dstPtr = m_patchPixels.data();
+
+        KisSequentialConstIterator it(projectionDevice, m_patchRect);
+        int nConseqPixels = 0;
+
+        if (*dstCS == *srcCS) {
+            do {
+                nConseqPixels = it.nConseqPixels();
+                memcpy(dstPtr, it.rawDataConst(), nConseqPixels * srcPixelSize);
+                dstPtr += nConseqPixels * dstPixelSize;
+            } while (it.nextPixels(nConseqPixels));
+        } else {
+            // fetch the transformation once, not for every run of pixels
+            KoCachedColorConversionTransformation cct =
+                KoColorSpaceRegistry::instance()->colorConversionCache()->
+                    cachedConverter(srcCS, dstCS, renderingIntent, conversionFlags);
+
+            do {
+                nConseqPixels = it.nConseqPixels();
+                cct.transformation()->transform(it.rawDataConst(), dstPtr, nConseqPixels);
+                dstPtr += nConseqPixels * dstPixelSize;
+            } while (it.nextPixels(nConseqPixels));
+        }
+    }
+
     void convertTo(const KoColorSpace* dstCS,
                    KoColorConversionTransformation::Intent renderingIntent,
                    KoColorConversionTransformation::ConversionFlags conversionFlags)
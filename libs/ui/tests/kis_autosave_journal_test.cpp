@@ -0,0 +1,277 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_autosave_journal_test.h"
+
+#include <QTest>
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_layer_utils.h>
+#include <KisAutosaveJournal.h>
+
+#include <testutil.h>
+
+namespace {
+
+const QRect imageRect(0, 0, 512, 512);
+const int numLayers = 3;
+
+KisImageSP createSyntheticImage()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "autosave journal test");
+
+    QByteArray noise(imageRect.width() * imageRect.height() * cs->pixelSize(), 0);
+    for (int i = 0; i < noise.size(); i++) {
+        noise[i] = char(qrand() & 0xff);
+    }
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer%1").arg(i), OPACITY_OPAQUE_U8);
+        layer->paintDevice()->writeBytes(reinterpret_cast<const quint8*>(noise.constData()), imageRect);
+        image->addNode(layer, image->root());
+    }
+
+    image->initialRefreshGraph();
+    return image;
+}
+
+KisPaintDeviceSP layerDevice(KisImageSP image, int index)
+{
+    return image->root()->at(index)->paintDevice();
+}
+
+void smallEdit(KisImageSP image, int layerIndex, const QRect &rc)
+{
+    KisPaintDeviceSP dev = layerDevice(image, layerIndex);
+    dev->fill(rc, KoColor(Qt::red, dev->colorSpace()));
+    image->waitForDone();
+}
+
+KisImageSP cloneForSaving(KisImageSP image)
+{
+    image->waitForDone();
+    return image->clone(true);
+}
+
+/**
+ * Writes all the pixel data of the image into \p fileName. It emulates
+ * the cost of the full autosave without requiring the .kra filter.
+ */
+void writeFullDump(KisImageSP image, const QString &fileName)
+{
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+
+    QDataStream stream(&file);
+
+    for (quint32 i = 0; i < image->root()->childCount(); i++) {
+        KisPaintDeviceSP dev = layerDevice(image, i);
+        const QRect rc = dev->exactBounds();
+
+        QByteArray buffer(rc.width() * rc.height() * dev->pixelSize(), 0);
+        dev->readBytes(reinterpret_cast<quint8*>(buffer.data()), rc);
+        stream << rc << qCompress(buffer, 1);
+    }
+}
+
+void doFullSave(KisAutosaveJournal *journal, KisImageSP image, const QString &baseFileName)
+{
+    KisImageSP clone = cloneForSaving(image);
+    QCOMPARE(journal->prepareSave(clone, baseFileName), KisAutosaveJournal::FullSave);
+    writeFullDump(clone, baseFileName);
+    journal->commitPendingSave(true);
+}
+
+void doDeltaSave(KisAutosaveJournal *journal, KisImageSP image, const QString &baseFileName)
+{
+    KisImageSP clone = cloneForSaving(image);
+    QCOMPARE(journal->prepareSave(clone, baseFileName), KisAutosaveJournal::DeltaSave);
+    QCOMPARE(journal->writePendingDelta(), KisImportExportFilter::OK);
+    journal->commitPendingSave(true);
+}
+
+void compareImages(KisImageSP image1, KisImageSP image2)
+{
+    QCOMPARE(image1->root()->childCount(), image2->root()->childCount());
+
+    for (quint32 i = 0; i < image1->root()->childCount(); i++) {
+        QPoint pt;
+        if (!TestUtil::comparePaintDevices(pt, layerDevice(image1, i), layerDevice(image2, i))) {
+            QFAIL(QString("Layer %1 differs at (%2, %3)").arg(i).arg(pt.x()).arg(pt.y()).toLatin1().constData());
+        }
+    }
+}
+
+}
+
+void KisAutosaveJournalTest::testDeltaSaveAndReplay()
+{
+    QTemporaryDir dir;
+    const QString baseFileName = dir.path() + "/.test-autosave.kra";
+
+    KisImageSP image = createSyntheticImage();
+    KisAutosaveJournal journal;
+
+    doFullSave(&journal, image, baseFileName);
+
+    // the state of the image as the recovery would load it from the base file
+    KisImageSP recoveredImage = cloneForSaving(image);
+
+    // every edit changes a single tile
+    for (int i = 0; i < 3; i++) {
+        smallEdit(image, i, QRect(10 + 128 * i, 70, 20, 20));
+        doDeltaSave(&journal, image, baseFileName);
+    }
+
+    const qint64 baseSize = QFileInfo(baseFileName).size();
+    const qint64 journalSize = QFileInfo(KisAutosaveJournal::journalFileName(baseFileName)).size();
+
+    QCOMPARE(journal.numDeltaRecords(), 3);
+    QCOMPARE(KisAutosaveJournal::countDeltaRecords(baseFileName), 3);
+    QVERIFY(journalSize < baseSize / 10);
+
+    QString errorMessage;
+    QVERIFY(KisAutosaveJournal::replayDeltas(baseFileName, recoveredImage, &errorMessage));
+    QVERIFY(errorMessage.isEmpty());
+
+    compareImages(image, recoveredImage);
+}
+
+void KisAutosaveJournalTest::testFullSaveTriggers()
+{
+    QTemporaryDir dir;
+    const QString baseFileName = dir.path() + "/.test-autosave.kra";
+
+    KisImageSP image = createSyntheticImage();
+
+    KisAutosaveJournal journal;
+    journal.setMaxDeltaRecords(2);
+
+    doFullSave(&journal, image, baseFileName);
+
+    // nothing that could be journaled has changed
+    QCOMPARE(journal.prepareSave(cloneForSaving(image), baseFileName), KisAutosaveJournal::FullSave);
+    journal.commitPendingSave(false);
+
+    // a failed full save forgets the base
+    smallEdit(image, 0, QRect(10, 10, 10, 10));
+    QCOMPARE(journal.prepareSave(cloneForSaving(image), baseFileName), KisAutosaveJournal::FullSave);
+    journal.commitPendingSave(false);
+    doFullSave(&journal, image, baseFileName);
+
+    // a failed delta save falls back to a full save
+    smallEdit(image, 0, QRect(20, 20, 10, 10));
+    QCOMPARE(journal.prepareSave(cloneForSaving(image), baseFileName), KisAutosaveJournal::DeltaSave);
+    journal.commitPendingSave(false);
+    doFullSave(&journal, image, baseFileName);
+    smallEdit(image, 0, QRect(25, 25, 10, 10));
+    doDeltaSave(&journal, image, baseFileName);
+
+    // the autosave file name has changed
+    smallEdit(image, 0, QRect(30, 30, 10, 10));
+    QCOMPARE(journal.prepareSave(cloneForSaving(image), baseFileName + "2"), KisAutosaveJournal::FullSave);
+    journal.commitPendingSave(false);
+    doFullSave(&journal, image, baseFileName);
+
+    // the layer structure has changed
+    smallEdit(image, 0, QRect(40, 40, 10, 10));
+    image->root()->at(1)->setName("renamed layer");
+    QCOMPARE(journal.prepareSave(cloneForSaving(image), baseFileName), KisAutosaveJournal::FullSave);
+    journal.commitPendingSave(false);
+    doFullSave(&journal, image, baseFileName);
+    QCOMPARE(journal.numDeltaRecords(), 0);
+    QVERIFY(!QFile::exists(KisAutosaveJournal::journalFileName(baseFileName)));
+
+    // the journal is compacted when it has too many records
+    smallEdit(image, 0, QRect(50, 50, 10, 10));
+    doDeltaSave(&journal, image, baseFileName);
+    smallEdit(image, 0, QRect(60, 60, 10, 10));
+    doDeltaSave(&journal, image, baseFileName);
+    smallEdit(image, 0, QRect(70, 70, 10, 10));
+    doFullSave(&journal, image, baseFileName);
+
+    // a big part of the image has changed, the delta would be too big
+    layerDevice(image, 1)->fill(imageRect, KoColor(Qt::blue, image->colorSpace()));
+    layerDevice(image, 2)->fill(imageRect, KoColor(Qt::blue, image->colorSpace()));
+    QCOMPARE(journal.prepareSave(cloneForSaving(image), baseFileName), KisAutosaveJournal::FullSave);
+    journal.commitPendingSave(false);
+}
+
+void KisAutosaveJournalTest::testBrokenRecordIsSkipped()
+{
+    QTemporaryDir dir;
+    const QString baseFileName = dir.path() + "/.test-autosave.kra";
+    const QString journalFileName = KisAutosaveJournal::journalFileName(baseFileName);
+
+    KisImageSP image = createSyntheticImage();
+    KisAutosaveJournal journal;
+
+    doFullSave(&journal, image, baseFileName);
+    KisImageSP recoveredImage = cloneForSaving(image);
+
+    smallEdit(image, 0, QRect(100, 100, 50, 50));
+    doDeltaSave(&journal, image, baseFileName);
+    KisImageSP expectedImage = cloneForSaving(image);
+
+    const qint64 validSize = QFileInfo(journalFileName).size();
+
+    // emulate a crash in the middle of writing the second record
+    smallEdit(image, 1, QRect(400, 400, 50, 50));
+    doDeltaSave(&journal, image, baseFileName);
+
+    {
+        QFile file(journalFileName);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.resize(validSize + (file.size() - validSize) / 2));
+    }
+
+    QCOMPARE(KisAutosaveJournal::countDeltaRecords(baseFileName), 1);
+    QVERIFY(KisAutosaveJournal::replayDeltas(baseFileName, recoveredImage));
+    compareImages(expectedImage, recoveredImage);
+
+    // the base has been overwritten with the content of the same size
+    {
+        QFile file(baseFileName);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.seek(file.size() - 1));
+        const char lastByte = file.read(1)[0];
+        QVERIFY(file.seek(file.size() - 1));
+        QVERIFY(file.putChar(~lastByte));
+    }
+
+    QCOMPARE(KisAutosaveJournal::countDeltaRecords(baseFileName), 0);
+
+    // the journal belongs to another base file
+    {
+        QFile file(baseFileName);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write("another file");
+    }
+
+    QCOMPARE(KisAutosaveJournal::countDeltaRecords(baseFileName), 0);
+    QVERIFY(!KisAutosaveJournal::replayDeltas(baseFileName, recoveredImage));
+}
+
+QTEST_MAIN(KisAutosaveJournalTest)
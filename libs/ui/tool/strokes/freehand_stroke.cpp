@@ -211,10 +211,9 @@ void FreehandStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
         case Data::QPAINTER_PATH:
             info->painter->drawPainterPath(d->path, d->pen);
             break;
-        case Data::QPAINTER_PATH_FILL: {
+        case Data::QPAINTER_PATH_FILL:
             info->painter->setBackgroundColor(d->customColor);
-            info->painter->fillPainterPath(d->path);}
-            info->painter->drawPainterPath(d->path, d->pen);
+            info->painter->fillAndDrawPainterPath(d->path, d->pen);
             break;
         };
 
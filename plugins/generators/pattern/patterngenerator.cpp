@@ -103,7 +103,24 @@ void KoPatternGenerator::generate(KisProcessingInformation dstInfo,
 
 //    KoColor c = config->getColor("color");
 
+    if (!pattern) return;
+
     KisFillPainter gc(dst);
+
+    /**
+     * Without a selection or channel flags the layer just repeats the
+     * pattern, so the repeated cells can share the tiles.
+     *
+     * NOTE: the whole rect is still generated eagerly on every update of
+     * the layer, the generators have no way to render only the tiles
+     * the walkers request.
+     */
+    if (!dstInfo.selection() && config->channelFlags().isEmpty()) {
+        gc.fillRectNoCompose(QRect(dstInfo.topLeft(), size), pattern);
+        gc.end();
+        return;
+    }
+
     gc.setPattern(pattern);
 //    gc.setPaintColor(c);
     gc.setProgress(progressUpdater);
@@ -55,7 +55,14 @@ KraConverter::~KraConverter()
 
 KisImageBuilder_Result KraConverter::buildImage(QIODevice *io)
 {
-    m_store = KoStore::createStore(io, KoStore::Read, "", KoStore::Zip);
+    m_store = KoStore::createStore(io, KoStore::Read, "", KoStore::ParallelZip);
+
+    if (m_store->bad()) {
+        // the archives KoParallelZipStore cannot handle (e.g. zip64 ones)
+        // may still be readable by KArchive
+        delete m_store;
+        m_store = KoStore::createStore(io, KoStore::Read, "", KoStore::Zip);
+    }
 
     if (m_store->bad()) {
         m_doc->setErrorMessage(i18n("Not a valid Krita file"));
@@ -109,7 +116,7 @@ QList<KisPaintingAssistantSP> KraConverter::assistants()
 
 KisImageBuilder_Result KraConverter::buildFile(QIODevice *io)
 {
-    m_store = KoStore::createStore(io, KoStore::Write, m_doc->nativeFormatMimeType(), KoStore::Zip);
+    m_store = KoStore::createStore(io, KoStore::Write, m_doc->nativeFormatMimeType(), KoStore::ParallelZip);
 
     if (m_store->bad()) {
         m_doc->setErrorMessage(i18n("Could not create the file for saving"));
@@ -24,6 +24,9 @@
 #include <QRect>
 #include <QBuffer>
 #include <QByteArray>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 #include <KoColorSpaceRegistry.h>
 #include <KoColorProfile.h>
@@ -59,6 +62,8 @@
 #include "kis_dom_utils.h"
 #include "kis_raster_keyframe_channel.h"
 #include "kis_paint_device_frames_interface.h"
+#include "kis_paint_device_lazy_loader.h"
+#include "kis_spontaneous_job.h"
 
 using namespace KRA;
 
@@ -93,6 +98,7 @@ KisKraLoadVisitor::KisKraLoadVisitor(KisImageSP image,
         m_keyframeFilenames(keyframeFilenames)
 {
     m_external = false;
+    m_lazyLoading = false;
     m_image = image;
     m_store = store;
     m_name = name;
@@ -150,7 +156,7 @@ bool KisKraLoadVisitor::visit(KisPaintLayer *layer)
     loadNodeKeyframes(layer);
 
     dbgFile << "Visit: " << layer->name() << " colorSpace: " << layer->colorSpace()->id();
-    if (!loadPaintDevice(layer->paintDevice(), getLocation(layer))) {
+    if (!loadPaintDevice(layer->paintDevice(), getLocation(layer), layer)) {
         return false;
     }
     if (!loadProfile(layer->paintDevice(), getLocation(layer, DOT_ICC))) {
@@ -396,6 +402,11 @@ bool KisKraLoadVisitor::visit(KisColorizeMask *mask)
     return true;
 }
 
+void KisKraLoadVisitor::setLazyLoading(bool value)
+{
+    m_lazyLoading = value;
+}
+
 QStringList KisKraLoadVisitor::errorMessages() const
 {
     return m_errorMessages;
@@ -433,7 +444,99 @@ struct FramedDevicePolicy
     int m_frameId;
 };
 
-bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString& location)
+struct KisKraLoadVisitor::DeferredDeviceLoad
+{
+    KisPaintDeviceSP device;
+    QString location;
+    QByteArray data;
+    QByteArray defaultPixel;
+    bool isVisible = true;
+    bool success = false;
+};
+
+KisKraLoadVisitor::~KisKraLoadVisitor() = default;
+
+namespace {
+
+bool loadDeviceData(KisPaintDevice *device, const QByteArray &data, const QByteArray &defaultPixel)
+{
+    QBuffer buffer(const_cast<QByteArray*>(&data));
+    buffer.open(QIODevice::ReadOnly);
+
+    if (!device->read(&buffer)) {
+        return false;
+    }
+
+    // the profile of the device may have been changed after the
+    // visit, so the color is created in the final color space
+    if (defaultPixel.size() == int(device->colorSpace()->pixelSize())) {
+        KoColor color(Qt::transparent, device->colorSpace());
+        memcpy(color.data(), defaultPixel.constData(), defaultPixel.size());
+        device->setDefaultPixel(color);
+    }
+
+    return true;
+}
+
+/**
+ * Keeps the raw layer data read from the archive and decodes
+ * it into tiles when the device is accessed for the first time
+ */
+class KisKraLazyDeviceLoader : public KisPaintDeviceLazyLoader
+{
+public:
+    KisKraLazyDeviceLoader(const QByteArray &data, const QByteArray &defaultPixel)
+        : m_data(data),
+          m_defaultPixel(defaultPixel)
+    {
+    }
+
+    bool load(KisPaintDevice *device) override {
+        return loadDeviceData(device, m_data, m_defaultPixel);
+    }
+
+private:
+    QByteArray m_data;
+    QByteArray m_defaultPixel;
+};
+
+/**
+ * Decodes a lazily loaded device while the image is idle. The job
+ * belongs to the image's update queue, so it never outlives the image.
+ */
+class KisKraMaterializeDeviceJob : public KisSpontaneousJob
+{
+public:
+    KisKraMaterializeDeviceJob(KisPaintDeviceSP device)
+        : m_device(device)
+    {
+    }
+
+    bool overrides(const KisSpontaneousJob *_otherJob) override {
+        const KisKraMaterializeDeviceJob *otherJob =
+            dynamic_cast<const KisKraMaterializeDeviceJob*>(_otherJob);
+
+        return otherJob && otherJob->m_device == m_device;
+    }
+
+    void run() override {
+        // skip the devices of the layers removed in the meantime
+        if (m_device->refCount() > 1) {
+            m_device->materialize();
+        }
+    }
+
+    int levelOfDetail() const override {
+        return 0;
+    }
+
+private:
+    KisPaintDeviceSP m_device;
+};
+
+}
+
+bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString& location, KisNode *deferringNode)
 {
     // Layer data
     KisPaintDeviceFramesInterface *frameInterface = device->framesInterface();
@@ -444,6 +547,9 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
     }
 
     if (!frameInterface || frames.count() <= 1) {
+        if (deferringNode && m_store->supportsConcurrentReading()) {
+            return deferPaintDeviceLoading(device, location, deferringNode->visible(true));
+        }
         return loadPaintDeviceFrame(device, location, SimpleDevicePolicy());
     } else {
         KisRasterKeyframeChannel *keyframeChannel = device->keyframeChannel();
@@ -468,6 +574,93 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
     return true;
 }
 
+bool KisKraLoadVisitor::deferPaintDeviceLoading(KisPaintDeviceSP device, const QString &location, bool isVisible)
+{
+    if (!m_store->hasFile(location)) {
+        m_warningMessages << i18n("Could not load pixel data: %1.", location);
+        return true;
+    }
+
+    DeferredDeviceLoad load;
+    load.device = device;
+    load.isVisible = isVisible;
+
+    // the data is read after the visitor has left all the directories
+    load.location = location.startsWith("tar:/") ?
+        location : "tar:/" + m_store->currentPath() + location;
+
+    if (m_store->open(location + ".defaultpixel")) {
+        if (m_store->size() == device->colorSpace()->pixelSize()) {
+            load.defaultPixel = m_store->read(m_store->size());
+        }
+        m_store->close();
+    }
+
+    m_deferredLoads.append(load);
+    return true;
+}
+
+bool KisKraLoadVisitor::loadDeferredPaintDevices()
+{
+    KoStore *store = m_store;
+    const bool lazyLoading = m_lazyLoading;
+
+    /**
+     * The files are read by a local pool, so the loading doesn't
+     * compete with the other users of the global one
+     */
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(QThread::idealThreadCount());
+
+    for (int i = 0; i < m_deferredLoads.size(); i++) {
+        DeferredDeviceLoad *load = &m_deferredLoads[i];
+
+        QtConcurrent::run(&threadPool,
+            [store, lazyLoading, load] () {
+                if (!store->readFileConcurrently(load->location, &load->data)) return;
+
+                if (lazyLoading) {
+                    load->success = true;
+                } else {
+                    load->success = loadDeviceData(load->device.data(), load->data, load->defaultPixel);
+                    load->data.clear();
+                }
+            });
+    }
+
+    threadPool.waitForDone();
+
+    bool hasLazyDevices = false;
+
+    /**
+     * The upper layers cover the lower ones, so they are
+     * materialized first. The hidden layers are not
+     * materialized until someone needs them.
+     */
+    for (int i = m_deferredLoads.size() - 1; i >= 0; i--) {
+        DeferredDeviceLoad &load = m_deferredLoads[i];
+
+        if (!load.success) {
+            m_warningMessages << i18n("Could not read pixel data: %1.", load.location);
+            load.device->disconnect();
+            continue;
+        }
+
+        if (lazyLoading) {
+            load.device->setLazyLoader(new KisKraLazyDeviceLoader(load.data, load.defaultPixel));
+            hasLazyDevices = true;
+
+            if (load.isVisible) {
+                m_image->addSpontaneousJob(new KisKraMaterializeDeviceJob(load.device));
+            }
+        }
+    }
+
+    m_deferredLoads.clear();
+
+    return hasLazyDevices;
+}
+
 template<class DevicePolicy>
 bool KisKraLoadVisitor::loadPaintDeviceFrame(KisPaintDeviceSP device, const QString &location, DevicePolicy policy)
 {
@@ -22,6 +22,7 @@
 
 #include <QRect>
 #include <QStringList>
+#include <QVector>
 
 // kritaimage
 #include "kis_types.h"
@@ -43,6 +44,7 @@ public:
                       QMap<KisNode *, QString> &keyframeFilenames,
                       const QString & name,
                       int syntaxVersion);
+    ~KisKraLoadVisitor() override;
 
 public:
     void setExternalUri(const QString &uri);
@@ -62,12 +64,36 @@ public:
     bool visit(KisSelectionMask *mask) override;
     bool visit(KisColorizeMask *mask) override;
 
+    /**
+     * If the store supports concurrent reading, the pixel data of the
+     * non-animated paint layers is not loaded during the visit. Call this
+     * method after the visit is completed to decode all the postponed
+     * devices in parallel.
+     *
+     * In lazy loading mode the devices only get the raw data from the
+     * archive. It is decoded on the first access to the device, or by
+     * spontaneous jobs of the image for the visible layers.
+     *
+     * @return true if some devices have been left not materialized
+     */
+    bool loadDeferredPaintDevices();
+
+    /**
+     * \see loadDeferredPaintDevices()
+     */
+    void setLazyLoading(bool value);
+
     QStringList errorMessages() const;
     QStringList warningMessages() const;
 
 private:
 
-    bool loadPaintDevice(KisPaintDeviceSP device, const QString& location);
+    /**
+     * Loads the pixel data of \p device. If \p deferringNode is set, the
+     * loading may be postponed till loadDeferredPaintDevices()
+     */
+    bool loadPaintDevice(KisPaintDeviceSP device, const QString& location, KisNode *deferringNode = 0);
+    bool deferPaintDeviceLoading(KisPaintDeviceSP device, const QString& location, bool isVisible);
 
     template<class DevicePolicy>
     bool loadPaintDeviceFrame(KisPaintDeviceSP device, const QString &location, DevicePolicy policy);
@@ -85,6 +111,7 @@ private:
     KisImageSP m_image;
     KoStore *m_store;
     bool m_external;
+    bool m_lazyLoading;
     QString m_uri;
     QMap<KisNode *, QString> m_layerFilenames;
     QMap<KisNode *, QString> m_keyframeFilenames;
@@ -92,6 +119,9 @@ private:
     int m_syntaxVersion;
     QStringList m_errorMessages;
     QStringList m_warningMessages;
+
+    struct DeferredDeviceLoad;
+    QVector<DeferredDeviceLoad> m_deferredLoads;
 };
 
 #endif // KIS_KRA_LOAD_VISITOR_H_
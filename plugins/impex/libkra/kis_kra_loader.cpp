@@ -26,6 +26,7 @@
 
 #include <QUrl>
 #include <QBuffer>
+#include <QImage>
 
 #include <KoStore.h>
 #include <KoColorSpaceRegistry.h>
@@ -57,6 +58,7 @@
 #include <kis_layer.h>
 #include <kis_name_server.h>
 #include <kis_paint_layer.h>
+#include <kis_paint_device.h>
 #include <kis_selection.h>
 #include <kis_selection_mask.h>
 #include <kis_shape_layer.h>
@@ -406,7 +408,30 @@ void KisKraLoader::loadBinaryData(KoStore * store, KisImageSP image, const QStri
         visitor.setExternalUri(uri);
     }
 
+    KisConfig cfg;
+    visitor.setLazyLoading(cfg.lazyLayerLoading());
+
     image->rootLayer()->accept(visitor);
+    const bool hasLazyDevices = visitor.loadDeferredPaintDevices();
+
+    /**
+     * Until the lazily loaded layers are decoded, the image is
+     * represented by the merged image stored in the file, so the
+     * projection can be regenerated in the background
+     */
+    if (hasLazyDevices && !external && store->hasFile("mergedimage.png")) {
+        QByteArray data;
+        QImage mergedImage;
+
+        if (store->extractFile("mergedimage.png", data) &&
+            mergedImage.loadFromData(data, "PNG") &&
+            mergedImage.size() == image->bounds().size()) {
+
+            image->projection()->convertFromQImage(mergedImage, 0);
+            image->setProjectionPreloaded(true);
+        }
+    }
+
     if (!visitor.errorMessages().isEmpty()) {
         m_d->errorMessages.append(visitor.errorMessages());
     }
@@ -38,6 +38,48 @@
 #include <kis_fixed_paint_device.h>
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
+#include <kis_image_config.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
+
+#include <QElapsedTimer>
+#include <QtMath>
+#include <kis_pointer_utils.h>
+
+
+struct KisColorSmudgeOp::UpdateSharedState
+{
+    QVector<DabInfo> dabs;
+    QElapsedTimer dabRenderingTimer;
+};
+
+namespace {
+
+/**
+ * Splits \p rc into horizontal stripes of \p stripeHeight pixels.
+ * The borders of the stripes are aligned to the multiples of
+ * \p stripeHeight, so, if it is a multiple of the tile size, two
+ * stripes will never share the same tile.
+ */
+QVector<QRect> splitIntoStripes(const QRect &rc, int stripeHeight)
+{
+    QVector<QRect> stripes;
+
+    int y = rc.top();
+    while (y <= rc.bottom()) {
+        const int stripeIndex =
+            y >= 0 ? y / stripeHeight : -((-y + stripeHeight - 1) / stripeHeight);
+        const int bottom = qMin(rc.bottom(), (stripeIndex + 1) * stripeHeight - 1);
+
+        stripes.append(QRect(rc.left(), y, rc.width(), bottom - y + 1));
+        y = bottom + 1;
+    }
+
+    return stripes;
+}
+
+}
+
 
 
 KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image)
@@ -45,12 +87,12 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     , m_firstRun(true)
     , m_image(image)
     , m_tempDev(painter->device()->createCompositionSourceDevice())
-    , m_backgroundPainter(new KisPainter(m_tempDev))
     , m_smudgePainter(new KisPainter(m_tempDev))
-    , m_colorRatePainter(new KisPainter(m_tempDev))
     , m_smudgeRateOption()
     , m_colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false)
     , m_smudgeRadiusOption()
+    , m_currentUpdatePeriod(40)
+    , m_idealNumStripes(KisImageConfig().maxNumberOfThreads())
 {
     Q_UNUSED(node);
 
@@ -80,17 +122,14 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
 
     m_gradient = painter->gradient();
 
-    m_backgroundPainter->setCompositeOp(COMPOSITE_COPY);
     // Smudge Painter works in default COMPOSITE_OVER mode
-    m_colorRatePainter->setCompositeOp(painter->compositeOp()->id());
+    m_colorRateCompositeOpId = painter->compositeOp()->id();
 
     m_rotationOption.applyFanCornersInfo(this);
 }
 
 KisColorSmudgeOp::~KisColorSmudgeOp()
 {
-    delete m_backgroundPainter;
-    delete m_colorRatePainter;
     delete m_smudgePainter;
 }
 
@@ -199,92 +238,269 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
         return spacingInfo;
     }
 
-    // save the old opacity value and composite mode
-    quint8  oldOpacity = painter()->opacity();
-    QString oldCompositeOpId = painter()->compositeOp()->id();
-    qreal   fpOpacity  = (qreal(oldOpacity) / 255.0) * m_opacityOption.getOpacityf(info);
+    DabInfo dab;
+    dab.info = info;
+    dab.dstDabRect = m_dstDabRect;
+    dab.srcDabRect = srcDabRect;
+    dab.hotSpot = hotSpot;
+    dab.maskDab = m_maskDab;
+    dab.preserveMask = !m_dabCache->needSeparateOriginal();
+    dab.useOverlay = m_image && m_overlayModeOption.isChecked();
+    dab.useColorRate = m_colorRateOption.isChecked();
 
-    if (m_image && m_overlayModeOption.isChecked()) {
-        m_image->blockUpdates();
-        m_backgroundPainter->bitBlt(QPoint(), m_image->projection(), srcDabRect);
-        m_image->unblockUpdates();
+    const qreal fpOpacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
+
+    if (dab.useColorRate) {
+        // this will apply the opacity (selected by the user) to the color rate
+        // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
+        qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
+        dab.colorRateOpacity = m_colorRateOption.computeOpacity(info, 0.0, maxColorRate, fpOpacity);
+
+        // the current color (foreground color) or a gradient color (if enabled)
+        dab.paintColor = painter()->paintColor();
+        m_gradientOption.apply(dab.paintColor, m_gradient, info);
     }
-    else {
-        // IMPORTANT: clear the temporary painting device to color black with zero opacity:
-        //            it will only clear the extents of the brush.
-        m_tempDev->clear(QRect(QPoint(), m_dstDabRect.size()));
+
+    // opacity calculated by the rate option
+    dab.smudgeRateOpacity = m_smudgeRateOption.computeOpacity(info, 0.0, 1.0, fpOpacity);
+
+    if (painter()->runnableStrokeJobsInterface()) {
+        /**
+         * The mask is owned by the dab cache and will be overwritten
+         * by the next paintAt() call, so we should keep a copy of it
+         * until the dab is rendered by doAsyncronousUpdate() jobs.
+         */
+        dab.maskDab = new KisFixedPaintDevice(*m_maskDab);
+        m_pendingDabs.append(dab);
+    } else {
+        renderDab(&dab);
     }
 
-    if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) {
-        m_smudgePainter->bitBlt(QPoint(), painter()->device(), srcDabRect);
+    return spacingInfo;
+}
+
+void KisColorSmudgeOp::prepareDab(DabInfo *dab)
+{
+    if (dab->useOverlay) {
+        m_image->blockUpdates();
+    }
+
+    if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) return;
+
+    QPoint pt = (dab->srcDabRect.topLeft() + dab->hotSpot).toPoint();
+
+    if (m_smudgeRadiusOption.isChecked()) {
+        qreal effectiveSize = 0.5 * (dab->dstDabRect.width() + dab->dstDabRect.height());
+        m_smudgeRadiusOption.apply(*m_smudgePainter, dab->info, effectiveSize, pt.x(), pt.y(), painter()->device());
+
+        dab->smudgeColor = m_smudgePainter->paintColor();
+
     } else {
-        QPoint pt = (srcDabRect.topLeft() + hotSpot).toPoint();
+        KoColor color = painter()->paintColor();
 
-        if (m_smudgeRadiusOption.isChecked()) {
-            qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
-            m_smudgeRadiusOption.apply(*m_smudgePainter, info, effectiveSize, pt.x(), pt.y(), painter()->device());
+        // get the pixel on the canvas that lies beneath the hot spot
+        // of the dab and fill  the temporary paint device with that color
 
-            KoColor color2 = m_smudgePainter->paintColor();
-            m_smudgePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color2);
+        KisCrossDeviceColorPickerInt colorPicker(painter()->device(), color);
+        colorPicker.pickColor(pt.x(), pt.y(), color.data());
 
-        } else {
-            KoColor color = painter()->paintColor();
+        dab->smudgeColor = color;
+    }
+}
 
-            // get the pixel on the canvas that lies beneath the hot spot
-            // of the dab and fill  the temporary paint device with that color
+void KisColorSmudgeOp::sampleDabArea(const DabInfo &dab, const QRect &rc)
+{
+    const QRect srcRect = rc.translated(dab.srcDabRect.topLeft());
 
-            KisCrossDeviceColorPickerInt colorPicker(painter()->device(), color);
-            colorPicker.pickColor(pt.x(), pt.y(), color.data());
+    if (dab.useOverlay) {
+        KisPainter backgroundPainter(m_tempDev);
+        backgroundPainter.setCompositeOp(COMPOSITE_COPY);
+        backgroundPainter.bitBlt(rc.topLeft(), m_image->projection(), srcRect);
+    }
+    else {
+        // IMPORTANT: clear the temporary painting device to color black with zero opacity:
+        //            it will only clear the extents of the brush.
+        m_tempDev->clear(rc);
+    }
 
-            m_smudgePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
-        }
+    KisPainter smudgePainter(m_tempDev);
+
+    if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) {
+        smudgePainter.bitBlt(rc.topLeft(), painter()->device(), srcRect);
+    } else {
+        smudgePainter.fill(rc.x(), rc.y(), rc.width(), rc.height(), dab.smudgeColor);
     }
 
     // if the user selected the color smudge option,
     // we will mix some color into the temporary painting device (m_tempDev)
-    if (m_colorRateOption.isChecked()) {
-        // this will apply the opacity (selected by the user) to copyPainter
-        // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
-        qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
-        m_colorRateOption.apply(*m_colorRatePainter, info, 0.0, maxColorRate, fpOpacity);
-
-        // paint a rectangle with the current color (foreground color)
-        // or a gradient color (if enabled)
-        // into the temporary painting device and use the user selected
-        // composite mode
-        KoColor color = painter()->paintColor();
-        m_gradientOption.apply(color, m_gradient, info);
-        m_colorRatePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
+    if (dab.useColorRate) {
+        // paint a rectangle with the current color using the user
+        // selected composite mode
+        KisPainter colorRatePainter(m_tempDev);
+        colorRatePainter.setCompositeOp(m_colorRateCompositeOpId);
+        colorRatePainter.setOpacity(dab.colorRateOpacity);
+        colorRatePainter.fill(rc.x(), rc.y(), rc.width(), rc.height(), dab.paintColor);
     }
+}
+
+void KisColorSmudgeOp::blitDabArea(const DabInfo &dab, const QRect &rc)
+{
+    const QRect dstRect = rc.translated(dab.dstDabRect.topLeft());
+
+    KisPainter gc(painter()->device(), painter()->selection());
+    gc.setChannelFlags(painter()->channelFlags());
+    gc.setCompositeOp(COMPOSITE_COPY);
 
     // if color is disabled (only smudge) and "overlay mode" is enabled
     // then first blit the region under the brush from the image projection
     // to the painting device to prevent a rapid build up of alpha value
     // if the color to be smudged is semi transparent.
-    if (m_image && m_overlayModeOption.isChecked() && !m_colorRateOption.isChecked()) {
+    if (dab.useOverlay && !dab.useColorRate) {
+        gc.bitBlt(dstRect.topLeft(), m_image->projection(), dstRect);
+    }
+
+    // then blit the temporary painting device on the canvas at the current brush position
+    // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
+    gc.setOpacity(dab.smudgeRateOpacity);
+    gc.bitBltWithFixedSelection(dstRect.x(), dstRect.y(),
+                                m_tempDev, dab.maskDab,
+                                rc.x(), rc.y(),
+                                rc.x(), rc.y(),
+                                rc.width(), rc.height());
+}
+
+void KisColorSmudgeOp::finishDab(const DabInfo &dab)
+{
+    if (painter()->hasMirroring()) {
+        // save the old opacity value and composite mode
+        quint8  oldOpacity = painter()->opacity();
+        QString oldCompositeOpId = painter()->compositeOp()->id();
+
         painter()->setCompositeOp(COMPOSITE_COPY);
-        painter()->setOpacity(OPACITY_OPAQUE_U8);
-        m_image->blockUpdates();
-        painter()->bitBlt(m_dstDabRect.topLeft(), m_image->projection(), m_dstDabRect);
+        painter()->setOpacity(dab.smudgeRateOpacity);
+        painter()->renderMirrorMaskSafe(dab.dstDabRect, m_tempDev, 0, 0, dab.maskDab, dab.preserveMask);
+
+        // restore orginal opacy and composite mode values
+        painter()->setOpacity(oldOpacity);
+        painter()->setCompositeOp(oldCompositeOpId);
+    }
+
+    painter()->addDirtyRect(dab.dstDabRect);
+
+    if (dab.useOverlay) {
         m_image->unblockUpdates();
     }
+}
+
+void KisColorSmudgeOp::renderDab(DabInfo *dab)
+{
+    const QRect dabRect(QPoint(), dab->dstDabRect.size());
+
+    prepareDab(dab);
+    sampleDabArea(*dab, dabRect);
+    blitDabArea(*dab, dabRect);
+    finishDab(*dab);
+}
+
+void KisColorSmudgeOp::addDabRenderingJobs(UpdateSharedStateSP state, int index, QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    /**
+     * Every dab reads the area of the canvas that has just been
+     * written by the previous one, so the dabs themselves are rendered
+     * strictly sequentially. But the pixels of a single big dab can
+     * be processed concurrently in stripes: first all the stripes of
+     * the smudge source are sampled into m_tempDev and mixed with the
+     * paint color, then the stripes are written into the canvas.
+     */
+    const int tileSize = 64;
+    const QRect dstDabRect = state->dabs[index].dstDabRect;
+    const int stripeHeight =
+        tileSize * qMax(1, qCeil(qreal(dstDabRect.height()) / (tileSize * m_idealNumStripes)));
+
+    const QVector<QRect> sampleStripes =
+        splitIntoStripes(QRect(QPoint(), dstDabRect.size()), stripeHeight);
+
+    QVector<QRect> blitStripes = splitIntoStripes(dstDabRect, stripeHeight);
+    for (auto it = blitStripes.begin(); it != blitStripes.end(); ++it) {
+        *it = it->translated(-dstDabRect.topLeft());
+    }
 
+    if (sampleStripes.size() < 2 && blitStripes.size() < 2) {
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, index, this] () {
+                    renderDab(&state->dabs[index]);
+                },
+                KisStrokeJobData::SEQUENTIAL));
+        return;
+    }
 
-    // set opacity calculated by the rate option
-    m_smudgeRateOption.apply(*painter(), info, 0.0, 1.0, fpOpacity);
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [state, index, this] () {
+                prepareDab(&state->dabs[index]);
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+    Q_FOREACH (const QRect &rc, sampleStripes) {
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, index, rc, this] () {
+                    sampleDabArea(state->dabs[index], rc);
+                },
+                KisStrokeJobData::CONCURRENT));
+    }
 
-    // then blit the temporary painting device on the canvas at the current brush position
-    // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
+    /**
+     * The source and destination areas of the dab overlap, so all
+     * the sampling must be finished before we start writing into the
+     * canvas. The sequential job works as a barrier here.
+     */
+    jobs.append(new KisRunnableStrokeJobData([] () {}, KisStrokeJobData::SEQUENTIAL));
+
+    Q_FOREACH (const QRect &rc, blitStripes) {
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, index, rc, this] () {
+                    blitDabArea(state->dabs[index], rc);
+                },
+                KisStrokeJobData::CONCURRENT));
+    }
 
-    painter()->setCompositeOp(COMPOSITE_COPY);
-    painter()->bitBltWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
-    painter()->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, 0, 0, m_maskDab, !m_dabCache->needSeparateOriginal());
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [state, index, this] () {
+                finishDab(state->dabs[index]);
+            },
+            KisStrokeJobData::SEQUENTIAL));
+}
 
-    // restore orginal opacy and composite mode values
-    painter()->setOpacity(oldOpacity);
-    painter()->setCompositeOp(oldCompositeOpId);
+int KisColorSmudgeOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    if (!m_updateSharedState && !m_pendingDabs.isEmpty()) {
 
-    return spacingInfo;
+        m_updateSharedState = toQShared(new UpdateSharedState());
+        UpdateSharedStateSP state = m_updateSharedState;
+
+        state->dabs.swap(m_pendingDabs);
+        state->dabRenderingTimer.start();
+
+        for (int i = 0; i < state->dabs.size(); i++) {
+            addDabRenderingJobs(state, i, jobs);
+        }
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, this] () {
+                    const int renderingTime = state->dabRenderingTimer.elapsed();
+                    m_currentUpdatePeriod = qBound(20, int(1.5 * renderingTime), 100);
+
+                    m_updateSharedState.clear();
+                },
+                KisStrokeJobData::SEQUENTIAL));
+    }
+
+    return m_currentUpdatePeriod;
 }
 
 KisSpacingInformation KisColorSmudgeOp::updateSpacingImpl(const KisPaintInformation &info) const
@@ -20,9 +20,14 @@
 #define _KIS_COLORSMUDGEOP_H_
 
 #include <QRect>
+#include <QVector>
+#include <QSharedPointer>
+
+#include <KoColor.h>
 
 #include <kis_brush_based_paintop.h>
 #include <kis_types.h>
+#include <brushengine/kis_paint_information.h>
 #include <kis_pressure_size_option.h>
 #include <kis_pressure_opacity_option.h>
 #include <kis_pressure_spacing_option.h>
@@ -39,6 +44,7 @@ class QPointF;
 class KoAbstractGradient;
 class KisBrushBasedPaintOpSettings;
 class KisPainter;
+class KisRunnableStrokeJobData;
 
 class KisColorSmudgeOp: public KisBrushBasedPaintOp
 {
@@ -46,24 +52,66 @@ public:
     KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image);
     ~KisColorSmudgeOp() override;
 
+    int doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
     KisSpacingInformation updateSpacingImpl(const KisPaintInformation &info) const override;
 
 private:
+    /**
+     * Everything needed to render a single dab that does not depend on
+     * the content of the canvas. It is calculated in paintAt() and
+     * consumed by the rendering jobs afterwards.
+     */
+    struct DabInfo {
+        KisPaintInformation info;
+        QRect dstDabRect;
+        QRect srcDabRect;
+        QPointF hotSpot;
+        KisFixedPaintDeviceSP maskDab;
+        bool preserveMask = true;
+
+        bool useOverlay = false;
+        bool useColorRate = false;
+        KoColor paintColor;
+        quint8 colorRateOpacity = OPACITY_OPAQUE_U8;
+        quint8 smudgeRateOpacity = OPACITY_OPAQUE_U8;
+
+        // sampled from the canvas in prepareDab() in dulling mode
+        KoColor smudgeColor;
+    };
+
+    struct UpdateSharedState;
+    typedef QSharedPointer<UpdateSharedState> UpdateSharedStateSP;
+
     // Sets the m_maskDab _and m_maskDabRect
     void updateMask(const KisPaintInformation& info, double scale, double rotation, const QPointF &cursorPoint);
 
     inline void getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y);
 
+    /**
+     * The dab is rendered in four stages. prepareDab() and finishDab()
+     * must be called sequentially, but sampleDabArea() and blitDabArea()
+     * can be called concurrently for non-overlapping areas of the same dab,
+     * as long as all the sampling is finished before the blitting starts.
+     * The areas are passed in the dab-local coordinates.
+     */
+    void prepareDab(DabInfo *dab);
+    void sampleDabArea(const DabInfo &dab, const QRect &rc);
+    void blitDabArea(const DabInfo &dab, const QRect &rc);
+    void finishDab(const DabInfo &dab);
+
+    void renderDab(DabInfo *dab);
+    void addDabRenderingJobs(UpdateSharedStateSP state, int index, QVector<KisRunnableStrokeJobData*> &jobs);
+
 private:
     bool                      m_firstRun;
     KisImageWSP               m_image;
     KisPaintDeviceSP          m_tempDev;
-    KisPainter*               m_backgroundPainter;
     KisPainter*               m_smudgePainter;
-    KisPainter*               m_colorRatePainter;
+    QString                   m_colorRateCompositeOpId;
     const KoAbstractGradient* m_gradient;
     KisPressureSizeOption     m_sizeOption;
     KisPressureOpacityOption  m_opacityOption;
@@ -78,6 +126,11 @@ private:
     QRect                     m_dstDabRect;
     KisFixedPaintDeviceSP     m_maskDab;
     QPointF                   m_lastPaintPos;
+
+    QVector<DabInfo>          m_pendingDabs;
+    UpdateSharedStateSP       m_updateSharedState;
+    int                       m_currentUpdatePeriod;
+    const int                 m_idealNumStripes;
 };
 
 #endif // _KIS_COLORSMUDGEOP_H_
@@ -38,6 +38,13 @@ public:
      */
     void apply(KisPainter& painter, const KisPaintInformation& info, qreal scaleMin = 0.0, qreal scaleMax = 1.0, qreal multiplicator = 1.0) const;
 
+    /**
+     * Calculate the opacity apply() would set on the painter without
+     * touching any painter. Useful when the painter is not available
+     * at the moment the paint information is processed.
+     */
+    quint8 computeOpacity(const KisPaintInformation& info, qreal scaleMin = 0.0, qreal scaleMax = 1.0, qreal multiplicator = 1.0) const;
+
     void setRate(qreal rate) {
         KisCurveOption::setValue(rate);
     }
@@ -28,11 +28,17 @@
 
 #include <kis_types.h>
 #include <kis_iterator_ng.h>
+#include <kis_random_accessor_ng.h>
 #include <kis_cross_device_color_picker.h>
 
 #include <cmath>
 #include <ctime>
+#include <limits>
+
 #include <KoColorSpaceRegistry.h>
+#include <KoMixColorsOp.h>
+
+#include <KisRunnableStrokeJobData.h>
 
 const qreal degToRad = M_PI / 180.0;
 
@@ -156,15 +162,48 @@ bool DeformBrush::setupAction(
     return true;
 }
 
+namespace {
+
+/// the dab is rendered in the bands of this height on the worker threads
+const int bandHeight = 16;
+
+/// smaller dabs are rendered on the calling thread
+const int minParallelArea = 128 * 128;
+
+/**
+ * When the deformation pulls the pixels from too far away (or
+ * from the infinity), the source area is not copied, the pixels
+ * are picked one by one instead
+ */
+const int maxSourceAreaFactor = 16;
+
+void gatherPixels(KisPaintDeviceSP dev, const QRect &rc, bool useOldData, quint8 *dst)
+{
+    const int pixelSize = dev->pixelSize();
+    KisRandomConstAccessorSP it = dev->createRandomConstAccessorNG(rc.x(), rc.y());
+
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        int x = rc.left();
+        while (x <= rc.right()) {
+            const int numColumns = qMin(it->numContiguousColumns(x), rc.right() - x + 1);
+
+            it->moveTo(x, y);
+            memcpy(dst, useOldData ? it->oldRawData() : it->rawDataConst(), numColumns * pixelSize);
+
+            dst += numColumns * pixelSize;
+            x += numColumns;
+        }
+    }
+}
+
+}
+
 KisFixedPaintDeviceSP DeformBrush::paintMask(KisFixedPaintDeviceSP dab,
         KisPaintDeviceSP layer,
         qreal scale,
         qreal rotation,
         QPointF pos, qreal subPixelX, qreal subPixelY, int dabX, int dabY)
 {
-    KisFixedPaintDeviceSP mask = new KisFixedPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
-    KisCrossDeviceColorPicker colorPicker(layer, dab);
-
     qreal fWidth = maskWidth(scale);
     qreal fHeight = maskHeight(scale);
 
@@ -183,84 +222,291 @@ KisFixedPaintDeviceSP DeformBrush::paintMask(KisFixedPaintDeviceSP dab,
     qreal const majorAxis = 2.0 / fWidth;
     qreal const minorAxis = 2.0 / fHeight;
 
-    qreal distance;
-
     QTransform forwardRotationMatrix;
     forwardRotationMatrix.rotateRadians(-rotation);
     QTransform reverseRotationMatrix;
     reverseRotationMatrix.rotateRadians(rotation);
 
+    const DeformModes mode = DeformModes(m_properties->deform_action - 1);
+
     // if can't paint, stop
-    if (!setupAction(DeformModes(m_properties->deform_action - 1),
-                     pos, forwardRotationMatrix))
+    if (!setupAction(mode, pos, forwardRotationMatrix))
     {
         return 0;
     }
 
-    mask->setRect(dab->bounds());
-    mask->lazyGrowBufferWithoutInitialization();
-    quint8* maskPointer = mask->data();
-    qint8 maskPixelSize = mask->pixelSize();
+    if (!m_mask) {
+        m_mask = new KisFixedPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+    }
 
-    quint8* dabPointer = dab->data();
-    int dabPixelSize = dab->colorSpace()->pixelSize();
+    m_mask->setRect(dab->bounds());
+    m_mask->lazyGrowBufferWithoutInitialization();
 
-    for (int y = 0; y <  dstHeight; y++) {
-        for (int x = 0; x < dstWidth; x++) {
-            qreal maskX = x - centerX;
-            qreal maskY = y - centerY;
-            forwardRotationMatrix.map(maskX, maskY, &maskX, &maskY);
-            distance = norme(maskX * majorAxis, maskY * minorAxis);
+    const int numPixels = dstWidth * dstHeight;
+    m_points.resize(numPixels);
+    m_pixelStates.resize(numPixels);
 
-            if (distance > 1.0) {
-                // leave there OPACITY TRANSPARENT pixel (default pixel)
+    auto calculateRows = [&] (int begin, int end) {
+        QPointF *point = m_points.data() + begin * dstWidth;
+        quint8 *state = m_pixelStates.data() + begin * dstWidth;
+        quint8 *maskPointer = m_mask->data() + begin * dstWidth;
 
-                colorPicker.pickOldColor(x + dabX, y + dabY, dabPointer);
-                dabPointer += dabPixelSize;
-
-                *maskPointer = OPACITY_TRANSPARENT_U8;
-                maskPointer += maskPixelSize;
-                continue;
-            }
+        for (int y = begin; y < end; y++) {
+            for (int x = 0; x < dstWidth; x++, point++, state++, maskPointer++) {
+                qreal maskX = x - centerX;
+                qreal maskY = y - centerY;
+                forwardRotationMatrix.map(maskX, maskY, &maskX, &maskY);
+                qreal distance = norme(maskX * majorAxis, maskY * minorAxis);
 
-            if (m_sizeProperties->brush_density != 1.0) {
-                if (m_sizeProperties->brush_density < drand48()) {
-                    dabPointer += dabPixelSize;
+                if (distance > 1.0) {
+                    // leave there OPACITY TRANSPARENT pixel (default pixel)
+                    *state = OutsideDab;
                     *maskPointer = OPACITY_TRANSPARENT_U8;
-                    maskPointer += maskPixelSize;
                     continue;
                 }
-            }
 
-            m_deformAction->transform(&maskX, &maskY, distance);
-            reverseRotationMatrix.map(maskX, maskY, &maskX, &maskY);
+                if (m_sizeProperties->brush_density != 1.0) {
+                    if (m_sizeProperties->brush_density < drand48()) {
+                        *state = SkippedPixel;
+                        *maskPointer = OPACITY_TRANSPARENT_U8;
+                        continue;
+                    }
+                }
 
-            maskX += pos.x();
-            maskY += pos.y();
+                m_deformAction->transform(&maskX, &maskY, distance);
+                reverseRotationMatrix.map(maskX, maskY, &maskX, &maskY);
 
-            if (!m_properties->deform_use_bilinear) {
-                maskX = qRound(maskX);
-                maskY = qRound(maskY);
-            }
+                maskX += pos.x();
+                maskY += pos.y();
+
+                if (!m_properties->deform_use_bilinear) {
+                    maskX = qRound(maskX);
+                    maskY = qRound(maskY);
+                }
 
-            if (m_properties->deform_use_old_data) {
-                colorPicker.pickOldColor(maskX, maskY, dabPointer);
+                *point = QPointF(maskX, maskY);
+                *state = DeformedPixel;
+                *maskPointer = OPACITY_OPAQUE_U8;
             }
-            else {
-                colorPicker.pickColor(maskX, maskY, dabPointer);
+        }
+    };
+
+    /**
+     * The density option and the color deformation use drand48(),
+     * which is neither thread-safe nor reproducible when called from
+     * several threads, so in this case the coordinates are calculated
+     * on the calling thread
+     */
+    const bool useRandom =
+        m_sizeProperties->brush_density != 1.0 || mode == DEFORM_COLOR;
+
+    const bool useThreads = numPixels >= minParallelArea;
+
+    if (useRandom || !useThreads) {
+        calculateRows(0, dstHeight);
+    } else {
+        runInBands(dstHeight, calculateRows);
+    }
+
+    /**
+     * Copy the areas of the layer the dab reads from into linear
+     * buffers, so the resampling doesn't need any accessors
+     */
+    bool hasBackground = false;
+    bool canGather = true;
+    qreal left = std::numeric_limits<qreal>::max();
+    qreal top = std::numeric_limits<qreal>::max();
+    qreal right = std::numeric_limits<qreal>::lowest();
+    qreal bottom = std::numeric_limits<qreal>::lowest();
+
+    for (int i = 0; i < numPixels; i++) {
+        if (m_pixelStates[i] == OutsideDab) {
+            hasBackground = true;
+        } else if (m_pixelStates[i] == DeformedPixel) {
+            const QPointF &pt = m_points[i];
+
+            if (!std::isfinite(pt.x()) || !std::isfinite(pt.y())) {
+                canGather = false;
+                break;
             }
 
-            dabPointer += dabPixelSize;
+            left = qMin(left, pt.x());
+            top = qMin(top, pt.y());
+            right = qMax(right, pt.x());
+            bottom = qMax(bottom, pt.y());
+        }
+    }
 
-            *maskPointer = OPACITY_OPAQUE_U8;
-            maskPointer += maskPixelSize;
+    QRect sourceRect;
+    if (canGather && left <= right) {
+        const qreal maxSourceSize = qreal(maxSourceAreaFactor) * numPixels + 4.0;
 
+        if ((right - left + 2.0) * (bottom - top + 2.0) > maxSourceSize) {
+            canGather = false;
+        } else {
+            sourceRect = QRect(QPoint(int(std::floor(left)), int(std::floor(top))),
+                               QPoint(int(std::floor(right)) + 1, int(std::floor(bottom)) + 1));
         }
     }
+
+    if (!canGather) {
+        renderWithPicker(dab, layer, dabX, dabY);
+        m_counter++;
+        return m_mask;
+    }
+
+    const QRect backgroundRect =
+        hasBackground ? QRect(dabX, dabY, dstWidth, dstHeight) : QRect();
+
+    const int srcPixelSize = layer->pixelSize();
+
+    if (!backgroundRect.isEmpty()) {
+        m_backgroundPixels.resize(backgroundRect.width() * backgroundRect.height() * srcPixelSize);
+        gatherPixels(layer, backgroundRect, true, m_backgroundPixels.data());
+    }
+
+    if (!sourceRect.isEmpty()) {
+        m_sourcePixels.resize(sourceRect.width() * sourceRect.height() * srcPixelSize);
+        gatherPixels(layer, sourceRect, m_properties->deform_use_old_data, m_sourcePixels.data());
+    }
+
+    const KoColorSpace *srcCS = layer->colorSpace();
+
+    auto renderBand = [&] (int begin, int end) {
+        renderRows(begin, end, dab, srcCS, backgroundRect, sourceRect);
+    };
+
+    if (useThreads) {
+        runInBands(dstHeight, renderBand);
+    } else {
+        renderBand(0, dstHeight);
+    }
+
     m_counter++;
 
-    return mask;
+    return m_mask;
+}
+
+void DeformBrush::runInBands(int height, std::function<void(int, int)> func)
+{
+    QVector<KisRunnableStrokeJobData*> jobs;
+
+    for (int y = 0; y < height; y += bandHeight) {
+        const int end = qMin(y + bandHeight, height);
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [func, y, end] () { func(y, end); },
+                KisStrokeJobData::CONCURRENT));
+    }
+
+    m_bandsExecutor.addRunnableJobs(jobs);
+}
 
+void DeformBrush::renderRows(int begin, int end, KisFixedPaintDeviceSP dab,
+                             const KoColorSpace *srcCS,
+                             const QRect &backgroundRect, const QRect &sourceRect) const
+{
+    const KoColorSpace *dstCS = dab->colorSpace();
+    const KoMixColorsOp *mixOp = srcCS->mixColorsOp();
+
+    const int width = dab->bounds().width();
+    const int srcPixelSize = srcCS->pixelSize();
+    const int dstPixelSize = dstCS->pixelSize();
+    const int sourceStride = sourceRect.width() * srcPixelSize;
+
+    /**
+     * When the color spaces differ, the row is resampled in the color
+     * space of the layer and converted in one go
+     */
+    const bool needsConversion = !(*srcCS == *dstCS);
+    QVector<quint8> rowBuffer(needsConversion ? width * srcPixelSize : 0);
+
+    for (int y = begin; y < end; y++) {
+        quint8 *dstRow = dab->data() + y * width * dstPixelSize;
+        quint8 *dst = needsConversion ? rowBuffer.data() : dstRow;
+
+        const QPointF *point = m_points.constData() + y * width;
+        const quint8 *state = m_pixelStates.constData() + y * width;
+
+        for (int x = 0; x < width; x++, dst += srcPixelSize) {
+            if (state[x] == OutsideDab) {
+                memcpy(dst,
+                       m_backgroundPixels.constData() + (y * width + x) * srcPixelSize,
+                       srcPixelSize);
+            } else if (state[x] == SkippedPixel) {
+                memset(dst, 0, srcPixelSize);
+            } else {
+                const QPointF &pt = point[x];
+                const int srcX = int(std::floor(pt.x()));
+                const int srcY = int(std::floor(pt.y()));
+                const qreal hsub = pt.x() - srcX;
+                const qreal vsub = pt.y() - srcY;
+
+                const quint8 *src =
+                    m_sourcePixels.constData() +
+                    (srcY - sourceRect.y()) * sourceStride +
+                    (srcX - sourceRect.x()) * srcPixelSize;
+
+                if (hsub == 0.0 && vsub == 0.0) {
+                    // nearest neighbour mode or an exact hit
+                    memcpy(dst, src, srcPixelSize);
+                    continue;
+                }
+
+                // the same weights KisRandomSubAccessor uses
+                const qint16 weights[4] = {
+                    qint16(qRound((1.0 - hsub) * (1.0 - vsub) * 255)),
+                    qint16(qRound((1.0 - vsub) * hsub * 255)),
+                    qint16(qRound(vsub * (1.0 - hsub) * 255)),
+                    qint16(qRound(hsub * vsub * 255))
+                };
+
+                const quint8 *pixels[4] = {
+                    src,
+                    src + srcPixelSize,
+                    src + sourceStride,
+                    src + sourceStride + srcPixelSize
+                };
+
+                mixOp->mixColors(pixels, weights, 4, dst);
+            }
+        }
+
+        if (needsConversion) {
+            srcCS->convertPixelsTo(rowBuffer.constData(), dstRow, dstCS, width,
+                                   KoColorConversionTransformation::internalRenderingIntent(),
+                                   KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+}
+
+void DeformBrush::renderWithPicker(KisFixedPaintDeviceSP dab, KisPaintDeviceSP layer, int dabX, int dabY)
+{
+    KisCrossDeviceColorPicker colorPicker(layer, dab);
+
+    const int width = dab->bounds().width();
+    const int height = dab->bounds().height();
+    const int dabPixelSize = dab->colorSpace()->pixelSize();
+
+    quint8 *dabPointer = dab->data();
+    const QPointF *point = m_points.constData();
+    const quint8 *state = m_pixelStates.constData();
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++, point++, state++, dabPointer += dabPixelSize) {
+            if (*state == OutsideDab) {
+                colorPicker.pickOldColor(x + dabX, y + dabY, dabPointer);
+            } else if (*state == DeformedPixel) {
+                if (m_properties->deform_use_old_data) {
+                    colorPicker.pickOldColor(point->x(), point->y(), dabPointer);
+                }
+                else {
+                    colorPicker.pickColor(point->x(), point->y(), dabPointer);
+                }
+            }
+        }
+    }
 }
 
 void DeformBrush::debugColor(const quint8* data, KoColorSpace * cs)
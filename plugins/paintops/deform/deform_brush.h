@@ -24,6 +24,9 @@
 
 #include <kis_brush_size_option.h>
 #include <kis_deform_option.h>
+#include <KisThreadPoolRunnableStrokeJobsExecutor.h>
+
+#include <functional>
 
 #include <time.h>
 
@@ -216,9 +219,29 @@ public:
     QPointF hotSpot(qreal scale, qreal rotation);
 
 private:
+    friend class KisDeformBrushTest;
+
     // return true if can paint
     bool setupAction(
         DeformModes mode, const QPointF& pos, QTransform const& rotation);
+
+    /// the state of every pixel of the dab calculated by paintMask()
+    enum PixelState {
+        OutsideDab,     ///< the pixel is copied from the layer as it is
+        SkippedPixel,   ///< the pixel is dropped by the density option
+        DeformedPixel   ///< the pixel is resampled from m_points
+    };
+
+    /**
+     * Splits the rows of the dab into bands and calls \p func for
+     * each of them concurrently. Returns when all the bands are done.
+     */
+    void runInBands(int height, std::function<void(int, int)> func);
+
+    void renderRows(int begin, int end, KisFixedPaintDeviceSP dab,
+                    const KoColorSpace *srcCS,
+                    const QRect &backgroundRect, const QRect &sourceRect) const;
+    void renderWithPicker(KisFixedPaintDeviceSP dab, KisPaintDeviceSP layer, int dabX, int dabY);
     void debugColor(const quint8* data, KoColorSpace * cs);
 
     qreal maskWidth(qreal scale) {
@@ -244,6 +267,20 @@ private:
 
     DeformBase * m_deformAction;
 
+    // the buffers of paintMask(), reused between the dabs
+    KisFixedPaintDeviceSP m_mask;
+    QVector<QPointF> m_points;
+    QVector<quint8> m_pixelStates;
+    QVector<quint8> m_backgroundPixels;
+    QVector<quint8> m_sourcePixels;
+
+    /**
+     * The stroke's own jobs interface queues the jobs after the
+     * current dab job, so the bands of a dab are rendered by a
+     * synchronous executor instead
+     */
+    KisThreadPoolRunnableStrokeJobsExecutor m_bandsExecutor;
+
     DeformOption * m_properties;
     BrushSizeOption * m_sizeProperties;
 };
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_deform_brush_test.h"
+
+#include <QTest>
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_fixed_paint_device.h>
+
+#include "deform_brush.h"
+
+
+static KisPaintDeviceSP createTestLayer()
+{
+    QImage image(512, 512, QImage::Format_ARGB32);
+
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            image.setPixel(x, y, qRgba(x & 0xff, y & 0xff, (x * y) & 0xff, 128 + ((x + y) & 0x7f)));
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(image, 0);
+    return dev;
+}
+
+void KisDeformBrushTest::testGatheredResampling_data()
+{
+    QTest::addColumn<int>("action");
+    QTest::addColumn<bool>("useBilinear");
+    QTest::addColumn<int>("diameter");
+
+    // the actions are numbered as in DeformOption::deform_action
+    QTest::newRow("grow") << 1 << true << 100;
+    QTest::newRow("shrink") << 2 << true << 100;
+    QTest::newRow("swirl-cw") << 3 << true << 100;
+    QTest::newRow("swirl-ccw") << 4 << true << 100;
+    QTest::newRow("move") << 5 << true << 100;
+    QTest::newRow("lens-in") << 6 << true << 100;
+    QTest::newRow("lens-out") << 7 << true << 100;
+    QTest::newRow("color") << 8 << true << 100;
+    QTest::newRow("swirl-cw-nearest") << 3 << false << 100;
+    QTest::newRow("lens-out-nearest") << 7 << false << 100;
+
+    // the dabs of 128x128 and larger are rendered in bands
+    QTest::newRow("swirl-cw-bands") << 3 << true << 200;
+    QTest::newRow("lens-in-bands") << 6 << true << 200;
+    QTest::newRow("grow-bands-nearest") << 1 << false << 200;
+}
+
+void KisDeformBrushTest::testGatheredResampling()
+{
+    QFETCH(int, action);
+    QFETCH(bool, useBilinear);
+    QFETCH(int, diameter);
+
+    KisPaintDeviceSP layer = createTestLayer();
+    const KoColorSpace *cs = layer->colorSpace();
+
+    BrushSizeOption sizeProperties;
+    sizeProperties.brush_diameter = diameter;
+    sizeProperties.brush_aspect = 1.0;
+    sizeProperties.brush_rotation = 0.0;
+    sizeProperties.brush_scale = 1.0;
+    sizeProperties.brush_spacing = 0.1;
+    sizeProperties.brush_density = 1.0;
+    sizeProperties.brush_jitter_movement = 0.0;
+    sizeProperties.brush_jitter_movement_enabled = false;
+
+    DeformOption properties;
+    properties.deform_amount = 0.35;
+    properties.deform_use_bilinear = useBilinear;
+    properties.deform_use_counter = false;
+    properties.deform_use_old_data = false;
+    properties.deform_action = action;
+
+    DeformBrush brush;
+    brush.setSizeProperties(&sizeProperties);
+    brush.setProperties(&properties);
+    brush.initDeformAction();
+
+    const qreal scale = 1.0;
+    const qreal rotation = 0.3;
+
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    KisFixedPaintDeviceSP mask;
+
+    int dabX = 0;
+    int dabY = 0;
+
+    // the move action needs two dabs to know the direction
+    const QPointF positions[] = {QPointF(237.3, 251.6), QPointF(251.7, 262.2)};
+
+    for (const QPointF &pt : positions) {
+        const QPointF pos = pt - brush.hotSpot(scale, rotation);
+
+        dabX = qFloor(pos.x());
+        dabY = qFloor(pos.y());
+
+        mask = brush.paintMask(dab, layer, scale, rotation, pt,
+                               pos.x() - dabX, pos.y() - dabY,
+                               dabX, dabY);
+        if (mask) break;
+    }
+
+    QVERIFY(mask);
+
+    KisFixedPaintDeviceSP reference = new KisFixedPaintDevice(cs);
+    reference->setRect(dab->bounds());
+    reference->initialize();
+
+    // the per-pixel picker renders the points calculated by the last dab
+    brush.renderWithPicker(reference, layer, dabX, dabY);
+
+    const int numPixels = dab->bounds().width() * dab->bounds().height();
+    const int pixelSize = cs->pixelSize();
+
+    const quint8 *dabPtr = dab->data();
+    const quint8 *refPtr = reference->data();
+
+    for (int i = 0; i < numPixels; i++) {
+        for (int c = 0; c < pixelSize; c++) {
+            const int diff = qAbs(int(dabPtr[i * pixelSize + c]) - int(refPtr[i * pixelSize + c]));
+
+            if (diff > 1) {
+                qDebug() << "pixel" << i << "channel" << c
+                         << "gathered" << dabPtr[i * pixelSize + c]
+                         << "picked" << refPtr[i * pixelSize + c];
+                QFAIL("the gathered resampling differs from the color picker");
+            }
+        }
+    }
+}
+
+QTEST_MAIN(KisDeformBrushTest)
@@ -21,14 +21,12 @@
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorTransformation.h>
-#include <KoCompositeOpRegistry.h>
 
 #include <QVariant>
 #include <QHash>
 #include <QVector>
 
 #include <kis_types.h>
-#include <kis_random_accessor_ng.h>
 #include <kis_cross_device_color_picker.h>
 #include <kis_fixed_paint_device.h>
 
@@ -57,7 +55,6 @@ HairyBrush::~HairyBrush()
 
 void HairyBrush::initAndCache()
 {
-    m_compositeOp = m_dab->colorSpace()->compositeOp(COMPOSITE_OVER);
     m_pixelSize = m_dab->colorSpace()->pixelSize();
 
     if (m_properties->useSaturation) {
@@ -136,8 +133,6 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     Bristle *bristle = 0;
     KoColor bristleColor(dab->colorSpace());
 
-    m_dabAccessor = dab->createRandomAccessorNG((int)x1, (int)y1);
-
     m_dab = dab;
 
     // initialization block
@@ -155,6 +150,15 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
         }
     }
 
+    const HairySplatBuffer::Mode splatMode =
+        m_properties->antialias ?
+        (m_properties->useCompositing ?
+         HairySplatBuffer::CompositeParticles : HairySplatBuffer::AccumulateParticles) :
+        (m_properties->useCompositing ?
+         HairySplatBuffer::CompositePixels : HairySplatBuffer::DarkenPixels);
+
+    m_splats.reset(dab->colorSpace(), splatMode);
+
     KisRandomSourceSP randomSource = pi2.randomSource();
 
     qreal fx1, fy1, fx2, fy2;
@@ -237,8 +241,14 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
         }
 
     }
+
+    /**
+     * The ink depletion above depends on the order of the bristles,
+     * but painting the collected ink doesn't, so it is done in one go
+     */
+    m_splats.render(dab);
+
     m_dab = 0;
-    m_dabAccessor = 0;
 }
 
 
@@ -302,106 +312,7 @@ void HairyBrush::opacityDepletion(Bristle* bristle, KoColor& bristleColor, qreal
 inline void HairyBrush::addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color)
 {
     Q_UNUSED(bristle);
-    if (m_properties->antialias) {
-        if (m_properties->useCompositing) {
-            paintParticle(pos, color);
-        } else {
-            paintParticle(pos, color, 1.0);
-        }
-    }
-    else {
-        int ix = qRound(pos.x());
-        int iy = qRound(pos.y());
-        if (m_properties->useCompositing) {
-            plotPixel(ix, iy, color);
-        }
-        else {
-            darkenPixel(ix, iy, color);
-        }
-    }
-}
-
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
-{
-    // opacity top left, right, bottom left, right
-    quint8 opacity = color.opacityU8();
-    opacity *= weight;
-
-    int ipx = int (pos.x());
-    int ipy = int (pos.y());
-    qreal fx = pos.x() - ipx;
-    qreal fy = pos.y() - ipy;
-
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity);
-
-    const KoColorSpace * cs = m_dab->colorSpace();
-
-    m_dabAccessor->moveTo(ipx  , ipy);
-    btl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy);
-    btr =  quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btr, 1);
-
-    m_dabAccessor->moveTo(ipx, ipy + 1);
-    bbl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy + 1);
-    bbr = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbr, 1);
-}
-
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
-{
-    // opacity top left, right, bottom left, right
-    memcpy(m_color.data(), color.data(), m_pixelSize);
-    quint8 opacity = color.opacityU8();
-
-    int ipx = int (pos.x());
-    int ipy = int (pos.y());
-    qreal fx = pos.x() - ipx;
-    qreal fy = pos.y() - ipy;
-
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity);
-
-    m_color.setOpacity(btl);
-    plotPixel(ipx  , ipy, m_color);
-
-    m_color.setOpacity(btr);
-    plotPixel(ipx + 1  , ipy, m_color);
-
-    m_color.setOpacity(bbl);
-    plotPixel(ipx  , ipy + 1, m_color);
-
-    m_color.setOpacity(bbr);
-    plotPixel(ipx + 1 , ipy + 1, m_color);
-}
-
-
-inline void HairyBrush::plotPixel(int wx, int wy, const KoColor &color)
-{
-    m_dabAccessor->moveTo(wx, wy);
-    m_compositeOp->composite(m_dabAccessor->rawData(), m_pixelSize, color.data() , m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
-}
-
-inline void HairyBrush::darkenPixel(int wx, int wy, const KoColor &color)
-{
-    m_dabAccessor->moveTo(wx, wy);
-    if (m_dab->colorSpace()->opacityU8(m_dabAccessor->rawData()) < color.opacityU8()) {
-        memcpy(m_dabAccessor->rawData(), color.data(), m_pixelSize);
-    }
+    m_splats.addSplat(pos, color);
 }
 
 double HairyBrush::computeMousePressure(double distance)
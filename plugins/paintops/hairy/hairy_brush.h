@@ -27,12 +27,10 @@
 
 #include "trajectory.h"
 #include "bristle.h"
+#include "hairy_splat_buffer.h"
 
 #include <kis_paint_device.h>
 #include <brushengine/kis_paint_information.h>
-#include <kis_random_accessor_ng.h>
-
-class KoCompositeOp;
 
 
 class KisHairyProperties
@@ -88,14 +86,6 @@ public:
 private:
     /// paints single bristle
     void addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color);
-    /// composite single pixel to dab
-    void plotPixel(int wx, int wy, const KoColor &color);
-    /// check the opacity of dab pixel and if the opacity is less then color, it will copy color to dab
-    void darkenPixel(int wx, int wy, const KoColor &color);
-    /// paint wu particle by copying the color and setup just the opacity, weight is complementary to opacity of the color
-    void paintParticle(QPointF pos, const KoColor& color, qreal weight);
-    /// paint wu particle using composite operation
-    void paintParticle(QPointF pos, const KoColor& color);
     /// similar to sample input color in spray
     void colorifyBristles(KisPaintDeviceSP source, QPointF point);
 
@@ -123,8 +113,8 @@ private:
     QHash<QString, QVariant> m_params;
     // temporary device
     KisPaintDeviceSP m_dab;
-    KisRandomAccessorSP m_dabAccessor;
-    const KoCompositeOp * m_compositeOp;
+    // the ink of all the bristles of the current line
+    HairySplatBuffer m_splats;
     quint32 m_pixelSize;
 
     int m_counter;
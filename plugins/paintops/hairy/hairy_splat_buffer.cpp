@@ -0,0 +1,340 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "hairy_splat_buffer.h"
+
+#include <limits>
+
+#include <QThread>
+
+#include <KoCompositeOpRegistry.h>
+
+#include <kis_assert.h>
+#include <kis_paint_device.h>
+#include <KisRunnableStrokeJobData.h>
+
+
+namespace {
+
+/**
+ * Smaller batches are not worth the overhead of the threads
+ * and of the merging of the groups
+ */
+const int minSplatsPerGroup = 4096;
+
+}
+
+HairySplatBuffer::HairySplatBuffer()
+    : m_colorSpace(0),
+      m_compositeOp(0),
+      m_pixelSize(0),
+      m_mode(AccumulateParticles)
+{
+}
+
+void HairySplatBuffer::reset(const KoColorSpace *cs, Mode mode)
+{
+    m_colorSpace = cs;
+    m_compositeOp = cs->compositeOp(COMPOSITE_OVER);
+    m_pixelSize = cs->pixelSize();
+    m_mode = mode;
+
+    m_positions.clear();
+    m_colorIndexes.clear();
+    m_colors.clear();
+    m_colorOpacities.clear();
+}
+
+void HairySplatBuffer::addColor(const KoColor &color)
+{
+    const int offset = m_colors.size();
+    m_colors.resize(offset + m_pixelSize);
+    memcpy(m_colors.data() + offset, color.data(), m_pixelSize);
+
+    m_colorOpacities.append(m_colorSpace->opacityU8(color.data()));
+}
+
+QRect HairySplatBuffer::calculateSplatOrigins()
+{
+    const int numSplats = m_positions.size();
+    const bool antialiased = m_mode == AccumulateParticles || m_mode == CompositeParticles;
+
+    m_origins.resize(numSplats);
+
+    const QPointF *pos = m_positions.constData();
+    QPoint *origin = m_origins.data();
+
+    int left = std::numeric_limits<int>::max();
+    int top = std::numeric_limits<int>::max();
+    int right = std::numeric_limits<int>::min();
+    int bottom = std::numeric_limits<int>::min();
+
+    if (antialiased) {
+        m_weights.resize(4 * numSplats);
+
+        const int *colorIndex = m_colorIndexes.constData();
+        const quint8 *colorOpacity = m_colorOpacities.constData();
+        quint8 *weights = m_weights.data();
+
+        /**
+         * The same rounding as the per-pixel painting used to have,
+         * so the weights of a particle are: top-left, top-right,
+         * bottom-left, bottom-right
+         */
+        for (int i = 0; i < numSplats; i++) {
+            const int ipx = int(pos[i].x());
+            const int ipy = int(pos[i].y());
+            const qreal fx = pos[i].x() - ipx;
+            const qreal fy = pos[i].y() - ipy;
+            const quint8 opacity = colorOpacity[colorIndex[i]];
+
+            weights[4 * i + 0] = qRound((1.0 - fx) * (1.0 - fy) * opacity);
+            weights[4 * i + 1] = qRound(fx * (1.0 - fy) * opacity);
+            weights[4 * i + 2] = qRound((1.0 - fx) * fy * opacity);
+            weights[4 * i + 3] = qRound(fx * fy * opacity);
+
+            origin[i] = QPoint(ipx, ipy);
+        }
+    } else {
+        for (int i = 0; i < numSplats; i++) {
+            origin[i] = QPoint(qRound(pos[i].x()), qRound(pos[i].y()));
+        }
+    }
+
+    for (int i = 0; i < numSplats; i++) {
+        left = qMin(left, origin[i].x());
+        top = qMin(top, origin[i].y());
+        right = qMax(right, origin[i].x());
+        bottom = qMax(bottom, origin[i].y());
+    }
+
+    const int extent = antialiased ? 1 : 0;
+    return QRect(QPoint(left, top), QPoint(right + extent, bottom + extent));
+}
+
+void HairySplatBuffer::renderGroup(Accumulator *acc) const
+{
+    const bool antialiased = m_mode == AccumulateParticles;
+    const QPoint *origin = m_origins.constData();
+
+    if (acc->rect.isEmpty()) {
+        const int extent = antialiased ? 1 : 0;
+
+        for (int i = acc->begin; i < acc->end; i++) {
+            acc->rect |= QRect(origin[i], QSize(1 + extent, 1 + extent));
+        }
+    }
+
+    const int area = acc->rect.width() * acc->rect.height();
+    acc->opacity.fill(0, area);
+    acc->winner.fill(0, area);
+
+    const int stride = acc->rect.width();
+    quint16 *opacity = acc->opacity.data();
+    quint32 *winner = acc->winner.data();
+
+    if (antialiased) {
+        const quint8 *weights = m_weights.constData();
+
+        for (int i = acc->begin; i < acc->end; i++) {
+            const int index = (origin[i].y() - acc->rect.y()) * stride + origin[i].x() - acc->rect.x();
+            const int offsets[4] = {index, index + 1, index + stride, index + stride + 1};
+
+            for (int j = 0; j < 4; j++) {
+                const int idx = offsets[j];
+                opacity[idx] = qMin<int>(OPACITY_OPAQUE_U8, opacity[idx] + weights[4 * i + j]);
+                winner[idx] = i + 1;
+            }
+        }
+    } else {
+        const int *colorIndex = m_colorIndexes.constData();
+        const quint8 *colorOpacity = m_colorOpacities.constData();
+
+        for (int i = acc->begin; i < acc->end; i++) {
+            const int idx = (origin[i].y() - acc->rect.y()) * stride + origin[i].x() - acc->rect.x();
+            const quint8 splatOpacity = colorOpacity[colorIndex[i]];
+
+            // the first of the most opaque splats wins
+            if (splatOpacity > opacity[idx]) {
+                opacity[idx] = splatOpacity;
+                winner[idx] = i + 1;
+            }
+        }
+    }
+}
+
+void HairySplatBuffer::mergeGroup(const Accumulator &acc)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_total.rect.contains(acc.rect));
+
+    const int srcStride = acc.rect.width();
+    const int dstStride = m_total.rect.width();
+
+    for (int y = 0; y < acc.rect.height(); y++) {
+        const quint16 *srcOpacity = acc.opacity.constData() + y * srcStride;
+        const quint32 *srcWinner = acc.winner.constData() + y * srcStride;
+
+        const int dstOffset =
+            (acc.rect.y() + y - m_total.rect.y()) * dstStride +
+            acc.rect.x() - m_total.rect.x();
+
+        quint16 *dstOpacity = m_total.opacity.data() + dstOffset;
+        quint32 *dstWinner = m_total.winner.data() + dstOffset;
+
+        if (m_mode == AccumulateParticles) {
+            /**
+             * The groups are merged in the order of the splats, so
+             * the last splat touching the pixel gives the color
+             */
+            for (int x = 0; x < srcStride; x++) {
+                dstOpacity[x] = qMin<int>(OPACITY_OPAQUE_U8, dstOpacity[x] + srcOpacity[x]);
+                if (srcWinner[x]) {
+                    dstWinner[x] = srcWinner[x];
+                }
+            }
+        } else {
+            for (int x = 0; x < srcStride; x++) {
+                if (srcOpacity[x] > dstOpacity[x]) {
+                    dstOpacity[x] = srcOpacity[x];
+                    dstWinner[x] = srcWinner[x];
+                }
+            }
+        }
+    }
+}
+
+void HairySplatBuffer::applyAccumulated(quint8 *pixels) const
+{
+    const int area = m_total.rect.width() * m_total.rect.height();
+    const quint16 *opacity = m_total.opacity.constData();
+    const quint32 *winner = m_total.winner.constData();
+    const int *colorIndex = m_colorIndexes.constData();
+
+    for (int i = 0; i < area; i++, pixels += m_pixelSize) {
+        if (!winner[i]) continue;
+
+        const quint8 dstOpacity = m_colorSpace->opacityU8(pixels);
+        const quint8 *color = colorAt(colorIndex[winner[i] - 1]);
+
+        if (m_mode == AccumulateParticles) {
+            memcpy(pixels, color, m_pixelSize);
+            m_colorSpace->setOpacity(pixels, quint8(qMin<int>(OPACITY_OPAQUE_U8, dstOpacity + opacity[i])), 1);
+        } else if (opacity[i] > dstOpacity) {
+            memcpy(pixels, color, m_pixelSize);
+        }
+    }
+}
+
+void HairySplatBuffer::compositeSplats(quint8 *pixels) const
+{
+    const int numSplats = m_positions.size();
+    const int stride = m_total.rect.width();
+    const QPoint *origin = m_origins.constData();
+    const int *colorIndex = m_colorIndexes.constData();
+
+    if (m_mode == CompositeParticles) {
+        QVector<quint8> particleColor(m_pixelSize);
+        quint8 *particle = particleColor.data();
+        const quint8 *weights = m_weights.constData();
+
+        for (int i = 0; i < numSplats; i++) {
+            const int index = (origin[i].y() - m_total.rect.y()) * stride + origin[i].x() - m_total.rect.x();
+            const int offsets[4] = {index, index + 1, index + stride, index + stride + 1};
+
+            memcpy(particle, colorAt(colorIndex[i]), m_pixelSize);
+
+            for (int j = 0; j < 4; j++) {
+                m_colorSpace->setOpacity(particle, weights[4 * i + j], 1);
+                m_compositeOp->composite(pixels + offsets[j] * m_pixelSize, m_pixelSize,
+                                         particle, m_pixelSize,
+                                         0, 0, 1, 1, OPACITY_OPAQUE_U8);
+            }
+        }
+    } else {
+        for (int i = 0; i < numSplats; i++) {
+            const int index = (origin[i].y() - m_total.rect.y()) * stride + origin[i].x() - m_total.rect.x();
+
+            m_compositeOp->composite(pixels + index * m_pixelSize, m_pixelSize,
+                                     colorAt(colorIndex[i]), m_pixelSize,
+                                     0, 0, 1, 1, OPACITY_OPAQUE_U8);
+        }
+    }
+}
+
+void HairySplatBuffer::render(KisPaintDeviceSP dab)
+{
+    const int numSplats = m_positions.size();
+    if (!numSplats) return;
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(*dab->colorSpace() == *m_colorSpace);
+
+    const QRect rect = calculateSplatOrigins();
+
+    m_pixels.resize(rect.width() * rect.height() * m_pixelSize);
+    dab->readBytes(m_pixels.data(), rect);
+
+    m_total.begin = 0;
+    m_total.end = numSplats;
+    m_total.rect = rect;
+
+    if (m_mode == CompositeParticles || m_mode == CompositePixels) {
+        // OVER is not commutative, so the splats are composited in order
+        compositeSplats(m_pixels.data());
+    } else {
+        const int numGroups =
+            qMin(QThread::idealThreadCount(), numSplats / minSplatsPerGroup);
+
+        if (numGroups <= 1) {
+            renderGroup(&m_total);
+        } else {
+            /**
+             * The splats are stored bristle by bristle, so every group
+             * covers a compact area of the dab
+             */
+            QVector<Accumulator> groups(numGroups);
+            for (int i = 0; i < numGroups; i++) {
+                groups[i].begin = i * numSplats / numGroups;
+                groups[i].end = (i + 1) * numSplats / numGroups;
+            }
+
+            QVector<KisRunnableStrokeJobData*> jobs;
+            for (int i = 0; i < numGroups; i++) {
+                Accumulator *acc = &groups[i];
+
+                jobs.append(
+                    new KisRunnableStrokeJobData(
+                        [this, acc] () { renderGroup(acc); },
+                        KisStrokeJobData::CONCURRENT));
+            }
+
+            m_groupsExecutor.addRunnableJobs(jobs);
+
+            const int area = rect.width() * rect.height();
+            m_total.opacity.fill(0, area);
+            m_total.winner.fill(0, area);
+
+            Q_FOREACH (const Accumulator &acc, groups) {
+                mergeGroup(acc);
+            }
+        }
+
+        applyAccumulated(m_pixels.data());
+    }
+
+    dab->writeBytes(m_pixels.data(), rect);
+}
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _HAIRY_SPLAT_BUFFER_H_
+#define _HAIRY_SPLAT_BUFFER_H_
+
+#include <QPointF>
+#include <QRect>
+#include <QVector>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+
+#include <kis_types.h>
+#include <KisThreadPoolRunnableStrokeJobsExecutor.h>
+
+class KoCompositeOp;
+
+/**
+ * Collects the ink of all the bristles painted by a single
+ * HairyBrush::paintLine() call and renders it into the dab at once.
+ *
+ * The splats are rendered into a linear buffer covering the bounds of
+ * the splats instead of going through a random accessor pixel by pixel.
+ * When the ink is not composited (the opacity of the particles is
+ * accumulated or the most opaque bristle wins), the result doesn't depend on
+ * the order of the splats besides the color of the last/first one, so
+ * big batches are split into groups of bristles rendered concurrently
+ * and merged afterwards. The result is the same as painting the splats
+ * one by one.
+ */
+class HairySplatBuffer
+{
+public:
+    enum Mode {
+        AccumulateParticles, ///< antialiased, the opacity of the particles is added up
+        CompositeParticles,  ///< antialiased, the particles are composited with OVER
+        DarkenPixels,        ///< aliased, the most opaque color is taken
+        CompositePixels      ///< aliased, the pixels are composited with OVER
+    };
+
+public:
+    HairySplatBuffer();
+
+    /**
+     * Drops all the splats and prepares the buffer for a new batch
+     */
+    void reset(const KoColorSpace *cs, Mode mode);
+
+    inline void addSplat(const QPointF &pos, const KoColor &color);
+
+    int numSplats() const {
+        return m_positions.size();
+    }
+
+    /**
+     * Renders all the collected splats into \p dab
+     */
+    void render(KisPaintDeviceSP dab);
+
+private:
+    /**
+     * The ink of a range of splats: the accumulated opacity and the
+     * index + 1 of the splat whose color is taken for every pixel
+     */
+    struct Accumulator {
+        int begin = 0;
+        int end = 0;
+        QRect rect;
+        QVector<quint16> opacity;
+        QVector<quint32> winner;
+    };
+
+    void addColor(const KoColor &color);
+
+    QRect calculateSplatOrigins();
+    void renderGroup(Accumulator *acc) const;
+    void mergeGroup(const Accumulator &acc);
+    void applyAccumulated(quint8 *pixels) const;
+    void compositeSplats(quint8 *pixels) const;
+
+    inline const quint8* colorAt(int index) const {
+        return m_colors.constData() + index * m_pixelSize;
+    }
+
+private:
+    const KoColorSpace *m_colorSpace;
+    const KoCompositeOp *m_compositeOp;
+    int m_pixelSize;
+    Mode m_mode;
+
+    QVector<QPointF> m_positions;
+    QVector<int> m_colorIndexes;
+
+    QVector<quint8> m_colors;
+    QVector<quint8> m_colorOpacities;
+
+    /// per-splat values calculated before rendering
+    QVector<QPoint> m_origins;
+    QVector<quint8> m_weights;
+
+    Accumulator m_total;
+    QVector<quint8> m_pixels;
+
+    /**
+     * The dab is painted inside a sequential stroke job, so the groups
+     * are rendered by a synchronous executor with its own thread pool
+     */
+    KisThreadPoolRunnableStrokeJobsExecutor m_groupsExecutor;
+};
+
+inline void HairySplatBuffer::addSplat(const QPointF &pos, const KoColor &color)
+{
+    if (m_colorIndexes.isEmpty() ||
+        memcmp(colorAt(m_colorIndexes.last()), color.data(), m_pixelSize)) {
+
+        addColor(color);
+    }
+
+    m_positions.append(pos);
+    m_colorIndexes.append(m_colorOpacities.size() - 1);
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_hairy_brush_benchmark.h"
+
+#include <QTest>
+#include <QImage>
+#include <QPainter>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_fixed_paint_device.h>
+#include <kis_paint_device.h>
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_random_source.h>
+
+#include "hairy_brush.h"
+
+
+namespace {
+
+KisHairyProperties defaultProperties()
+{
+    KisHairyProperties properties;
+
+    properties.radius = 0;
+    properties.inkAmount = 1024;
+    properties.sigma = 0;
+    properties.inkDepletionCurve = QVector<qreal>(properties.inkAmount, 1.0);
+    properties.inkDepletionEnabled = false;
+    properties.isbrushDimension1D = false;
+    properties.useMousePressure = false;
+    properties.useSaturation = false;
+    properties.useOpacity = false;
+    properties.useWeights = false;
+
+    properties.useSoakInk = false;
+    properties.connectedPath = true;
+    properties.antialias = true;
+    properties.useCompositing = false;
+
+    properties.pressureWeight = 0;
+    properties.bristleLengthWeight = 0;
+    properties.bristleInkAmountWeight = 0;
+    properties.inkDepletionWeight = 0;
+
+    properties.shearFactor = 0;
+    properties.randomFactor = 2.0;
+    properties.scaleFactor = 1.0;
+    properties.threshold = false;
+
+    return properties;
+}
+
+KisFixedPaintDeviceSP createRoundDab(int diameter)
+{
+    QImage image(diameter, diameter, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+    QPainter gc(&image);
+    gc.setRenderHint(QPainter::Antialiasing);
+    gc.setPen(Qt::NoPen);
+    gc.setBrush(Qt::black);
+    gc.drawEllipse(image.rect());
+    gc.end();
+
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dab->convertFromQImage(image, "");
+
+    return dab;
+}
+
+}
+
+void KisHairyBrushBenchmark::benchmarkPaintLine_data()
+{
+    QTest::addColumn<int>("diameter");
+    QTest::addColumn<bool>("antialias");
+    QTest::addColumn<bool>("useCompositing");
+    QTest::addColumn<bool>("inkDepletion");
+
+    // a round dab of the diameter d has about 0.78 * d^2 bristles
+    QTest::newRow("d26-aa") << 26 << true << false << false;
+    QTest::newRow("d50-aa") << 50 << true << false << false;
+    QTest::newRow("d120-aa") << 120 << true << false << false;
+    QTest::newRow("d120-aa-depletion") << 120 << true << false << true;
+    QTest::newRow("d50-aa-composite") << 50 << true << true << false;
+    QTest::newRow("d120-aa-composite") << 120 << true << true << false;
+    QTest::newRow("d50-aliased") << 50 << false << false << false;
+    QTest::newRow("d120-aliased") << 120 << false << false << false;
+    QTest::newRow("d120-aliased-composite") << 120 << false << true << false;
+}
+
+void KisHairyBrushBenchmark::benchmarkPaintLine()
+{
+    QFETCH(int, diameter);
+    QFETCH(bool, antialias);
+    QFETCH(bool, useCompositing);
+    QFETCH(bool, inkDepletion);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisHairyProperties properties = defaultProperties();
+    properties.antialias = antialias;
+    properties.useCompositing = useCompositing;
+    properties.inkDepletionEnabled = inkDepletion;
+    properties.useOpacity = inkDepletion;
+
+    HairyBrush brush;
+    brush.setProperties(&properties);
+    brush.setInkColor(KoColor(Qt::black, cs));
+    brush.fromDabWithDensity(createRoundDab(diameter), 1.0);
+
+    KisPaintDeviceSP dab = new KisPaintDevice(cs);
+    KisRandomSourceSP randomSource = new KisRandomSource(1);
+
+    QBENCHMARK {
+        // a stroke of 50 segments, the dab is cleared by the paintop
+        // before every segment
+        for (int i = 0; i < 50; i++) {
+            KisPaintInformation pi1(QPointF(100 + 10 * i, 100 + 3 * i), 1.0);
+            KisPaintInformation pi2(QPointF(110 + 10 * i, 103 + 3 * i), 1.0);
+            pi1.setRandomSource(randomSource);
+            pi2.setRandomSource(randomSource);
+
+            dab->clear();
+            brush.paintLine(dab, KisPaintDeviceSP(), pi1, pi2, 1.0, 0.3);
+        }
+    }
+}
+
+QTEST_MAIN(KisHairyBrushBenchmark)
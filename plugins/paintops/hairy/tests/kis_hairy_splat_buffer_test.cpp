@@ -0,0 +1,165 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_hairy_splat_buffer_test.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_random_accessor_ng.h>
+#include <brushengine/kis_random_source.h>
+
+#include "hairy_splat_buffer.h"
+
+
+namespace {
+
+/**
+ * Paints a single splat the way HairyBrush did before the splats
+ * were batched
+ */
+void paintSplat(KisRandomAccessorSP it, const KoColorSpace *cs,
+                HairySplatBuffer::Mode mode, const QPointF &pos, const KoColor &color)
+{
+    const KoCompositeOp *compositeOp = cs->compositeOp(COMPOSITE_OVER);
+    const int pixelSize = cs->pixelSize();
+
+    if (mode == HairySplatBuffer::DarkenPixels || mode == HairySplatBuffer::CompositePixels) {
+        it->moveTo(qRound(pos.x()), qRound(pos.y()));
+
+        if (mode == HairySplatBuffer::CompositePixels) {
+            compositeOp->composite(it->rawData(), pixelSize, color.data(), pixelSize,
+                                   0, 0, 1, 1, OPACITY_OPAQUE_U8);
+        } else if (cs->opacityU8(it->rawData()) < color.opacityU8()) {
+            memcpy(it->rawData(), color.data(), pixelSize);
+        }
+
+        return;
+    }
+
+    const quint8 opacity = color.opacityU8();
+
+    const int ipx = int(pos.x());
+    const int ipy = int(pos.y());
+    const qreal fx = pos.x() - ipx;
+    const qreal fy = pos.y() - ipy;
+
+    const QPoint pixels[4] = {
+        QPoint(ipx, ipy), QPoint(ipx + 1, ipy),
+        QPoint(ipx, ipy + 1), QPoint(ipx + 1, ipy + 1)
+    };
+
+    const quint8 weights[4] = {
+        quint8(qRound((1.0 - fx) * (1.0 - fy) * opacity)),
+        quint8(qRound(fx * (1.0 - fy) * opacity)),
+        quint8(qRound((1.0 - fx) * fy * opacity)),
+        quint8(qRound(fx * fy * opacity))
+    };
+
+    KoColor particle(color);
+
+    for (int i = 0; i < 4; i++) {
+        it->moveTo(pixels[i].x(), pixels[i].y());
+
+        if (mode == HairySplatBuffer::CompositeParticles) {
+            particle.setOpacity(weights[i]);
+            compositeOp->composite(it->rawData(), pixelSize, particle.data(), pixelSize,
+                                   0, 0, 1, 1, OPACITY_OPAQUE_U8);
+        } else {
+            const quint8 newOpacity =
+                quint8(qMin<int>(OPACITY_OPAQUE_U8, weights[i] + cs->opacityU8(it->rawData())));
+            memcpy(it->rawData(), color.data(), pixelSize);
+            cs->setOpacity(it->rawData(), newOpacity, 1);
+        }
+    }
+}
+
+}
+
+void KisHairySplatBufferTest::testRenderMatchesPerSplat_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("numSplats");
+
+    QTest::newRow("accumulate-particles") << int(HairySplatBuffer::AccumulateParticles) << 3000;
+    QTest::newRow("composite-particles") << int(HairySplatBuffer::CompositeParticles) << 3000;
+    QTest::newRow("darken-pixels") << int(HairySplatBuffer::DarkenPixels) << 3000;
+    QTest::newRow("composite-pixels") << int(HairySplatBuffer::CompositePixels) << 3000;
+
+    // big batches are split into groups rendered concurrently
+    QTest::newRow("accumulate-particles-groups") << int(HairySplatBuffer::AccumulateParticles) << 40000;
+    QTest::newRow("darken-pixels-groups") << int(HairySplatBuffer::DarkenPixels) << 40000;
+}
+
+void KisHairySplatBufferTest::testRenderMatchesPerSplat()
+{
+    QFETCH(int, mode);
+    QFETCH(int, numSplats);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect bounds(0, 0, 160, 160);
+
+    KisPaintDeviceSP dab = new KisPaintDevice(cs);
+    KisPaintDeviceSP reference = new KisPaintDevice(cs);
+
+    // a part of the dab already has some semi-transparent ink
+    KoColor background(QColor(30, 160, 90, 100), cs);
+    dab->fill(QRect(40, 40, 60, 60), background);
+    reference->fill(QRect(40, 40, 60, 60), background);
+
+    const KoColor colors[] = {
+        KoColor(QColor(200, 20, 20, 255), cs),
+        KoColor(QColor(20, 20, 200, 128), cs),
+        KoColor(QColor(240, 200, 20, 40), cs)
+    };
+
+    HairySplatBuffer buffer;
+    buffer.reset(cs, HairySplatBuffer::Mode(mode));
+
+    KisRandomAccessorSP it = reference->createRandomAccessorNG(0, 0);
+    KisRandomSource source(1);
+
+    // the splats come bristle by bristle, so the colors come in runs
+    for (int i = 0; i < numSplats; i++) {
+        const KoColor &color = colors[(i / 50) % 3];
+        const QPointF pos(20.0 + 120.0 * source.generateNormalized(),
+                          20.0 + 120.0 * source.generateNormalized());
+
+        buffer.addSplat(pos, color);
+        paintSplat(it, cs, HairySplatBuffer::Mode(mode), pos, color);
+    }
+
+    buffer.render(dab);
+
+    const int numBytes = bounds.width() * bounds.height() * cs->pixelSize();
+
+    QVector<quint8> result(numBytes);
+    QVector<quint8> expected(numBytes);
+
+    dab->readBytes(result.data(), bounds);
+    reference->readBytes(expected.data(), bounds);
+
+    QCOMPARE(result, expected);
+}
+
+QTEST_MAIN(KisHairySplatBufferTest)
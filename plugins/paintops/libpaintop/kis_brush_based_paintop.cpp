@@ -97,6 +97,20 @@ KisBrushBasedPaintOp::KisBrushBasedPaintOp(const KisPropertiesConfigurationSP se
     m_brush->notifyStrokeStarted();
 
     m_precisionOption.readOptionSetting(settings);
+
+    /**
+     * The stamp cache quantizes the size, the rotation and the subpixel
+     * offset of the dabs to 1/4 px. The highest precision level, which
+     * is also the default one, promises exact dabs (KisDabCache doesn't
+     * reuse dabs on this level either), so the cache is used only when
+     * the preset or the auto precision lowers the level. Otherwise every
+     * preset with a predefined brush would change its output.
+     *
+     * See KisGbrBrushTest::benchmarkStrokeDabs() for the cost of the
+     * default level compared to the cached one.
+     */
+    m_brush->setStampCacheEnabled(m_precisionOption.precisionLevel() < 5);
+
     m_dabCache = new KisDabCache(m_brush);
     m_dabCache->setPrecisionOption(&m_precisionOption);
 
@@ -35,6 +35,7 @@
 
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorSpaceMaths.h>
 
 #include <kis_resource_server_provider.h>
 #include <kis_pattern_chooser.h>
@@ -42,10 +43,9 @@
 #include <kis_multipliers_double_slider_spinbox.h>
 #include <resources/KoPattern.h>
 #include <kis_paint_device.h>
-#include <kis_fill_painter.h>
 #include <kis_painter.h>
-#include <kis_iterator_ng.h>
 #include <kis_fixed_paint_device.h>
+#include <kis_assert.h>
 #include <kis_gradient_slider.h>
 #include "kis_embedded_pattern_manager.h"
 #include "kis_algebra_2d.h"
@@ -205,7 +205,7 @@ void KisTextureProperties::recalculateMask()
 {
     if (!m_pattern) return;
 
-    m_mask = 0;
+    m_mask.clear();
 
     QImage mask = m_pattern->pattern();
 
@@ -227,10 +227,8 @@ void KisTextureProperties::recalculateMask()
     int width = mask.width();
     int height = mask.height();
 
-    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
-    m_mask = new KisPaintDevice(cs);
-
-    KisHLineIteratorSP iter = m_mask->createHLineIteratorNG(0, 0, width);
+    m_mask.resize(width * height);
+    quint8 *maskPtr = m_mask.data();
 
     for (int row = 0; row < height; ++row) {
         for (int col = 0; col < width; ++col) {
@@ -263,10 +261,9 @@ void KisTextureProperties::recalculateMask()
                 maskValue = OPACITY_OPAQUE_F;
             }
 
-            cs->setOpacity(iter->rawData(), maskValue, 1);
-            iter->nextPixel();
+            *maskPtr = KoColorSpaceMaths<qreal, quint8>::scaleToA(maskValue);
+            maskPtr++;
         }
-        iter->nextRow();
     }
 
     m_maskBounds = QRect(0, 0, width, height);
@@ -311,39 +308,88 @@ void KisTextureProperties::apply(KisFixedPaintDeviceSP dab, const QPoint &offset
 {
     if (!m_enabled) return;
 
-    KisPaintDeviceSP fillDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
-    QRect rect = dab->bounds();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(!m_mask.isEmpty());
+
+    const QRect rect = dab->bounds();
+    const int maskWidth = m_maskBounds.width();
+    const int maskHeight = m_maskBounds.height();
+
+    /**
+     * The texture wraps around the mask bounds, so find the position
+     * of the dab's top-left pixel inside the mask
+     */
+    const int x = offset.x() % maskWidth - m_offsetX;
+    const int y = offset.y() % maskHeight - m_offsetY;
 
-    int x = offset.x() % m_maskBounds.width() - m_offsetX;
-    int y = offset.y() % m_maskBounds.height() - m_offsetY;
+    const int startX = x >= 0 ? x % maskWidth : maskWidth - ((-x - 1) % maskWidth + 1);
+    int maskY = y >= 0 ? y % maskHeight : maskHeight - ((-y - 1) % maskHeight + 1);
 
-    KisFillPainter fillPainter(fillDevice);
-    fillPainter.fillRect(x - 1, y - 1, rect.width() + 2, rect.height() + 2, m_mask, m_maskBounds);
-    fillPainter.end();
+    /**
+     * The strength of the texture is folded into a lookup table, so
+     * that every row of the dab is masked in a single pass
+     */
+    const qreal pressure = m_strengthOption.apply(info);
+    quint8 strengthTable[256];
 
-    qreal pressure = m_strengthOption.apply(info);
+    if (m_texturingMode == MULTIPLY) {
+        for (int i = 0; i < 256; i++) {
+            strengthTable[i] = quint8(i * pressure);
+        }
+    }
+    else {
+        const int pressureOffset = (1.0 - pressure) * 255;
+
+        for (int i = 0; i < 256; i++) {
+            strengthTable[i] = quint8(qMin(255, i + pressureOffset));
+        }
+    }
+
+    const KoColorSpace *cs = dab->colorSpace();
+    const int pixelSize = cs->pixelSize();
     quint8 *dabData = dab->data();
 
-    KisHLineIteratorSP iter = fillDevice->createHLineIteratorNG(x, y, rect.width());
+    QVector<quint8> maskRow(rect.width());
+
     for (int row = 0; row < rect.height(); ++row) {
-        for (int col = 0; col < rect.width(); ++col) {
-            if (m_texturingMode == MULTIPLY) {
-                dab->colorSpace()->multiplyAlpha(dabData, quint8(*iter->oldRawData() * pressure), 1);
+        const quint8 *maskLine = m_mask.constData() + maskY * maskWidth;
+        quint8 *maskRowPtr = maskRow.data();
+
+        int maskX = startX;
+        int col = 0;
+
+        while (col < rect.width()) {
+            const int numPixels = qMin(rect.width() - col, maskWidth - maskX);
+            const quint8 *src = maskLine + maskX;
+
+            for (int i = 0; i < numPixels; i++) {
+                maskRowPtr[i] = strengthTable[src[i]];
             }
-            else {
-                int pressureOffset = (1.0 - pressure) * 255;
 
-                qint16 maskA = *iter->oldRawData() + pressureOffset;
-                quint8 dabA = dab->colorSpace()->opacityU8(dabData);
+            maskRowPtr += numPixels;
+            col += numPixels;
+            maskX = 0;
+        }
+
+        if (m_texturingMode == MULTIPLY) {
+            cs->applyAlphaU8Mask(dabData, maskRow.constData(), rect.width());
+            dabData += rect.width() * pixelSize;
+        }
+        else {
+            const quint8 *maskA = maskRow.constData();
+
+            for (int col = 0; col < rect.width(); ++col) {
+                quint8 dabA = cs->opacityU8(dabData);
+
+                dabA = qMax(0, (qint16)dabA - *maskA);
+                cs->setOpacity(dabData, dabA, 1);
 
-                dabA = qMax(0, (qint16)dabA - maskA);
-                dab->colorSpace()->setOpacity(dabData, dabA, 1);
+                maskA++;
+                dabData += pixelSize;
             }
+        }
 
-            iter->nextPixel();
-            dabData += dab->pixelSize();
+        if (++maskY >= maskHeight) {
+            maskY = 0;
         }
-        iter->nextRow();
     }
 }
-
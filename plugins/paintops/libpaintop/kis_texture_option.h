@@ -28,6 +28,7 @@
 #include "kis_pressure_texture_strength_option.h"
 
 #include <QRect>
+#include <QVector>
 
 class KisTextureChooser;
 class KisTextureOptionWidget;
@@ -99,7 +100,12 @@ private:
 private:
     KisPressureTextureStrengthOption m_strengthOption;
     QRect m_maskBounds; // this can be different from the extent if we mask out too many pixels in a big mask!
-    KisPaintDeviceSP m_mask;
+
+    /**
+     * The pattern converted into the alpha values of the texture,
+     * m_maskBounds.width() * m_maskBounds.height() values row by row
+     */
+    QVector<quint8> m_mask;
     void recalculateMask();
 };
 
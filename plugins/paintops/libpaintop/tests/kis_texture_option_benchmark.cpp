@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_texture_option_benchmark.h"
+
+#include <QTest>
+#include <QPainter>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoResourceServerProvider.h>
+#include <resources/KoPattern.h>
+
+#include <kis_fixed_paint_device.h>
+#include <kis_properties_configuration.h>
+#include <kis_resource_server_provider.h>
+#include <brushengine/kis_paint_information.h>
+
+#include "kis_embedded_pattern_manager.h"
+#include "kis_texture_option.h"
+
+
+namespace {
+
+KisPropertiesConfigurationSP createTextureSettings(bool enabled, int texturingMode)
+{
+    QImage image(512, 512, QImage::Format_ARGB32);
+    image.fill(Qt::white);
+
+    {
+        QPainter gc(&image);
+        gc.setRenderHint(QPainter::Antialiasing);
+        for (int i = 0; i < 32; i++) {
+            gc.setPen(QPen(QColor(i * 8, i * 8, i * 8), 3));
+            gc.drawEllipse(QPointF(256, 256), 8 * i, 4 * i);
+        }
+    }
+
+    KoPattern pattern(image, "__test_texture_pattern", KoResourceServerProvider::instance()->patternServer()->saveLocation());
+
+    KisPropertiesConfigurationSP settings(new KisPropertiesConfiguration);
+    KisEmbeddedPatternManager::saveEmbeddedPattern(settings, &pattern);
+
+    settings->setProperty("Texture/Pattern/Enabled", enabled);
+    settings->setProperty("Texture/Pattern/Scale", 0.7);
+    settings->setProperty("Texture/Pattern/Brightness", 0.1);
+    settings->setProperty("Texture/Pattern/Contrast", 1.2);
+    settings->setProperty("Texture/Pattern/OffsetX", 17);
+    settings->setProperty("Texture/Pattern/OffsetY", 5);
+    settings->setProperty("Texture/Pattern/TexturingMode", texturingMode);
+
+    return settings;
+}
+
+KisFixedPaintDeviceSP createDab(int size)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    dab->setRect(QRect(0, 0, size, size));
+    dab->initialize();
+    dab->fill(0, 0, size, size, KoColor(Qt::black, cs).data());
+
+    return dab;
+}
+
+}
+
+void KisTextureOptionBenchmark::initTestCase()
+{
+    // touch all the barriers
+    KisResourceServerProvider::instance()->paintOpPresetServer();
+    KoResourceServerProvider::instance()->patternServer();
+}
+
+void KisTextureOptionBenchmark::testTextureWrapsAround()
+{
+    KisTextureProperties properties(0);
+    properties.fillProperties(createTextureSettings(true, KisTextureProperties::MULTIPLY));
+    QVERIFY(properties.m_enabled);
+
+    KisPaintInformation info(QPointF(), 1.0);
+
+    // the scaled pattern is 358x358 px, so the dabs should
+    // get the same texture when shifted by the pattern size
+    const int patternSize = qRound(512 * 0.7);
+
+    KisFixedPaintDeviceSP dab1 = createDab(200);
+    KisFixedPaintDeviceSP dab2 = createDab(200);
+    KisFixedPaintDeviceSP dab3 = createDab(200);
+
+    properties.apply(dab1, QPoint(300, 250), info);
+    properties.apply(dab2, QPoint(300 + patternSize, 250 - 2 * patternSize), info);
+    properties.apply(dab3, QPoint(310, 250), info);
+
+    const int numBytes = 200 * 200 * dab1->pixelSize();
+
+    QVERIFY(!memcmp(dab1->data(), dab2->data(), numBytes));
+    QVERIFY(memcmp(dab1->data(), dab3->data(), numBytes));
+}
+
+void KisTextureOptionBenchmark::benchmarkTexture_data()
+{
+    QTest::addColumn<bool>("enabled");
+    QTest::addColumn<int>("texturingMode");
+    QTest::addColumn<int>("dabSize");
+
+    QTest::newRow("plain-30") << false << int(KisTextureProperties::MULTIPLY) << 30;
+    QTest::newRow("multiply-30") << true << int(KisTextureProperties::MULTIPLY) << 30;
+    QTest::newRow("subtract-30") << true << int(KisTextureProperties::SUBTRACT) << 30;
+    QTest::newRow("plain-300") << false << int(KisTextureProperties::MULTIPLY) << 300;
+    QTest::newRow("multiply-300") << true << int(KisTextureProperties::MULTIPLY) << 300;
+    QTest::newRow("subtract-300") << true << int(KisTextureProperties::SUBTRACT) << 300;
+}
+
+void KisTextureOptionBenchmark::benchmarkTexture()
+{
+    QFETCH(bool, enabled);
+    QFETCH(int, texturingMode);
+    QFETCH(int, dabSize);
+
+    KisTextureProperties properties(0);
+    properties.fillProperties(createTextureSettings(enabled, texturingMode));
+
+    KisPaintInformation info(QPointF(), 1.0);
+    KisFixedPaintDeviceSP dab = createDab(dabSize);
+
+    int i = 0;
+
+    QBENCHMARK {
+        // a dense stroke: 100 dabs spaced by 10% of the dab size
+        for (int j = 0; j < 100; j++, i++) {
+            properties.apply(dab, QPoint(i * dabSize / 10, i * dabSize / 20), info);
+        }
+    }
+}
+
+QTEST_MAIN(KisTextureOptionBenchmark)
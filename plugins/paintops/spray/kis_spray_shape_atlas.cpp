@@ -0,0 +1,212 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_spray_shape_atlas.h"
+
+#include <cmath>
+
+#include <QPainterPath>
+#include <QTransform>
+
+#include <KoColorSpace.h>
+
+#include <KisCoverageRasterizer.h>
+#include <kis_fixed_paint_device.h>
+
+
+namespace {
+
+const int subpixelSteps = 4;
+const int sizeSteps = 4;
+const int angleSteps = 256;
+const int scaleSteps = 64;
+
+/// the caches are dropped when grown over these limits
+const int maxCachedMasks = 4096;
+const int maxCachedImages = 256;
+
+inline int angleBucket(qreal angle)
+{
+    const qreal turn = angle / (2.0 * M_PI);
+    int bucket = qRound((turn - std::floor(turn)) * angleSteps);
+    return bucket % angleSteps;
+}
+
+inline qreal bucketAngle(int bucket)
+{
+    return bucket * (2.0 * M_PI / angleSteps);
+}
+
+}
+
+KisSprayShapeAtlas::KisSprayShapeAtlas()
+    : m_imageSourceKey(0),
+      m_imageColorSpace(0)
+{
+}
+
+KisSprayShapeAtlas::~KisSprayShapeAtlas()
+{
+}
+
+KisSprayShapeAtlas::Mask
+KisSprayShapeAtlas::rasterize(Shape shape, const QPointF &center,
+                              qreal width, qreal height, qreal angle)
+{
+    QPainterPath path;
+
+    if (shape == Ellipse) {
+        path.addEllipse(QPointF(), 0.5 * width, 0.5 * height);
+    } else {
+        path.addRect(QRectF(-0.5 * width, -0.5 * height, width, height));
+    }
+
+    QTransform t;
+    t.translate(center.x(), center.y());
+    t.rotateRadians(angle);
+    path = t.map(path);
+
+    Mask mask;
+    mask.rect = path.boundingRect().toAlignedRect();
+
+    if (mask.rect.isEmpty()) {
+        return mask;
+    }
+
+    mask.coverage.resize(mask.rect.width() * mask.rect.height());
+
+    KisCoverageRasterizer rasterizer(path, mask.rect);
+    KisCoverageRasterizer::Band band;
+
+    for (int i = 0; i < rasterizer.numBands(); i++) {
+        rasterizer.renderBand(i, &band);
+
+        memcpy(mask.coverage.data() + (band.rect.y() - mask.rect.y()) * mask.rect.width(),
+               band.coverage.constData(),
+               band.coverage.size());
+    }
+
+    return mask;
+}
+
+KisSprayShapeAtlas::Mask
+KisSprayShapeAtlas::shapeMask(Shape shape, const QPointF &pos,
+                              qreal width, qreal height, qreal angle,
+                              QPoint *origin)
+{
+    int originX = int(std::floor(pos.x()));
+    int originY = int(std::floor(pos.y()));
+    int subX = qRound((pos.x() - originX) * subpixelSteps);
+    int subY = qRound((pos.y() - originY) * subpixelSteps);
+
+    if (subX == subpixelSteps) {
+        originX++;
+        subX = 0;
+    }
+
+    if (subY == subpixelSteps) {
+        originY++;
+        subY = 0;
+    }
+
+    const int quantizedWidth = qRound(width * sizeSteps);
+    const int quantizedHeight = qRound(height * sizeSteps);
+
+    if (quantizedWidth > maxCachedSize * sizeSteps ||
+        quantizedHeight > maxCachedSize * sizeSteps) {
+
+        *origin = QPoint(originX, originY);
+        return rasterize(shape, pos - QPointF(originX, originY), width, height, angle);
+    }
+
+    *origin = QPoint(originX, originY);
+
+    // the rotation of a circle doesn't change anything
+    const int angleIndex =
+        shape == Ellipse && quantizedWidth == quantizedHeight ? 0 : angleBucket(angle);
+
+    const quint64 key =
+        quint64(shape) |
+        quint64(subX) << 1 |
+        quint64(subY) << 3 |
+        quint64(angleIndex) << 5 |
+        quint64(quantizedWidth) << 13 |
+        quint64(quantizedHeight) << 29;
+
+    auto it = m_masks.find(key);
+
+    if (it == m_masks.end()) {
+        if (m_masks.size() >= maxCachedMasks) {
+            m_masks.clear();
+        }
+
+        it = m_masks.insert(key,
+                            rasterize(shape,
+                                      QPointF(qreal(subX) / subpixelSteps,
+                                              qreal(subY) / subpixelSteps),
+                                      qreal(quantizedWidth) / sizeSteps,
+                                      qreal(quantizedHeight) / sizeSteps,
+                                      bucketAngle(angleIndex)));
+    }
+
+    return it.value();
+}
+
+KisFixedPaintDeviceSP KisSprayShapeAtlas::imageParticle(const QImage &image, qreal angle, qreal scale,
+                                                        const KoColorSpace *colorSpace)
+{
+    if (image.cacheKey() != m_imageSourceKey || colorSpace != m_imageColorSpace) {
+        m_images.clear();
+        m_imageSourceKey = image.cacheKey();
+        m_imageColorSpace = colorSpace;
+    }
+
+    const int angleIndex = angleBucket(angle);
+    const int scaleIndex = qMax(1, qRound(scale * scaleSteps));
+
+    const quint64 key = quint64(angleIndex) | quint64(scaleIndex) << 8;
+
+    auto it = m_images.find(key);
+
+    if (it == m_images.end()) {
+        if (m_images.size() >= maxCachedImages) {
+            m_images.clear();
+        }
+
+        const qreal bucketScale = qreal(scaleIndex) / scaleSteps;
+
+        QTransform m;
+        m.rotate(bucketAngle(angleIndex) * 180.0 / M_PI);
+        m.scale(bucketScale, bucketScale);
+
+        KisFixedPaintDeviceSP device = new KisFixedPaintDevice(colorSpace);
+        device->convertFromQImage(image.transformed(m, Qt::SmoothTransformation), QString());
+
+        it = m_images.insert(key, device);
+    }
+
+    return it.value();
+}
+
+void KisSprayShapeAtlas::clear()
+{
+    m_masks.clear();
+    m_images.clear();
+    m_imageSourceKey = 0;
+    m_imageColorSpace = 0;
+}
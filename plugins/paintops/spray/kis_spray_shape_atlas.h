@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_SPRAY_SHAPE_ATLAS_H
+#define KIS_SPRAY_SHAPE_ATLAS_H
+
+#include <QHash>
+#include <QImage>
+#include <QPointF>
+#include <QRect>
+#include <QVector>
+
+#include <kis_types.h>
+
+class KoColorSpace;
+
+/**
+ * A cache of the pre-rasterized particles of the spray paintop.
+ *
+ * The shapes are quantized into buckets: the size to 1/4 px, the
+ * rotation to 1/256 of the full turn and the subpixel offset to 1/4 px,
+ * so the masks of the particles of a dab (and of the consecutive dabs)
+ * are rasterized once and then only composited. The shapes bigger than
+ * maxCachedSize are rasterized exactly and not cached.
+ *
+ * The image particles are cached in the same way: the image
+ * is transformed and converted into the color space of the dab once
+ * per rotation and scale bucket.
+ */
+class KisSprayShapeAtlas
+{
+public:
+    enum Shape {
+        Ellipse,
+        Rectangle
+    };
+
+    struct Mask {
+        /// the rect of the mask relative to the origin of the particle
+        QRect rect;
+        /// rect.width() * rect.height() coverage values, row by row
+        QVector<quint8> coverage;
+    };
+
+    static const int maxCachedSize = 256;
+
+public:
+    KisSprayShapeAtlas();
+    ~KisSprayShapeAtlas();
+
+    /**
+     * \return the coverage mask of the \p shape of \p width x \p height
+     *         rotated by \p angle radians and centered at \p pos.
+     *         \p origin receives the integer position the mask rect
+     *         is relative to
+     */
+    Mask shapeMask(Shape shape, const QPointF &pos,
+                   qreal width, qreal height, qreal angle,
+                   QPoint *origin);
+
+    /**
+     * \return the \p image rotated by \p angle radians and scaled by
+     *         \p scale, converted into \p colorSpace
+     */
+    KisFixedPaintDeviceSP imageParticle(const QImage &image, qreal angle, qreal scale,
+                                        const KoColorSpace *colorSpace);
+
+    void clear();
+
+private:
+    static Mask rasterize(Shape shape, const QPointF &center,
+                          qreal width, qreal height, qreal angle);
+
+private:
+    QHash<quint64, Mask> m_masks;
+    QHash<quint64, KisFixedPaintDeviceSP> m_images;
+    qint64 m_imageSourceKey;
+    const KoColorSpace *m_imageColorSpace;
+};
+
+#endif // KIS_SPRAY_SHAPE_ATLAS_H
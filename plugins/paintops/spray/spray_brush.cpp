@@ -22,6 +22,7 @@
 #include <KoColorSpace.h>
 #include <KoColorTransformation.h>
 #include <KoCompositeOp.h>
+#include <KoCompositeOpRegistry.h>
 #include <KoMixColorsOp.h>
 
 #include <brushengine/kis_paintop.h>
@@ -50,13 +51,14 @@
 
 SprayBrush::SprayBrush()
 {
-    m_painter = 0;
     m_transfo = 0;
+    m_compositeOp = 0;
+    m_particleOpacity = OPACITY_OPAQUE_U8;
+    m_hsvParameters[0] = m_hsvParameters[1] = m_hsvParameters[2] = 0.0;
 }
 
 SprayBrush::~SprayBrush()
 {
-    delete m_painter;
     delete m_transfo;
 }
 
@@ -113,11 +115,10 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
 {
     KisRandomSourceSP randomSource = info.randomSource();
 
-    // initializing painter
-    if (!m_painter) {
-        m_painter = new KisPainter(dab);
-        m_painter->setFillStyle(KisPainter::FillStyleForegroundColor);
-        m_painter->setMaskImageSize(m_shapeProperties->width, m_shapeProperties->height);
+    // initializing the cached state
+    if (!m_particleBuffer) {
+        m_particleBuffer = new KisFixedPaintDevice(dab->colorSpace());
+        m_compositeOp = dab->colorSpace()->compositeOp(COMPOSITE_OVER);
         m_dabPixelSize = dab->colorSpace()->pixelSize();
         if (m_colorProperties->useRandomHSV) {
             m_transfo = dab->colorSpace()->createColorTransformation("hsv_adjustment", QHash<QString, QVariant>());
@@ -127,13 +128,11 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
         if (!m_brushQImage.isNull()) {
             m_brushQImage = m_brushQImage.scaled(m_shapeProperties->width, m_shapeProperties->height);
         }
-        m_imageDevice = new KisPaintDevice(dab->colorSpace());
     }
 
 
     qreal x = info.pos().x();
     qreal y = info.pos().y();
-    KisRandomAccessorSP accessor = dab->createRandomAccessorNG(qRound(x), qRound(y));
 
     Q_ASSERT(color.colorSpace()->pixelSize() == dab->pixelSize());
     m_inkColor = color;
@@ -158,19 +157,24 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
         m_particlesCount = m_properties->particleCount;
     }
 
-    QHash<QString, QVariant> params;
     qreal nx, ny;
-    int ix, iy;
 
     qreal angle;
     qreal length;
     qreal rotationZ = 0.0;
     qreal particleScale = 1.0;
 
+    m_particles.clear();
+
     bool shouldColor = true;
     if (m_colorProperties->fillBackground) {
-        m_painter->setPaintColor(bgColor);
-        paintCircle(m_painter, x, y, m_radius);
+        Particle particle;
+        particle.type = Particle::Ellipse;
+        particle.pos = QPointF(x, y);
+        particle.width = particle.height = 2.0 * m_radius;
+        particle.color = bgColor;
+        particle.opacity = m_particleOpacity;
+        m_particles.append(particle);
     }
 
     QTransform m;
@@ -178,6 +182,11 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
     m.rotateRadians(-rotation + deg2rad(m_properties->brushRotation));
     m.scale(m_properties->scale, m_properties->scale);
 
+    /**
+     * First, generate all the particles of the dab. The random
+     * values are generated in the same order as they always were,
+     * so the strokes look the same.
+     */
     for (quint32 i = 0; i < m_particlesCount; i++) {
         // generate random angle
         angle = randomSource->generateNormalized() * M_PI * 2;
@@ -245,208 +254,322 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             }
 
             if (m_colorProperties->useRandomHSV && m_transfo) {
-                params["h"] = (m_colorProperties->hue / 180.0) * randomSource->generateNormalized();
-                params["s"] = (m_colorProperties->saturation / 100.0) * randomSource->generateNormalized();
-                params["v"] = (m_colorProperties->value / 100.0) * randomSource->generateNormalized();
-                m_transfo->setParameters(params);
-                m_transfo->setParameter(3, 1);//sets the type to HSV. For some reason 0 is not an option.
-                m_transfo->setParameter(4, false);//sets the colorize to false.
+                m_hsvParameters[0] = (m_colorProperties->hue / 180.0) * randomSource->generateNormalized();
+                m_hsvParameters[1] = (m_colorProperties->saturation / 100.0) * randomSource->generateNormalized();
+                m_hsvParameters[2] = (m_colorProperties->value / 100.0) * randomSource->generateNormalized();
+                setHsvParameters(m_hsvParameters);
                 m_transfo->transform(m_inkColor.data(), m_inkColor.data() , 1);
             }
 
             if (m_colorProperties->useRandomOpacity) {
                 quint8 alpha = qRound(randomSource->generateNormalized() * OPACITY_OPAQUE_U8);
                 m_inkColor.setOpacity(alpha);
-                m_painter->setOpacity(alpha);
+                m_particleOpacity = alpha;
             }
 
             if (!m_colorProperties->colorPerParticle) {
                 shouldColor = false;
             }
-
-            m_painter->setPaintColor(m_inkColor);
         }
 
         qreal jitteredWidth = qMax(1.0 * additionalScale, m_shapeProperties->width * particleScale * additionalScale);
         qreal jitteredHeight = qMax(1.0 * additionalScale, m_shapeProperties->height * particleScale * additionalScale);
 
+        Particle particle;
+        particle.pos = QPointF(nx + x, ny + y);
+        particle.color = m_inkColor;
+        particle.opacity = m_particleOpacity;
+        particle.hsv[0] = m_hsvParameters[0];
+        particle.hsv[1] = m_hsvParameters[1];
+        particle.hsv[2] = m_hsvParameters[2];
+
+        bool hasParticle = true;
+
         if (m_shapeProperties->enabled){
         switch (m_shapeProperties->shape){
             // ellipse
             case 0:
             {
+                particle.type = Particle::Ellipse;
+                particle.width = jitteredWidth;
+
                 if (m_shapeProperties->width == m_shapeProperties->height){
-                    paintCircle(m_painter, nx + x, ny + y, jitteredWidth * 0.5);
+                    particle.height = jitteredWidth;
+                    particle.angle = 0.0;
                 }
                 else {
-                    paintEllipse(m_painter, nx + x, ny + y, jitteredWidth * 0.5 , jitteredHeight * 0.5, rotationZ);
+                    particle.height = jitteredHeight;
+                    particle.angle = rotationZ;
                 }
                 break;
             }
             // rectangle
             case 1:
             {
-                paintRectangle(m_painter, nx + x, ny + y, qRound(jitteredWidth) , qRound(jitteredHeight), rotationZ);
+                particle.type = Particle::Rectangle;
+                particle.width = qRound(jitteredWidth);
+                particle.height = qRound(jitteredHeight);
+                particle.angle = rotationZ;
                 break;
             }
             // wu-particle
             case 2: {
-                paintParticle(accessor, m_inkColor, nx + x, ny + y);
+                particle.type = Particle::WuParticle;
                 break;
             }
             // pixel
             case 3: {
-                ix = qRound(nx + x);
-                iy = qRound(ny + y);
-                accessor->moveTo(ix, iy);
-                memcpy(accessor->rawData(), m_inkColor.data(), m_dabPixelSize);
+                particle.type = Particle::Pixel;
                 break;
             }
             case 4: {
                 if (!m_brushQImage.isNull()) {
-
-                    QTransform m;
-                    m.rotate(rad2deg(rotationZ));
-                    m.scale(additionalScale, additionalScale);
+                    particle.type = Particle::Image;
+                    particle.angle = rotationZ;
+                    particle.scale = additionalScale;
 
                     if (m_shapeDynamicsProperties->randomSize) {
-                        m.scale(particleScale, particleScale);
+                        particle.scale *= particleScale;
                     }
-                    m_transformed = m_brushQImage.transformed(m, Qt::SmoothTransformation);
-                    m_imageDevice->convertFromQImage(m_transformed, 0);
-                    KisRandomAccessorSP ac = m_imageDevice->createRandomAccessorNG(0, 0);
-                    QRect rc = m_transformed.rect();
-
-                    if (m_colorProperties->useRandomHSV && m_transfo) {
-
-                        for (int y = rc.y(); y < rc.y() + rc.height(); y++) {
-                            for (int x = rc.x(); x < rc.x() + rc.width(); x++) {
-                                ac->moveTo(x, y);
-                                m_transfo->transform(ac->rawData(), ac->rawData() , 1);
-                            }
-                        }
-                    }
-
-                    ix = qRound(nx + x - rc.width() * 0.5);
-                    iy = qRound(ny + y - rc.height() * 0.5);
-                    m_painter->bitBlt(QPoint(ix, iy), m_imageDevice, rc);
-                    m_imageDevice->clear();
-                    break;
+                } else {
+                    hasParticle = false;
                 }
+                break;
             }
+            default:
+                hasParticle = false;
             }
             // Auto-brush
         }
         else {
-            KisDabShape shape(particleScale * additionalScale, 1.0, -rotationZ);
+            particle.type = Particle::Brush;
+            particle.scale = particleScale * additionalScale;
+            particle.angle = -rotationZ;
+        }
+
+        if (hasParticle) {
+            m_particles.append(particle);
+        }
+
+        if (m_colorProperties->colorPerParticle){
+            m_inkColor=color;//reset color//
+        }
+    }
+    // recover from jittering of color,
+    // m_inkColor.opacity is recovered with every paint
+
+    renderParticles(dab, info);
+}
+
+void SprayBrush::setHsvParameters(const qreal *hsv)
+{
+    QHash<QString, QVariant> params;
+    params["h"] = hsv[0];
+    params["s"] = hsv[1];
+    params["v"] = hsv[2];
+    m_transfo->setParameters(params);
+    m_transfo->setParameter(3, 1);//sets the type to HSV. For some reason 0 is not an option.
+    m_transfo->setParameter(4, false);//sets the colorize to false.
+}
+
+void SprayBrush::renderParticles(KisPaintDeviceSP dab, const KisPaintInformation &info)
+{
+    if (m_particles.isEmpty()) return;
+
+    /**
+     * Find the area covered by the particles. The masks of the shapes
+     * and the images are fetched from the atlas right here, so that
+     * their bounds are known.
+     */
+    QRect bounds;
+
+    for (auto it = m_particles.begin(); it != m_particles.end(); ++it) {
+        Particle &particle = *it;
+
+        switch (particle.type) {
+        case Particle::Ellipse:
+        case Particle::Rectangle: {
+            QPoint origin;
+            particle.mask =
+                m_shapeAtlas.shapeMask(particle.type == Particle::Ellipse ?
+                                       KisSprayShapeAtlas::Ellipse : KisSprayShapeAtlas::Rectangle,
+                                       particle.pos, particle.width, particle.height, particle.angle,
+                                       &origin);
+            particle.rect = particle.mask.rect.translated(origin);
+            break;
+        }
+        case Particle::WuParticle:
+            particle.rect = QRect(int(particle.pos.x()), int(particle.pos.y()), 2, 2);
+            break;
+        case Particle::Pixel:
+            particle.rect = QRect(qRound(particle.pos.x()), qRound(particle.pos.y()), 1, 1);
+            break;
+        case Particle::Image: {
+            particle.image = m_shapeAtlas.imageParticle(m_brushQImage, particle.angle, particle.scale,
+                                                        dab->colorSpace());
+            const QRect rc = particle.image->bounds();
+            particle.rect = QRect(qRound(particle.pos.x() - rc.width() * 0.5),
+                                  qRound(particle.pos.y() - rc.height() * 0.5),
+                                  rc.width(), rc.height());
+            break;
+        }
+        case Particle::Brush: {
+            KisDabShape shape(particle.scale, 1.0, particle.angle);
             QPointF hotSpot = m_brush->hotSpot(shape, info);
-            QPointF pos(nx + x, ny + y);
-            QPointF pt = pos - hotSpot;
+            QPointF pt = particle.pos - hotSpot;
 
             qint32 ix;
-            qreal xFraction;
             qint32 iy;
-            qreal yFraction;
 
-            KisPaintOp::splitCoordinate(pt.x(), &ix, &xFraction);
-            KisPaintOp::splitCoordinate(pt.y(), &iy, &yFraction);
+            KisPaintOp::splitCoordinate(pt.x(), &ix, &particle.xFraction);
+            KisPaintOp::splitCoordinate(pt.y(), &iy, &particle.yFraction);
+
+            particle.rect = QRect(ix, iy,
+                                  m_brush->maskWidth(shape, particle.xFraction, particle.yFraction, info),
+                                  m_brush->maskHeight(shape, particle.xFraction, particle.yFraction, info));
+            break;
+        }
+        }
+
+        bounds |= particle.rect;
+    }
+
+    if (bounds.isEmpty()) return;
+
+    /**
+     * Render all the particles into a single buffer
+     * and write it into the dab at once
+     */
+    m_particleBuffer->setRect(bounds);
+    m_particleBuffer->lazyGrowBufferWithoutInitialization();
+    dab->readBytes(m_particleBuffer->data(), bounds);
+
+    const int stride = bounds.width() * m_dabPixelSize;
+
+    auto pixelAt = [&] (int x, int y) {
+        return m_particleBuffer->data() + (y - bounds.y()) * stride + (x - bounds.x()) * m_dabPixelSize;
+    };
+
+    const bool useHsv = m_colorProperties->useRandomHSV && m_transfo;
+
+    Q_FOREACH (const Particle &particle, m_particles) {
+        switch (particle.type) {
+        case Particle::Ellipse:
+        case Particle::Rectangle:
+            if (!particle.rect.isEmpty()) {
+                compositeParticle(particle.rect, particle.color.data(), 0,
+                                  particle.mask.coverage.constData(), particle.rect.width(),
+                                  particle.opacity);
+            }
+            break;
+        case Particle::WuParticle: {
+            // this version overwrite pixels, e.g. when it sprays two particle next
+            // to each other, the pixel with lower opacity can override other pixel.
+            // Maybe some kind of compositing using here would be cool
+
+            const int ipx = particle.rect.x();
+            const int ipy = particle.rect.y();
+            const qreal fx = particle.pos.x() - ipx;
+            const qreal fy = particle.pos.y() - ipy;
+
+            KoColor pcolor(particle.color);
+
+            pcolor.setOpacity((1 - fx) * (1 - fy));
+            memcpy(pixelAt(ipx, ipy), pcolor.data(), m_dabPixelSize);
+
+            pcolor.setOpacity(fx * (1 - fy));
+            memcpy(pixelAt(ipx + 1, ipy), pcolor.data(), m_dabPixelSize);
+
+            pcolor.setOpacity((1 - fx) * fy);
+            memcpy(pixelAt(ipx, ipy + 1), pcolor.data(), m_dabPixelSize);
+
+            pcolor.setOpacity(fx * fy);
+            memcpy(pixelAt(ipx + 1, ipy + 1), pcolor.data(), m_dabPixelSize);
+            break;
+        }
+        case Particle::Pixel:
+            memcpy(pixelAt(particle.rect.x(), particle.rect.y()), particle.color.data(), m_dabPixelSize);
+            break;
+        case Particle::Image: {
+            const quint8 *src = particle.image->data();
+            const int numPixels = particle.rect.width() * particle.rect.height();
+
+            if (useHsv) {
+                m_imageParticle.resize(numPixels * m_dabPixelSize);
+                setHsvParameters(particle.hsv);
+                m_transfo->transform(src, m_imageParticle.data(), numPixels);
+                src = m_imageParticle.constData();
+            }
+
+            compositeParticle(particle.rect, src, particle.rect.width() * m_dabPixelSize,
+                              0, 0, particle.opacity);
+            break;
+        }
+        case Particle::Brush: {
+            KisDabShape shape(particle.scale, 1.0, particle.angle);
 
-            //KisFixedPaintDeviceSP dab;
             if (m_brush->brushType() == IMAGE ||
                     m_brush->brushType() == PIPE_IMAGE) {
                 m_fixedDab = m_brush->paintDevice(m_fixedDab->colorSpace(),
-                          shape, info, xFraction, yFraction);
+                          shape, info, particle.xFraction, particle.yFraction);
 
-                if (m_colorProperties->useRandomHSV && m_transfo) {
+                if (useHsv) {
                     quint8 * dabPointer = m_fixedDab->data();
                     int pixelCount = m_fixedDab->bounds().width() * m_fixedDab->bounds().height();
+                    setHsvParameters(particle.hsv);
                     m_transfo->transform(dabPointer, dabPointer, pixelCount);
                 }
 
             }
             else {
-                m_brush->mask(m_fixedDab, m_inkColor, shape,
-                              info, xFraction, yFraction);
+                m_brush->mask(m_fixedDab, particle.color, shape,
+                              info, particle.xFraction, particle.yFraction);
             }
-            m_painter->bltFixed(QPoint(ix, iy), m_fixedDab, m_fixedDab->bounds());
+
+            const QRect dabRect = m_fixedDab->bounds();
+            compositeParticle(QRect(particle.rect.topLeft(), dabRect.size()),
+                              m_fixedDab->data(), dabRect.width() * m_fixedDab->pixelSize(),
+                              0, 0, particle.opacity);
+            break;
         }
-        if (m_colorProperties->colorPerParticle){
-            m_inkColor=color;//reset color//
         }
     }
-    // recover from jittering of color,
-    // m_inkColor.opacity is recovered with every paint
-}
 
-
-
-void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry)
-{
-    // opacity top left, right, bottom left, right
-    KoColor pcolor(color);
-    //int opacity = pcolor.opacityU8();
-
-    int ipx = int (rx);
-    int ipy = int (ry);
-    qreal fx = rx - ipx;
-    qreal fy = ry - ipy;
-
-    qreal btl = (1 - fx) * (1 - fy);
-    qreal btr = (fx)  * (1 - fy);
-    qreal bbl = (1 - fx) * (fy);
-    qreal bbr = (fx)  * (fy);
-
-    // this version overwrite pixels, e.g. when it sprays two particle next
-    // to each other, the pixel with lower opacity can override other pixel.
-    // Maybe some kind of compositing using here would be cool
-
-    pcolor.setOpacity(btl);
-    writeAccessor->moveTo(ipx  , ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(btr);
-    writeAccessor->moveTo(ipx + 1, ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(bbl);
-    writeAccessor->moveTo(ipx, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(bbr);
-    writeAccessor->moveTo(ipx + 1, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    dab->writeBytes(m_particleBuffer->data(), bounds);
 }
 
-void SprayBrush::paintCircle(KisPainter* painter, qreal x, qreal y, qreal radius)
+void SprayBrush::compositeParticle(const QRect &rc,
+                                   const quint8 *src, int srcRowStride,
+                                   const quint8 *mask, int maskRowStride,
+                                   quint8 opacity)
 {
-    QPainterPath path;
-    path.addEllipse(QPointF(x,y),radius,radius);
-    painter->fillPainterPath(path);
-}
+    const QRect bounds = m_particleBuffer->bounds();
+    const QRect clipped = rc & bounds;
+    if (clipped.isEmpty()) return;
 
+    const int dx = clipped.x() - rc.x();
+    const int dy = clipped.y() - rc.y();
 
-void SprayBrush::paintEllipse(KisPainter* painter, qreal x, qreal y, qreal a, qreal b, qreal angle)
-{
-    QPainterPath path;
-    path.addEllipse(QPointF(), a, b);
-    QTransform t;
-    t.translate(x, y);
-    t.rotateRadians(angle);
-    path = t.map(path);
-    painter->fillPainterPath(path);
-}
+    // a zero stride means the source is a single color
+    if (srcRowStride) {
+        src += dy * srcRowStride + dx * m_dabPixelSize;
+    }
 
-void SprayBrush::paintRectangle(KisPainter* painter, qreal x, qreal y, qreal width, qreal height, qreal angle)
-{
-    QPainterPath path;
-    path.addRect(QRectF(-0.5 * width, -0.5 * height, width, height));
-    QTransform t;
-    t.translate(x, y);
-    t.rotateRadians(angle);
-    path = t.map(path);
-    painter->fillPainterPath(path);
-}
+    if (mask) {
+        mask += dy * maskRowStride + dx;
+    }
 
+    const int dstRowStride = bounds.width() * m_dabPixelSize;
+    quint8 *dst = m_particleBuffer->data() +
+        (clipped.y() - bounds.y()) * dstRowStride +
+        (clipped.x() - bounds.x()) * m_dabPixelSize;
+
+    m_compositeOp->composite(dst, dstRowStride,
+                             src, srcRowStride,
+                             mask, maskRowStride,
+                             clipped.height(), clipped.width(),
+                             opacity);
+}
 
 void SprayBrush::paintOutline(KisPaintDeviceSP dev , const KoColor &outlineColor, qreal posX, qreal posY, qreal radius)
 {
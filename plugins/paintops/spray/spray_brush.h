@@ -32,9 +32,13 @@
 
 
 #include <QImage>
+#include <QVector>
 #include <kis_brush.h>
 
+#include "kis_spray_shape_atlas.h"
+
 class KisPaintInformation;
+class KoCompositeOp;
 
 class SprayBrush
 {
@@ -53,17 +57,21 @@ public:
     void setFixedDab(KisFixedPaintDeviceSP dab);
 
 private:
+    friend class KisSprayBrushTest;
+
     KoColor m_inkColor;
     qreal m_radius;
     quint32 m_particlesCount;
     quint8 m_dabPixelSize;
 
-    KisPainter * m_painter;
-    KisPaintDeviceSP m_imageDevice;
     QImage m_brushQImage;
-    QImage m_transformed;
 
     KoColorTransformation* m_transfo;
+    const KoCompositeOp *m_compositeOp;
+
+    /// the opacity and the random HSV shift of the last colored particle
+    quint8 m_particleOpacity;
+    qreal m_hsvParameters[3];
 
     const KisSprayProperties * m_properties;
     const KisColorProperties * m_colorProperties;
@@ -73,14 +81,54 @@ private:
     KisBrushSP m_brush;
     KisFixedPaintDeviceSP m_fixedDab;
 
+    struct Particle {
+        enum Type {
+            Ellipse,
+            Rectangle,
+            WuParticle,
+            Pixel,
+            Image,
+            Brush
+        };
+
+        Type type = Pixel;
+        QPointF pos;
+        qreal width = 0.0;
+        qreal height = 0.0;
+        qreal angle = 0.0;
+        qreal scale = 1.0;
+        KoColor color;
+        quint8 opacity = OPACITY_OPAQUE_U8;
+        qreal hsv[3] = {0.0, 0.0, 0.0};
+
+        // calculated by renderParticles()
+        QRect rect;
+        KisSprayShapeAtlas::Mask mask;
+        KisFixedPaintDeviceSP image;
+        qreal xFraction = 0.0;
+        qreal yFraction = 0.0;
+    };
+
+    /**
+     * The particles of the current dab are collected first and then
+     * rendered into m_particleBuffer, which is written into the dab at
+     * once. The shapes come pre-rasterized from m_shapeAtlas.
+     */
+    QVector<Particle> m_particles;
+    KisSprayShapeAtlas m_shapeAtlas;
+    KisFixedPaintDeviceSP m_particleBuffer;
+    QVector<quint8> m_imageParticle;
+
 private:
     /// rotation in radians according the settings (gauss distribution, uniform distribution or fixed angle)
     qreal rotationAngle(KisRandomSourceSP randomSource);
-    /// Paints Wu Particle
-    void paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry);
-    void paintCircle(KisPainter * painter, qreal x, qreal y, qreal radius);
-    void paintEllipse(KisPainter * painter, qreal x, qreal y, qreal a, qreal b, qreal angle);
-    void paintRectangle(KisPainter * painter, qreal x, qreal y, qreal width, qreal height, qreal angle);
+
+    void setHsvParameters(const qreal *hsv);
+    void renderParticles(KisPaintDeviceSP dab, const KisPaintInformation &info);
+    void compositeParticle(const QRect &rc,
+                           const quint8 *src, int srcRowStride,
+                           const quint8 *mask, int maskRowStride,
+                           quint8 opacity);
 
     void paintOutline(KisPaintDeviceSP dev, const KoColor& painterColor, qreal posX, qreal posY, qreal radius);
 
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_spray_brush_benchmark.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+#include <brushengine/kis_paint_information.h>
+
+#include "spray_brush.h"
+
+
+void KisSprayBrushBenchmark::benchmarkParticles_data()
+{
+    QTest::addColumn<int>("shape");
+    QTest::addColumn<int>("particleCount");
+    QTest::addColumn<bool>("randomRotation");
+    QTest::addColumn<bool>("randomSize");
+
+    // the shapes are numbered as in KisShapeProperties::shape
+    QTest::newRow("ellipse-1000") << 0 << 1000 << false << false;
+    QTest::newRow("ellipse-5000") << 0 << 5000 << false << false;
+    QTest::newRow("ellipse-5000-dynamics") << 0 << 5000 << true << true;
+    QTest::newRow("rectangle-5000-dynamics") << 1 << 5000 << true << true;
+    QTest::newRow("wu-particle-5000") << 2 << 5000 << false << false;
+    QTest::newRow("pixel-5000") << 3 << 5000 << false << false;
+}
+
+void KisSprayBrushBenchmark::benchmarkParticles()
+{
+    QFETCH(int, shape);
+    QFETCH(int, particleCount);
+    QFETCH(bool, randomRotation);
+    QFETCH(bool, randomSize);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisSprayProperties properties;
+    properties.diameter = 300;
+    properties.particleCount = particleCount;
+    properties.aspect = 1.0;
+    properties.coverage = 0.1;
+    properties.amount = 0.0;
+    properties.spacing = 0.5;
+    properties.scale = 1.0;
+    properties.brushRotation = 0.0;
+    properties.jitterMovement = false;
+    properties.useDensity = false;
+    properties.gaussian = false;
+
+    KisColorProperties colorProperties;
+    colorProperties.useRandomHSV = false;
+    colorProperties.useRandomOpacity = false;
+    colorProperties.sampleInputColor = false;
+    colorProperties.fillBackground = false;
+    colorProperties.colorPerParticle = false;
+    colorProperties.mixBgColor = false;
+    colorProperties.hue = 0;
+    colorProperties.saturation = 0;
+    colorProperties.value = 0;
+
+    KisShapeProperties shapeProperties;
+    shapeProperties.shape = shape;
+    shapeProperties.width = 6;
+    shapeProperties.height = 4;
+    shapeProperties.enabled = true;
+    shapeProperties.proportional = false;
+
+    KisShapeDynamicsProperties dynamicsProperties;
+    dynamicsProperties.enabled = randomRotation || randomSize;
+    dynamicsProperties.randomSize = randomSize;
+    dynamicsProperties.fixedRotation = false;
+    dynamicsProperties.randomRotation = randomRotation;
+    dynamicsProperties.followCursor = false;
+    dynamicsProperties.followDrawingAngle = false;
+    dynamicsProperties.fixedAngle = 0;
+    dynamicsProperties.randomRotationWeight = 1.0;
+    dynamicsProperties.followCursorWeigth = 0.0;
+    dynamicsProperties.followDrawingAngleWeight = 0.0;
+
+    SprayBrush brush;
+    brush.setProperties(&properties, &colorProperties, &shapeProperties, &dynamicsProperties, KisBrushSP());
+
+    KisPaintDeviceSP dab = new KisPaintDevice(cs);
+    KisPaintDeviceSP source = new KisPaintDevice(cs);
+
+    const KoColor color(Qt::black, cs);
+    const KoColor bgColor(Qt::white, cs);
+
+    QBENCHMARK {
+        // a stroke of 20 dabs, the dab is cleared by the paintop
+        // before every dab
+        for (int i = 0; i < 20; i++) {
+            KisPaintInformation info(QPointF(200 + 20 * i, 200), 1.0);
+
+            dab->clear();
+            brush.paint(dab, source, info, 0.0, 1.0, 1.0, color, bgColor);
+        }
+    }
+}
+
+QTEST_MAIN(KisSprayBrushBenchmark)
@@ -0,0 +1,248 @@
+/*
+ *  Copyright (c) 2018 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_spray_brush_test.h"
+
+#include <QTest>
+#include <QPainterPath>
+#include <QTransform>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <kis_random_accessor_ng.h>
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_random_source.h>
+
+#include "spray_brush.h"
+
+
+static void fillShape(KisPainter *painter, const QPainterPath &shape,
+                      const QPointF &pos, qreal angle)
+{
+    QTransform t;
+    t.translate(pos.x(), pos.y());
+    t.rotateRadians(angle);
+    painter->fillPainterPath(t.map(shape));
+}
+
+void KisSprayBrushTest::testBatchedParticles_data()
+{
+    QTest::addColumn<int>("shape");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<bool>("useDynamics");
+    QTest::addColumn<bool>("useRandomOpacity");
+
+    // the shapes are numbered as in KisShapeProperties::shape
+    QTest::newRow("circle") << 0 << 5 << 5 << false << false;
+    QTest::newRow("ellipse-dynamics") << 0 << 9 << 4 << true << false;
+    QTest::newRow("ellipse-opacity") << 0 << 9 << 4 << true << true;
+    QTest::newRow("rectangle") << 1 << 6 << 4 << false << false;
+    QTest::newRow("rectangle-dynamics") << 1 << 7 << 3 << true << true;
+    QTest::newRow("wu-particle") << 2 << 1 << 1 << false << false;
+    QTest::newRow("pixel") << 3 << 1 << 1 << false << false;
+}
+
+/**
+ * Renders the particles of the last dab of \p brush one by one with
+ * KisPainter, the way SprayBrush did it before the particles were
+ * batched, and compares the result with the batched dab.
+ *
+ * The shapes of the batched path come quantized from the atlas and are
+ * rasterized by another rasterizer, so their edges are allowed to differ
+ * slightly. The pixel particles are written directly and must match
+ * exactly.
+ */
+void KisSprayBrushTest::testBatchedParticles()
+{
+    QFETCH(int, shape);
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(bool, useDynamics);
+    QFETCH(bool, useRandomOpacity);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisSprayProperties properties;
+    properties.diameter = 200;
+    properties.particleCount = 150;
+    properties.aspect = 1.0;
+    properties.coverage = 0.1;
+    properties.amount = 0.0;
+    properties.spacing = 0.5;
+    properties.scale = 1.0;
+    properties.brushRotation = 0.0;
+    properties.jitterMovement = false;
+    properties.useDensity = false;
+    properties.gaussian = false;
+
+    KisColorProperties colorProperties;
+    colorProperties.useRandomHSV = false;
+    colorProperties.useRandomOpacity = useRandomOpacity;
+    colorProperties.sampleInputColor = false;
+    colorProperties.fillBackground = false;
+    colorProperties.colorPerParticle = useRandomOpacity;
+    colorProperties.mixBgColor = false;
+    colorProperties.hue = 0;
+    colorProperties.saturation = 0;
+    colorProperties.value = 0;
+
+    KisShapeProperties shapeProperties;
+    shapeProperties.shape = shape;
+    shapeProperties.width = width;
+    shapeProperties.height = height;
+    shapeProperties.enabled = true;
+    shapeProperties.proportional = false;
+
+    KisShapeDynamicsProperties dynamicsProperties;
+    dynamicsProperties.enabled = useDynamics;
+    dynamicsProperties.randomSize = useDynamics;
+    dynamicsProperties.fixedRotation = false;
+    dynamicsProperties.randomRotation = useDynamics;
+    dynamicsProperties.followCursor = false;
+    dynamicsProperties.followDrawingAngle = false;
+    dynamicsProperties.fixedAngle = 0;
+    dynamicsProperties.randomRotationWeight = 1.0;
+    dynamicsProperties.followCursorWeigth = 0.0;
+    dynamicsProperties.followDrawingAngleWeight = 0.0;
+
+    SprayBrush brush;
+    brush.setProperties(&properties, &colorProperties, &shapeProperties, &dynamicsProperties, KisBrushSP());
+
+    KisPaintDeviceSP dab = new KisPaintDevice(cs);
+    KisPaintDeviceSP source = new KisPaintDevice(cs);
+
+    const KoColor color(Qt::black, cs);
+    const KoColor bgColor(Qt::white, cs);
+
+    KisPaintInformation info(QPointF(200.3, 200.6), 1.0);
+    info.setRandomSource(new KisRandomSource(12345));
+    brush.paint(dab, source, info, 0.0, 1.0, 1.0, color, bgColor);
+
+    QCOMPARE(brush.m_particles.size(), int(properties.particleCount));
+
+    KisPaintDeviceSP reference = new KisPaintDevice(cs);
+    KisPainter painter(reference);
+    painter.setFillStyle(KisPainter::FillStyleForegroundColor);
+
+    KisRandomAccessorSP accessor = reference->createRandomAccessorNG(0, 0);
+
+    Q_FOREACH (const SprayBrush::Particle &particle, brush.m_particles) {
+        painter.setPaintColor(particle.color);
+        painter.setOpacity(particle.opacity);
+
+        switch (particle.type) {
+        case SprayBrush::Particle::Ellipse: {
+            QPainterPath path;
+            path.addEllipse(QPointF(), 0.5 * particle.width, 0.5 * particle.height);
+            fillShape(&painter, path, particle.pos, particle.angle);
+            break;
+        }
+        case SprayBrush::Particle::Rectangle: {
+            QPainterPath path;
+            path.addRect(QRectF(-0.5 * particle.width, -0.5 * particle.height,
+                                particle.width, particle.height));
+            fillShape(&painter, path, particle.pos, particle.angle);
+            break;
+        }
+        case SprayBrush::Particle::WuParticle: {
+            const int ipx = int(particle.pos.x());
+            const int ipy = int(particle.pos.y());
+            const qreal fx = particle.pos.x() - ipx;
+            const qreal fy = particle.pos.y() - ipy;
+
+            const qreal weights[] = {(1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy};
+            const QPoint offsets[] = {QPoint(0, 0), QPoint(1, 0), QPoint(0, 1), QPoint(1, 1)};
+
+            KoColor pcolor(particle.color);
+
+            for (int i = 0; i < 4; i++) {
+                pcolor.setOpacity(weights[i]);
+                accessor->moveTo(ipx + offsets[i].x(), ipy + offsets[i].y());
+                memcpy(accessor->rawData(), pcolor.data(), cs->pixelSize());
+            }
+            break;
+        }
+        case SprayBrush::Particle::Pixel:
+            accessor->moveTo(qRound(particle.pos.x()), qRound(particle.pos.y()));
+            memcpy(accessor->rawData(), particle.color.data(), cs->pixelSize());
+            break;
+        default:
+            QFAIL("unexpected particle type");
+        }
+    }
+
+    const bool isExact = shape == 2 || shape == 3;
+
+    const QRect rc = dab->exactBounds() | reference->exactBounds();
+    QVERIFY(!rc.isEmpty());
+
+    QImage dabImage = dab->convertToQImage(0, rc.x(), rc.y(), rc.width(), rc.height());
+    QImage referenceImage = reference->convertToQImage(0, rc.x(), rc.y(), rc.width(), rc.height());
+
+    int numPaintedPixels = 0;
+    int totalDiff = 0;
+
+    for (int y = 0; y < rc.height(); y++) {
+        for (int x = 0; x < rc.width(); x++) {
+            const QRgb dabPixel = dabImage.pixel(x, y);
+            const QRgb referencePixel = referenceImage.pixel(x, y);
+
+            if (isExact) {
+                if (dabPixel != referencePixel) {
+                    qDebug() << "pixel" << rc.topLeft() + QPoint(x, y)
+                             << "batched" << hex << dabPixel
+                             << "reference" << referencePixel;
+                    QFAIL("the batched particles differ from the reference");
+                }
+                continue;
+            }
+
+            const int dabAlpha = qAlpha(dabPixel);
+            const int referenceAlpha = qAlpha(referencePixel);
+
+            if (!dabAlpha && !referenceAlpha) continue;
+
+            const int diff = qAbs(dabAlpha - referenceAlpha);
+
+            // a quarter of a pixel of the subpixel offset and the size
+            if (diff > 96) {
+                qDebug() << "pixel" << rc.topLeft() + QPoint(x, y)
+                         << "batched" << dabAlpha
+                         << "reference" << referenceAlpha;
+                QFAIL("the batched particles differ from the reference");
+            }
+
+            numPaintedPixels++;
+            totalDiff += diff;
+        }
+    }
+
+    if (!isExact) {
+        QVERIFY(numPaintedPixels > 0);
+
+        const qreal meanDiff = qreal(totalDiff) / numPaintedPixels;
+        QVERIFY2(meanDiff < 16.0, qPrintable(QString("mean alpha difference %1").arg(meanDiff)));
+    }
+}
+
+QTEST_MAIN(KisSprayBrushTest)
@@ -683,8 +683,15 @@ void KisToolTransform::updateSelectionPath()
     QPainterPath selectionOutline;
     KisSelectionSP selection = resources->activeSelection();
 
+    /**
+     * The outline job keeps only the tile-local outline of the pixel
+     * selections up to date, the polygonal one is calculated lazily
+     */
     if (selection && selection->outlineCacheValid()) {
         selectionOutline = selection->outlineCache();
+    } else if (selection && !selection->hasShapeSelection() &&
+               selection->outlineTileCacheValid()) {
+        selectionOutline = selection->outlineTileCache().outline();
     } else {
         selectionOutline.addRect(m_selectedPortionCache->exactBounds());
     }